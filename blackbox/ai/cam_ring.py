@@ -0,0 +1,62 @@
+# -*- coding: utf-8 -*-
+"""
+cam_ring.py
+- C 카메라 수신 엔진(libhardware/src/cam_ingest.c, cam_ring.c)이 쓰는 프레임 링의 파이썬 쪽 reader.
+- C가 memfd를 만들어 fork/exec 시 환경 변수(BLACKBOX_CAM_SHM_FD)로 넘겨줌.
+- 어느 슬롯을 읽을지는 C가 analyze 프레임에 실어 보냄 (카메라별 slot, seq, 수신 시각).
+  C는 그 슬롯을 다음 두 번의 analyze 동안 덮어쓰지 않으므로 잠금 없이 np.frombuffer 뷰로 바로 읽음.
+- 그보다 늦게 읽었을 때를 대비해, 다 읽은 뒤 seq가 그대로인지 still_valid()로 확인.
+"""
+import os
+import mmap
+import struct
+
+import numpy as np
+
+CAM_RING_MAGIC = 0x314D4143
+CAM_RING_VERSION = 1
+ENV_FD = "BLACKBOX_CAM_SHM_FD"
+
+# hardware.h / cam_ring.c 의 구조체와 바이트 단위로 같아야 함
+_HDR = struct.Struct("<IIIIIIII")      # magic, version, cams, slots, width, height, stride, slot_size
+_HDR_SIZE = 64
+_SLOT = struct.Struct("<QdII")         # seq, timestamp, width, height (머리 64바이트)
+_SLOT_SIZE = 64
+
+
+class CamRingReader:
+    def __init__(self, shm_fd: int):
+        self.mm = mmap.mmap(shm_fd, 0, prot=mmap.PROT_READ)  # 0 = memfd 전체, 읽기 전용
+        (magic, version, self.cams, self.slots, self.width, self.height,
+         self.stride, self.slot_size) = _HDR.unpack_from(self.mm, 0)
+        if magic != CAM_RING_MAGIC or version != CAM_RING_VERSION:
+            raise ValueError(f"cam_ring: bad header magic=0x{magic:08x} version={version}")
+        self._buf = np.frombuffer(self.mm, dtype=np.uint8)
+
+    @classmethod
+    def from_env(cls):
+        """C가 넘겨준 fd가 있으면 reader 생성, 없으면(단독 실행, C 수신 엔진 실패) None"""
+        shm_fd = os.environ.get(ENV_FD)
+        if shm_fd is None:
+            return None
+        return cls(int(shm_fd))
+
+    def _slot_off(self, cam, slot):
+        return _HDR_SIZE + self.slot_size * (cam * self.slots + slot)
+
+    def frame(self, cam, slot, seq):
+        """
+        (height, width, 3) BGR 뷰 (복사 없음, 읽기 전용). 슬롯이 없거나 이미 다른 프레임이면 None.
+        뷰를 다 쓴 뒤(복사/resize 후) still_valid()로 한 번 더 확인할 것.
+        """
+        if slot < 0 or slot >= self.slots or cam < 0 or cam >= self.cams:
+            return None
+        off = self._slot_off(cam, slot)
+        if _SLOT.unpack_from(self.mm, off)[0] != seq:
+            return None
+        start = off + _SLOT_SIZE
+        return self._buf[start:start + self.stride * self.height].reshape(self.height, self.width, 3)
+
+    def still_valid(self, cam, slot, seq):
+        """읽는 동안 C가 슬롯을 덮어쓰지 않았으면 True"""
+        return _SLOT.unpack_from(self.mm, self._slot_off(cam, slot))[0] == seq
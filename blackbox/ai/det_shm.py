@@ -0,0 +1,89 @@
+# -*- coding: utf-8 -*-
+"""
+det_shm.py
+- C 컨트롤러(libhardware/src/det_shm.c)와 공유하는 탐지 결과 링의 파이썬 쪽 writer.
+- C가 memfd와 eventfd를 만들어 fork/exec 시 환경 변수(BLACKBOX_DET_SHM_FD / BLACKBOX_DET_EVENT_FD)로 넘겨줌.
+- 슬롯에 DetectedObject 레코드를 고정 레이아웃으로 쓰고 write_seq를 올린 뒤 eventfd에 씀.
+  (eventfd 쓰기가 슬롯 쓰기 이후에 일어나야 C가 덜 쓰인 슬롯을 읽지 않음)
+- C가 붙잡고 있는 슬롯(read_seq)을 덮어쓸 차례면 결과를 버리고 dropped만 올림.
+"""
+import os
+import mmap
+import time
+import struct
+
+DET_SHM_MAGIC = 0x31544544
+DET_SHM_VERSION = 2
+DET_SHM_TRUNCATED = 0x01
+ENV_FD = "BLACKBOX_DET_SHM_FD"
+ENV_EVENT_FD = "BLACKBOX_DET_EVENT_FD"
+
+# hardware.h / det_shm.c 의 구조체와 바이트 단위로 같아야 함
+_HDR = struct.Struct("<IIIIII")        # magic, version, slots, max_objects, slot_size, reserved
+_OFF_WRITE_SEQ = 24
+_OFF_READ_SEQ = 32
+_OFF_DROPPED = 40
+_HDR_SIZE = 64
+_U64 = struct.Struct("<Q")
+_SLOT = struct.Struct("<QqIId")        # seq, token, count, flags, timestamp(촬영 시각) (32 bytes)
+_OBJ = struct.Struct("<B3xfffff")      # DetectedObject: label, x, y, ax, ay, score (24 bytes)
+_ONE = (1).to_bytes(8, "little")
+
+
+class DetShmWriter:
+    def __init__(self, shm_fd: int, event_fd: int):
+        self.event_fd = event_fd
+        self.mm = mmap.mmap(shm_fd, 0)  # 0 = memfd 전체
+        magic, version, self.slots, self.max_objects, self.slot_size, _ = _HDR.unpack_from(self.mm, 0)
+        if magic != DET_SHM_MAGIC or version != DET_SHM_VERSION:
+            raise ValueError(f"det_shm: bad header magic=0x{magic:08x} version={version}")
+
+    @classmethod
+    def from_env(cls):
+        """C가 넘겨준 fd가 있으면 writer 생성, 없으면(단독 실행 등) None"""
+        shm_fd = os.environ.get(ENV_FD)
+        event_fd = os.environ.get(ENV_EVENT_FD)
+        if shm_fd is None or event_fd is None:
+            return None
+        return cls(int(shm_fd), int(event_fd))
+
+    def publish(self, objs, token=None, capture_time=None) -> bool:
+        """
+        objs: [{"label", "x", "y", "ax", "ay", "score"}, ...]  score가 없으면 1  (_build_json_msg 결과와 같은 형태)
+        capture_time: 결과가 나온 카메라 프레임의 촬영 시각 (time.monotonic 기준). C가 이 시각의 차량 상태로 위험을 평가함.
+                      모르면 None → 지금 시각
+        return: True=기록함, False=C가 붙잡은 슬롯이라 버림
+        """
+        mm = self.mm
+        write_seq = _U64.unpack_from(mm, _OFF_WRITE_SEQ)[0]
+        read_seq = _U64.unpack_from(mm, _OFF_READ_SEQ)[0]
+        seq = write_seq + 1
+        if seq - read_seq >= self.slots:
+            dropped = _U64.unpack_from(mm, _OFF_DROPPED)[0]
+            _U64.pack_into(mm, _OFF_DROPPED, dropped + 1)
+            return False
+
+        flags = 0
+        if len(objs) > self.max_objects:
+            objs = objs[:self.max_objects]
+            flags |= DET_SHM_TRUNCATED
+
+        base = _HDR_SIZE + self.slot_size * (seq % self.slots)
+        body = b"".join(
+            _OBJ.pack(int(o.get("label", 0)) & 0xFF,
+                      float(o.get("x", 0.0)), float(o.get("y", 0.0)),
+                      float(o.get("ax", 0.0)), float(o.get("ay", 0.0)),
+                      float(o.get("score", 1.0)))
+            for o in objs)
+        off = base + _SLOT.size
+        mm[off:off + len(body)] = body
+        _SLOT.pack_into(mm, base, seq, -1 if token is None else int(token), len(objs), flags,
+                        time.monotonic() if capture_time is None else float(capture_time))
+
+        # 슬롯을 다 쓴 뒤에 번호 공개 → eventfd로 깨움
+        _U64.pack_into(mm, _OFF_WRITE_SEQ, seq)
+        try:
+            os.write(self.event_fd, _ONE)
+        except BlockingIOError:
+            pass  # 카운터가 가득 찬 경우: C는 어차피 깨어나 있음
+        return True
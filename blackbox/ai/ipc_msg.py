@@ -0,0 +1,204 @@
+# -*- coding: utf-8 -*-
+"""
+ipc_msg.py
+- C 컨트롤러(libhardware/src/ipc_msg.c)와 주고받는 길이 접두 바이너리 메시지.
+- 프레임 = 헤더 16바이트 <HBBIQ> (magic, version, type, payload 길이, 사이클 토큰) + payload.
+- analyze/draw payload는 고정 레이아웃이라 json.loads 없이 struct/numpy로 바로 풂.
+- 헤더가 맞지 않으면 한 바이트씩 밀며 다시 동기화.
+- 하트비트: C 감독이 활성/대기 프로세스가 살아 있는지(멈추지 않았는지) 판단하는 근거.
+"""
+import os
+import time
+import struct
+import threading
+import multiprocessing
+
+import numpy as np
+
+IPC_MAGIC = 0x4242
+IPC_VERSION = 1
+IPC_MAX_PAYLOAD = 1 << 20
+
+MSG_ANALYZE = 1
+MSG_DRAW = 2
+MSG_DONE = 3
+MSG_RESULT_JSON = 4
+MSG_HEARTBEAT = 5
+MSG_ACTIVATE = 6
+MSG_LAST = MSG_ACTIVATE
+
+# 하트비트 상태 (hardware.h IPC_BEAT_*)
+BEAT_STANDBY = 1    # 초기화를 마치고 ACTIVATE를 기다림
+BEAT_ACTIVE = 2     # analyze/draw 처리 중
+
+HEARTBEAT_SEC = 0.1     # hardware.h VISION_HEARTBEAT_SEC
+STALL_SEC = 0.4         # 명령 하나를 이보다 오래 붙잡으면 하트비트를 멈춤 (C는 VISION_HANG_SEC 뒤 교체)
+ENV_ROLE = "BLACKBOX_VISION_ROLE"
+
+_HDR = struct.Struct("<HBBIQ")              # 16 bytes
+_VEH = struct.Struct("<ddiiffBbBx4B")       # 40 bytes (hardware.h IPC_VEHICLE_SIZE)
+_DRAW = struct.Struct("<II")                # events, path count
+_FRAMESET = struct.Struct("<IIdd")          # 카메라 수, 유효 수, 기준 시각, 시각 차 (hardware.h IPC_FRAMESET_SIZE)
+_FRAME_REF = struct.Struct("<iIQd")         # 슬롯, pad, seq, 수신 시각 (hardware.h IPC_FRAME_REF_SIZE)
+
+# json_sender_proc 등 여러 프로세스가 같은 stdout 파이프에 쓰므로 프레임 단위로 직렬화
+# (fork 전에 만들어져야 자식 프로세스와 공유됨)
+_out_lock = multiprocessing.Lock()
+
+
+def _decode_vehicle(buf, off=0):
+    (gps_x, gps_y, speed, rpm, gear_ratio, degree,
+     brake, gear, throttle, t0, t1, t2, t3) = _VEH.unpack_from(buf, off)
+    return {
+        "gps": [gps_x, gps_y],
+        "steer": degree,
+        "speed": speed,
+        "rpm": rpm,
+        "brake_state": brake,
+        "gear_ratio": gear_ratio,
+        "gear_state": gear,
+        "throttle": throttle,
+        "tires": [t0, t1, t2, t3],
+    }
+
+
+def decode(msg_type, payload):
+    """
+    (명령, payload dict) 반환. 기존 JSON 프로토콜과 같은 키를 씀.
+    - analyze: 차량 스냅샷 (gps, steer 포함)
+      C 카메라 링을 쓰면 frames = [(slot, seq, 수신 시각), ...] 카메라 순서, frame_time/frame_spread도 추가
+    - draw: 차량 스냅샷 + value(이벤트 플래그) + path_x/path_y (numpy float64, 복사 없음)
+    """
+    if msg_type == MSG_ANALYZE and len(payload) >= _VEH.size:
+        out = _decode_vehicle(payload)
+        if len(payload) >= _VEH.size + _FRAMESET.size:
+            cams, _valid, ref_time, spread = _FRAMESET.unpack_from(payload, _VEH.size)
+            off = _VEH.size + _FRAMESET.size
+            if len(payload) >= off + _FRAME_REF.size * cams:
+                frames = []
+                for i in range(cams):
+                    slot, _, seq, ts = _FRAME_REF.unpack_from(payload, off + _FRAME_REF.size * i)
+                    frames.append((slot, seq, ts))
+                out["frames"] = frames
+                out["frame_time"] = ref_time
+                out["frame_spread"] = spread
+        return "analyze", out
+
+    if msg_type == MSG_DRAW and len(payload) >= _VEH.size + _DRAW.size:
+        out = _decode_vehicle(payload)
+        events, n = _DRAW.unpack_from(payload, _VEH.size)
+        off = _VEH.size + _DRAW.size
+        if len(payload) < off + 16 * n:
+            return None, None
+        out["value"] = events
+        out["path_x"] = np.frombuffer(payload, dtype="<f8", count=n, offset=off)
+        out["path_y"] = np.frombuffer(payload, dtype="<f8", count=n, offset=off + 8 * n)
+        return "draw", out
+
+    return None, None
+
+
+def _read_exact(stream, n):
+    buf = bytearray()
+    while len(buf) < n:
+        chunk = stream.read(n - len(buf))
+        if not chunk:
+            return None
+        buf += chunk
+    return bytes(buf)
+
+
+def read_message(stream):
+    """
+    바이너리 스트림(sys.stdin.buffer)에서 프레임 하나를 읽음.
+    return: (type, token, payload bytes), EOF면 None
+    """
+    hdr = _read_exact(stream, _HDR.size)
+    if hdr is None:
+        return None
+    while True:
+        magic, version, msg_type, length, token = _HDR.unpack(hdr)
+        if (magic == IPC_MAGIC and version == IPC_VERSION and
+                MSG_ANALYZE <= msg_type <= MSG_LAST and length <= IPC_MAX_PAYLOAD):
+            break
+        # 프레임 경계를 잃었음: 한 바이트 밀고 다시 확인
+        nxt = _read_exact(stream, 1)
+        if nxt is None:
+            return None
+        hdr = hdr[1:] + nxt
+
+    payload = _read_exact(stream, length) if length else b""
+    if payload is None:
+        return None
+    return msg_type, token, payload
+
+
+def _send(fd, msg_type, token, payload=b""):
+    frame = _HDR.pack(IPC_MAGIC, IPC_VERSION, msg_type, len(payload), int(token or 0)) + payload
+    with _out_lock:
+        view = memoryview(frame)
+        while view:
+            n = os.write(fd, view)
+            view = view[n:]
+
+
+def send_done(token, fd=1):
+    """draw 처리 완료 통지"""
+    _send(fd, MSG_DONE, token)
+
+
+def send_result_json(token, text, fd=1):
+    """공유 메모리 채널이 없을 때의 탐지 결과 (JSON 텍스트)"""
+    _send(fd, MSG_RESULT_JSON, token, text.encode("utf-8"))
+
+
+def send_heartbeat(state, fd=1):
+    """살아 있음 통지 (payload: 상태 u32)"""
+    _send(fd, MSG_HEARTBEAT, 0, struct.pack("<I", state))
+
+
+class Heartbeat:
+    """
+    HEARTBEAT_SEC마다 상태를 보내는 스레드.
+    - 메인 루프가 명령 하나를 STALL_SEC 넘게 처리 중이면 보내지 않음 → C가 멈춘 것으로 보고 대기 프로세스로 교체
+      (명령을 기다리며 stdin에서 막혀 있는 것은 정상이므로 idle()로 표시)
+    - C가 파이프를 닫으면 조용히 끝남
+    """
+    def __init__(self, state=BEAT_STANDBY, fd=1):
+        self.state = state
+        self.fd = fd
+        self._busy_since = None
+        self._th = threading.Thread(target=self._loop, daemon=True)
+
+    def start(self):
+        self._th.start()
+        return self
+
+    def busy(self):
+        self._busy_since = time.monotonic()
+
+    def idle(self):
+        self._busy_since = None
+
+    def _loop(self):
+        while True:
+            busy = self._busy_since
+            if busy is None or time.monotonic() - busy < STALL_SEC:
+                try:
+                    send_heartbeat(self.state, self.fd)
+                except OSError:
+                    return
+            time.sleep(HEARTBEAT_SEC)
+
+
+def wait_for_activate(stream):
+    """
+    대기 모드: ACTIVATE가 올 때까지 stdin을 읽으며 기다림 (그 전 메시지는 버림)
+    return: True=승격, False=EOF (C가 대기 프로세스를 정리함)
+    """
+    while True:
+        msg = read_message(stream)
+        if msg is None:
+            return False
+        if msg[0] == MSG_ACTIVATE:
+            return True
@@ -1,16 +1,26 @@
 # -*- coding: utf-8 -*-
 """
 vision_server.py (테스트 더미)
-- C에서 "analyze {json}\n" 요청이 오면 0.5초 뒤 임의의 객체 목록을 JSON으로 응답.
-- 표준 출력(stdout)으로만 결과를 보내고, 표준 에러(stderr)로는 로그를 남김.
-- 의존성: 표준 라이브러리만 사용.
+- C에서 analyze 프레임(ipc_msg)이 오면 0.5초 뒤 임의의 객체 목록으로 응답 (token 포함).
+- draw 프레임에는 done 프레임으로 응답.
+- C가 공유 메모리 채널(det_shm)을 넘겨주면 결과는 그쪽으로, 아니면 표준 출력(stdout)으로 보내고,
+  표준 에러(stderr)로는 로그를 남김.
+- C 감독이 대기 프로세스로 띄우면(BLACKBOX_VISION_ROLE=standby) ACTIVATE까지 기다리고, 하트비트를 보냄.
+- TEST_SERVER_HANG_AFTER=N: analyze N번 처리 후 멈춤 (하트비트 끊김 → C의 대기 프로세스 교체 시험용).
+- C가 카메라 프레임 링(cam_ring)을 넘겨주면 analyze에 실린 슬롯을 읽어 보고 유효한 카메라 수를 로그로 남김.
+- 의존성: 표준 라이브러리 + numpy (ipc_msg의 경로 배열 디코딩).
 """
+import os
 import sys
 import json
 import time
 import random
 import signal
 
+import det_shm
+import ipc_msg
+import cam_ring
+
 def log(msg: str):
     print(f"[Py LOG] {msg}", file=sys.stderr, flush=True)
 
@@ -20,6 +30,7 @@ def make_dummy_objects():
       - label: 0~4
       - x, y: 전방/좌우 위치 (m 가정) -> 대략 1~30m, -5~5m
       - ax, ay: 상대 가속/속도 같은 값 느낌으로 -2~2 범위 임의
+      - score: 탐지 신뢰도 0.3~1.0 (vision_server의 score_thresh 이상만 나감)
     """
     n = random.randint(1, 5)  # 0~5개
     objs = []
@@ -30,62 +41,82 @@ def make_dummy_objects():
             "y": round(random.uniform(-5.0, 5.0), 2),
             "ax": round(random.uniform(-2.0, 2.0), 2),
             "ay": round(random.uniform(-2.0, 2.0), 2),
+            "score": round(random.uniform(0.3, 1.0), 3),
         }
         objs.append(obj)
     return objs
 
-def parse_command(line: str):
-    """
-    'analyze {json}' 형태에서 payload만 파싱 (없어도 동작은 하게 관대하게 처리)
-    """
-    line = line.strip()
-    if not line:
-        return None, None
-    if not line.startswith("analyze"):
-        return None, None
-
-    payload = None
-    # 'analyze ' 뒤에 JSON이 붙어 있을 수도 있음
-    if len(line) > len("analyze"):
-        rest = line[len("analyze"):].strip()
-        if rest:
-            try:
-                payload = json.loads(rest)
-            except Exception:
-                payload = None
-    return "analyze", payload
-
 def main():
     random.seed()  # 필요하면 고정 seed로 재현성 확보 가능: random.seed(1234)
     log("Dummy vision server started. Waiting for commands on stdin...")
+    shm = det_shm.DetShmWriter.from_env()
+    ring = cam_ring.CamRingReader.from_env()
+    hang_after = int(os.environ.get("TEST_SERVER_HANG_AFTER", "0"))
+    analyzed = 0
 
     # Ctrl+C 핸들러(깨끗한 종료)
     signal.signal(signal.SIGINT, lambda *_: sys.exit(0))
 
+    standby = os.environ.get(ipc_msg.ENV_ROLE) == "standby"
+    heartbeat = ipc_msg.Heartbeat(ipc_msg.BEAT_STANDBY if standby else ipc_msg.BEAT_ACTIVE).start()
+    if standby:
+        log("standby ready, waiting for activate")
+        if not ipc_msg.wait_for_activate(sys.stdin.buffer):
+            log("stdin closed while standby. exiting.")
+            return
+        log("activated")
+        heartbeat.state = ipc_msg.BEAT_ACTIVE
+
     while True:
-        line = sys.stdin.readline()
-        if not line:
+        heartbeat.idle()
+        msg = ipc_msg.read_message(sys.stdin.buffer)
+        if msg is None:
             log("stdin closed. exiting.")
             break
+        heartbeat.busy()
 
-        cmd, payload = parse_command(line)
+        msg_type, token, raw = msg
+        cmd, payload = ipc_msg.decode(msg_type, raw)
+        if cmd == "draw":
+            ipc_msg.send_done(token)
+            continue
         if cmd != "analyze":
-            log(f"ignored line: {line.strip()}")
+            log(f"ignored message type={msg_type} token={token}")
             continue
 
         # (옵션) 넘겨받은 GPS/steer를 참고해 무언가 하려면 payload를 활용
         # payload 예: {"gps":[x,y], "steer": deg}
         log(f"received analyze request. payload={payload}")
+        if ring is not None and payload.get("frames"):
+            ok = 0
+            for i, (slot, seq, _) in enumerate(payload["frames"]):
+                view = ring.frame(i, slot, seq)
+                if view is not None and int(view[0, 0, 0]) >= 0 and ring.still_valid(i, slot, seq):
+                    ok += 1
+            log(f"camera frames: {ok}/{len(payload['frames'])} readable, spread={payload['frame_spread'] * 1e3:.1f}ms")
+        analyzed += 1
+        if hang_after and analyzed > hang_after:
+            log("simulating hang")
+            while True:
+                time.sleep(60)
 
-        # 요구사항: 0.5초 뒤에 임의 데이터 응답
+        # 요구사항: 0.5초 뒤에 임의 데이터 응답 (촬영 시각은 요청을 받은 시각)
+        capture_time = payload.get("frame_time") or time.monotonic()
         time.sleep(0.5)
 
+        objects = make_dummy_objects()
+        if shm is not None:
+            shm.publish(objects, token, capture_time)
+            log("dummy result written to shared memory.")
+            continue
+
         result = {
             "status": "ok",
-            "objects": make_dummy_objects(),
+            "objects": objects,
+            "token": token,
+            "capture_time": capture_time,
         }
-        print(json.dumps(result, ensure_ascii=False))
-        sys.stdout.flush()
+        ipc_msg.send_result_json(token, json.dumps(result, ensure_ascii=False))
         log("dummy result sent.")
 
 if __name__ == "__main__":
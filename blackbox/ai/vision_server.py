@@ -19,6 +19,8 @@ import core
 import demo_manager
 import async_api
 import recorder
+import ipc_msg
+import cam_ring
 
 
 # ---- Hailo ----
@@ -375,6 +377,10 @@ def _build_json_msg(dets_dict, meta=None, score_thresh=0.3):
 def json_sender_proc(det_q):
     import sys, json
     import pre_post_process as pp
+    import det_shm
+    # C가 공유 메모리 채널을 넘겨줬으면 JSON 대신 고정 레이아웃 레코드로 씀 (C는 파싱 없이 제자리에서 읽음)
+    shm = det_shm.DetShmWriter.from_env()
+    log(f"detection channel: {'shared memory' if shm else 'stdout JSON'}")
     while True:
         try:
             item = det_q.get(timeout=1)
@@ -391,47 +397,39 @@ def json_sender_proc(det_q):
         else:
             dets_dict = item if isinstance(item, dict) else {}
 
+        objs = _build_json_msg(dets_dict, meta=meta)
+        # analyze 요청의 사이클 토큰을 그대로 돌려줘야 C가 지난 사이클 결과를 걸러낼 수 있음
+        token = meta.get("token") if isinstance(meta, dict) else None
+        # 프레임 촬영 시각: C가 결과 도착 시각이 아니라 이 시각의 차량 상태로 위험을 평가함
+        capture_time = meta.get("capture_time") if isinstance(meta, dict) else None
+
+        if shm is not None:
+            if not shm.publish(objs, token, capture_time):
+                log(f"detection slot busy, dropped result token={token}")
+            continue
+
         obj = {
-            "objects": _build_json_msg(dets_dict, meta=meta),
+            "objects": objs,
         }
+        if token is not None:
+            obj["token"] = token
+        if capture_time is not None:
+            obj["capture_time"] = capture_time
 
-        print(json.dumps(obj, ensure_ascii=False))
-        sys.stdout.flush()
+        ipc_msg.send_result_json(token, json.dumps(obj, ensure_ascii=False))
 
-def parse_command(line: str):
+def read_command(stream):
     """
-    'analyze {json}' 형태에서 payload만 파싱 (없어도 동작은 하게 관대하게 처리)
+    C가 보낸 바이너리 프레임 하나를 (eof, 명령, 토큰, payload)로 풂 (ipc_msg 참고)
+    - token: C가 붙인 사이클 번호. draw 처리 후 done 프레임으로 돌려줌
+    - 알 수 없는 메시지면 명령이 None, EOF면 eof=True
     """
-    line = line.strip()
-    if not line:
-        return None, None
-
-    if line.startswith("analyze"):
-
-        payload = None
-        # 'analyze ' 뒤에 JSON이 붙어 있을 수도 있음
-        if len(line) > len("analyze"):
-            rest = line[len("analyze"):].strip()
-            if rest:
-                try:
-                    payload = json.loads(rest)
-                except Exception:
-                    payload = None
-        return "analyze", payload
-
-
-    elif line.startswith("draw"):
-
-        payload = None
-        # 'analyze ' 뒤에 JSON이 붙어 있을 수도 있음
-        if len(line) > len("draw"):
-            rest = line[len("draw"):].strip()
-            if rest:
-                try:
-                    payload = json.loads(rest)
-                except Exception:
-                    payload = None
-        return "draw", payload
+    msg = ipc_msg.read_message(stream)
+    if msg is None:
+        return True, None, None, None
+    msg_type, token, raw = msg
+    cmd, payload = ipc_msg.decode(msg_type, raw)
+    return False, cmd, token, payload
 
 
 
@@ -787,6 +785,24 @@ class GstVideoReceiver:
         if self.pipeline:
             self.pipeline.set_state(Gst.State.NULL)
 
+def _cam_frame(i, ring, refs, receivers):
+    """
+    카메라 i의 800x450 BGR 프레임 (새 배열), 없으면 None
+    - C 카메라 링이 있으면 analyze에 실려 온 슬롯(refs[i] = (slot, seq, 수신 시각))을 복사 없이 읽고 한 번만 복사
+    - 없으면(단독 실행 등) 자체 GstVideoReceiver의 latest_frame
+    """
+    if ring is not None:
+        if not refs or i >= len(refs):
+            return None
+        slot, seq, _ = refs[i]
+        view = ring.frame(i, slot, seq)
+        if view is None:
+            return None
+        img = view.copy() if view.shape[:2] == (SRC_H, SRC_W) else cv2.resize(view, (SRC_W, SRC_H))
+        return img if ring.still_valid(i, slot, seq) else None  # 읽는 중에 덮어써졌으면 버림
+    f = receivers[i].latest_frame
+    return None if f is None else cv2.resize(f, (SRC_W, SRC_H))
+
 det_for_json_q = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
 det_for_bev_q  = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
 
@@ -804,15 +820,29 @@ def fanout_proc(src_q, dst_qs):
             try: q.put_nowait(item)
             except: pass
 # =================== 메인 ===================
+def _open_vdevice(params, retry_sec=5.0):
+    """
+    대기 프로세스가 승격되는 시점에는 이전 활성 프로세스가 막 종료된 참이라 장치가 아직 풀리지 않았을 수 있음 → 잠깐 재시도
+    """
+    deadline = time.monotonic() + retry_sec
+    while True:
+        try:
+            return VDevice(params)
+        except Exception as e:
+            if time.monotonic() >= deadline:
+                raise
+            log(f"[HAILO] VDevice busy, retrying: {e}")
+            time.sleep(0.1)
+
+
 def main():
     log("Simple BEV server starting")
 
-    # GStreamer 시작
+    # C 감독이 띄운 대기 프로세스면 초기화만 해 두고 ACTIVATE를 기다림 (단독 실행이면 바로 활성)
+    standby = os.environ.get(ipc_msg.ENV_ROLE) == "standby"
+
+    # ---- 1) 미리 올려 둘 수 있는 것: 다른 프로세스와 나눠 쓰지 않는 CPU 쪽 자원 ----
     Gst.init(None)
-    receivers = [GstVideoReceiver(PORT0 + i) for i in range(NUM_CAMS)]
-    for r in receivers:
-        r.init_pipeline()
-        r.start()
 
     # Map 데이터 로드
     map_image = cv2.imread(MAP_PATH)
@@ -820,6 +850,68 @@ def main():
         log(f"Error: Map image not found at {MAP_PATH}")
         map_image = np.zeros((MAP_SIZE, MAP_SIZE, 3), np.uint8) # Fallback to black image
 
+    # C 카메라 수신 엔진의 프레임 링 (여러 프로세스가 같이 매핑해도 됨, 없으면 승격 후 직접 수신)
+    cam_frames = cam_ring.CamRingReader.from_env()
+
+    # HEF는 승격 후 장치에 올리지만, 파일 검증/페이지 캐시 적재는 미리
+    for hef_path in (BACKBONE_HEF, TRANSFORMER_HEF):
+        HEF(hef_path)
+
+    fps_calculator = fps_calc.FPSCalc(2)
+    queues = []
+    bb_tranformer_meta_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
+    transformer_pp_meta_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
+    bb_tranformer_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
+    transformer_pp_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
+    pp_3dnms_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
+
+    manager = multiprocessing.Manager()
+    demo_mng = demo_manager.DemoManager(manager)
+    threads = []
+    processes = []
+
+    # ONNX 후처리 세션은 CPU에서 돌므로 대기 중에 미리 로드
+    processes.append(multiprocessing.Process(target=pre_post_process.post_proc,
+                                                args=(transformer_pp_queue, transformer_pp_meta_queue,
+                                                pp_3dnms_queue, POSTPROC_ONNX, demo_mng)))
+    for p in processes: p.start()
+
+    # fanout
+    fan = multiprocessing.Process(target=fanout_proc, args=(pp_3dnms_queue, [det_for_json_q, det_for_bev_q]))
+    fan.daemon = False
+    fan.start()
+
+    # 각 소비자에는 자기 큐만 전달
+    json_out = multiprocessing.Process(target=json_sender_proc, args=(det_for_json_q,))
+    json_out.daemon = False
+    json_out.start()
+
+    # 하트비트는 초기화가 끝난 뒤부터: 첫 하트비트가 C에게 '준비 완료' 신호
+    heartbeat = ipc_msg.Heartbeat(ipc_msg.BEAT_STANDBY if standby else ipc_msg.BEAT_ACTIVE).start()
+
+    if standby:
+        log("standby ready, waiting for activate")
+        if not ipc_msg.wait_for_activate(sys.stdin.buffer):
+            log("stdin closed while standby. exiting.")
+            demo_mng.set_terminate()
+            for q in (pp_3dnms_queue, det_for_json_q, det_for_bev_q):
+                try: q.put_nowait(STOP)
+                except: pass
+            for p in processes: p.join(timeout=2)
+            return
+        log("activated")
+        heartbeat.state = ipc_msg.BEAT_ACTIVE
+
+    # ---- 2) 한 프로세스만 가질 수 있는 자원: 카메라 UDP 포트(C 링이 없을 때), Hailo 장치, 화면, 녹화 디렉터리 ----
+    # GStreamer 시작 (C가 카메라를 수신하면 링 슬롯을 읽으므로 수신기를 만들지 않음)
+    receivers = []
+    if cam_frames is None:
+        receivers = [GstVideoReceiver(PORT0 + i) for i in range(NUM_CAMS)]
+        for r in receivers:
+            r.init_pipeline()
+            r.start()
+    else:
+        log(f"[CAM] using C frame ring: {cam_frames.cams} cams {cam_frames.width}x{cam_frames.height}")
 
     # Recorder 초기화
     rec_events = recorder.TimeWindowEventRecorder6(
@@ -842,19 +934,7 @@ def main():
         fps_hint=5.0
     )
 
-
-    fps_calculator = fps_calc.FPSCalc(2)
-    queues = []
-    bb_tranformer_meta_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
-    transformer_pp_meta_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
-    bb_tranformer_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
-    transformer_pp_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
-    pp_3dnms_queue = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
-
-
     # Hailo VDevice
-    manager = multiprocessing.Manager()
-    demo_mng = demo_manager.DemoManager(manager)
     device_ids = Device.scan()
     if not device_ids:
         raise RuntimeError("Hailo 디바이스가 없습니다. (모듈/권한 확인: lsmod | grep -i hailo, /dev/hailo0 권한)")
@@ -864,14 +944,12 @@ def main():
     params = VDevice.create_params()
     if hasattr(params, "device_ids"):
         params.device_ids = device_ids
-    threads = []
-    processes = []
-    with VDevice(params) as target:
+    with _open_vdevice(params) as target:
         log("[HAILO] VDevice ready")
     params = VDevice.create_params()
     params.scheduling_algorithm = HailoSchedulingAlgorithm.ROUND_ROBIN
 
-    with VDevice(params) as target:
+    with _open_vdevice(params) as target:
 
         camera_in_q = multiprocessing.Queue(maxsize=MAX_QUEUE_SIZE)
 
@@ -881,26 +959,14 @@ def main():
         threads.append(threading.Thread(target=core.transformer, args=(target, TRANSFORMER_HEF, MATMUL_NPY, bb_tranformer_queue, bb_tranformer_meta_queue, transformer_pp_queue, transformer_pp_meta_queue,
                                                                        demo_mng,2.15,-5.3)))
 
-        processes.append(multiprocessing.Process(target=pre_post_process.post_proc,
-                                                    args=(transformer_pp_queue, transformer_pp_meta_queue,
-                                                    pp_3dnms_queue, POSTPROC_ONNX, demo_mng)))
-
         log("multi process starting...")
         for t in threads: t.start()
-        for p in processes: p.start()
-
-        # fanout
-        fan = multiprocessing.Process(target=fanout_proc, args=(pp_3dnms_queue, [det_for_json_q, det_for_bev_q]))
-        fan.daemon = False
-        fan.start()
 
-        # 각 소비자에는 자기 큐만 전달
-        json_out = multiprocessing.Process(target=json_sender_proc, args=(det_for_json_q,))
-        json_out.daemon = False
-        json_out.start()
-
-        token  = 0
         recodCMD = 0
+        # analyze와 draw는 같은 사이클 토큰으로 짝지음: C는 done을 기다리지 않고 다음 사이클을 보낼 수 있음
+        pending_analyze = {}          # token -> (analyze payload, 녹화용 원본 프레임)
+        last_analyze = (None, None)   # 짝이 없는 draw가 오면 가장 최근 analyze를 사용
+        PENDING_ANALYZE_MAX = 8
 
         log("init done")
         WIN = "Dashboard"
@@ -913,137 +979,142 @@ def main():
         try :
             while True:
 
-                line = sys.stdin.readline()
-                if not line:
+                heartbeat.idle()    # 명령 대기는 정상 (하트비트 계속)
+                eof, cmd, token, payload = read_command(sys.stdin.buffer)
+                if eof:
                     log("stdin closed. exiting.")
                     break
+                heartbeat.busy()    # 이 명령을 STALL_SEC 안에 끝내지 못하면 하트비트가 멈춤
 
-                cmd, anlalyze_paylaod = parse_command(line)
-                if cmd != "analyze":
-                    log(f"ignored line in analyze: {line.strip()}")
-                    continue
-
-                images_record = []
                 if cmd == "analyze":
-                    # 1) 6캠 프레임 수집
+                    # 1) 6캠 프레임 수집 (C 링이면 수신 시각이 맞춰진 세트)
+                    images_record = []
                     images_after_pre = []
+                    frame_refs = payload.get("frames")
+                    # 촬영 시각: C 링이면 세트의 기준 시각, 아니면 지금 수신기에서 꺼낸 시각
+                    meta = {"token": token, "capture_time": payload.get("frame_time") or time.monotonic()}
                     for i in range(NUM_CAMS):
-                        f = receivers[i].latest_frame
-                        if f is None:
-                            f = np.zeros((SRC_H, SRC_W, 3), np.uint8)
-                        img = cv2.resize(f, (800, 450))
-                        images_record.append(img.copy())
+                        img = _cam_frame(i, cam_frames, frame_refs, receivers)
+                        if img is None:
+                            img = np.zeros((SRC_H, SRC_W, 3), np.uint8)
+                        images_record.append(img)   # 새 배열이라 크롭 뷰와 공유해도 됨 (아무도 고치지 않음)
                         x, y, width, height = 0, 130, 800, 450
                         img = img[y:height, x:x + width]
                         images_after_pre.append(img)
 
                     frames_np = np.asarray(images_after_pre, dtype=np.uint8)
-                    token += 1
 
                     try:
-                        camera_in_q.put((frames_np, {"token": token}), block=False)
+                        camera_in_q.put((frames_np, meta), block=False)
                     except _queue.Full:
                         _ = camera_in_q.get()
-                        camera_in_q.put((frames_np, {"token": token}), block=False)
+                        camera_in_q.put((frames_np, meta), block=False)
                         log("[Main] WARN: camera_in_q full, dropping frame")
 
-                    log("wating draw cmd...")
-                    line = sys.stdin.readline()
-                    cmd, payload = parse_command(line)
-
-                    if cmd != "draw":
-                        log(f"ignored line in draw: {line.strip()}")
-                        print("done", flush=True)
-                        continue
-
-                    if cmd == "draw":
-                        cam_order = [2, 0, 1, 5, 3, 4]
-
-                        # 🌟🌟🌟 수정된 Mosaic 생성 파라미터 🌟🌟🌟
-                        mosaic = make_mosaic_grid(
-                            images_record, # 크롭 전 원본(800x450) 사용
-                            rows=3, cols=2,
-                            tile_wh=(190, 107), # 400px 패널에 맞춘 크기
-                            pad=6,
-                            order=cam_order,
-                            draw_index=True
-                        )
-
-                        if DEBUGMODE:
-                            # 🌟 수정된 창 이름
-                            cv2.imshow("Cams 3x2", mosaic)
-                            cv2.waitKey(1)
-
-                        bev_480, payload_draw = render_bev_frame(
-                            map_image, det_for_bev_q, (payload, anlalyze_paylaod),
-                            xy_range=XY_RANGE_M, size=480
-                        )
-                        
-                        _, pos = draw_bev_boxes_on(bev_480, det_for_bev_q.get() if not det_for_bev_q.empty() else None)
-                        
-                        img_top    = images_record[0] if len(images_record) > pos[0] else None
-                        img_bottom = images_record[3] if len(images_record) > pos[1] else None
-
-
-                        H, W = bev_480.shape[:2]
-                        txt1 = f"tires {payload['tires'][0]:.1f}, {payload['tires'][1]:.1f}, {payload['tires'][2]:.1f}, {payload['tires'][3]:.1f} event : {payload['value']}"
-                        txt2 = f"speed : {payload['speed']:.1f} km/h brake :{payload_draw['brake_state']}%  throttle : {payload_draw['throttle']} % rpm : {payload_draw['rpm']}"
-
-                        path_x = payload.get('path_x', [])
-                        path_y = payload.get('path_y', [])
-
-                        n = min(len(path_x), len(path_y))
-                        scale = (W/2)*XY_RANGE_M
-                        for i in range(n - 1):
-                            log(f"pixel {i}: ({path_x[i]}, {path_y[i]})")
-                            x1 = int(240-path_x[i])
-                            y1 = int(path_y[i]+ 240)
-                            x2 = int(240-path_x[i+1])
-                            y2 = int(path_y[i+1]+240)
-                            cv2.line(bev_480, (y1, x1), (y2, x2), (0, 0, 255), 3)
-
-
-                        # Display Dashboard에 텍스트 그리기
-                        cv2.putText(bev_480, txt1, (20, H - 50), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0,0,0), 2, cv2.LINE_AA)
-                        cv2.putText(bev_480, txt1, (20, H - 50), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (255,255,255), 1, cv2.LINE_AA)
-                        cv2.putText(bev_480, txt2, (20, H - 30), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0,0,0), 2, cv2.LINE_AA)
-                        cv2.putText(bev_480, txt2, (20, H - 30), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (255,255,255), 1, cv2.LINE_AA)
-                        
-                        # Dashboard for display
-                        dashboard_display = compose_dashboard_800x450_two_imgs_left_bev_right(img_top, img_bottom, bev_480)
-                        
-                        cv2.imshow(WIN, dashboard_display)
-
-                        # Dashboard for recording
-                        record_dashboard = compose_dashboard_800x450_mosaic_left_bev_right(mosaic, bev_480)
-                        now_ts = time.time()
-                        # 🌟 cam_id 추가
-                        rec_events.push_single(record_dashboard, cam_id=0)
-                        rec_always.push_batch([record_dashboard], ts=now_ts)
-
-                        key = cv2.waitKey(1) & 0xFF
-                        if key in (27, ord('q')):
-                            break
-                        elif key == ord('f'):
-                            fs = cv2.getWindowProperty(WIN, cv2.WND_PROP_FULLSCREEN)
-                            cv2.setWindowProperty(WIN, cv2.WND_PROP_FULLSCREEN, cv2.WINDOW_NORMAL if fs == 1.0 else cv2.WINDOW_FULLSCREEN)
-
-                        event = payload['value']
-                        SPECIAL_LINE_PATH = "./special_event_log.txt"
-                        ts = time.strftime("%Y-%m-%d %H:%M:%S")
-                        with open(SPECIAL_LINE_PATH, "a", encoding="utf-8") as f:
-                            f.write(f"[{ts}] : event value : {event}\n")
-                        if ((event & 0x7F) != 0x00):
-                            log(f"event : {event}")
-                            trigger_str = recoder_event(event)
-                            rec_events.trigger(str(trigger_str))
-                            with open(SPECIAL_LINE_PATH, "a", encoding="utf-8") as f:
-                                f.write(f"[{ts}] {trigger_str} : event value : {event}\n")
-                        log("end draw ...")
-
-
-                print("done", flush=True)
-            print("exit", flush=True)
+                    # draw가 올 때까지 보관 (오래된 것부터 정리)
+                    last_analyze = (payload, images_record)
+                    pending_analyze[token] = last_analyze
+                    while len(pending_analyze) > PENDING_ANALYZE_MAX:
+                        pending_analyze.pop(next(iter(pending_analyze)))
+                    continue
+
+                if cmd != "draw":
+                    log(f"ignored message: token={token}")
+                    continue
+
+                anlalyze_paylaod, images_record = pending_analyze.pop(token, last_analyze)
+                if payload is None or anlalyze_paylaod is None or images_record is None:
+                    log(f"draw {token}: missing payload or analyze, skip render")
+                    ipc_msg.send_done(token)
+                    continue
+
+                cam_order = [2, 0, 1, 5, 3, 4]
+
+                # 🌟🌟🌟 수정된 Mosaic 생성 파라미터 🌟🌟🌟
+                mosaic = make_mosaic_grid(
+                    images_record, # 크롭 전 원본(800x450) 사용
+                    rows=3, cols=2,
+                    tile_wh=(190, 107), # 400px 패널에 맞춘 크기
+                    pad=6,
+                    order=cam_order,
+                    draw_index=True
+                )
+
+                if DEBUGMODE:
+                    # 🌟 수정된 창 이름
+                    cv2.imshow("Cams 3x2", mosaic)
+                    cv2.waitKey(1)
+
+                bev_480, payload_draw = render_bev_frame(
+                    map_image, det_for_bev_q, (payload, anlalyze_paylaod),
+                    xy_range=XY_RANGE_M, size=480
+                )
+
+                _, pos = draw_bev_boxes_on(bev_480, det_for_bev_q.get() if not det_for_bev_q.empty() else None)
+
+                img_top    = images_record[0] if len(images_record) > pos[0] else None
+                img_bottom = images_record[3] if len(images_record) > pos[1] else None
+
+
+                H, W = bev_480.shape[:2]
+                txt1 = f"tires {payload['tires'][0]:.1f}, {payload['tires'][1]:.1f}, {payload['tires'][2]:.1f}, {payload['tires'][3]:.1f} event : {payload['value']}"
+                txt2 = f"speed : {payload['speed']:.1f} km/h brake :{payload_draw['brake_state']}%  throttle : {payload_draw['throttle']} % rpm : {payload_draw['rpm']}"
+
+                path_x = payload.get('path_x', [])
+                path_y = payload.get('path_y', [])
+
+                n = min(len(path_x), len(path_y))
+                scale = (W/2)*XY_RANGE_M
+                for i in range(n - 1):
+                    log(f"pixel {i}: ({path_x[i]}, {path_y[i]})")
+                    x1 = int(240-path_x[i])
+                    y1 = int(path_y[i]+ 240)
+                    x2 = int(240-path_x[i+1])
+                    y2 = int(path_y[i+1]+240)
+                    cv2.line(bev_480, (y1, x1), (y2, x2), (0, 0, 255), 3)
+
+
+                # Display Dashboard에 텍스트 그리기
+                cv2.putText(bev_480, txt1, (20, H - 50), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0,0,0), 2, cv2.LINE_AA)
+                cv2.putText(bev_480, txt1, (20, H - 50), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (255,255,255), 1, cv2.LINE_AA)
+                cv2.putText(bev_480, txt2, (20, H - 30), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0,0,0), 2, cv2.LINE_AA)
+                cv2.putText(bev_480, txt2, (20, H - 30), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (255,255,255), 1, cv2.LINE_AA)
+
+                # Dashboard for display
+                dashboard_display = compose_dashboard_800x450_two_imgs_left_bev_right(img_top, img_bottom, bev_480)
+
+                cv2.imshow(WIN, dashboard_display)
+
+                # Dashboard for recording
+                record_dashboard = compose_dashboard_800x450_mosaic_left_bev_right(mosaic, bev_480)
+                now_ts = time.time()
+                # 🌟 cam_id 추가
+                rec_events.push_single(record_dashboard, cam_id=0)
+                rec_always.push_batch([record_dashboard], ts=now_ts)
+
+                key = cv2.waitKey(1) & 0xFF
+                if key in (27, ord('q')):
+                    break
+                elif key == ord('f'):
+                    fs = cv2.getWindowProperty(WIN, cv2.WND_PROP_FULLSCREEN)
+                    cv2.setWindowProperty(WIN, cv2.WND_PROP_FULLSCREEN, cv2.WINDOW_NORMAL if fs == 1.0 else cv2.WINDOW_FULLSCREEN)
+
+                event = payload['value']
+                SPECIAL_LINE_PATH = "./special_event_log.txt"
+                ts = time.strftime("%Y-%m-%d %H:%M:%S")
+                with open(SPECIAL_LINE_PATH, "a", encoding="utf-8") as f:
+                    f.write(f"[{ts}] : event value : {event}\n")
+                if ((event & 0x7F) != 0x00):
+                    log(f"event : {event}")
+                    trigger_str = recoder_event(event)
+                    rec_events.trigger(str(trigger_str))
+                    with open(SPECIAL_LINE_PATH, "a", encoding="utf-8") as f:
+                        f.write(f"[{ts}] {trigger_str} : event value : {event}\n")
+                log("end draw ...")
+
+                # 이 사이클 완료 통지: C는 토큰으로 짝을 맞춤 (순서가 바뀌어도 됨)
+                ipc_msg.send_done(token)
+            log("exit")
         except KeyboardInterrupt:
             demo_mng.set_terminate()
 
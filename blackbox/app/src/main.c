@@ -4,11 +4,21 @@
     * @details
     * 이 프로그램은 아래의 동작들을 수행함
     * 1.  **프로세스 모델**: C가 부모(지휘자), Python이 자식(AI 분석)으로 동작.
+    * 모델을 미리 올려 둔 대기 Python 프로세스를 하나 더 두고, 활성 프로세스가 죽거나(EOF) 하트비트가 끊기면(멈춤)
+    * 파이프를 대기 프로세스로 바로 바꾼 뒤 새 대기 프로세스를 뒤에서 띄움.
+    * 카메라 6대의 RTP/H.264 수신/디코드는 C(cam_ingest)가 맡아 공유 메모리 링에 쓰고, analyze마다 수신 시각이 맞는
+    * 프레임 세트를 골라 슬롯 번호만 넘김 → 파이썬은 복사 없이 읽고, 파이썬 프로세스가 바뀌어도 카메라 수신은 끊기지 않음.
     * 2.  **프로세스 간 통신(IPC)**: 두 개의 파이프(pipe)를 사용해 안정적인 양방향 통신 채널을 구축.
     * 3.  **동적 경로 탐색**: C 실행 파일의 위치를 기준으로 Python 스크립트의 절대 경로를 동적으로 계산하여,
     * 어디서 프로그램을 실행하든 경로 문제 없이 Python을 실행 가능.
     * 4.  **비동기 I/O 처리**: 'select()' 시스템 콜을 사용하여 여러 입력 소스(Python의 응답, CAN 메시지 등)를
     * 하나의 스레드에서 효율적으로 동시에 감시하고 처리. ('AI 분석 대기 중 CAN 통신' 요구사항 해결)
+    * CAN 요청/수신/해석은 전용 수집 스레드(can_acq)가 맡고, 최신 스냅샷을 락프리 링 + eventfd로 넘겨줌.
+    * 따라서 파이썬 대기나 저장 처리 중에도 CAN 수신이 멈추지 않음.
+    * 메인 루프는 epoll로 돌며, 제어 주기(CONTROL_RATE_HZ)와 AI 요청 주기(AI_REQUEST_RATE_HZ)는 timerfd,
+    * 종료 신호는 signalfd로 받음. → 사이클 타이밍이 select() 타임아웃이 아니라 타이머로 결정됨.
+    * 카메라 녹화는 SIGUSR1로 켜고 끔 (libhardware 녹화 엔진, appsrc 모드면 녹화 타이머마다 camera_get_frame → storage_write_frame).
+    * 대시보드(탐지 박스/HUD 합성) 녹화는 아직 파이썬 vision_server.py의 OpenCV 녹화기가 함.
     * 5.  **상태 관리(State Management)**: 비동기적으로 도착하는 데이터들(AI 결과, CAN 메시지)을
     * 상태 변수에 저장했다가, 모든 데이터가 준비되었을 때만 최종 제어 로직을 수행.
     *
@@ -18,10 +28,12 @@
     *
     * @run
     * ./run.sh
-    * (종료하려면 터미널에서 Ctrl+C를 누르세요.)
+    * ./blackbox_main [CAN 인터페이스(기본 can0)] [제어 주기 Hz(기본 CONTROL_RATE_HZ)] [로그 파일(기본 stderr)]
+    * (종료하려면 터미널에서 Ctrl+C를 누르세요. 카메라 녹화 시작/정지: kill -USR1 <PID>)
     */
 
     // --- 1. 필수 헤더 파일 포함 ---
+    #define _GNU_SOURCE     // pipe2(O_CLOEXEC)
     #include <stdio.h>      // 표준 입출력 함수 (printf, perror, FILE*, fprintf, fflush, fgets)
     #include <stdlib.h>     // 표준 라이브러리 함수 (exit, malloc, free)
     #include <unistd.h>     // 유닉스 표준(POSIX) API (pipe, fork, dup2, execvp, read, write, sleep, close, readlink)
@@ -31,29 +43,83 @@
     #include <fcntl.h>      // fcntl() 함수 사용 (파일 디스크립터 속성 제어)
     #include <sys/time.h>   // timeval 구조체 사용 (select 타임아웃)
     #include <sys/select.h> // select() 원형
+    #include <sys/epoll.h>  // epoll: 메인 이벤트 루프
+    #include <sys/timerfd.h>// timerfd: 제어/AI 요청 주기 타이머
+    #include <sys/signalfd.h>// signalfd: SIGINT/SIGTERM을 이벤트로 받아 정상 종료
+    #include <stdint.h>
     #include <signal.h>
     #include <time.h>
     #include <math.h>
-    #include "cJSON.h"      // cJSON 라이브러리 사용을 위한 헤더
     #include "hardware.h"
 
 
     // --- 2. 전역 변수 ---
-    static FILE* stream_to_python = NULL;
-    static FILE* stream_from_python = NULL;
-    static int pipe_from_python_fd = -1;
-
-    static DetectedObject *g_ai_objs = NULL;
+    // 위험 평가에 쓰는 최신 AI 결과: 공유 메모리 슬롯을 직접 가리키거나(det_shm), JSON 경로면 풀(g_ai_pools) 안을 가리킴
+    static const DetectedObject *g_ai_objs = NULL;
     static int g_ai_count = 0;
-
-    // ===== 파이썬 프로세스 재시작을 위한 전역 상태 =====
-    static pid_t g_py_pid = -1;                 // ← 실행 중인 파이썬 자식 프로세스의 PID 저장
-    static int c_to_python_pipe[2] = {-1, -1};  // ← C → Python 파이프 (부모가 [1]에 씀, 자식이 [0]에서 읽음)
-    static int python_to_c_pipe[2] = {-1, -1};  // ← Python → C 파이프 (자식이 [1]에 씀, 부모가 [0]에서 읽음)
-
-    static int  start_python_process(void);     // ← 파이썬 자식 프로세스를 시작(생성)하는 헬퍼 함수 선언
-    static void stop_python_process(void);      // ← 파이썬 자식 프로세스를 종료(정리)하는 헬퍼 함수 선언
-
+    static int g_ai_from_pool = 0;
+    // JSON 결과용 풀 두 개: 하나는 g_ai_objs가 가리키고, 다른 하나(g_ai_pool_spare)에 다음 결과를 파싱
+    // (지난 사이클 결과로 판명돼 버려도 현재 결과가 덮이지 않음)
+    static DetPool g_ai_pools[2];
+    static int g_ai_pool_spare = 0;
+    // g_ai_objs가 나온 카메라 프레임의 촬영 시각: 위험 평가는 결과 도착 시각이 아니라 이 시각의 차량 상태로 함
+    static double g_ai_capture_time = 0.0;
+    static SignalHistory g_sig_hist;    // CAN 신호 이력 (촬영 시각의 차량 상태 보간용)
+    // 사이클을 넘는 객체 추적: 위험 평가는 g_ai_objs 대신 확정 트랙(g_trk.out, 필터 속도)을 봄
+    static Tracker g_trk;
+    static int g_trk_pending = 0;       // 아직 트래커에 넣지 않은 새 AI 결과가 있음
+    static BevGrid g_bev;               // 확정 트랙의 BEV 격자 색인 (트랙이 바뀔 때마다 다시 만듦, 거리/경로 통로 질의용)
+
+    // ===== analyze/draw 사이클 토큰과 in-flight 창 =====
+    // draw를 보낸 뒤 done을 기다리지 않고 다음 사이클로 넘어감. done <token>은 순서가 바뀌어 와도 토큰으로 짝지음.
+    typedef struct {
+        unsigned long token;
+        double sent_at;
+    } PyInflight;
+
+    static unsigned long g_cycle_token = 0;             // 마지막으로 발급한 사이클 토큰
+    static unsigned long g_ai_token = 0;                // 결과를 기다리는 analyze 요청의 토큰
+    static PyInflight g_py_inflight[PY_INFLIGHT_MAX];   // draw를 보냈지만 done을 못 받은 사이클
+    static int g_py_inflight_count = 0;
+
+    // ===== 비전(파이썬) 프로세스 감독: 슬롯 2개 = 활성 1개 + 미리 초기화해 둔 대기 1개 =====
+    #define VISION_SLOTS 2
+
+    typedef enum {
+        VIS_EMPTY = 0,      // 프로세스 없음
+        VIS_STARTING,       // 띄웠지만 아직 모델/맵 로딩 중 (첫 하트비트 전)
+        VIS_STANDBY,        // 초기화 완료, ACTIVATE 대기
+        VIS_ACTIVE          // analyze/draw 처리 중
+    } VisionState;
+
+    typedef struct {
+        pid_t pid;              // 자식 PID (= 프로세스 그룹 ID)
+        int to_fd;              // C → Py (자식 stdin)
+        int from_fd;            // Py → C (자식 stdout, 논블로킹, epoll에 EV_VISION0 + 슬롯으로 등록)
+        IpcReader reader;       // 바이너리 프레임 재조립 버퍼
+        VisionState state;
+        double spawned_at;
+        double last_beat;       // 마지막 하트비트 수신 시각
+    } VisionProc;
+
+    static VisionProc g_vis[VISION_SLOTS];
+    static int g_vis_active = -1;           // 활성 슬롯 (-1이면 analyze/draw를 보내지 않음)
+    static double g_vis_respawn_at = 0.0;   // 이 시각 이후에 빈 슬롯을 다시 채움
+    static unsigned int g_vis_failovers = 0;
+
+    // SIGKILL만 보내고 아직 수거하지 않은 비전 프로세스 (vision_supervise가 이 PID만 waitpid)
+    #define VISION_REAP_MAX 8
+    static pid_t g_vis_reap[VISION_REAP_MAX];
+    static int g_vis_reap_count = 0;
+
+
+    //AI 분석 요청에 반드시 필요한 PID (스케줄러 우선순위가 가장 높음)
+    static const CANRequest pids_ai_required[] ={
+        {PID_GPS_XDATA, GPS_XDATA_FLAG},
+        {PID_GPS_YDATA, GPS_YDATA_FLAG},
+        {PID_STEERING_DATA, STEERING_DATA_FLAG}
+    };
+    static const unsigned char num_pids_ai_required = sizeof(pids_ai_required) / sizeof(pids_ai_required[0]);
 
     //요청할 PID와 완료 조건을 짝지어 목록으로 정의함
     static const CANRequest pids_to_request[] ={
@@ -65,11 +131,32 @@
     };
     //확인할 PID의 갯수
     static const unsigned char num_pids_to_request = sizeof(pids_to_request) / sizeof(pids_to_request[0]);
-    //다음에 확인할 PID의 인덱스를 저장할 변수
-    static unsigned char next_pid_index = 0;
 
-    //가속도 측정 구조체
-    static SpeedMonitor g_spmon = {0};
+    //CAN 수집 스레드 통계 출력용 (스케줄러 본체는 수집 스레드가 소유)
+    static CANScheduler g_can_stats;
+
+    //BCM 모드(CAN_POLL_MODE_BCM)에서 커널에 등록할 PID별 요청 주기
+    static const CANBcmPoll bcm_polls[] = {
+        {PID_GPS_XDATA,     100},
+        {PID_GPS_YDATA,     100},
+        {PID_STEERING_DATA, 100},
+        {PID_VEHICLE_SPEED, 100},
+        {PID_ENGINE_SPEED,  100},
+        {PID_BRAKE_DATA,    100},
+        {PID_THROTTLE_DATA, 100},
+        {PID_GEAR_STATE,    500},
+        {PID_TIRE_DATA,     1000}  // 타이어 공기압은 천천히 변하므로 1초 주기
+    };
+    static const int num_bcm_polls = sizeof(bcm_polls) / sizeof(bcm_polls[0]);
+
+    //가속도 측정 구조체 (회귀 가감속/저크, GPS·속도 융합, 타이어 공기압 추세)
+    static KinEstimator g_kin;
+
+    //충돌 검사용 객체 배치 (SoA, 결과가 올 때마다 다시 채움)
+    static CollBatch g_coll;
+
+    //차의 예상 경로 (속도/조향각이 바뀔 때만 다시 계산)
+    static PathCache g_path;
 
     /**
     * @brief 현재 차량 상태를 기반으로 미래 경로(x, y)를 계산하여 배열에 채움
@@ -126,147 +213,402 @@
 
     //     }
 
-    static int check_collision_risk(const DetectedObject *ai_objs, int ai_count,
-                                 const double *path_x, const double *path_y, int path_count) {
-    
-    if (!ai_objs || ai_count <= 0 || !path_x || !path_y || path_count <= 0) {
-        return 0; // 유효한 데이터가 없으면 위험 없음
-    }
-
-    const double R_obj = 1.0; // 객체의 충돌 반경 (1.0 미터)
-    // hardware.h에 정의된 차량 크기 사용
-    const double L_half = VHEICLE_LENGTH / 2.0;
-    const double W_half = VHEICLE_WIDTH / 2.0;
-
-    for (int i = 0; i < ai_count; ++i) {
-        const DetectedObject *o = &ai_objs[i];
-        
-        // 1. 객체의 초기 위치 및 속도 (ax, ay를 Vx, Vy로 사용)
-        double initial_x = (double)o->x;
-        double initial_y = (double)o->y;
-        double speed_x = (double)o->ax;
-        double speed_y = (double)o->ay;
-        
-        // 2. 예측 시간 단계별 충돌 검사
-        for (int t_idx = 0; t_idx < path_count; t_idx++) {
-            
-            // 경과 시간 (t)
-            double t_sec = (t_idx + 1) * PREDICTION_DT; 
-            
-            // 2-1. 차량의 예측 궤적 위치 (차량 중심)
-            double path_x_center = path_x[t_idx];
-            double path_y_center = path_y[t_idx];
-            
-            // 2-2. 객체의 미래 예측 위치 (등속 직선 운동)
-            double obj_x = initial_x + speed_x * t_sec;
-            double obj_y = initial_y + speed_y * t_sec;
-            
-            // 3. 충돌 검사 로직 (AABB vs. Circle)
+    /**
+    * @brief AI 객체들이 차량의 예상 궤적(자전거 모델 원호)과 충돌하는지 검사
+    *        (경로 샘플 사이를 건너뛰지 않도록 객체마다 연속 시간 첫 접촉 시각을 구함, 예측 구간은 속도에 비례)
+    * @param ids 객체별 트랙 ID (경고 로그용, 없으면 NULL)
+    * @return 예측 구간 안에 차량 박스와 접촉하는 객체 수 (0이면 위험 없음)
+    * @note 객체마다 첫 접촉 시각은 g_coll.t_contact에 남음 (ai_objs와 같은 순서)
+    */
+    static int check_collision_risk(const DetectedObject *ai_objs, const unsigned int *ids, int ai_count, const TtcEgo *ego) {
+        if (!ai_objs || ai_count <= 0 || !ego) {
+            coll_batch_load(&g_coll, NULL, 0); // 지난 객체로 확률을 구하지 않게 배치를 비움
+            return 0; // 유효한 데이터가 없으면 위험 없음
+        }
+        if (coll_batch_load(&g_coll, ai_objs, ai_count) < 0) {
+            return 0;
+        }
+        // 차량 원호 통로 안의 객체만 풂 (격자가 이 객체 배열로 만든 것이 아니면 모두 풂)
+        int hits = coll_batch_ttc_grid(&g_coll, ego, (g_bev.objs == ai_objs) ? &g_bev : NULL);
+        if (hits <= 0) {
+            return 0;
+        }
 
-            // 객체 중심(obj_x, obj_y)이 차량 AABB에 가장 가까운 지점 찾기
-            // AABB 범위: X: [path_x_center - L_half, path_x_center + L_half]
-            //            Y: [path_y_center - W_half, path_y_center + W_half]
-            
-            // X축에서 가장 가까운 AABB 경계 지점
-            double closest_x = fmax(path_x_center - L_half, fmin(obj_x, path_x_center + L_half));
-            // Y축에서 가장 가까운 AABB 경계 지점
-            double closest_y = fmax(path_y_center - W_half, fmin(obj_y, path_y_center + W_half));
-            
-            // 객체 중심과 AABB 경계 지점 간의 거리 제곱 계산
-            double dx = obj_x - closest_x;
-            double dy = obj_y - closest_y;
-            double distance_sq = dx*dx + dy*dy;
-            
-            // 충돌 여부 판단: 최단 거리 <= 객체 반경 (R_obj)
-            if (distance_sq <= R_obj * R_obj) {
-                printf("[CRITICAL] !!! 미래 충돌 예측: T+%.1fs에 객체 %u와 충돌 (객체 Pos: %.2f, %.2f)!!!\n",
-                       t_sec, o->label, obj_x, obj_y);
-                return 1; // 충돌 위험 감지
+        // 가장 먼저 접촉하는 객체를 경고
+        int first = -1;
+        for (int i = 0; i < ai_count; ++i) {
+            if (g_coll.t_contact[i] >= 0.0f && (first < 0 || g_coll.t_contact[i] < g_coll.t_contact[first])) {
+                first = i;
             }
         }
+        const DetectedObject *o = &ai_objs[first];
+        double t_sec = g_coll.t_contact[first];
+        log_warn("[CRITICAL] !!! 미래 충돌 예측: T+%.1fs에 객체 %u(ID %u)와 충돌 (객체 Pos: %.2f, %.2f), 위험 객체 %d개 !!!\n",
+               t_sec, o->label, ids ? ids[first] : 0u, o->x + o->ax * t_sec, o->y + o->ay * t_sec, hits);
+        return hits;
     }
-    return 0; // 충돌 위험 없음
-}
 
     /**
     * @brief 현재 차량 상태를 기반으로 미래 경로(x, y)를 계산 (입력: -30~30 바퀴 각도)
+    * @details 곡률 표 + 경로 캐시(path_predict)로 계산하며, 속도/조향각이 지난번과 같으면 이전 경로를 그대로 씀.
+    *          결과는 g_path.x / g_path.y (POS_COUNT개, PREDICTION_DT 간격)
     * @param current_speed_kph 현재 속도 (km/h)
     * @param current_steer_deg 현재 바퀴 조향각 (-30.0 ~ 30.0)
-    * @param out_x 결과가 저장될 X좌표 배열
-    * @param out_y 결과가 저장될 Y좌표 배열
     */
-    void calc_future_path(int current_speed_kph, float current_steer_deg,
-                        double out_x[POS_COUNT], double out_y[POS_COUNT]) {
+    static void calc_future_path(int current_speed_kph, float current_steer_deg) {
+        path_predict(&g_path, current_speed_kph, current_steer_deg);
+    }
         
-        // 1. 배열 초기화
-        memset(out_x, 0, sizeof(double) * POS_COUNT);
-        memset(out_y, 0, sizeof(double) * POS_COUNT);
+    // }
 
-        // 2. 물리량 변환
-        double v_mps = (double)current_speed_kph * KPH_TO_MPS;
-        double steer_angle = (double)current_steer_deg;
+    /* =======================================================================================
+    * ===== [ADD] 헬퍼: 파이썬 analyze 요청 전송 (GPS/STEER 포함 차량 스냅샷) =====================
+    *  - 목적: 필수 데이터(GPS, 스티어링)가 준비된 시점에 프레임 하나로 명령을 보냄.
+    *  - 형식: IPC_MSG_ANALYZE 바이너리 프레임 (token: 사이클 번호, 결과와 done에 그대로 돌아옴)
+    *  - 텍스트 포맷팅 없이 고정 레이아웃을 write() 한 번으로 보냄
+    *  - 카메라 링이 있으면 이번 사이클에 분석할 프레임 세트(카메라별 슬롯/수신 시각)를 함께 실음
+    * ======================================================================================= */
+    static int send_ai_request(int to_py, const VehicleData* v, unsigned long token, const CamFrameSet* frames) {
+        if (to_py < 0 || !v) return -1;
+
+        unsigned char frame[IPC_HEADER_SIZE + IPC_VEHICLE_SIZE + IPC_FRAMESET_SIZE + IPC_FRAME_REF_SIZE * CAM_RING_MAX_CAMS];
+        size_t n = ipc_encode_analyze(frame, sizeof(frame), token, v, frames);
+        if (n == 0) return -1;
+        return ipc_write_all(to_py, frame, n);
+    }
+
+    // static int send_save_request(FILE* to_py, const VehicleData* v, const unsigned char value,
+    //                              const double* path_x, const double* path_y, int count) {
+    //     if (!to_py || !v) return -1;
 
-        // 각도가 너무 작으면(직진) 0으로 처리 (노이즈 제거)
-        if (fabs(steer_angle) < 0.5) {
-            steer_angle = 0.0;
+    //     int n = fprintf(to_py,
+    //         "draw {"
+    //             "\"value\":%u,"
+    //             // "\"gps\":[%.6f,%.6f],"
+    //             "\"speed\":%d,"
+    //             "\"rpm\":%d,"
+    //             "\"brake_state\":%u,"
+    //             "\"gear_ratio\":%.4f,"
+    //             "\"gear_state\":%d,"      /* char -> int 코드로 전송 */
+    //             //"\"degree\":%.2f,"
+    //             "\"throttle\":%u,"
+    //             "\"tires\":[%u,%u,%u,%u]"
+    //         "}\n",
+    //         (unsigned)value,
+    //         // v->gps_x, v->gps_y,
+    //         v->speed,
+    //         v->rpm,
+    //         (unsigned)v->brake_state,
+    //         v->gear_ratio,
+    //         (int)v->gear_state,
+    //         //v->degree,
+    //         (unsigned)v->throttle,
+    //         v->tire_pressure[0], v->tire_pressure[1],
+    //         v->tire_pressure[2], v->tire_pressure[3]
+    //     );
+    //     if (n <= 0) return -1;
+
+    //     fflush(to_py);
+    //     return 0;
+    // }
+
+    // draw 요청: 차량 스냅샷 + 이벤트 플래그 + 예측 경로를 IPC_MSG_DRAW 프레임 하나로 전송 (경로는 double 그대로 복사)
+    static int send_save_request(int to_py, const VehicleData* v, const unsigned char value, 
+                                const double* path_x, const double* path_y, int count, unsigned long token) {
+        if (to_py < 0 || !v) return -1;
+
+        unsigned char frame[IPC_HEADER_SIZE + IPC_VEHICLE_SIZE + 8 + 2 * sizeof(double) * POS_COUNT];
+        if (count > POS_COUNT) count = POS_COUNT;
+        size_t n = ipc_encode_draw(frame, sizeof(frame), token, v, value, path_x, path_y, count);
+        if (n == 0) return -1;
+        return ipc_write_all(to_py, frame, n);
+    }
+
+    // ===== in-flight 창 관리 =====
+    static void py_window_add(unsigned long token, double now) {
+        if (g_py_inflight_count >= PY_INFLIGHT_MAX) return; // analyze 전에 자리를 확인하므로 오지 않음
+        g_py_inflight[g_py_inflight_count].token = token;
+        g_py_inflight[g_py_inflight_count].sent_at = now;
+        g_py_inflight_count++;
+    }
+
+    // done <token> 수신: 창에서 제거하고 draw 왕복 시간(초)을 반환, 모르는 토큰이면 -1
+    static double py_window_done(unsigned long token, double now) {
+        for (int i = 0; i < g_py_inflight_count; i++) {
+            if (g_py_inflight[i].token != token) continue;
+            double rtt = now - g_py_inflight[i].sent_at;
+            g_py_inflight[i] = g_py_inflight[--g_py_inflight_count];
+            return rtt;
         }
+        return -1.0;
+    }
 
-        // 3. 직진 or 곡선 판단 및 계산
-        if (steer_angle == 0.0) {
-            // [직진일 때]
-            for (int i = 0; i < POS_COUNT; i++) {
-                double t = (i + 1) * PREDICTION_DT;
-                out_x[i] = v_mps * t; 
-                out_y[i] = 0.0;
+    // done이 너무 오래 오지 않은 사이클은 포기 (파이썬이 줄을 잃어버려도 창이 영구히 막히지 않게)
+    static void py_window_expire(double now) {
+        for (int i = 0; i < g_py_inflight_count; ) {
+            if (now - g_py_inflight[i].sent_at > PY_DONE_TIMEOUT_SEC) {
+                log_warn("[C] Python done timeout: token %lu\n", g_py_inflight[i].token);
+                g_py_inflight[i] = g_py_inflight[--g_py_inflight_count];
+                continue;
             }
-        } 
-        else {
-            // [곡선일 때: 자전거 모델]
-            
-            // 3-1. 바퀴 각도(deg) -> 라디안(rad) 변환
-            // (입력값이 이미 바퀴 각도이므로 기어비 나눗셈 불필요)
-            // [주의] Carla 좌표계: -30이 왼쪽인지 오른쪽인지 확인 필요.
-            // 보통 왼쪽이 +각도(반시계)여야 수학 공식과 맞습니다.
-            // 만약 경로가 반대로 휘면 아래에 -를 붙이세요: -steer_angle
-            double wheel_angle_rad = (steer_angle) * (M_PI / 180.0);
-
-            // 3-2. 회전 반경 R 계산
-            // tan(90도)는 무한대이므로 방어 코드 필요하지만 30도라 안전함
-            double R = VEHICLE_WHEELBASE / tan(wheel_angle_rad);
-
-            // 3-3. 각속도 omega 계산
-            // 속도가 0이면 R 계산과 무관하게 제자리
-            if (fabs(v_mps) < 0.1) {
-                // 정지 상태면 경로 없음(0,0)
-                return; 
+            i++;
+        }
+    }
+
+    // AI 결과 교체: 이전 결과가 공유 메모리 슬롯이면 붙잡기를 풂 (풀은 재사용하므로 해제하지 않음)
+    static void ai_objs_clear(void) {
+        g_ai_objs = NULL;
+        g_ai_count = 0;
+        g_ai_from_pool = 0;
+        det_shm_release();
+    }
+
+    static void ai_objs_set(const DetectedObject* objs, int n, int from_pool, double capture_time) {
+        g_ai_objs = objs;
+        g_ai_count = n;
+        g_ai_from_pool = from_pool;
+        g_ai_capture_time = (capture_time > 0.0) ? capture_time : now_sec(); // 촬영 시각을 모르는 서버면 도착 시각
+        g_trk_pending = 1;  // 트래커 갱신은 촬영 시각의 차량 상태를 구하는 위험 평가에서
+        if (from_pool) det_shm_release(); // JSON 경로 결과로 바뀌면 공유 메모리 슬롯은 더 이상 안 씀
+    }
+
+    // 객체가 하나도 없는 결과: 넘길 객체는 없지만 트래커에는 빈 관측으로 넣어 트랙 나이/놓침을 셈
+    static void ai_objs_set_empty(double capture_time) {
+        ai_objs_clear();
+        g_ai_capture_time = (capture_time > 0.0) ? capture_time : now_sec();
+        g_trk_pending = 1;
+    }
+
+    // 활성 비전 프로세스를 잃었을 때: 기다리던 결과와 in-flight draw의 done은 오지 않음
+    static void ai_state_reset(unsigned char* ai_state_flag) {
+        ai_objs_clear();
+        tracker_reset(&g_trk);
+        bev_grid_build(&g_bev, g_trk.out, 0);
+        g_trk_pending = 0;
+        *ai_state_flag = 0;
+        g_py_inflight_count = 0;
+    }
+
+    /* =======================================================================================
+    * @brief 공유 메모리 채널로 온 탐지 결과 처리 (JSON 경로의 handle_python_message와 같은 규칙)
+    *  - 지금 기다리는 analyze 토큰의 결과만 받아들이고, 슬롯을 붙잡아 다음 결과까지 제자리에서 읽음
+    *  - 객체가 없으면 AI 에러로 처리
+    * ======================================================================================= */
+    static void handle_detections(const DetResult* res, unsigned char* state_flag) {
+        if ((*state_flag & AI_REQUEST_FLAG) != AI_REQUEST_FLAG ||
+            (res->token >= 0 && (unsigned long)res->token != g_ai_token)) {
+            if (!g_ai_objs || g_ai_from_pool) det_shm_release(); // 붙잡은 슬롯이 없으면 풀어줌
+            return;
+        }
+        if (res->flags & DET_SHM_TRUNCATED) {
+            log_warn("[C] AI result truncated to %d objects\n", res->count);
+        }
+        if (res->count <= 0) {
+            log_warn("[C] AI result has no objects\n");
+            ai_objs_set_empty(res->timestamp);
+            *state_flag |= AI_RESEULT_ERROR_FLAG;
+            return;
+        }
+        det_shm_hold(res->seq);
+        ai_objs_set(res->objects, res->count, 0, res->timestamp);
+        *state_flag |= AI_RESULT_READY_FLAG;
+    }
+
+    /* =======================================================================================
+    * ===== [ADD] 헬퍼: 파이썬 메시지 하나 처리 ===============================================
+    *  - IPC_MSG_DONE: 해당 사이클의 draw 완료 → in-flight 창에서 제거
+    *  - IPC_MSG_RESULT_JSON: 공유 메모리를 못 쓰는 서버의 결과 JSON을 여분 풀에 파싱(det_json_parse)하고 상태 플래그 설정
+    *    (지금 기다리는 analyze 토큰이 아닌 결과는 지난 사이클 것이므로 버림)
+    *  - 실패해도 치명적이지 않으므로 파싱 실패는 로깅 후 무시(프로토타입 전략)
+    * ======================================================================================= */
+    static int handle_python_message(const IpcMessage* msg, unsigned char* state_flag) {
+        if (!msg || !state_flag) return -1;
+
+        if (msg->type == IPC_MSG_DONE) {
+            double rtt = py_window_done(msg->token, now_sec());
+            if (rtt >= 0.0) {
+                log_info("[C] Python done %lu (%.1f ms)\n", msg->token, rtt * 1e3);
             }
-            
-            double omega = v_mps / R;
+            return 0;
+        }
+        if (msg->type != IPC_MSG_RESULT_JSON) return 0;
 
-            for (int i = 0; i < POS_COUNT; i++) {
-                double t = (i + 1) * PREDICTION_DT;
-                
-                // t초 동안 회전한 총 각도
-                double theta = omega * t;
+        DetPool* pool = &g_ai_pools[g_ai_pool_spare];
+        long token = -1;
+        int n = det_json_parse((const char*)msg->payload, msg->len, pool, &token);
+        if (token < 0) token = (long)msg->token; // JSON에 토큰이 없으면 프레임 헤더의 토큰 사용
+
+        // 요청하지 않았거나 지난 사이클의 결과면 무시
+        if ((*state_flag & AI_REQUEST_FLAG) != AI_REQUEST_FLAG ||
+            (unsigned long)token != g_ai_token) {
+            return 0;
+        }
+
+        if(n <= 0){
+            log_warn(n < 0 ? "[C] Python JSON parse error\n" : "[C] AI result has no objects\n");
+            if (n == 0) ai_objs_set_empty(pool->capture_time);
+            *state_flag |= AI_RESEULT_ERROR_FLAG;   // AI 결과 에러 플래그
+            return -1;
+        }
+
+        ai_objs_set(pool->items, n, 1, pool->capture_time);
+        g_ai_pool_spare ^= 1;   // 다음 결과는 다른 풀에 (지금 풀은 g_ai_objs가 가리킴)
+
+        *state_flag |= AI_RESULT_READY_FLAG;   // AI 결과 수신 상태 완료
+        return 0;
+    }
+
+    // ===== epoll 이벤트 종류 (epoll_event.data.u32) =====
+    enum {
+        EV_SIGNAL = 1,      // SIGINT/SIGTERM (signalfd)
+        EV_CONTROL_TIMER,   // 제어 주기 타이머
+        EV_AI_TIMER,        // AI 분석 요청 주기 타이머
+        EV_CAN,             // CAN 수집 스레드의 새 스냅샷 알림 (eventfd)
+        EV_VISION0,         // 파이썬 → C 파이프 (슬롯 0)
+        EV_VISION1,         // 파이썬 → C 파이프 (슬롯 1)
+        EV_DETECTIONS,      // 파이썬이 공유 메모리에 탐지 결과를 씀 (eventfd)
+        EV_RECORD_TIMER     // 카메라 녹화(appsrc) 프레임 주기 타이머 (녹화 중에만)
+    };
+    #define MAIN_MAX_EVENTS 8
+
+    // 제어 주기 측정값 (사이클마다 출력 후 초기화)
+    typedef struct {
+        double last_tick;
+        double period_min;
+        double period_max;
+        double period_sum;
+        unsigned int ticks;
+        unsigned int overruns;  // 처리가 늦어 건너뛴 틱 수 (timerfd 만료 횟수 - 1)
+    } ControlTiming;
+
+    // hz 주기로 만료되는 timerfd 생성 (첫 만료도 한 주기 뒤)
+    static int timer_open(double hz) {
+        if (hz <= 0.0) return -1;
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0) return -1;
+
+        long period_ns = (long)(1e9 / hz);
+        struct itimerspec its;
+        its.it_interval.tv_sec  = period_ns / 1000000000L;
+        its.it_interval.tv_nsec = period_ns % 1000000000L;
+        its.it_value = its.it_interval;
+        if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // 타이머 만료 횟수를 읽어 비움 (0이면 아직 만료 전)
+    static uint64_t timer_consume(int fd) {
+        uint64_t expirations = 0;
+        if (read(fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) return 0;
+        return expirations;
+    }
+
+    static int epoll_watch(int epfd, int fd, unsigned int tag) {
+        struct epoll_event ev = {0};
+        ev.events = EPOLLIN;
+        ev.data.u32 = tag;
+        return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    // ============================================================================
+    // 카메라 녹화 (SIGUSR1로 켜고 끔)
+    // - v4l2 모드: 녹화 엔진이 카메라를 직접 읽으므로 시작/정지만 함
+    // - appsrc 모드: 녹화 fps 타이머마다 camera_get_frame() 프레임을 storage_write_frame()에 넘김 (성공하면 소유권도 넘어감)
+    //   지금 camera_get_frame()은 검은 RGB 프레임을 주는 스텁이라, 이 모드는 녹화 경로 확인용일 뿐 실제 영상은 남지 않음
+    //   대시보드(탐지 박스/HUD를 합성한 화면) 녹화는 아직 vision_server.py의 OpenCV 녹화기(rec_events/rec_always)가 함
+    // ============================================================================
+    static int g_rec_on = 0;
+    static int g_rec_timer_fd = -1;
+    static unsigned int g_rec_frames = 0, g_rec_drops = 0;
+
+    static void camera_record_stop(void) {
+        if (g_rec_timer_fd >= 0) { close(g_rec_timer_fd); g_rec_timer_fd = -1; } // 닫으면 epoll에서도 빠짐
+        if (!g_rec_on) return;
+        storage_stop_recording();
+        g_rec_on = 0;
+        log_info("[C] Camera recording stopped (frames=%u drops=%u)\n", g_rec_frames, g_rec_drops);
+    }
 
-                // 원형 궤적 공식 (시작점 0,0, 초기방향 x축)
-                out_x[i] = R * sin(theta);
-                out_y[i] = R * (1.0 - cos(theta));
+    static void camera_record_toggle(int epfd) {
+        if (g_rec_on) {
+            camera_record_stop();
+            return;
+        }
+        if (storage_start_recording(NULL) < 0) {
+            log_warn("[C] Camera recording start failed\n");
+            return;
+        }
+        g_rec_on = 1;
+        g_rec_frames = g_rec_drops = 0;
+
+        int fps = storage_frame_fps();
+        if (fps > 0) {
+            g_rec_timer_fd = timer_open((double)fps);
+            if (g_rec_timer_fd < 0 || epoll_watch(epfd, g_rec_timer_fd, EV_RECORD_TIMER) < 0) {
+                log_warn("[C] Camera recording frame timer failed\n");
+                camera_record_stop();
+                return;
             }
         }
+        log_info("[C] Camera recording started (%s)\n", fps > 0 ? "appsrc" : "v4l2");
+    }
+
+    static void camera_record_frame(void) {
+        FrameBuffer* fb = camera_get_frame();
+        if (!fb) return;
+        int rc = storage_write_frame(fb);
+        if (rc == 0) {
+            g_rec_frames++;
+            return;
+        }
+        if (rc != -EPIPE) camera_release_frame(fb); // -EPIPE만 녹화 엔진이 이미 해제함
+        g_rec_drops++;
     }
-        
-    // }
 
     // ============================================================================
-    // 파이썬 자식 프로세스를 시작하는 함수
-    // - 파이프 2개 생성 → fork() → 자식에서 dup2로 stdin/stdout 재지정 → execvp로 vision_server.py 실행
-    // - 부모에서는 fdopen/논블로킹 설정 등 스트림 초기화
+    // 비전(파이썬) 프로세스 감독
+    // - 대기 프로세스는 모델/맵을 미리 올려 두고 ACTIVATE를 기다림 (카메라/Hailo 장치/화면은 승격 후 잡음)
+    // - 활성이 EOF(크래시)거나 하트비트가 VISION_HANG_SEC 넘게 끊기면(멈춤) 대기 프로세스를 바로 승격하고,
+    //   빈 슬롯에는 뒤에서 새 대기 프로세스를 띄움 (모델 로딩은 한 번에 하나씩만)
+    // - 자식은 자기 프로세스 그룹을 가지므로, 멈춘 프로세스는 multiprocessing 자식까지 SIGKILL 한 번으로 정리
     // ============================================================================
-    static int start_python_process(void) {
+
+    static int vision_active_fd(void) {
+        return (g_vis_active >= 0) ? g_vis[g_vis_active].to_fd : -1;
+    }
+
+    static void vision_signal(pid_t pid, int sig) {
+        if (kill(-pid, sig) < 0) kill(pid, sig); // 그룹이 아직 안 만들어졌으면 본인에게만
+    }
+
+    // 수거한 비전 프로세스의 종료 상태 기록
+    static void vision_log_exit(pid_t pid, int status) {
+        if (WIFEXITED(status)) {
+            log_info("[C] Vision PID=%d exited with code %d\n", (int)pid, WEXITSTATUS(status));
+        } else if (WIFSIGNALED(status)) {
+            log_info("[C] Vision PID=%d killed by signal %d\n", (int)pid, WTERMSIG(status));
+        }
+    }
+
+    // 파이썬 자식 하나를 대기 모드로 띄움
+    // - 파이프 2개 생성 → fork() → 자식에서 dup2로 stdin/stdout 재지정 → execvp로 vision_server.py 실행
+    static int vision_spawn(int slot, int epfd, double now) {
+        VisionProc* vp = &g_vis[slot];
+        int to_py[2], from_py[2];
+
         // 1) 양방향 통신을 위한 파이프 2개 생성
-        if (pipe(c_to_python_pipe) == -1 || pipe(python_to_c_pipe) == -1) {
+        //    CLOEXEC: 다른 슬롯의 자식이 이 파이프를 물려받으면 이 자식이 죽어도 EOF가 오지 않음
+        if (pipe2(to_py, O_CLOEXEC) == -1) {
+            perror("pipe() failed");
+            return -1;
+        }
+        if (pipe2(from_py, O_CLOEXEC) == -1) {
             perror("pipe() failed");
+            close(to_py[0]);
+            close(to_py[1]);
             return -1;
         }
 
@@ -274,22 +616,32 @@
         pid_t pid = fork();
         if (pid < 0) {               // fork 실패
             perror("fork() failed");
+            close(to_py[0]); close(to_py[1]);
+            close(from_py[0]); close(from_py[1]);
             return -1;
         }
 
         if (pid == 0) {
             // -------------------- [자식 프로세스 영역] --------------------
-            // 3) 표준 입출력 재지정: 자식의 stdin ← C→Py 파이프의 읽기쪽, stdout ← Py→C 파이프의 쓰기쪽
-            dup2(c_to_python_pipe[0], STDIN_FILENO);
-            dup2(python_to_c_pipe[1], STDOUT_FILENO);
+            // 자기 프로세스 그룹: 감독이 multiprocessing 자식까지 한 번에 종료할 수 있게
+            setpgid(0, 0);
+
+            // 3) 표준 입출력 재지정 (dup2로 만든 fd에는 CLOEXEC가 붙지 않고, 원본 파이프 fd는 exec에서 닫힘)
+            dup2(to_py[0], STDIN_FILENO);
+            dup2(from_py[1], STDOUT_FILENO);
+
+            // 부모는 SIGINT/SIGTERM을 signalfd로 받으려고 막아둠 → exec 전에 자식은 기본 상태로 되돌림
+            sigset_t no_block;
+            sigemptyset(&no_block);
+            sigprocmask(SIG_SETMASK, &no_block, NULL);
+            signal(SIGPIPE, SIG_DFL);
 
-            // 4) 더 이상 직접 쓰지 않을 원본 fd들은 정리(자원 누수 방지)
-            close(c_to_python_pipe[0]); 
-            close(c_to_python_pipe[1]); 
-            close(python_to_c_pipe[0]); 
-            close(python_to_c_pipe[1]);
+            // 탐지 결과 공유 메모리/eventfd를 exec 후에도 열어 두고 번호를 환경 변수로 넘김
+            det_shm_export();
+            cam_ring_export();          // 카메라 링이 없으면(수신 엔진 시작 실패) 파이썬이 직접 수신
+            setenv(VISION_ENV_ROLE, "standby", 1);
 
-            // 5) C 실행파일 기준으로 vision_server.py의 절대경로 계산 (원래 코드 로직 재사용)
+            // 4) C 실행파일 기준으로 vision_server.py의 절대경로 계산
             char exe_path[1024];
             ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path)-1);
             if (len != -1) {
@@ -299,777 +651,730 @@
                 char script_path[1024];
                 snprintf(script_path, sizeof(script_path), "%s/ai/vision_server.py", exe_path);
 
-                // 6) 파이썬 스크립트 실행 (실패 시 아래로 떨어져 종료)
+                // 5) 파이썬 스크립트 실행 (실패 시 아래로 떨어져 종료)
                 char *args[] = { "python3", script_path, NULL };
                 execvp(args[0], args);
             }
 
-            // 7) 여기 도달하면 exec 실패 → 에러 로그 후 비정상 종료
+            // 6) 여기 도달하면 exec 실패 → 에러 로그 후 비정상 종료
             fprintf(stderr, "EXECVP or Path Calculation FAILED: %s\n", strerror(errno));
             _exit(127); // ← 자식은 반드시 _exit 사용(버퍼 중복 flush 방지)
         }
 
         // -------------------- [부모 프로세스 영역] --------------------
-        g_py_pid = pid; // 방금 띄운 자식 PID 기록
-
-        // 8) 부모는 자신이 쓰지 않는 파이프 방향을 정리하고, stdio 스트림으로 감싸기
-        close(c_to_python_pipe[0]);                 // 부모는 C→Py 파이프의 읽기쪽 불필요
-        close(python_to_c_pipe[1]);                 // 부모는 Py→C 파이프의 쓰기쪽 불필요
-        pipe_from_python_fd = python_to_c_pipe[0];  // select 감시용 fd
-        stream_to_python    = fdopen(c_to_python_pipe[1], "w"); // 라인 버퍼링 출력
-        stream_from_python  = fdopen(pipe_from_python_fd, "r"); // 입력 스트림
-
-        if (!stream_to_python || !stream_from_python) {
-            perror("fdopen failed");
+        setpgid(pid, pid); // 자식보다 먼저 실행돼도 그룹이 정해지도록 양쪽에서 설정
+
+        // 7) 부모는 자신이 쓰지 않는 파이프 방향을 정리
+        close(to_py[0]);
+        close(from_py[1]);
+        vp->pid = pid;
+        vp->to_fd = to_py[1];       // 프레임은 write()로 직접 씀
+        vp->from_fd = from_py[0];   // epoll 감시용 fd (바이너리 프레임을 직접 read)
+        vp->state = VIS_STARTING;
+        vp->spawned_at = now;
+        vp->last_beat = now;
+
+        // 8) 이전 자식이 남긴 덜 받은 프레임은 버리고, 파이썬→C 파이프는 논블로킹으로
+        ipc_reader_reset(&vp->reader);
+        fcntl(vp->from_fd, F_SETFL, O_NONBLOCK);
+
+        if (epoll_watch(epfd, vp->from_fd, EV_VISION0 + slot) < 0) {
+            perror("[C] epoll_ctl(vision)");
+            close(vp->to_fd);
+            close(vp->from_fd);
+            vp->to_fd = vp->from_fd = -1;
+            vision_signal(pid, SIGKILL);
+            vp->pid = -1;
+            vp->state = VIS_EMPTY;
             return -1;
         }
 
-        // 9) '\n'마다 즉시 flush 되도록 라인 버퍼링 설정
-        setvbuf(stream_to_python, NULL, _IOLBF, 0);
-
-        // 10) 파이썬→C 파이프는 논블로킹으로: select와 궁합 좋게
-        fcntl(pipe_from_python_fd, F_SETFL, O_NONBLOCK);
-
-        // 11) 자식이 죽은 상태에서 write 시 SIGPIPE로 프로세스 전체가 죽지 않도록 무시
-        signal(SIGPIPE, SIG_IGN);
-
-        printf("[C] Python child started. PID=%d\n", (int)g_py_pid);
+        log_info("[C] Vision standby starting in slot %d. PID=%d\n", slot, (int)pid);
         return 0;
     }
 
-    // ============================================================================
-    // 파이썬 자식 프로세스를 종료/정리하는 함수
-    // - 스트림/파이프 정리 → SIGTERM 전송 → 짧게 대기 후 waitpid로 수거
-    // ============================================================================
-    static void stop_python_process(void) {
-        // 1) stdio 스트림부터 닫아 내부 버퍼를 안전히 비움
-        // if (stream_to_python)   { fclose(stream_to_python);   stream_to_python = NULL; }
-        // if (stream_from_python) { fclose(stream_from_python); stream_from_python = NULL; }
-        if (stream_to_python)   { fclose(stream_to_python);   stream_to_python = NULL; c_to_python_pipe[1] = -1; }
-        if (stream_from_python) { fclose(stream_from_python); stream_from_python = NULL; python_to_c_pipe[0] = -1; }
-
-        // 2) 로우 fd도 닫아줌 (중복 닫힘 방지 위해 -1 체크)
-        if (c_to_python_pipe[0]   != -1) { close(c_to_python_pipe[0]);   c_to_python_pipe[0]   = -1; }
-        if (c_to_python_pipe[1]   != -1) { close(c_to_python_pipe[1]);   c_to_python_pipe[1]   = -1; }
-        if (python_to_c_pipe[0]   != -1) { close(python_to_c_pipe[0]);   python_to_c_pipe[0]   = -1; }
-        if (python_to_c_pipe[1]   != -1) { close(python_to_c_pipe[1]);   python_to_c_pipe[1]   = -1; }
-        pipe_from_python_fd = -1;
-
-        // 3) 자식 프로세스가 살아 있다면 종료 신호 전달 후 수거
-        if (g_py_pid > 0) {
-            kill(g_py_pid, SIGTERM); // 우아한 종료 요청
-            int status = 0;
-            // 짧게 폴링하며 종료 기다림
-            for (int i = 0; i < 10; ++i) {
-                pid_t r = waitpid(g_py_pid, &status, WNOHANG);
-                if (r == g_py_pid) break; // 종료됨
-                usleep(100 * 1000);       // 100ms 대기
+    // 슬롯 정리: 파이프를 닫고(닫힌 fd는 epoll에서 자동으로 빠짐) 프로세스 그룹 종료
+    // - graceful: stdin EOF/SIGTERM으로 정리할 시간을 주고 수거 (프로그램 종료 시)
+    // - 아니면(멈춤/크래시 교체) 바로 SIGKILL, 수거는 g_vis_reap에 넣어 vision_supervise의 waitpid(WNOHANG)에 맡김 → 제어 루프가 멈추지 않음
+    static void vision_kill(int slot, int graceful) {
+        VisionProc* vp = &g_vis[slot];
+
+        if (vp->to_fd >= 0)   { close(vp->to_fd);   vp->to_fd = -1; }
+        if (vp->from_fd >= 0) { close(vp->from_fd); vp->from_fd = -1; }
+
+        if (vp->pid > 0) {
+            if (graceful) {
+                vision_signal(vp->pid, SIGTERM); // 우아한 종료 요청
+                int status = 0;
+                int reaped = 0;
+                // 짧게 폴링하며 종료 기다림
+                for (int i = 0; i < 10 && !reaped; ++i) {
+                    reaped = (waitpid(vp->pid, &status, WNOHANG) == vp->pid);
+                    if (!reaped) usleep(100 * 1000); // 100ms 대기
+                }
+                if (!reaped) {
+                    vision_signal(vp->pid, SIGKILL);
+                    waitpid(vp->pid, &status, 0);
+                }
+                vision_log_exit(vp->pid, status);
+            } else {
+                vision_signal(vp->pid, SIGKILL);
+                if (g_vis_reap_count < VISION_REAP_MAX) {
+                    g_vis_reap[g_vis_reap_count++] = vp->pid;
+                } else {
+                    int status = 0; // 수거 대기 목록이 가득 참: SIGKILL이라 곧 끝나므로 여기서 기다림
+                    if (waitpid(vp->pid, &status, 0) == vp->pid) vision_log_exit(vp->pid, status);
+                }
             }
-            // 그래도 안 끝났으면 블록킹 wait (혹은 SIGKILL 고려 가능)
-            waitpid(g_py_pid, &status, 0);
-            g_py_pid = -1;
         }
+        vp->pid = -1;
+        vp->state = VIS_EMPTY;
+        if (slot == g_vis_active) g_vis_active = -1;
     }
 
-    /* =======================================================================================
-    * @brief JSON 문자열을 파싱하여 DetectedObject 구조체 배열로 동적 할당.
-    * @param json_string Python으로부터 받은 JSON 문자열.
-    * @param count 파싱된 객체의 개수를 저장할 포인터.
-    * @return 동적으로 할당된 DetectedObject 배열의 포인터. 사용 후 반드시 free() 해야 함.
-    * 파싱 실패 시 NULL을 반환.
-    * =======================================================================================*/
-
-    DetectedObject* parse_ai_results(const char* json_string, int*count){
-
-        if(!count) return NULL;
-
-        //count 포인터가 가르키는 값을 0으로 초기화함, 실패 시에도 안정성 확보
-        *count = 0;
-
-        if(!json_string) return NULL;
-        
-        //입력받은 문자열(json_string)을 cJSON 라이브러리를 사용해 파싱함
-        //결과로 JSON 구조 전체를 나타내는 cJSON 객체(트리구조)의 최상위 노드(root)를 얻음
-        cJSON *root = cJSON_Parse(json_string);
-
-        //파싱에 실패하면 NULL값 반환
-        if(NULL == root){
-            fprintf(stderr, "[C] Python JSON pare error\n");
-            return NULL;
+    // 대기 프로세스에 ACTIVATE를 보내 활성으로 승격 (이후 analyze/draw는 이 슬롯의 파이프로 감)
+    static int vision_activate(int slot, double now) {
+        VisionProc* vp = &g_vis[slot];
+        unsigned char frame[IPC_HEADER_SIZE];
+        size_t n = ipc_encode_control(frame, sizeof(frame), IPC_MSG_ACTIVATE, 0);
+        if (n == 0 || ipc_write_all(vp->to_fd, frame, n) < 0) {
+            log_warn("[C] Vision slot %d activate failed\n", slot);
+            vision_kill(slot, 0);
+            return -1;
         }
+        vp->state = VIS_ACTIVE;
+        vp->last_beat = now;
+        g_vis_active = slot;
+        log_info("[C] Vision slot %d active. PID=%d\n", slot, (int)vp->pid);
+        return 0;
+    }
 
-        //root 객체에서 objects라는 key를 가진 항목을 찾음
-        cJSON *objects_array = cJSON_GetObjectItemCaseSensitive(root, "objects");
-
-        //object 항목이 JSON배열 타입이 맞는지 확인
-        if(!cJSON_IsArray(objects_array)){
-            fprintf(stderr, "[C] 'objects' key is not an array\n");
-            cJSON_Delete(root);
-            return NULL;
+    // 활성이 없으면 준비된 대기 프로세스를 승격. 활성 슬롯 반환 (-1이면 준비된 프로세스 없음)
+    static int vision_promote(double now) {
+        for (int s = 0; s < VISION_SLOTS && g_vis_active < 0; s++) {
+            if (g_vis[s].state == VIS_STANDBY) vision_activate(s, now);
         }
+        return g_vis_active;
+    }
 
-        //배열에 몇 개의 객체가 들어있는지 확인
-        int object_count = cJSON_GetArraySize(objects_array);
+    // 하트비트: 수신 시각 갱신, 모델 로딩을 마친 프로세스는 대기 상태로
+    static void vision_heartbeat(int slot, const IpcMessage* msg, double now) {
+        VisionProc* vp = &g_vis[slot];
+        uint32_t beat = 0;
+        if (msg->len >= sizeof(beat)) memcpy(&beat, msg->payload, sizeof(beat));
 
-        //탐지된 객체가 하나도 없는 경우 NULL을 반환
-        if(object_count <= 0){
-            cJSON_Delete(root);
-            return NULL;
+        vp->last_beat = now;
+        if (vp->state == VIS_STARTING && beat == IPC_BEAT_STANDBY) {
+            vp->state = VIS_STANDBY;
+            log_info("[C] Vision slot %d ready (init %.1f s)\n", slot, now - vp->spawned_at);
         }
+    }
 
-        //메모리 동적 할당, 탐지된 객체의 수만큼 DetectedObject 구조체 배열을 위한 메모리를 힙에 할당
-        DetectedObject* result_array = (DetectedObject*)malloc(object_count * sizeof(DetectedObject));
-        
-        //메모리 오류 검사, 메모리가 부족하면 NULL을 반환
-        if(NULL == result_array){
-            fprintf(stderr, "[C] Failed to allocate memory for objects array\n");
-            cJSON_Delete(root);
-            return NULL;
+    // 슬롯의 프로세스를 잃음: 정리 후 활성이었으면 대기 프로세스로 바로 교체. 활성을 잃었으면 1 반환
+    static int vision_lost(int slot, const char* reason, double now) {
+        int was_active = (slot == g_vis_active);
+        log_warn("[C] Vision slot %d %s. PID=%d\n", slot, reason, (int)g_vis[slot].pid);
+        vision_kill(slot, 0);
+        g_vis_respawn_at = now + VISION_RESPAWN_BACKOFF_SEC;
+        if (!was_active) return 0;
+
+        int s = vision_promote(now);
+        if (s >= 0) {
+            g_vis_failovers++;
+            log_warn("[C] Vision failover: slot %d -> slot %d\n", slot, s);
+        } else {
+            log_warn("[C] No standby ready. AI paused until a vision process finishes init\n");
         }
+        return 1;
+    }
 
-        //배열 초기화
-        memset(result_array, 0, sizeof(DetectedObject) * object_count);
-
-        //cJSON_ArrayForEach 매크로를 사용하여 배열의 모든 요소를 순회
-        int i = 0;
-        cJSON *element;
-        cJSON_ArrayForEach(element, objects_array){
-
-            if(!cJSON_IsObject(element))
-                continue; //객체가 아니면 스킵
-
-            cJSON *jlabel = cJSON_GetObjectItemCaseSensitive(element, "label");
-            cJSON *jx     = cJSON_GetObjectItemCaseSensitive(element, "x");
-            cJSON *jy     = cJSON_GetObjectItemCaseSensitive(element, "y");
-            cJSON *jax    = cJSON_GetObjectItemCaseSensitive(element, "ax");
-            cJSON *jay    = cJSON_GetObjectItemCaseSensitive(element, "ay");
-
-            result_array[i].label = (unsigned char)(cJSON_IsNumber(jlabel) ? jlabel->valueint   : 0);
-            result_array[i].x     = (float)(cJSON_IsNumber(jx)     ? jx->valuedouble            : 0.0f);
-            result_array[i].y     = (float)(cJSON_IsNumber(jy)     ? jy->valuedouble            : 0.0f);
-            result_array[i].ax    = (float)(cJSON_IsNumber(jax)    ? jax->valuedouble           : 0.0f);
-            result_array[i].ay    = (float)(cJSON_IsNumber(jay)    ? jay->valuedouble           : 0.0f);
-            i++;
+    // 제어 주기마다: 초기화 시간 초과/하트비트 끊김 검사, 빈 슬롯 채우기, 종료된 자식 수거
+    // 활성을 잃었으면 1 반환 (호출자가 AI 상태 초기화)
+    static int vision_supervise(int epfd, double now) {
+        int lost = 0;
+        int starting = 0;
+
+        for (int s = 0; s < VISION_SLOTS; s++) {
+            VisionProc* vp = &g_vis[s];
+            if (vp->state == VIS_STARTING && now - vp->spawned_at > VISION_INIT_TIMEOUT_SEC) {
+                vision_lost(s, "init timeout", now);
+            } else if ((vp->state == VIS_STANDBY || vp->state == VIS_ACTIVE) &&
+                       now - vp->last_beat > VISION_HANG_SEC) {
+                lost |= vision_lost(s, "heartbeat lost (hung)", now);
+            }
+            if (vp->state == VIS_STARTING) starting = 1;
         }
 
-        cJSON_Delete(root);
+        // 첫 대기 프로세스가 준비됐거나, 교체 시점에 준비된 대기 프로세스가 없었던 경우
+        vision_promote(now);
 
-        if(i == 0){
-            free(result_array);
-            return NULL;
+        // 빈 슬롯 채우기: 모델 로딩 중인 프로세스가 없을 때 하나씩 (동시에 올리면 둘 다 느려짐)
+        if (!starting && now >= g_vis_respawn_at) {
+            for (int s = 0; s < VISION_SLOTS; s++) {
+                if (g_vis[s].state != VIS_EMPTY) continue;
+                if (vision_spawn(s, epfd, now) < 0) g_vis_respawn_at = now + VISION_RESPAWN_BACKOFF_SEC;
+                break;
+            }
         }
 
-        *count = i;
-        return result_array;
-
+        // SIGKILL로 정리한 비전 프로세스만 수거 (좀비 방지, 다른 자식은 건드리지 않음)
+        for (int i = 0; i < g_vis_reap_count; ) {
+            int status = 0;
+            pid_t r = waitpid(g_vis_reap[i], &status, WNOHANG);
+            if (r == 0 || (r < 0 && errno == EINTR)) { i++; continue; } // 아직 종료 중
+            if (r == g_vis_reap[i]) vision_log_exit(r, status);
+            g_vis_reap[i] = g_vis_reap[--g_vis_reap_count];  // 수거했거나 이미 없는 PID(ECHILD): 목록에서 뺌
+        }
+        return lost;
     }
 
-    /* =======================================================================================
-    * ===== [ADD] 헬퍼: 파이썬 analyze 요청 라인 프로토콜 전송 (GPS/STEER 포함) ==================
-    *  - 목적: 필수 데이터(GPS, 스티어링)가 준비된 시점에 단 한 줄로 명령을 보냄.
-    *  - 형식: C -> Py 로 "analyze {json}\n"
-    *  - 주의: fflush( ) 필수 (라인버퍼링 보장)
-    * ======================================================================================= */
-    static int send_ai_request(FILE* to_py, const VehicleData* v) {
-        if (!to_py || !v) return -1;
-
-        /* JSON에 부동소수점 수치를 넣음 */
-        int n = fprintf(to_py,
-                        "analyze {\"gps\":[%.6f,%.6f],\"steer\":%.2f}\n",
-                        v->gps_x, v->gps_y, v->degree);
-        if (n <= 0) return -1;
-
-        /* 매우 중요: stdio 버퍼가 파이프로 실제 전달되도록 즉시 비움 */
-        fflush(to_py);
-        return 0;
+    static void control_timing_tick(ControlTiming* ct, double now, uint64_t expirations) {
+        if (expirations > 1) ct->overruns += (unsigned int)(expirations - 1);
+        if (ct->last_tick > 0.0) {
+            double period = now - ct->last_tick;
+            if (ct->ticks == 0 || period < ct->period_min) ct->period_min = period;
+            if (ct->ticks == 0 || period > ct->period_max) ct->period_max = period;
+            ct->period_sum += period;
+            ct->ticks++;
+        }
+        ct->last_tick = now;
     }
 
-    // static int send_save_request(FILE* to_py, const VehicleData* v, const unsigned char value,
-    //                              const double* path_x, const double* path_y, int count) {
-    //     if (!to_py || !v) return -1;
-
-    //     int n = fprintf(to_py,
-    //         "draw {"
-    //             "\"value\":%u,"
-    //             // "\"gps\":[%.6f,%.6f],"
-    //             "\"speed\":%d,"
-    //             "\"rpm\":%d,"
-    //             "\"brake_state\":%u,"
-    //             "\"gear_ratio\":%.4f,"
-    //             "\"gear_state\":%d,"      /* char -> int 코드로 전송 */
-    //             //"\"degree\":%.2f,"
-    //             "\"throttle\":%u,"
-    //             "\"tires\":[%u,%u,%u,%u]"
-    //         "}\n",
-    //         (unsigned)value,
-    //         // v->gps_x, v->gps_y,
-    //         v->speed,
-    //         v->rpm,
-    //         (unsigned)v->brake_state,
-    //         v->gear_ratio,
-    //         (int)v->gear_state,
-    //         //v->degree,
-    //         (unsigned)v->throttle,
-    //         v->tire_pressure[0], v->tire_pressure[1],
-    //         v->tire_pressure[2], v->tire_pressure[3]
-    //     );
-    //     if (n <= 0) return -1;
-
-    //     fflush(to_py);
-    //     return 0;
-    // }
-
-    static int send_save_request(FILE* to_py, const VehicleData* v, const unsigned char value, 
-                                const double* path_x, const double* path_y, int count) {
-        if (!to_py || !v) return -1;
-
-        // 1. JSON의 앞부분 (기본 데이터) 출력 (줄바꿈 없이 "draw {" 로 시작)
-        fprintf(to_py, "draw {");
-        
-        fprintf(to_py, "\"value\":%u,", (unsigned)value);
-        fprintf(to_py, "\"speed\":%d,", v->speed);
-        fprintf(to_py, "\"rpm\":%d,", v->rpm);
-        fprintf(to_py, "\"brake_state\":%u,", (unsigned)v->brake_state);
-        fprintf(to_py, "\"gear_ratio\":%.4f,", v->gear_ratio);
-        fprintf(to_py, "\"gear_state\":%d,", (int)v->gear_state);
-        fprintf(to_py, "\"throttle\":%u,", (unsigned)v->throttle);
-        fprintf(to_py, "\"tires\":[%u,%u,%u,%u],", 
-                v->tire_pressure[0], v->tire_pressure[1], 
-                v->tire_pressure[2], v->tire_pressure[3]);
-
-        // 2. Path X 배열 추가
-        fprintf(to_py, "\"path_x\":[");
-        if (path_x) {
-            for (int i = 0; i < count; i++) {
-                // 마지막 원소가 아니면 콤마(,) 추가
-                fprintf(to_py, "%.2f%s", path_x[i], (i < count - 1) ? "," : "");
-            }
+    // --- 3. main 함수: 모든 코드의 시작점 ---
+    // 사용법: blackbox_main [CAN 인터페이스] [제어 주기 Hz] [로그 파일]  (기본값 can0, 시뮬레이터 사용 시 vcan0, 로그는 stderr)
+    int main(int argc, char* argv[]) {
+        const char* can_ifname = (argc > 1) ? argv[1] : "can0";
+        double control_hz = (argc > 2) ? atof(argv[2]) : CONTROL_RATE_HZ;
+        if (control_hz <= 0.0) control_hz = CONTROL_RATE_HZ;
+
+        // 종료 신호(+ 녹화 토글 SIGUSR1)는 signalfd로 받음: 스레드/자식 생성 전에 막아야 모든 스레드가 같은 마스크를 물려받음
+        sigset_t exit_signals;
+        sigemptyset(&exit_signals);
+        sigaddset(&exit_signals, SIGINT);
+        sigaddset(&exit_signals, SIGTERM);
+        sigaddset(&exit_signals, SIGUSR1);
+        sigprocmask(SIG_BLOCK, &exit_signals, NULL);
+
+        // 로그 드레인 스레드: 제어 루프는 레코드만 링에 넣고, 포맷팅/출력은 이 스레드가 담당
+        if (log_start((argc > 3) ? argv[3] : NULL) < 0) {
+            fprintf(stderr, "[C] log file open failed, logging to stderr\n");
+            log_start(NULL);
         }
-        fprintf(to_py, "],");
 
-        // 3. Path Y 배열 추가
-        fprintf(to_py, "\"path_y\":[");
-        if (path_y) {
-            for (int i = 0; i < count; i++) {
-                fprintf(to_py, "%.2f%s", path_y[i], (i < count - 1) ? "," : "");
-            }
+        // --- 2-1. 탐지 결과 공유 메모리 채널 (자식이 물려받아야 하므로 파이썬 시작 전에 생성) ---
+        int det_event_fd = det_shm_create();
+        if (det_event_fd < 0) {
+            fprintf(stderr, "[C] FATAL: failed to create detection channel\n");
+            return EXIT_FAILURE;
         }
-        fprintf(to_py, "]");
-
-        // 4. JSON 닫기 및 줄바꿈
-        fprintf(to_py, "}\n");
-
-        // 5. 전송
-        fflush(to_py);
-        return 0;
-    }
 
-    /* =======================================================================================
-    * ===== [ADD] 헬퍼: 파이썬 한 줄(JSON) 처리 ==============================================
-    *  - 목적: Py -> C로 들어온 한 줄(JSON 문자열)을 파싱해 ai_result에 저장하고 상태 플래그 설정
-    *  - 실패해도 치명적이지 않으므로 파싱 실패는 로깅 후 무시(프로토타입 전략)
-    * ======================================================================================= */
-    static int handle_python_line(const char* line, unsigned char* state_flag) {
-        if (!line || !state_flag) return -1;
-
-        int n = 0;
-        DetectedObject *objs = parse_ai_results(line, &n);
-        if(!objs || n <= 0){
-            fprintf(stderr, "[C] AI parse failed or empty objects\n");
-            *state_flag |= AI_RESEULT_ERROR_FLAG;   // AI 결과 에러 플래그
-            return -1;
+        // --- 2-1-1. 카메라 수신 엔진 + 프레임 링 (링도 자식이 물려받으므로 파이썬 시작 전에) ---
+        //            실패해도 계속 진행: 링을 못 받은 파이썬은 예전처럼 직접 카메라를 수신함
+        if (cam_ingest_start(NULL) < 0) {
+            fprintf(stderr, "[C] camera ingest unavailable, vision server will receive cameras itself\n");
         }
 
-        if(g_ai_objs) free(g_ai_objs);
-        g_ai_objs = objs;
-        g_ai_count = n;
-
-        *state_flag |= AI_RESULT_READY_FLAG;   // AI 결과 수신 상태 완료
-        return 0;
-    }
-
-    static int wait_python_done(FILE* in, int fd, int timeout_ms)
-    {
-        if (!in || fd < 0) return -1;
-
-        while (1) {
-            // 1) 읽기 가능해질 때까지 select()로 대기 (타임아웃 적용)
-            fd_set rfds;
-            FD_ZERO(&rfds);
-            FD_SET(fd, &rfds);
-
-            struct timeval tv, *ptv = NULL;
-            if (timeout_ms > 0) {
-                tv.tv_sec  = timeout_ms / 1000;
-                tv.tv_usec = (timeout_ms % 1000) * 1000;
-                ptv = &tv;
-            }
-            int r = select(fd + 1, &rfds, NULL, NULL, ptv);
-            if (r < 0) {
-                if (errno == EINTR) continue;     // (신호로 깨어나면 재시도)
-                perror("[C] wait_python_done select");
-                return -1;
-            }
-            if (r == 0) {
-                // 2) 타임아웃: 더 기다리지 않음
-                return 1;
-            }
-
-            // 3) 읽을 데이터가 있음 → 라인 단위로 모두 읽어 "done" 확인
-            if (FD_ISSET(fd, &rfds)) {
-                char line[4096];
-                while (fgets(line, sizeof(line), in)) {
-                    // (핵심) 정확히 "done"으로 시작하는 라인 수신 시 완료
-                    if (strncmp(line, "done", 4) == 0) return 0;
-                    // 그 외 라인은 무시(필요하면 여기서 별도 파서 호출 가능)
-                }
-                // 4) 더 이상 읽을 게 없고 EOF면 자식 종료로 판단
-                if (feof(in)) return -2;
-
-                // 논블로킹/부분읽기 등으로 인한 임시 에러 플래그 정리 후 루프 계속
-                clearerr(in);
+        // --- 2-2. 비전 프로세스 슬롯/AI 결과 풀 (프로세스는 epoll 준비 후 띄움) ---
+        for (int s = 0; s < VISION_SLOTS; s++) {
+            g_vis[s].pid = -1;
+            g_vis[s].to_fd = g_vis[s].from_fd = -1;
+            if (ipc_reader_init(&g_vis[s].reader, 4096) < 0) {
+                fprintf(stderr, "[C] FATAL: out of memory\n");
+                return EXIT_FAILURE;
             }
         }
-    }
-
-    // --- 3. main 함수: 모든 코드의 시작점 ---
-    int main() {
-        // --- 2-1. 파이프(Pipe) 생성 ---
-        if (start_python_process() < 0) {
-            fprintf(stderr, "[C] FATAL: failed to start python child\n");
+        if (det_pool_init(&g_ai_pools[0], 64) < 0 || det_pool_init(&g_ai_pools[1], 64) < 0 ||
+            coll_batch_init(&g_coll, 64) < 0) {
+            fprintf(stderr, "[C] FATAL: out of memory\n");
             return EXIT_FAILURE;
         }
+        path_cache_init(&g_path);
+        tracker_init(&g_trk);
+        kin_init(&g_kin);
+        // 충돌 확률 작업 스레드 풀 (실패하면 TTC만으로 판단)
+        if (risk_mc_start(0) < 0) {
+            fprintf(stderr, "[C] WARN: risk worker pool unavailable, collision check uses TTC only\n");
+        }
+        // 자식이 죽은 상태에서 write 시 SIGPIPE로 프로세스 전체가 죽지 않도록 무시
+        signal(SIGPIPE, SIG_IGN);
 
-        //CAN 버스 초기화
-        int can_fd = can_init("can0");
-        if(can_fd < 0){
+        //CAN 수집 스레드 시작: 요청 스케줄링/수신/해석은 전용 스레드가 맡고, 여기서는 최신 스냅샷만 가져옴
+        //PID 등록 순서 = 우선순위: AI 필수 PID → 나머지 PID → 쓰로틀
+        //(BCM 모드에서는 주기 요청과 변화 감지를 커널에 맡김)
+        unsigned char acq_pids[CAN_SCHED_MAX_PIDS];
+        int num_acq_pids = 0;
+        for (unsigned char i = 0; i < num_pids_ai_required; i++) acq_pids[num_acq_pids++] = pids_ai_required[i].pid;
+        for (unsigned char i = 0; i < num_pids_to_request; i++) acq_pids[num_acq_pids++] = pids_to_request[i].pid;
+        acq_pids[num_acq_pids++] = PID_THROTTLE_DATA;
+
+        CANAcqConfig acq_cfg = {
+            .ifname = can_ifname,
+            .pids = acq_pids,
+            .pid_count = num_acq_pids,
+            .bcm_polls = bcm_polls,
+            .bcm_count = num_bcm_polls,
+            .round_period = CAN_ACQ_ROUND_SEC,
+        };
+        int can_event_fd = can_acq_start(&acq_cfg);
+        if(can_event_fd < 0){
             fprintf(stderr, "[C] FATAL: Failed to initialize CAN bus. Exiting.\n");
             exit(EXIT_FAILURE);
         }
 
         // --- 4-3. 상태 관리를 위한 변수 선언 ---
         VehicleData vehicle_data = {0}; // 차량 데이터를 저장할 구조체
-        CANMessage can_message = {0};   // CAN통신 데이터 프레임
-        unsigned char state_flag = 0;   // 상태 플래그
+        SignalStore signals;            // 값마다 수신 시각/허용 지연 (플래그 대신 신선도로 유효성 판단)
+        sig_store_init(&signals, NULL);
+        sig_hist_init(&g_sig_hist);
+        CANSnapshot can_snap = {0};          // 수집 스레드가 넘겨준 최신 스냅샷
+        unsigned int can_drops_reported = 0; // 마지막으로 로그에 남긴 드롭 수
+        unsigned int can_errors_reported = 0;
+        unsigned int bcm_timeouts_seen = 0;
         unsigned char ai_state_flag = 0;// AI 분석 결과 플래그
-        unsigned char state_flag2 = 0;
 
-        unsigned char car_state_flag = 0;  // 자동차 상태 확인 플래그
-
-        //파이썬에게 보낼 좌표 배열
-        double PosX_array[POS_COUNT];
-        double PosY_array[POS_COUNT];
+        unsigned char car_state_flag = 0;  // 자동차 상태 확인 플래그 (다음 draw 요청까지 누적)
+        double last_speed_ts = 0.0;        // 가속도 계산에 마지막으로 넣은 속도 샘플의 수신 시각
+        double last_gps_ts = 0.0;          // 속도 융합에 마지막으로 넣은 GPS 샘플의 수신 시각
+        double last_tire_ts = 0.0;         // 공기압 추세에 마지막으로 넣은 샘플의 수신 시각
+        unsigned int tire_bad_prev = 0;    // 지난 공기압 샘플의 이상 바퀴 비트 (바뀔 때만 로그)
+        unsigned int risk_evals = 0;       // 위험 평가를 수행한 제어 주기 수
+        unsigned int stale_ticks = 0;      // 필요한 신호가 stale해서 위험 평가를 건너뛴 제어 주기 수
+        unsigned int hist_misses = 0;      // 촬영 시각이 신호 이력 밖이라 가장 가까운 값으로 평가한 횟수
+        RiskMcStats mc_stats = {0};        // 마지막 몬테카를로 충돌 확률 계산 통계
+        float mc_p_max = 0.0f;             // 이번 사이클 중 가장 높은 객체 충돌 확률
+
+        ControlTiming control_timing = {0};
+        unsigned int py_backpressure = 0; // in-flight 창이 가득 차서 analyze를 미룬 횟수
+        CamFrameSet cam_set = {0};        // 마지막 analyze에 실어 보낸 카메라 프레임 세트
+        CamIngestStats cam_stats;
+
+        // --- 4-4. epoll 이벤트 루프 준비: 타이머 2개 + signalfd + CAN 알림 + 파이썬 파이프 ---
+        int epfd = epoll_create1(EPOLL_CLOEXEC);
+        int control_timer_fd = timer_open(control_hz);
+        int ai_timer_fd = timer_open(AI_REQUEST_RATE_HZ);
+        int signal_fd = signalfd(-1, &exit_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (epfd < 0 || control_timer_fd < 0 || ai_timer_fd < 0 || signal_fd < 0 ||
+            epoll_watch(epfd, signal_fd, EV_SIGNAL) < 0 ||
+            epoll_watch(epfd, control_timer_fd, EV_CONTROL_TIMER) < 0 ||
+            epoll_watch(epfd, ai_timer_fd, EV_AI_TIMER) < 0 ||
+            epoll_watch(epfd, can_event_fd, EV_CAN) < 0 ||
+            epoll_watch(epfd, det_event_fd, EV_DETECTIONS) < 0) {
+            perror("[C] FATAL: epoll/timerfd/signalfd setup");
+            exit(EXIT_FAILURE);
+        }
 
-        struct timespec request_time, complete_time;
-        long diff_ns = 0;
+        // 첫 비전 프로세스: 모델 로딩이 끝나면(첫 하트비트) 제어 주기의 vision_supervise가 승격하고 다음 대기 프로세스를 띄움
+        if (vision_spawn(0, epfd, now_sec()) < 0) {
+            fprintf(stderr, "[C] FATAL: failed to start python child\n");
+            return EXIT_FAILURE;
+        }
 
-        printf("[C] Main process start. Child PID: %d\n", (int)g_py_pid);
+        log_info("[C] Main process start. Child PID: %d, control %.1f Hz, AI request %.1f Hz, collision kernel %s\n",
+               (int)g_vis[0].pid, control_hz, AI_REQUEST_RATE_HZ, coll_kernel_name());
 
         sleep(2); //시작 대기 시간
 
-        // --- 4-4. 메인 이벤트 루프: 장치의 심장 박동 ---
-        while (1) {
-                // --- A. 필수 데이터 수집 및 파이썬 요청 단계 ---
-            // ai분석 요청을 하지 않았다면
-            if((ai_state_flag & AI_REQUEST_FLAG) != AI_REQUEST_FLAG){
-                //CAN 통신으로 필수 데이터를 받지 않았다면
-                if((state_flag & AI_AVAILABLE) != AI_AVAILABLE){
-                
-                    //GPS 데이터를 받지 않았다면
-                    if((state_flag & GPS_AVAILABLE) != GPS_AVAILABLE){
-                        //X좌표 데이터를 받지 않았다면
-                        if((state_flag & GPS_XDATA_FLAG) != GPS_XDATA_FLAG){
-                            //X좌표 데이터 요청
-                            if(can_request_pid(PID_GPS_XDATA) < 0){
-                                perror("[C] PID_GPS_XDATA request error");
-                            }
-                            else{
-                                printf("[C] GPS_XDATA_REQUEST\n");
-                            }
-                        }
-                        //x좌표 데이터를 받았다면
-                        else{
-                            //Y좌표 데이터 요청
-                            if((state_flag & GPS_YDATA_FLAG) != GPS_YDATA_FLAG){   // ✅ FLAG로 검사
-                                if(can_request_pid(PID_GPS_YDATA) < 0){
-                                    perror("[C] PID_GPS_YDATA request error");
-                                }
-                                else{
-                                    printf("[C] GPS_YDATA_REQUEST\n");
-                                }
-                            }
-                        }
-                    }
-                    //GPS 데이터를 받았다면
-                    else{
-                        //스티어링 데이터 요청
-                        if(can_request_pid(PID_STEERING_DATA) < 0){
-                            perror("[C] STEERING_DATA request error");
-                        }
-                        else{
-                            printf("[C] STEERING_DATA_REQUEST\n");
+        // --- 4-5. 메인 이벤트 루프: 장치의 심장 박동 ---
+        int running = 1;
+        while (running) {
+            struct epoll_event events[MAIN_MAX_EVENTS];
+            int nev = epoll_wait(epfd, events, MAIN_MAX_EVENTS, -1);
+            if (nev < 0) {
+                if (errno == EINTR) continue;
+                perror("[C] epoll_wait");
+                break;
+            }
+
+            int control_tick = 0; // 이번 깨어남에 제어 주기 타이머가 포함되었는지
+            for (int e = 0; e < nev; e++) {
+                switch (events[e].data.u32) {
+
+                // >>> 0) 종료 신호: 루프를 빠져나가 자원 정리
+                case EV_SIGNAL: {
+                    struct signalfd_siginfo si;
+                    if (read(signal_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+                        if (si.ssi_signo == SIGUSR1) {
+                            camera_record_toggle(epfd);
+                            break;
                         }
+                        log_info("[C] Signal %u received. Shutting down.\n", si.ssi_signo);
+                        running = 0;
                     }
+                    break;
                 }
 
-                //필수 데이터를 모두 수집했으면
-                else{
-
-                    //여기에 파이썬 실행 코드 추가, GPS좌표와 스티어링 데이터를 넘김
-                    // ===== [ADD] 필수 두 데이터(GPS, 조향각)가 준비되면, 파이썬에 분석 명령 전송 =====
-                    if (send_ai_request(stream_to_python, &vehicle_data) == 0) {
-                        ai_state_flag |= AI_REQUEST_FLAG;   // 중복 요청 방지
-                    } else {
-                        perror("[C] send_ai_request failed");
+                // >>> 0-1) 카메라 녹화 프레임 주기 (appsrc 녹화 중에만 등록됨)
+                case EV_RECORD_TIMER:
+                    if (g_rec_timer_fd >= 0 && timer_consume(g_rec_timer_fd) > 0) camera_record_frame();
+                    break;
+
+                // >>> 1) 제어 주기 타이머: 실제 처리는 모든 이벤트를 반영한 뒤 아래에서 수행
+                case EV_CONTROL_TIMER: {
+                    uint64_t exp = timer_consume(control_timer_fd);
+                    if (exp > 0) {
+                        control_timing_tick(&control_timing, now_sec(), exp);
+                        control_tick = 1;
                     }
+                    break;
                 }
-            }
-
-            //ai 분석 요청을 했다면
-            else{
-                //나머지 CAN 통신 요청
-                // (요구사항: AI가 돌고 있는 동안에도 CAN 수집은 계속된다)
-                // 필요시 여기에서 엔진, 속도, 브레이크, 타이어 등 추가 PID를 라운드-로빈으로 요청해도 됨.
-                // 예시(프로토타입): 속도/엔진RPM 라운드로 요청
 
-
-                // ======= [ADD] AI가 처리할동안 작업 수행 부분 ================================
-                
-                //차의 예상 경로 체크
-                calc_future_path(vehicle_data.speed, vehicle_data.degree, PosX_array, PosY_array);
-
-                //다른 CAN 데이터를 받지 못핬다면
-                if((state_flag & DATA_AVAILABLE) != DATA_AVAILABLE){
-                    
-                    //리스트를 순회하며 아직 받지 못한 PID를 찾음
-                    for(unsigned char i = 0; i < num_pids_to_request; i++){
-                        //이번 순서에 확인할 요청 정보 가져오기
-                        const CANRequest* current_req = &pids_to_request[next_pid_index];
-                        
-                        //이 요청에 해당하는 데이터가 아직 수신되지 않았으면
-                        if((state_flag & current_req->flag) != current_req->flag){
-                            
-                            //CAN버스로 데이터 요청
-                            if(can_request_pid(current_req->pid) < 0){
-                                perror("[C] CAN_Data_request failed");
-                            }
-                            
-                            //인덱스 업데이트
-                            next_pid_index = (next_pid_index + 1) % num_pids_to_request;
+                // >>> 2) AI 요청 주기 타이머: 아직 요청 전이고 필수 데이터(GPS, 조향각)가 신선하면 분석 명령 전송
+                //        done을 못 받은 사이클이 PY_INFLIGHT_MAX개면 새 사이클을 시작하지 않음 (역압)
+                case EV_AI_TIMER:
+                    if (timer_consume(ai_timer_fd) == 0) break;
+                    if (vision_active_fd() >= 0 &&
+                        (ai_state_flag & AI_REQUEST_FLAG) != AI_REQUEST_FLAG &&
+                        sig_store_fresh_all(&signals, SIG_MASK_AI, now_sec())) {
+                        if (g_py_inflight_count >= PY_INFLIGHT_MAX) {
+                            py_backpressure++;
                             break;
                         }
-                        //이미 플래그가 세워져 있으면 인덱스 1 증가시킴
-                        next_pid_index = (next_pid_index + 1) % num_pids_to_request;
-                        
+                        // 수신 시각이 맞는 카메라 프레임 세트를 골라 붙잡음 (링이 없으면 파이썬이 자기 수신기에서 가져감)
+                        int have_ring = cam_ring_pick(&cam_set, now_sec()) >= 0;
+                        if (send_ai_request(vision_active_fd(), &vehicle_data, g_cycle_token + 1,
+                                            have_ring ? &cam_set : NULL) == 0) {
+                            g_ai_token = ++g_cycle_token;
+                            ai_state_flag |= AI_REQUEST_FLAG;   // 중복 요청 방지
+                        } else {
+                            perror("[C] send_ai_request failed");
+                        }
+                    }
+                    break;
+
+                // >>> 3) CAN 스냅샷 수신 (수집 스레드가 eventfd로 알림, 쌓인 스냅샷 중 최신 것만 사용)
+                case EV_CAN:
+                    if (can_acq_latest(&can_snap, &g_sig_hist)) {
+                        signals = can_snap.store;
+                        vehicle_data = signals.data;
                     }
+                    // 소켓 버퍼 오버플로로 프레임이 버려졌다면 알림
+                    if (can_snap.drops != can_drops_reported) {
+                        log_warn("[C] CAN rx overflow: %u frames dropped\n", can_snap.drops - can_drops_reported);
+                        can_drops_reported = can_snap.drops;
+                    }
+                    // 버스 에러 이벤트(커널 CAN_RAW_ERR_FILTER로 구독한 것만 집계됨)
+                    if (can_snap.bus_errors != can_errors_reported) {
+                        log_warn("[C] CAN bus error event: class=0x%03X (%u new)\n",
+                                can_snap.last_error, can_snap.bus_errors - can_errors_reported);
+                        can_errors_reported = can_snap.bus_errors;
+                    }
+                    if (can_snap.bcm_timeouts != bcm_timeouts_seen) {
+                        log_warn("[C] CAN_BCM rx timeout: ECU silent\n");
+                        bcm_timeouts_seen = can_snap.bcm_timeouts;
+                    }
+                    break;
+
+                // >>> 4) 파이썬 탐지 결과 수신 (공유 메모리 슬롯을 제자리에서 읽음, 파싱/복사 없음)
+                case EV_DETECTIONS: {
+                    DetResult det;
+                    if (det_shm_poll(&det)) handle_detections(&det, &ai_state_flag);
+                    break;
                 }
 
-                //쓰로틀 업데이트(임시)
-                else if((state_flag2 & THROTTLE_DATA_FLAG) == 0x00){
-                    if(can_request_pid(PID_THROTTLE_DATA) < 0){
-                        perror("[C] CAN_Data_request failed");
+                // >>> 5) 파이썬 응답 수신 (슬롯별 파이프, 길이 접두 바이너리 프레임)
+                //        활성 슬롯의 done/결과 JSON만 제어에 반영하고, 하트비트는 모든 슬롯에서 받음
+                case EV_VISION0:
+                case EV_VISION1: {
+                    int slot = (int)events[e].data.u32 - EV_VISION0;
+                    VisionProc* vp = &g_vis[slot];
+                    if (vp->from_fd < 0) break; // 같은 epoll 묶음에서 이미 정리된 슬롯
+                    /* 주의: fd는 논블로킹. 프레임이 덜 왔으면 남은 바이트는 리더 버퍼에 두고 다음 이벤트에 이어 붙임 */
+                    int fill = ipc_reader_fill(&vp->reader, vp->from_fd);
+                    double t_rx = now_sec();
+                    IpcMessage msg;
+                    while (ipc_reader_next(&vp->reader, &msg)) {
+                        if (msg.type == IPC_MSG_HEARTBEAT) {
+                            vision_heartbeat(slot, &msg, t_rx);
+                        } else if (slot == g_vis_active) {
+                            handle_python_message(&msg, &ai_state_flag);
+                        }
                     }
+
+                    /* EOF(파이썬 종료) 감지: 활성이었으면 대기 프로세스로 바로 교체 (새 대기 프로세스는 제어 주기에서 띄움) */
+                    if (fill == 0 && vision_lost(slot, "exited (EOF)", t_rx)) {
+                        ai_state_reset(&ai_state_flag);
+                    }
+                    break;
                 }
 
-                // ===========================================================================
-                
-                
-                
+                default:
+                    break;
+                }
             }
 
-            // --- B. I/O 멀티플렉싱(select) 단계 ---
-            /* ===== [ADD] select()로 파이썬 파이프 + CAN 소켓을 동시에 감시 ==================
-                *  - 타임아웃: 50ms (프로토타입 기준 반응성/부하 균형)
-                *  - 준비된 FD만 비동기적으로 처리 → 한 루프에서 가능한 한 많이 소화
-                * ========================================================================= */
-            fd_set rfds;
-            FD_ZERO(&rfds);
-            int maxfd = -1;
-            if (pipe_from_python_fd >= 0) {
-                FD_SET(pipe_from_python_fd, &rfds);
-                if (pipe_from_python_fd > maxfd) maxfd = pipe_from_python_fd;
-            }
-            if (can_fd >= 0) {
-                FD_SET(can_fd, &rfds);
-                if (can_fd > maxfd) maxfd = can_fd;
-            }
-            if (maxfd < 0) {
-                // 감시할 FD가 없다면 잠깐 쉰 뒤 다음 루프로
-                usleep(50 * 1000);
-                continue;
-            }
+            // 제어 로직은 제어 주기 타이머에 맞춰서만 실행 (이벤트가 몰려도 주기가 흔들리지 않음)
+            if (!running || !control_tick) continue;
 
-            struct timeval tv;
-            tv.tv_sec = 0;
-            tv.tv_usec = 50 * 1000; // 50 ms
+            py_window_expire(now_sec());
 
-            int ready = select(maxfd + 1, &rfds, NULL, NULL, &tv);
-            if (ready < 0) {
-                if (errno == EINTR) continue; // 신호로 깨어남(무시)
-                perror("[C] select");
-                break;
-            }
-            if (ready == 0) {
-                // 타임아웃: 주기 작업 자리(하트비트 등)
-                printf("timeout\n");
-                // continue;
+            // 비전 프로세스 감독: 멈춘 활성 프로세스 교체, 빈 슬롯에 대기 프로세스 채우기
+            if (vision_supervise(epfd, now_sec())) {
+                ai_state_reset(&ai_state_flag);
             }
+            cam_ingest_poll(now_sec());     // 에러로 멈춘 카메라 파이프라인 재시작
+            // 녹화 파이프라인 에러(협상 실패 등) 확인 + 정지 후 mp4 마무리가 끝난 파이프라인 정리 (녹화를 꺼도 계속 호출)
+            if (storage_poll() < 0 && g_rec_on) camera_record_stop();
+
+            // >>> 6) 매 제어 주기 위험 평가: 모든 플래그가 모일 때까지 기다리지 않고,
+            //        평가에 필요한 신호만 허용 지연 이내인지 확인한 뒤 가장 최근 값과 가장 최근 AI 결과로 평가
+            //        (AI 결과는 다음 결과가 올 때까지 유지, 판단 결과는 다음 draw 요청까지 car_state_flag에 누적)
+            //        객체 좌표는 촬영 시각 기준이므로, 충돌 평가 궤적은 신호 이력으로 복원한 촬영 시각의 속도/조향각으로 계산
+            double t_tick = now_sec();
+            unsigned int fresh = sig_store_fresh_mask(&signals, t_tick);
+
+            if ((fresh & SIG_MASK_PATH) == SIG_MASK_PATH) {
+                risk_evals++;
+                // 차의 예상 경로 계산
+                calc_future_path(vehicle_data.speed, vehicle_data.degree);
+
+                // 빈 결과도 트래커에는 넣어야 하므로(놓침/나이) 갱신 대기 중이면 평가
+                if ((g_ai_objs && g_ai_count > 0) || g_trk_pending) {
+                    VehicleData ai_vehicle;
+                    unsigned int covered = sig_hist_at(&g_sig_hist, g_ai_capture_time, &vehicle_data, &ai_vehicle);
+                    if ((covered & SIG_MASK_PATH) != SIG_MASK_PATH) hist_misses++;
+                    TtcEgo ego;
+                    ttc_ego_init(&ego, ai_vehicle.speed, ai_vehicle.degree);
+
+                    // 새 AI 결과를 이전 트랙과 짝지음 (지난 촬영 이후 차량 이동은 촬영 시각의 속도/각속도로 보상)
+                    if (g_trk_pending) {
+                        if (tracker_update(&g_trk, g_ai_objs, g_ai_count, g_ai_capture_time, ego.v, ego.omega) < 0) {
+                            log_warn("[C] tracker update failed\n");
+                        }
+                        bev_grid_build(&g_bev, g_trk.out, g_trk.out_count);
+                        g_trk_pending = 0;
+                    }
+                    const DetectedObject *trk_objs = g_trk.out;
+                    int trk_count = g_trk.out_count;
 
-            // >>> 1) 파이썬 결과 수신 (라인 단위 JSON)
-            if (pipe_from_python_fd >= 0 && FD_ISSET(pipe_from_python_fd, &rfds)) {
-                /* 주의: fd는 논블로킹. stream_from_python은 stdio 버퍼를 쓰므로
-                    fgets가 즉시 NULL을 줄 수 있음(EAGAIN). 이는 '아직 한 줄이 안 채워짐' 의미 */
-                char line[4096];
-                while (fgets(line, sizeof(line), stream_from_python)) {
-                    /* vision_server.py는 결과를 한 줄 JSON으로 print하고 flush함 */
-                    handle_python_line(line, &ai_state_flag);
-                    /* 파이썬이 여러 줄을 연속적으로 보낼 수 있으므로 while로 드레인 */
-                }
+                    // 차량 가까이(MAX_DISTANCE 이내) 있는 객체만 BEV 격자에서 꺼내 종류별 플래그
+                    int near_idx[TRK_MAX_TRACKS];
+                    int near_count = bev_grid_radius(&g_bev, 0.0, 0.0, MAX_DISTANCE, near_idx, TRK_MAX_TRACKS);
+                    for (int k = 0; k < near_count; ++k) {
+                        const DetectedObject *o = &trk_objs[near_idx[k]];
+                        switch(o->label){
+                            case LABEL_CAR:
+                                break;
 
-                /* EOF(파이썬 종료) 감지 */
-                if (feof(stream_from_python)) {
-                    fprintf(stderr, "[C] Python EOF detected. Restarting child...\n");
+                            case LABEL_TRUCK:
+                                car_state_flag |= DETECT_TRUCK;
+                                break;
 
-                    // 1) AI 결과 동적 메모리/상태 정리 (누수/유효하지 않은 포인터 참조 방지)
-                    if (g_ai_objs) { free(g_ai_objs); g_ai_objs = NULL; g_ai_count = 0; }
-                    ai_state_flag = 0; // AI 결과 준비 플래그 초기화
+                            case LABEL_CONSTRUCTION_TRUCK:
+                                car_state_flag |= DETECT_TRUCK;
+                                break;
 
-                    // 2) 현 자식 프로세스 및 I/O 정리
-                    stop_python_process();
+                            case LABEL_BUS:
+                                break;
 
-                    // 3) 짧은 백오프(옵션): 연속 크래시 시 과도한 재시작을 피함
-                    sleep(1);
+                            case LABEL_TRAILER:
+                                break;
 
-                    // 4) 재시작 시도
-                    if (start_python_process() < 0) {
-                        fprintf(stderr, "[C] Restart failed. Will retry in 3s.\n");
-                        sleep(3);
-                        // 재시작 실패 시 다음 루프에서 다시 시도하도록 continue
-                        continue;
-                    }
+                            case LABEL_BARRIER:
+                                break;
 
-                    // 5) 스트림 에러 상태 초기화 (안전조치)
-                    clearerr(stream_from_python);
-                    continue; // 재시작 직후 루프 재개
-                }
-                clearerr(stream_from_python); // EAGAIN 등 클리어
-            }
+                            case LABEL_MOTOCYCLE:
+                                car_state_flag |= DETECT_ODOBANGS;
+                                break;
 
-            // >>> 2) CAN 프레임 수신 (있을 때 모두 드레인)
-            if (can_fd >= 0 && FD_ISSET(can_fd, &rfds)) {
-                while (1) {
-                    int r = can_receive_message(&can_message);
-                    if (r < 0) {
-                        // 심각한 소켓 에러 가능 (프로토타입: 경고만)
-                        perror("[C] can_receive_message");
-                        break;
-                    } else if (r == 0) {
-                        // 읽을 데이터 없음(논블로킹): 루프 종료
-                        break;
-                    } else {
-                        // 정상 프레임 1개 수신 → 파싱 및 상태 플래그 갱신
-                        can_parse_and_update_data(&can_message, &vehicle_data, &state_flag, &state_flag2);
-                    }
-                }
-                printf("[DEBUG] Flags: state_flag=0x%02X, state_flag2=0x%02X, ai_state_flag=0x%02X\n",
-                state_flag, state_flag2, ai_state_flag);
-            }
+                            case LABEL_BICYCLE:
+                                car_state_flag |= DETECT_ODOBANGS;
+                                break;
 
-            // >>> 3) 완료 조건 체크: AI 결과 + CAN 측 “완료 세트” 충족 시 제어 로직 실행
-            /* COMPLETE_DATA_FLAG는 hardware.h에 정의된 전체 데이터 집합 플래그임.
-                (ENGINE_SPEED, VEHICLE_SPEED, GEAR_STATE, GPS, STEERING, BRAKE, TIRE 등)
-                프로토타입에서는 이 완전 세트를 만족했을 때 한 번 제어 로직을 실행하도록 구성. */
-            if ( ((ai_state_flag & AI_RESULT_READY_FLAG) == AI_RESULT_READY_FLAG) &&
-                    ((state_flag & COMPLETE_DATA_FLAG) == COMPLETE_DATA_FLAG) &&
-                    ((state_flag2 & 0x01) == 0x01) ) {
+                            case LABEL_PEDESTRIAN:
+                                car_state_flag |= DETECT_HUMAN;
+                                break;
 
-                
-                //확인용 로그 출력
-                printf("[Path Prediction] ----------------------\n");
-                for(int i=0; i<POS_COUNT; i++){
-                    double t = (i+1) * PREDICTION_DT;
-                    printf("T+%.1fs: (%.2f, %.2f)\n", t, PosX_array[i], PosY_array[i]);
-                }
-                printf("----------------------------------------\n");
-
-            // ======= [ADD] 최종 제어 로직 지점 ==========================================
-                if (g_ai_objs && g_ai_count > 0) {
-                    for (int i = 0; i < g_ai_count; ++i) {
-                        const DetectedObject *o = &g_ai_objs[i];
-                        // TODO: 제어 로직 
-                        printf("[AI] L=%u x=%.2f y=%.2f ax=%.2f ay=%.2f\n",
-                                    o->label, o->x, o->y, o->ax, o->ay);
-                        //AI로부터 받은 JSON파일 분석
-                        // TODO: 동적 배열 for문으로 순회하면서 거리 및 좌표를 통한 거리 계산
-                        /*
-                        받는 데이터 형식
-                        typedef struct{
-                            unsigned char label;
-                            float x;
-                            float y;
-                            float ax;
-                            float ay;
-                        }DetectedObject;
-                        */
-                        //ai의 label 구성
-                        /*
-                        0 = car
-                        1 = truck
-                        2 = construction_vehicle
-                        3 = bus
-                        6 = motorcycle
-                        7 = bicycle
-                        8 = pedestrian // 보행자
-                        */
-                        float distance = hypotf(o->x, o->y);
-                        
-                        //거리가 임계값 안이라면
-                        if(distance <= MAX_DISTANCE){
-                            switch(o->label){
-                                case LABEL_CAR:
-                                    break;
-
-                                case LABEL_TRUCK:
-                                    car_state_flag |= DETECT_TRUCK;
-                                    break;
-
-                                case LABEL_CONSTRUCTION_TRUCK:
-                                    car_state_flag |= DETECT_TRUCK;
-                                    break;
-
-                                case LABEL_BUS:
-                                    break;
-
-                                case LABEL_TRAILER:
-                                    break;
-
-                                case LABEL_BARRIER:
-                                    break;
-
-                                case LABEL_MOTOCYCLE:
-                                    car_state_flag |= DETECT_ODOBANGS;
-                                    break;
-
-                                case LABEL_BICYCLE:
-                                    car_state_flag |= DETECT_ODOBANGS;
-                                    break;
-
-                                case LABEL_PEDESTRIAN:
-                                    car_state_flag |= DETECT_HUMAN;
-                                    break;
-
-                                case LABEL_TRAFFIC_CONE:
-                                    break;
-
-                                default:
-                                    break;
-                            }
-                        }
+                            case LABEL_TRAFFIC_CONE:
+                                break;
 
-                        
+                            default:
+                                break;
+                        }
                     }
-                    
-                    // 2. 미래 충돌 예측 검사 및 플래그 갱신
-                    if (check_collision_risk(g_ai_objs, g_ai_count, PosX_array, PosY_array, POS_COUNT)) {
+
+                    // 미래 충돌 예측: 지금 궤적의 첫 접촉 시각(TTC) + 조향/가감속 가설 여러 개의 객체별 충돌 확률
+                    // (확률을 구했으면 확률로, 작업 스레드 풀이 없으면 TTC로 판단)
+                    int ttc_hits = check_collision_risk(trk_objs, g_trk.out_id, trk_count, &ego);
+                    if (risk_mc_eval(&g_coll, ai_vehicle.speed, ai_vehicle.degree, RISK_MC_BUDGET_SEC, &mc_stats) > 0) {
+                        float p_max = 0.0f;
+                        for (int i = 0; i < g_coll.count; ++i) {
+                            if (g_coll.prob[i] > p_max) p_max = g_coll.prob[i];
+                        }
+                        if (p_max >= RISK_MC_PROB_THRESH) {
+                            car_state_flag |= DETECT_CRASH_RISK;
+                        }
+                        if (p_max > mc_p_max) mc_p_max = p_max;
+                    } else if (ttc_hits > 0) {
                         car_state_flag |= DETECT_CRASH_RISK;
                     }
-                                    
-
                 }
-                //=========가속도 저장 부분=============
-                double t_now = now_sec(); //현재 시간 측정
-                double v_now_kph = (double)vehicle_data.speed; //속도 int -> double 형변환
-                spmon_push(&g_spmon, v_now_kph, t_now); //속도, 시간 추가
-
-                //직전 샘플과 비교하여 가속도 계산 
-                double v_prev_kph, t_prev;
-                if(spmon_get_past(&g_spmon, 1, &v_prev_kph, &t_prev) == 0){
-                    double dv_mps = (v_now_kph - v_prev_kph) * KPH_TO_MPS;
-                    double dt     = t_now - t_prev;
-                    if(dt > 0.0){
-                        double a_mps2 = dv_mps / dt;//가속도 계산
-                        
-                        //가속도 감지 후 동작
-
-                        //급가속
-                        if (a_mps2 >= ACCEL_THRESH_MPS2) {
-                            printf("[EVENT] 급가속 감지: a=%.2f m/s^2 (%.1f→%.1f km/h, dt=%.2fs)\n",
-                                a_mps2, v_prev_kph, v_now_kph, dt);
-                            // TODO: 급가속 플래그 On
-                            car_state_flag |= ACCELRATION;
-                            
-
-                        //급감속
-                        } else if (a_mps2 <= DECEL_THRESH_MPS2) {
-                            printf("[EVENT] 급감속 감지: a=%.2f m/s^2 (%.1f→%.1f km/h, dt=%.2fs)\n",
-                                a_mps2, v_prev_kph, v_now_kph, dt);
-                            // TODO: 급감속 플래그 on
-                            car_state_flag |= DECELERATION;
-                        }
+            } else {
+                stale_ticks++;
+            }
 
+            //=========가속도 저장 부분=============
+            // 속도 값이 새로 들어왔을 때만 샘플 추가 (같은 값을 여러 번 넣으면 가속도가 0으로 희석됨)
+            // 시각은 제어 주기가 아니라 CAN 응답 수신 시각을 사용
+            // 가감속은 최근 KIN_WIN_SEC 창의 회귀 기울기라 1 km/h 양자화로 튀지 않음
+            if ((fresh & SIG_MASK(SIG_VEHICLE_SPEED)) &&
+                signals.sig[SIG_VEHICLE_SPEED].timestamp != last_speed_ts) {
+                double t_now = signals.sig[SIG_VEHICLE_SPEED].timestamp;
+                last_speed_ts = t_now;
+
+                if (kin_push_speed(&g_kin, (double)vehicle_data.speed, t_now)) {
+                    //급가속
+                    if (g_kin.accel >= ACCEL_THRESH_MPS2) {
+                        log_info("[EVENT] 급가속 감지: a=%.2f m/s^2 (jerk %.1f m/s^3, %d km/h, 창 %.2fs)\n",
+                            g_kin.accel, g_kin.jerk, vehicle_data.speed, g_kin.span);
+                        car_state_flag |= ACCELRATION;
+
+                    //급감속
+                    } else if (g_kin.accel <= DECEL_THRESH_MPS2) {
+                        log_info("[EVENT] 급감속 감지: a=%.2f m/s^2 (jerk %.1f m/s^3, %d km/h, 창 %.2fs)\n",
+                            g_kin.accel, g_kin.jerk, vehicle_data.speed, g_kin.span);
+                        car_state_flag |= DECELERATION;
                     }
                 }
 
-                //타이어 펑크 검출
+                // KIN_DV_LAG 샘플 전 대비 큰 속도 변화 (짧은 창에 잡히지 않는 지속적인 가감속)
+                if (g_kin.dv_kph >= DV10_KPH_THRESH) {
+                    car_state_flag |= ACCELRATION;
+                } else if (g_kin.dv_kph <= -DV10_KPH_THRESH) {
+                    car_state_flag |= DECELERATION;
+                }
+            }
+
+            // GPS 위치 차분 속도를 CAN 속도와 융합 (x, y가 모두 새로 들어왔을 때)
+            if ((fresh & SIG_MASK_GPS) == SIG_MASK_GPS &&
+                signals.sig[SIG_GPS_X].timestamp != last_gps_ts) {
+                last_gps_ts = signals.sig[SIG_GPS_X].timestamp;
+                kin_push_gps(&g_kin, vehicle_data.gps_x, vehicle_data.gps_y, last_gps_ts);
+            }
+
+            //타이어 펑크 검출 (타이어 값이 신선할 때만): 임계값 미만 + 느린 누설/다른 바퀴 대비 저압 추세
+            if (fresh & SIG_MASK(SIG_TIRE)) {
                 for(int i = 0; i < 4; i++){
                     if(vehicle_data.tire_pressure[i] < TIRE_PRESSURE_THRESHOLD){
                         car_state_flag |= DETECT_FUNK;
                     }
                 }
-                
-                if (send_save_request(stream_to_python, &vehicle_data, car_state_flag, PosX_array, PosY_array, POS_COUNT) == 0) {
-                    // 최대 3000ms(3초) 동안 "done" 대기. 0을 주면 무제한 대기.
-                    int wr = wait_python_done(stream_from_python, pipe_from_python_fd, 0);
-                    if (wr == 0) {
-                        printf("[C] Python done OK\n");
-                    } else if (wr == 1) {
-                        fprintf(stderr, "[C] Python done timeout\n");
-                    } else if (wr == -2) {
-                        fprintf(stderr, "[C] Python EOF (child exited)\n");
-                    } else {
-                        fprintf(stderr, "[C] Python done wait error\n");
+                if (signals.sig[SIG_TIRE].timestamp != last_tire_ts) {
+                    last_tire_ts = signals.sig[SIG_TIRE].timestamp;
+                    unsigned int bad = kin_push_tires(&g_kin, vehicle_data.tire_pressure, last_tire_ts);
+                    if (bad) {
+                        car_state_flag |= DETECT_FUNK;
+                        if (bad != tire_bad_prev) {
+                            log_warn("[EVENT] 타이어 이상 추세: leak=0x%x low=0x%x (%.1f %.1f %.1f %.1f psi/min)\n",
+                                g_kin.tire_leak, g_kin.tire_low, g_kin.tire[0].slope, g_kin.tire[1].slope,
+                                g_kin.tire[2].slope, g_kin.tire[3].slope);
+                        }
                     }
+                    tire_bad_prev = bad;
+                }
+            }
+
+            // >>> 7) AI 결과 도착: 이번 사이클 동안 누적된 판단 결과로 저장(draw) 요청 후 다음 사이클 시작
+            if ((ai_state_flag & AI_RESULT_READY_FLAG) == AI_RESULT_READY_FLAG) {
+
+                //확인용 로그 출력
+                log_debug("[Path Prediction] ----------------------\n");
+                for(int i=0; i<POS_COUNT; i++){
+                    double t = (i+1) * PREDICTION_DT;
+                    log_debug("T+%.1fs: (%.2f, %.2f)\n", t, g_path.x[i], g_path.y[i]);
+                }
+                log_debug("----------------------------------------\n");
+                for (int i = 0; i < g_ai_count; ++i) {
+                    const DetectedObject *o = &g_ai_objs[i];
+                    log_debug("[AI] L=%u x=%.2f y=%.2f ax=%.2f ay=%.2f s=%.2f\n",
+                                o->label, o->x, o->y, o->ax, o->ay, o->score);
+                }
+                for (int i = 0; i < g_trk.count; ++i) {
+                    const Track *tr = &g_trk.tracks[i];
+                    log_debug("[TRK] id=%u L=%u x=%.2f y=%.2f vx=%.2f vy=%.2f age=%d%s\n",
+                                tr->id, tr->label, tr->x, tr->y, tr->vx, tr->vy, tr->age,
+                                tr->confirmed ? (tr->misses ? " (coasting)" : "") : " (tentative)");
+                }
 
+                if (send_save_request(vision_active_fd(), &vehicle_data, car_state_flag, g_path.x, g_path.y, POS_COUNT, g_ai_token) == 0) {
+                    // done을 기다리지 않음: 토큰을 in-flight 창에 넣고 바로 다음 사이클로 (완료는 EV_VISION*에서 처리)
+                    py_window_add(g_ai_token, now_sec());
                 } else {
                         perror("[C] send_save_request failed");
                 }
 
-                //메모리 해제
-                if (g_ai_objs) { free(g_ai_objs); g_ai_objs = NULL; g_ai_count = 0; }
-                state_flag = 0;
-                state_flag2 = 0;
+                // AI 결과(g_ai_objs)는 다음 결과가 올 때까지 위험 평가에 계속 사용
                 ai_state_flag = 0;
                 car_state_flag = 0;
-                printf("\nfinish one cycle, next cycle will be started.\n");
+                log_info("finish one cycle, next cycle will be started.\n");
+
+                //제어 주기 통계 출력 (timerfd 틱 간격 = 실제 사이클 타이밍)
+                if (control_timing.ticks > 0) {
+                    log_info("[C] control tick: target=%.1fms avg=%.1fms min=%.1fms max=%.1fms overruns=%u\n",
+                           1e3 / control_hz, control_timing.period_sum / control_timing.ticks * 1e3,
+                           control_timing.period_min * 1e3, control_timing.period_max * 1e3,
+                           control_timing.overruns);
+                }
+                control_timing.ticks = 0;
+                control_timing.period_sum = 0.0;
+                control_timing.overruns = 0;
+                log_info("[C] python in-flight=%d/%d backpressure=%u failovers=%u active slot=%d\n",
+                       g_py_inflight_count, PY_INFLIGHT_MAX, py_backpressure, g_vis_failovers, g_vis_active);
+                log_info("[C] risk eval=%u stale skip=%u history miss=%u, AI lag=%.1fms, CAN stale-inflight=%u\n",
+                       risk_evals, stale_ticks, hist_misses, (now_sec() - g_ai_capture_time) * 1e3, can_snap.stale_inflight);
+                log_info("[C] path: computed=%lu reused=%lu, tracks=%d confirmed=%d created=%lu dropped=%lu\n",
+                       g_path.computed, g_path.reused, g_trk.count, g_trk.out_count, g_trk.created, g_trk.dropped);
+                g_trk.created = 0;
+                g_trk.dropped = 0;
+                log_info("[C] kinematics: a=%.2f m/s^2 jerk=%.1f dv%d=%.0f km/h, fused v=%.2f m/s (gps %.2f)\n",
+                       g_kin.accel, g_kin.jerk, KIN_DV_LAG, g_kin.dv_kph, g_kin.fv, g_kin.gps_speed);
+                log_info("[C] tire trend: %.2f %.2f %.2f %.2f psi/min\n",
+                       g_kin.tire[0].slope, g_kin.tire[1].slope, g_kin.tire[2].slope, g_kin.tire[3].slope);
+                g_path.computed = 0;
+                g_path.reused = 0;
+                cam_ingest_stats(&cam_stats);
+                if (cam_stats.cams > 0) {
+                    unsigned long cam_frames = 0, cam_drops = 0;
+                    for (int i = 0; i < cam_stats.cams; i++) {
+                        cam_frames += cam_stats.frames[i];
+                        cam_drops += cam_stats.drops[i];
+                    }
+                    log_info("[C] cameras: frames=%lu drops=%lu restarts=%u last set=%d/%d spread=%.1fms\n",
+                           cam_frames, cam_drops, cam_stats.restarts, cam_set.valid, cam_set.count, cam_set.spread * 1e3);
+                }
+                log_info("[C] risk MC: samples=%d threads=%d elapsed=%.2fms, max p=%.2f\n",
+                       mc_stats.samples, mc_stats.threads, mc_stats.elapsed * 1e3, mc_p_max);
+                risk_evals = 0;
+                stale_ticks = 0;
+                hist_misses = 0;
+                mc_p_max = 0.0f;
+
+                //PID별 응답 지연/신호 나이 출력 (지연 통계는 수집 스레드가 주기마다 갱신하는 복사본)
+                can_acq_sched_stats(&g_can_stats);
+                for (int i = 0; i < g_can_stats.count; i++) {
+                    const CANPidSlot* slot = &g_can_stats.slots[i];
+                    int sig = sig_from_pid(slot->pid);
+                    double age = (sig >= 0) ? sig_store_age(&signals, (SignalId)sig, t_tick) : -1.0;
+                    log_info("[CAN] PID 0x%02X latency last=%.1fms avg=%.1fms timeouts=%u failures=%u age=%.1fms\n",
+                           slot->pid, slot->last_latency * 1e3, slot->avg_latency * 1e3,
+                           slot->timeouts, slot->failures, age * 1e3);
+                }
 
             }
 
             if((ai_state_flag & AI_RESEULT_ERROR_FLAG) == AI_RESEULT_ERROR_FLAG){
                 //메모리 해제
-                if (g_ai_objs) { free(g_ai_objs); g_ai_objs = NULL; g_ai_count = 0; }
+                ai_objs_clear();
                 
-                printf("\nAI error occurred, next cycle will be started.\n");
+                log_info("AI error occurred, next cycle will be started.\n");
 
                 car_state_flag |= 0x80; //AI 에러 플래그
 
-                if (send_save_request(stream_to_python, &vehicle_data, car_state_flag, PosX_array, PosY_array, POS_COUNT) == 0) {
-                    // 최대 3000ms(3초) 동안 "done" 대기. 0을 주면 무제한 대기.
-                    int wr = wait_python_done(stream_from_python, pipe_from_python_fd, 0);
-                    if (wr == 0) {
-                        printf("[C] Python done OK\n");
-                    } else if (wr == 1) {
-                        fprintf(stderr, "[C] Python done timeout\n");
-                    } else if (wr == -2) {
-                        fprintf(stderr, "[C] Python EOF (child exited)\n");
-                    } else {
-                        fprintf(stderr, "[C] Python done wait error\n");
-                    }
-
+                if (send_save_request(vision_active_fd(), &vehicle_data, car_state_flag, g_path.x, g_path.y, POS_COUNT, g_ai_token) == 0) {
+                    // done을 기다리지 않음: 토큰을 in-flight 창에 넣고 바로 다음 사이클로 (완료는 EV_VISION*에서 처리)
+                    py_window_add(g_ai_token, now_sec());
                 } else {
                         perror("[C] send_save_request failed");
                 }
-                state_flag = 0;
-                state_flag2 = 0;
                 ai_state_flag = 0;
                 car_state_flag = 0;
 
@@ -1086,13 +1391,32 @@
             
             
 
-            // 필요하면 필수 두 데이터(GPS/STEER) 플래그만 리셋해서,
-            // 다시 두 데이터를 확보한 뒤 새로운 analyze 라운드를 도는 정책도 가능.
             
 
-        } // --- while(1) 루프 끝 ---
+        } // --- while(running) 루프 끝 ---
 
-        printf("\n[C] Main process finished. Cleaning up resources.\n");
-        stop_python_process();              // 파이썬 자식/파이프/스트림 한 번에 정리
+        log_info("[C] Main process finished. Cleaning up resources.\n");
+        close(control_timer_fd);
+        close(ai_timer_fd);
+        close(signal_fd);
+        close(epfd);
+        for (int s = 0; s < VISION_SLOTS; s++) {
+            vision_kill(s, 1);              // 파이썬 자식(활성/대기)과 파이프 정리
+        }
+        can_acq_stop();                     // CAN 수집 스레드 종료 + CAN/BCM 소켓 정리
+        camera_record_stop();
+        storage_finish();                   // 녹화 중(또는 마무리 중)이면 mp4 마무리까지 대기
+        cam_ingest_stop();                  // 카메라 파이프라인 정지 + 프레임 링 해제
+        ai_objs_clear();
+        det_shm_destroy();                  // 탐지 결과 공유 메모리/eventfd 정리
+        for (int s = 0; s < VISION_SLOTS; s++) {
+            ipc_reader_free(&g_vis[s].reader);
+        }
+        det_pool_free(&g_ai_pools[0]);
+        det_pool_free(&g_ai_pools[1]);
+        tracker_free(&g_trk);
+        risk_mc_stop();                     // 충돌 확률 작업 스레드 종료
+        coll_batch_free(&g_coll);
+        log_stop();                         // 남은 로그 출력 후 드레인 스레드 종료
         return 0;
     }
\ No newline at end of file
@@ -0,0 +1,147 @@
+/**
+ * @file bench_collision.c
+ * @brief 충돌 검사 벤치마크: coll_batch_check(SoA + SIMD 배치) vs 기존 main.c check_collision_risk 스칼라 루프,
+ *        그리고 같은 객체에 대한 연속 시간 TTC(coll_batch_ttc) 비용.
+ * @details
+ * 임의 객체를 객체 수별로 만들고, 곡선 예상 경로(POS_COUNT 단계) 하나에 대해 두 검사기를 반복 실행해 호출당 시간을 비교합니다.
+ * 기존 루프는 첫 충돌에서 멈추므로, 공정하게 비교하려고 객체마다 끝까지 돌며 같은 결과(첫 접촉 시각, 최소 거리)를 내게 고쳐 두었습니다.
+ * 측정 전에 두 결과가 같은지(거리는 float 오차 이내) 한 번 비교합니다.
+ * TTC는 샘플 간격이 없는 대신 예측 구간이 속도에 맞춰 정해지므로 접촉 수(ttc hits)가 다를 수 있습니다.
+ *
+ * 실행 예:
+ *   make bench && ./build/bin/bench_collision 20000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "hardware.h"
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// 예전 check_collision_risk()와 같은 계산 (fmin/fmax clamp 후 거리), 객체마다 첫 접촉 시각과 최소 거리를 남김
+static int check_scalar(const DetectedObject* objs, int n, const double* path_x, const double* path_y, int path_count,
+                        float* t_contact, float* min_dist) {
+    const double L_half = VEHICLE_LENGTH / 2.0;
+    const double W_half = VEHICLE_WIDTH / 2.0;
+    const double r2 = COLL_OBJ_RADIUS * COLL_OBJ_RADIUS;
+    int hits = 0;
+
+    for (int i = 0; i < n; i++) {
+        double best = INFINITY;
+        t_contact[i] = COLL_NO_CONTACT;
+        for (int k = 0; k < path_count; k++) {
+            double t = (k + 1) * PREDICTION_DT;
+            double ox = objs[i].x + objs[i].ax * t;
+            double oy = objs[i].y + objs[i].ay * t;
+            double cx = fmax(path_x[k] - L_half, fmin(ox, path_x[k] + L_half));
+            double cy = fmax(path_y[k] - W_half, fmin(oy, path_y[k] + W_half));
+            double d2 = (ox - cx) * (ox - cx) + (oy - cy) * (oy - cy);
+            if (d2 < best) best = d2;
+            if (d2 <= r2 && t_contact[i] < 0.0f) t_contact[i] = (float)t;
+        }
+        min_dist[i] = (float)sqrt(best);
+        if (t_contact[i] >= 0.0f) hits++;
+    }
+    return hits;
+}
+
+// 차량 주변 ±30m에 흩어진 객체, 일부는 경로 쪽으로 다가옴
+static void make_objects(DetectedObject* objs, int n) {
+    srand(4321 + n);
+    for (int i = 0; i < n; i++) {
+        objs[i].label = (unsigned char)(rand() % 10);
+        objs[i].x = (rand() % 6000) / 100.0f - 10.0f;
+        objs[i].y = (rand() % 6000) / 100.0f - 30.0f;
+        objs[i].ax = (rand() % 800) / 100.0f - 4.0f;
+        objs[i].ay = (rand() % 800) / 100.0f - 4.0f;
+        objs[i].score = 1.0f;
+    }
+}
+
+int main(int argc, char** argv) {
+    int iters = (argc > 1) ? atoi(argv[1]) : 20000;
+    if (iters <= 0) iters = 20000;
+    static const int sizes[] = { 10, 50, 200, 500 };
+
+    // 30km/h, 완만한 좌회전 경로
+    double path_x[POS_COUNT], path_y[POS_COUNT];
+    double v = 30.0 * KPH_TO_MPS, R = 40.0;
+    for (int k = 0; k < POS_COUNT; k++) {
+        double th = v * (k + 1) * PREDICTION_DT / R;
+        path_x[k] = R * sin(th);
+        path_y[k] = R * (1.0 - cos(th));
+    }
+
+    TtcEgo ego;
+    ttc_ego_init(&ego, 30, (float)(atan(VEHICLE_WHEELBASE / R) * 180.0 / M_PI)); // 같은 원호
+
+    CollBatch batch;
+    if (coll_batch_init(&batch, 16) < 0) return 1;
+
+    printf("kernel: %s\n", coll_kernel_name());
+    printf("%8s %6s %16s %16s %8s %10s %14s\n", "objects", "hits", "scalar ns/call", "batch ns/call", "speedup",
+           "ttc hits", "ttc ns/call");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        DetectedObject* objs = malloc(sizeof(DetectedObject) * (size_t)n);
+        float* ref_t = malloc(sizeof(float) * (size_t)n);
+        float* ref_d = malloc(sizeof(float) * (size_t)n);
+        if (!objs || !ref_t || !ref_d) return 1;
+        make_objects(objs, n);
+
+        // 결과 일치 확인
+        int ref_hits = check_scalar(objs, n, path_x, path_y, POS_COUNT, ref_t, ref_d);
+        if (coll_batch_load(&batch, objs, n) < 0) return 1;
+        int hits = coll_batch_check(&batch, path_x, path_y, POS_COUNT, PREDICTION_DT);
+        if (hits != ref_hits) {
+            fprintf(stderr, "hit count differs for %d objects (scalar %d, batch %d)\n", n, ref_hits, hits);
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            if (batch.t_contact[i] != ref_t[i] || fabsf(batch.min_dist[i] - ref_d[i]) > 1e-3f * (1.0f + ref_d[i])) {
+                fprintf(stderr, "mismatch at %d: t %.2f/%.2f dist %.4f/%.4f\n",
+                        i, ref_t[i], batch.t_contact[i], ref_d[i], batch.min_dist[i]);
+                return 1;
+            }
+        }
+
+        volatile float sink = 0.0f;
+        double t0 = bench_now();
+        for (int it = 0; it < iters; it++) {
+            sink += (float)check_scalar(objs, n, path_x, path_y, POS_COUNT, ref_t, ref_d);
+        }
+        double t1 = bench_now();
+        for (int it = 0; it < iters; it++) {
+            coll_batch_load(&batch, objs, n);
+            sink += (float)coll_batch_check(&batch, path_x, path_y, POS_COUNT, PREDICTION_DT);
+        }
+        double t2 = bench_now();
+        int ttc_hits = 0;
+        for (int it = 0; it < iters; it++) {
+            coll_batch_load(&batch, objs, n);
+            ttc_hits = coll_batch_ttc(&batch, &ego);
+            sink += (float)ttc_hits;
+        }
+        double t3 = bench_now();
+        (void)sink;
+
+        double ns_scalar = (t1 - t0) * 1e9 / iters;
+        double ns_batch = (t2 - t1) * 1e9 / iters;
+        double ns_ttc = (t3 - t2) * 1e9 / iters;
+        printf("%8d %6d %16.0f %16.0f %7.1fx %10d %14.0f\n", n, hits, ns_scalar, ns_batch, ns_scalar / ns_batch,
+               ttc_hits, ns_ttc);
+        free(objs);
+        free(ref_t);
+        free(ref_d);
+    }
+
+    coll_batch_free(&batch);
+    return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file bench_det_json.c
+ * @brief AI 결과 JSON 파싱 벤치마크: det_json_parse(단일 패스 스캐너) vs 기존 cJSON 경로.
+ * @details
+ * vision_server.py의 json.dumps 출력과 같은 모양({"objects": [{"label": .., "x": .., ...}], "token": N})을
+ * 객체 수별로 만들어 두고, 두 파서로 같은 입력을 반복 파싱해 호출당 시간을 비교합니다.
+ * cJSON 경로는 main.c의 예전 parse_ai_results()와 같은 순서(파싱 → 키 검색 → malloc → 트리 해제)를 그대로 따릅니다.
+ * 측정 전에 두 결과가 같은지 한 번 비교합니다.
+ *
+ * 실행 예:
+ *   make bench && ./build/bin/bench_det_json 20000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "cJSON.h"
+#include "hardware.h"
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// 예전 main.c parse_ai_results()와 같은 방식 (score는 원래 버려졌지만 비교를 위해 같이 읽음)
+static DetectedObject* parse_cjson(const char* json, size_t len, int* count, long* token) {
+    *count = 0;
+    *token = -1;
+    cJSON* root = cJSON_ParseWithLength(json, len);
+    if (!root) return NULL;
+
+    cJSON* jtoken = cJSON_GetObjectItemCaseSensitive(root, "token");
+    if (cJSON_IsNumber(jtoken)) *token = (long)jtoken->valuedouble;
+
+    cJSON* arr = cJSON_GetObjectItemCaseSensitive(root, "objects");
+    int n = cJSON_IsArray(arr) ? cJSON_GetArraySize(arr) : 0;
+    if (n <= 0) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    DetectedObject* out = calloc((size_t)n, sizeof(DetectedObject));
+    if (!out) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+
+    int i = 0;
+    cJSON* e;
+    cJSON_ArrayForEach(e, arr) {
+        if (!cJSON_IsObject(e)) continue;
+        cJSON* jl = cJSON_GetObjectItemCaseSensitive(e, "label");
+        cJSON* jx = cJSON_GetObjectItemCaseSensitive(e, "x");
+        cJSON* jy = cJSON_GetObjectItemCaseSensitive(e, "y");
+        cJSON* jax = cJSON_GetObjectItemCaseSensitive(e, "ax");
+        cJSON* jay = cJSON_GetObjectItemCaseSensitive(e, "ay");
+        cJSON* js = cJSON_GetObjectItemCaseSensitive(e, "score");
+        out[i].label = (unsigned char)(cJSON_IsNumber(jl) ? jl->valueint : 0);
+        out[i].x = (float)(cJSON_IsNumber(jx) ? jx->valuedouble : 0.0);
+        out[i].y = (float)(cJSON_IsNumber(jy) ? jy->valuedouble : 0.0);
+        out[i].ax = (float)(cJSON_IsNumber(jax) ? jax->valuedouble : 0.0);
+        out[i].ay = (float)(cJSON_IsNumber(jay) ? jay->valuedouble : 0.0);
+        out[i].score = (float)(cJSON_IsNumber(js) ? js->valuedouble : 1.0);
+        i++;
+    }
+    cJSON_Delete(root);
+    *count = i;
+    return out;
+}
+
+// vision_server.py의 json.dumps(기본 구분자 ", " / ": ")와 같은 모양으로 입력 생성
+static char* make_input(int n, size_t* len) {
+    size_t cap = 64 + (size_t)n * 128;
+    char* buf = malloc(cap);
+    if (!buf) return NULL;
+
+    size_t pos = (size_t)snprintf(buf, cap, "{\"objects\": [");
+    srand(1234 + n);
+    for (int i = 0; i < n; i++) {
+        pos += (size_t)snprintf(buf + pos, cap - pos,
+            "%s{\"label\": %d, \"x\": %.1f, \"y\": %.1f, \"ax\": %.1f, \"ay\": %.1f, \"score\": %.6f}",
+            i ? ", " : "", rand() % 10,
+            (rand() % 6000) / 100.0 - 30.0, (rand() % 6000) / 100.0 - 30.0,
+            (rand() % 400) / 100.0 - 2.0, (rand() % 400) / 100.0 - 2.0,
+            0.3 + (rand() % 7000) / 10000.0);
+    }
+    pos += (size_t)snprintf(buf + pos, cap - pos, "], \"token\": %d}", 4242 + n);
+    *len = pos;
+    return buf;
+}
+
+static int same_result(const DetectedObject* a, const DetectedObject* b, int n) {
+    for (int i = 0; i < n; i++) {
+        if (a[i].label != b[i].label || a[i].x != b[i].x || a[i].y != b[i].y ||
+            a[i].ax != b[i].ax || a[i].ay != b[i].ay || a[i].score != b[i].score) {
+            fprintf(stderr, "mismatch at %d\n", i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    int iters = (argc > 1) ? atoi(argv[1]) : 20000;
+    if (iters <= 0) iters = 20000;
+    static const int sizes[] = { 5, 20, 100, 500 };
+
+    DetPool pool;
+    if (det_pool_init(&pool, 16) < 0) return 1;
+
+    printf("%8s %10s %14s %14s %8s\n", "objects", "bytes", "cJSON ns/call", "scan ns/call", "speedup");
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        size_t len;
+        char* json = make_input(sizes[k], &len);
+        if (!json) return 1;
+
+        // 결과 일치 확인
+        int n_ref;
+        long tok_ref, tok;
+        DetectedObject* ref = parse_cjson(json, len, &n_ref, &tok_ref);
+        int n = det_json_parse(json, len, &pool, &tok);
+        if (!ref || n != n_ref || tok != tok_ref || !same_result(ref, pool.items, n)) {
+            fprintf(stderr, "results differ for %d objects (cJSON %d, scan %d)\n", sizes[k], n_ref, n);
+            return 1;
+        }
+        free(ref);
+
+        volatile float sink = 0.0f;
+        double t0 = bench_now();
+        for (int i = 0; i < iters; i++) {
+            DetectedObject* objs = parse_cjson(json, len, &n_ref, &tok_ref);
+            sink += objs[n_ref - 1].x;
+            free(objs);
+        }
+        double t1 = bench_now();
+        for (int i = 0; i < iters; i++) {
+            n = det_json_parse(json, len, &pool, &tok);
+            sink += pool.items[n - 1].x;
+        }
+        double t2 = bench_now();
+        (void)sink;
+
+        double ns_cjson = (t1 - t0) * 1e9 / iters;
+        double ns_scan = (t2 - t1) * 1e9 / iters;
+        printf("%8d %10zu %14.0f %14.0f %7.1fx\n", sizes[k], len, ns_cjson, ns_scan, ns_cjson / ns_scan);
+        free(json);
+    }
+
+    det_pool_free(&pool);
+    return 0;
+}
@@ -39,9 +39,22 @@ extern "C" {
 // --- 위험 상태 관련 변수 ---
 #define MAX_DISTANCE                2.0
 
-// --- 가속도 측정 관련 변수 ---
-#define SPEED_BUF                   32 // 최근 32개 사이클 저장
+// --- 가속도 측정 관련 변수 (주행 상태 추정기 KinEstimator) ---
 #define KPH_TO_MPS                  (1.0/3.6)
+#define KIN_WIN                     16   // 가감속/저크 회귀 창 최대 샘플 수
+#define KIN_WIN_SEC                 1.5  // 회귀 창 시간 폭 (이보다 오래된 샘플은 창에서 뺌)
+#define KIN_MIN_SPAN_SEC            0.3  // 창이 이보다 짧으면 가감속을 내지 않음
+#define KIN_REBASE_EVERY            64   // 이 샘플 수마다 누적합을 창에서 다시 계산 (빼기 누적 오차 제거)
+#define KIN_DV_LAG                  10   // DV10_KPH_THRESH 비교 샘플 간격
+#define KIN_SPEED_SIGMA_MPS         0.3  // CAN 속도 측정 잡음 (1 km/h 양자화 포함)
+#define KIN_GPS_SPEED_SIGMA_MPS     1.0  // GPS 위치 차분 속도 잡음
+#define KIN_GPS_MIN_DT              0.1  // GPS 차분 최소 간격 (초)
+#define KIN_GPS_MAX_DT              2.0  // 이보다 벌어진 GPS 샘플은 차분하지 않음
+#define KIN_JERK_SIGMA              3.0  // 속도 융합 필터 과정 잡음 (m/s^3)
+#define KIN_TIRE_TAU_SEC            300.0 // 공기압 추세 지수 가중 시상수 (초)
+#define KIN_TIRE_MIN_SPAN_SEC       60.0 // 추세를 믿기 위한 최소 관측 시간
+#define KIN_TIRE_LEAK_PSI_MIN       0.5  // 이보다 빨리 빠지면 누설 (psi/분)
+#define KIN_TIRE_DIFF_PSI           4.0  // 나머지 타이어 평균보다 이만큼 낮으면 이상 (psi)
 
 // 튜닝 임계값(조절하면서 튜닝)
 #define ACCEL_THRESH_MPS2           2.5 // 급가속: +2.5 m/s^2 이상
@@ -52,6 +65,17 @@ extern "C" {
 #define AI_RESULT_READY_FLAG        0x02
 #define AI_RESEULT_ERROR_FLAG        0x04
 
+// analyze/draw 사이클 토큰 파이프라인 (C는 draw 후 done을 기다리지 않고 다음 사이클 진행)
+#define PY_INFLIGHT_MAX             3    // done을 받지 못한 채 진행할 수 있는 최대 사이클 수 (가득 차면 새 analyze 보류)
+#define PY_DONE_TIMEOUT_SEC         5.0  // 이 시간 안에 done이 없으면 창에서 제거 (파이썬 정체 대비)
+
+// 비전(파이썬) 프로세스 감독: 활성 1개 + 모델을 미리 올려 두고 기다리는 대기 1개
+#define VISION_HEARTBEAT_SEC        0.1  // 파이썬 하트비트 주기 (ai/ipc_msg.py HEARTBEAT_SEC)
+#define VISION_HANG_SEC             0.5  // 하트비트가 이만큼 끊기면 멈춘 것으로 보고 대기 프로세스로 교체
+#define VISION_INIT_TIMEOUT_SEC     120.0 // 대기 프로세스 초기화가 이 안에 끝나지 않으면 다시 띄움
+#define VISION_RESPAWN_BACKOFF_SEC  1.0  // 프로세스를 잃은 뒤 새 대기 프로세스를 띄우기까지 (연속 크래시 시 과도한 재시작 방지)
+#define VISION_ENV_ROLE             "BLACKBOX_VISION_ROLE" // "standby"면 초기화 후 IPC_MSG_ACTIVATE를 기다림
+
 #define GPS_AVAILABLE               (GPS_XDATA_FLAG|GPS_YDATA_FLAG)
 #define AI_AVAILABLE                (GPS_XDATA_FLAG|GPS_YDATA_FLAG|STEERING_DATA_FLAG)
 #define COMPLETE_DATA_FLAG          (ENGINE_SPEED_FLAG|VEHICLE_SPEED_FLAG|GEAR_STATE_FLAG|GPS_XDATA_FLAG|GPS_YDATA_FLAG|STEERING_DATA_FLAG|BRAKE_DATA_FLAG|TIRE_DATA_FLAG)
@@ -60,6 +84,7 @@ extern "C" {
 #define ACCELRATION                 0x01 //급가속 감지                 
 #define DECELERATION                0x02 //급감속 감지
 #define DETECT_HUMAN                0x04 //사람 감지
+#define DETECT_CRASH_RISK           0x08 // 예상 경로상 충돌 위험
 #define DETECT_TRUCK                0x10 // 트럭 감지
 #define DETECT_ODOBANGS             0x20 // 오토바이, 자전거 감지
 #define DETECT_FUNK                 0x40 // 펑크 감지
@@ -81,6 +106,10 @@ extern "C" {
 //AI 요청 프레임 속도
 #define FPS_TARGET                  5.0
 
+//메인 루프 타이머 주기 (epoll + timerfd)
+#define CONTROL_RATE_HZ             FPS_TARGET // 제어 주기: 완료 조건 확인 + 제어 로직 (실행 인자로 변경 가능)
+#define AI_REQUEST_RATE_HZ          FPS_TARGET // AI 분석 요청 주기
+
 // 충돌 예측 값들
     //핸들 각도
 //#define STEERING_RATIO              15.0
@@ -91,22 +120,66 @@ extern "C" {
     //차량 전체의 폭
 #define VEHICLE_WIDTH               2.2
 
-//파이썬에게 보낼 좌표들 설정
+//파이썬에게 보낼 좌표들 설정 (컴파일 시 -DPOS_COUNT=... -DPREDICTION_DT=...로 변경 가능)
     //파이썬에게 보낼 미래 좌표 수
+#ifndef POS_COUNT
 #define POS_COUNT                   10
+#endif
     //예측 시간(초)
+#ifndef PREDICTION_DT
 #define PREDICTION_DT               0.5
+#endif
 
 //#define MAX_STEER_WHEEL_DEG         450.0   // [추가] 핸들 최대 회전각 (보통 450~540도)
 
 
 
+// --- 주행 상태 추정 (샘플마다 O(1), 고정 메모리) ---
+// 가감속/저크: 최근 KIN_WIN_SEC 안의 속도 샘플에 직선/2차 회귀 (누적합에 새 샘플을 더하고 창 밖 샘플을 뺌).
+// 속도 융합: [속도, 가속도] 칼만 필터에 CAN 속도와 GPS 위치 차분 속도를 측정으로 넣음.
+// 타이어: 바퀴마다 지수 가중 직선 회귀로 공기압 수준과 변화율(psi/분)을 추적해 느린 누설과 다른 바퀴 대비 저압을 찾음.
 typedef struct {
-    double v_kph[SPEED_BUF];
-    double t_sec[SPEED_BUF];
-    int    idx;
-    int    count;
-} SpeedMonitor;
+    double t0;              // 누적합의 기준 시각 (마지막 샘플)
+    double w, wt, wtt, wp, wtp; // 지수 가중 합: 1, tau, tau^2, p, tau*p (tau = t - t0 <= 0)
+    double first_t;         // 첫 샘플 시각 (0이면 아직 없음)
+    double level;           // 지금 공기압 추정 (psi)
+    double slope;           // 변화율 (psi/분)
+} KinTire;
+
+typedef struct {
+    // 속도 회귀 창 (원형 버퍼)
+    double t[KIN_WIN];
+    double v[KIN_WIN];      // m/s
+    int head;               // 가장 오래된 샘플 위치
+    int count;
+    double base;            // 누적합의 기준 시각 (tau = t - base)
+    double s0, s1, s2, s3, s4, sv, stv, sttv; // 합: 1, tau, tau^2, tau^3, tau^4, v, tau*v, tau^2*v
+    int since_rebase;
+    double accel;           // 회귀 가감속 (m/s^2, 창 시간 폭이 KIN_MIN_SPAN_SEC 이상일 때만 갱신)
+    double jerk;            // 2차 회귀 저크 (m/s^3)
+    double span;            // 창 시간 폭 (초)
+    int valid;
+    // DV10: KIN_DV_LAG 샘플 전 대비 속도 변화
+    double dv_ring[KIN_DV_LAG + 1];
+    int dv_head;
+    int dv_count;
+    double dv_kph;
+    // 속도 융합 ([v, a] 칼만 필터)
+    double fv, fa;          // 융합 속도 (m/s), 가속도 (m/s^2)
+    double p_vv, p_va, p_aa;
+    double f_t;             // 필터 시각 (0이면 아직 없음)
+    double gps_x, gps_y, gps_t;
+    double gps_speed;       // 마지막 GPS 차분 속도 (m/s, 없으면 -1)
+    // 타이어 공기압 추세
+    KinTire tire[4];
+    unsigned int tire_leak;     // 비트 i: 바퀴 i 누설 추세
+    unsigned int tire_low;      // 비트 i: 바퀴 i가 나머지보다 KIN_TIRE_DIFF_PSI 이상 낮음
+} KinEstimator;
+
+void kin_init(KinEstimator* k);
+int kin_push_speed(KinEstimator* k, double v_kph, double t); // 속도 샘플 (수신 시각), 1=accel/jerk 갱신됨
+void kin_push_gps(KinEstimator* k, double x, double y, double t);   // GPS 위치 (m), 차분 속도를 융합
+unsigned int kin_push_tires(KinEstimator* k, const unsigned char psi[4], double t); // 이상 바퀴 비트 (tire_leak | tire_low)
 
 // 현재 시간 측정
 static double now_sec(void) {
@@ -115,23 +188,6 @@ static double now_sec(void) {
     return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
 }
 
-// 히스토리에 (속도[km/h], 시간[s]) 추가
-static void spmon_push(SpeedMonitor *m, double v_kph, double t_sec) {
-    m->v_kph[m->idx] = v_kph;
-    m->t_sec[m->idx] = t_sec;
-    m->idx = (m->idx + 1) % SPEED_BUF;
-    if (m->count < SPEED_BUF) m->count++;
-}
-
-// i번째 과거 샘플 읽기
-static int spmon_get_past(const SpeedMonitor *m, int offset, double *v_kph, double *t_sec) {
-    if (offset >= m->count) return -1;
-    int pos = (m->idx - 1 - offset + SPEED_BUF) % SPEED_BUF;
-    if (v_kph) *v_kph = m->v_kph[pos];
-    if (t_sec) *t_sec = m->t_sec[pos];
-    return 0;
-}
-
 //==================CAN통신 관련====================
 
 typedef struct{
@@ -151,6 +207,67 @@ typedef struct {
 FrameBuffer* camera_get_frame();
 void camera_release_frame(FrameBuffer* frame);
 
+// --- 다중 카메라 RTP/H.264 수신 엔진 (카메라마다 udpsrc → 디코드 → BGR 프레임을 공유 메모리 링에 바로 씀) ---
+#define CAM_NUM                     6           // 카메라 수 (vision_server.py NUM_CAMS)
+#define CAM_BASE_PORT               5000        // 카메라 i의 RTP 포트 = CAM_BASE_PORT + i (5000~5005)
+#define CAM_FRAME_W                 800         // 링에 저장하는 프레임 크기 (파이썬이 쓰던 resize 크기, 디코더 뒤에서 videoscale)
+#define CAM_FRAME_H                 450
+#define CAM_JITTER_LATENCY_MS       60          // rtpjitterbuffer latency
+#define CAM_RESTART_SEC             2.0         // 파이프라인 에러 후 다시 시작하기까지
+#define CAM_STALE_SEC               1.0         // 세트 기준 시각보다 이만큼 오래된 프레임은 없는 것으로 봄
+
+// --- 카메라 프레임 공유 메모리 링 (C 수신 엔진 → vision_server.py, np.frombuffer로 복사 없이 읽음) ---
+// memfd 하나에 헤더 + 카메라별 슬롯 CAM_RING_SLOTS개. 레이아웃은 ai/cam_ring.py와 바이트 단위로 같아야 합니다.
+// 슬롯 선택/보호는 C가 전부 맡음: analyze마다 시각이 맞는 프레임 세트를 골라 붙잡고(cam_ring_pick) 슬롯 번호를 프레임에 실어 보냄.
+#define CAM_RING_MAGIC              0x314D4143u // 리틀 엔디언 "CAM1"
+#define CAM_RING_VERSION            1
+#define CAM_RING_MAX_CAMS           8
+#define CAM_RING_SLOTS              4           // 카메라당 슬롯: 쓰는 중 1 + 최신 1 + 붙잡힌 세트 최대 CAM_RING_HOLDS
+#define CAM_RING_HOLDS              2           // 덮어쓰지 않고 남겨 두는 최근 세트 수 (파이썬이 읽는 중일 수 있음)
+#define CAM_RING_ENV_FD             "BLACKBOX_CAM_SHM_FD"   // 자식에게 memfd 번호를 넘기는 환경 변수
+
+typedef struct {
+    int slot;                   // 링 슬롯 번호, 프레임이 없으면 -1
+    unsigned long seq;          // 슬롯에 쓴 프레임 번호 (파이썬이 읽은 뒤 덮어쓰이지 않았는지 확인)
+    double timestamp;           // 수신 시각 (now_sec와 같은 CLOCK_MONOTONIC 시계)
+} CamFrameRef;
+
+typedef struct {
+    int count;                  // 카메라 수 (cams[0..count-1])
+    int valid;                  // 프레임이 있는 카메라 수
+    double ref_time;            // 정렬 기준 시각 (모든 카메라가 프레임을 가진 가장 늦은 시각)
+    double spread;              // 고른 프레임들의 수신 시각 차 (최대 - 최소)
+    CamFrameRef cams[CAM_RING_MAX_CAMS];
+} CamFrameSet;
+
+typedef struct {
+    int cams;
+    unsigned long frames[CAM_RING_MAX_CAMS];    // 카메라별 링에 쓴 프레임 수
+    unsigned long drops[CAM_RING_MAX_CAMS];     // 빈 슬롯이 없어 버린 프레임 수
+    unsigned int restarts;                      // 에러로 파이프라인을 다시 시작한 횟수
+} CamIngestStats;
+
+int cam_ring_create(int cams, int width, int height);  // 0=성공, -1=실패
+int cam_ring_export(void);                              // fork된 자식에서 호출: fd를 exec 후에도 유지하고 환경 변수로 넘김
+unsigned char* cam_ring_write_begin(int cam, int* slot); // 쓸 슬롯의 픽셀 영역, 빈 슬롯이 없으면 NULL (프레임 버림)
+void cam_ring_write_end(int cam, int slot, double timestamp); // 다 쓴 슬롯을 최신 프레임으로 공개
+int cam_ring_pick(CamFrameSet* out, double now);        // 시각이 맞는 세트를 골라 붙잡음, 프레임 있는 카메라 수
+void cam_ring_stats(CamIngestStats* out);
+void cam_ring_destroy(void);
+
+typedef struct {
+    int num_cams;               // 0이면 CAM_NUM
+    int base_port;              // 0이면 CAM_BASE_PORT
+    int width;                  // 0이면 CAM_FRAME_W
+    int height;                 // 0이면 CAM_FRAME_H
+    int latency_ms;             // 0이면 CAM_JITTER_LATENCY_MS
+} CamIngestConfig;
+
+int cam_ingest_start(const CamIngestConfig* cfg);       // 링 생성 + 파이프라인 시작, 0=성공, -1=실패
+void cam_ingest_poll(double now);                       // 제어 주기에서 호출: 버스 에러 확인, 멈춘 파이프라인 재시작
+void cam_ingest_stats(CamIngestStats* out);
+void cam_ingest_stop(void);                             // 파이프라인 정지 + 링 해제
+
 // ================= 3. 그래픽 렌더링 API =================
 void graphics_draw_rectangle(FrameBuffer* frame, int x, int y, int w, int h, int thickness, unsigned int color);
 void graphics_draw_text(FrameBuffer* frame, const char* text, int x, int y, int font_size, unsigned int color);
@@ -159,15 +276,35 @@ void graphics_draw_text(FrameBuffer* frame, const char* text, int x, int y, int
 int lcd_display_frame(const FrameBuffer* frame);
 
 // ================= 5. 저장 장치 API =================
-int storage_start_recording(const char* filename);
-void storage_stop_recording();
-int storage_write_frame(const FrameBuffer* frame);
+// 녹화 파이프라인은 프로세스 안에서 돌립니다 (gst-launch 자식 프로세스 없음). 설정: /etc/aiblackbox/config.json의 "record"
+//  - source "v4l2"(기본): v4l2src(dmabuf, 형식 "format") → v4l2convert(같은 형식이면 통과) → 하드웨어 H.264 인코더(dmabuf-import) → mp4
+//  - source "appsrc": storage_write_frame()이 넣는 RGB24 프레임 → v4l2convert → 하드웨어 H.264 인코더 → mp4
+//    (현재 main은 camera_get_frame() 스텁의 검은 프레임만 넣음. 대시보드 합성 화면 녹화는 아직 파이썬 OpenCV 녹화기 몫)
+#define STORAGE_CONFIG_PATH         "/etc/aiblackbox/config.json"
+#define STORAGE_ENC_FORMAT          "NV12"      // 인코더 입력 형식 (카메라가 이 형식이면 변환 없이 dmabuf 그대로)
+#define STORAGE_MAX_INFLIGHT        4           // appsrc: 인코더가 아직 놓지 않은 프레임이 이만큼이면 새 프레임은 버림
+#define STORAGE_EOS_TIMEOUT_SEC     5.0         // 정지 후 mp4 마무리(EOS)를 기다리는 최대 시간
+
+int storage_start_recording(const char* filename);  // 0=성공, -1=실패(녹화 중이거나 이전 파일 마무리 중 포함)
+void storage_stop_recording();  // EOS만 보내고 바로 돌아옴 (마무리는 storage_poll이 정리)
+void storage_finish(void);      // 종료 시: 녹화를 멈추고 mp4 마무리까지 대기 (최대 STORAGE_EOS_TIMEOUT_SEC)
+// appsrc 모드: 프레임을 복사 없이 인코더에 넘김. 0이면 frame(camera_get_frame()이 준 것)의 소유권이 녹화기로 넘어가
+// 인코더가 다 쓴 뒤 camera_release_frame()으로 해제됩니다. 음수(-errno)면 호출자가 그대로 가짐
+//   -ENODEV: appsrc 녹화 중 아님, -EINVAL: 잘못된 프레임/녹화 중 크기 변경, -EAGAIN: 인코더 밀림으로 버림
+//   -EPIPE: 파이프라인이 받지 않음 (이때만 예외로 프레임은 이미 해제됨)
+int storage_write_frame(FrameBuffer* frame);
+int storage_frame_fps(void);    // appsrc 녹화 중이면 프레임을 넣을 fps, 아니면 0
+int storage_poll(void);         // 제어 주기에서 호출: 마무리 끝난 파이프라인 정리, 버스 에러(협상 실패 등)면 녹화를 내리고 -1
 
 // ================= 6. CAN 통신 API =================
+#define CAN_RX_BATCH                32 // recvmmsg 한 번에 읽어올 최대 프레임 수
+
 typedef struct {
     unsigned int id;
     unsigned char dlc;
     unsigned char data[8];
+    double timestamp;     // 커널 수신 시각 (CLOCK_MONOTONIC 기준 초, now_sec()와 같은 시간축)
+    double hw_timestamp;  // CAN 컨트롤러 하드웨어 타임스탬프(raw, 지원하지 않으면 0)
 } CANMessage;
 
 typedef struct {
@@ -183,13 +320,190 @@ typedef struct {
     unsigned char tire_pressure[4];
 } VehicleData;
 
+// --- CAN 커널 필터 (CAN_RAW_FILTER / CAN_RAW_ERR_FILTER) ---
+#define CAN_FILTER_MAX              16    // 설치 가능한 최대 ID 필터 수
+#define CAN_OBD_RESPONSE_ID         0x7E8 // 진단 응답 ID 시작 (0x7E8 ~ 0x7EF)
+#define CAN_OBD_RESPONSE_MASK       0x7F8 // 하위 3비트 무시 → 0x7E8 ~ 0x7EF만 통과
+// 구독할 버스 에러 클래스 (linux/can/error.h의 CAN_ERR_* 값과 동일)
+//   0x0001 TX_TIMEOUT, 0x0004 CRTL(컨트롤러 상태), 0x0040 BUSOFF, 0x0080 BUSERROR, 0x0100 RESTARTED
+#define CAN_ERR_EVENTS_DEFAULT      (0x0001 | 0x0004 | 0x0040 | 0x0080 | 0x0100)
+
+typedef struct {
+    unsigned int id;    // 통과시킬 CAN ID
+    unsigned int mask;  // 비교할 비트 마스크 ((수신ID & mask) == (id & mask) 이면 통과)
+} CANFilter;
+
+// --- 멀티 PID 요청 / ISO-TP ---
+#define OBD_MAX_PIDS_PER_REQUEST    6    // 서비스 모드 01 요청 한 번에 넣을 수 있는 최대 PID 수
+#define ISOTP_MAX_PAYLOAD           64   // 재조립할 ISO-TP 응답 최대 길이(바이트)
+
+// --- CAN 요청 스케줄러 (여러 PID를 동시에 요청하고 응답을 추적) ---
+#define CAN_SCHED_MAX_PIDS          16   // 스케줄러에 등록 가능한 최대 PID 수
+#define CAN_SCHED_MAX_INFLIGHT      8    // 동시에 응답을 기다릴 수 있는 최대 요청 수
+#define CAN_SCHED_TIMEOUT_SEC       0.05 // 요청 1건의 응답 대기 제한 시간(초)
+#define CAN_SCHED_MAX_RETRY         3    // 타임아웃 시 재전송 횟수
+
+typedef struct {
+    unsigned char pid;
+    unsigned char wanted;     // 1: 값이 필요함(요청 대상)
+    unsigned char in_flight;  // 1: 요청을 보내고 응답을 기다리는 중
+    unsigned char retries;    // 이번 요청에서 재전송한 횟수
+    double sent_at;           // 마지막 전송 시각 (now_sec 기준)
+    double deadline;          // 응답 제한 시각
+    double last_latency;      // 마지막 응답 지연(초)
+    double avg_latency;       // 응답 지연 이동평균(초)
+    unsigned int responses;   // 받은 응답 수
+    unsigned int timeouts;    // 타임아웃 발생 수
+    unsigned int failures;    // 재전송 한도를 넘겨 포기한 수
+} CANPidSlot;
+
+typedef struct {
+    CANPidSlot slots[CAN_SCHED_MAX_PIDS];
+    int count;          // 등록된 PID 수
+    int inflight;       // 현재 응답 대기 중인 요청 수
+    int max_inflight;
+    int max_retry;
+    int pids_per_request; // 요청 프레임 하나에 묶어 보낼 PID 수 (1 ~ OBD_MAX_PIDS_PER_REQUEST)
+    double timeout;
+} CANScheduler;
+
+void can_sched_init(CANScheduler* s, int max_inflight, double timeout_sec, int max_retry, int pids_per_request);
+int can_sched_add(CANScheduler* s, unsigned char pid);             // 0=성공, -1=가득 참
+int can_sched_want(CANScheduler* s, unsigned char pid);            // 값 요청 표시, -1=미등록 PID
+int can_sched_service(CANScheduler* s, double now);                // 전송/재전송한 요청 수 반환
+void can_sched_complete(CANScheduler* s, const unsigned char* pids, int count, double rx_time); // 응답 수신 처리
+double can_sched_next_deadline(const CANScheduler* s);             // 가장 가까운 응답 제한 시각, 없으면 0
+const CANPidSlot* can_sched_slot(const CANScheduler* s, unsigned char pid);
+
+// --- CAN_BCM(커널 브로드캐스트 매니저) 주기 요청 모드 ---
+#define CAN_POLL_MODE_BCM           0    // 1: PID 주기 요청/변화 감지를 커널 BCM에 맡김, 0: 사용자 공간 스케줄러
+#define CAN_BCM_MAX_POLLS           16   // BCM에 등록 가능한 최대 PID 수
+#define CAN_BCM_RX_TIMEOUT_MS       1000 // 이 시간 동안 응답이 하나도 없으면 RX_TIMEOUT 통지 (0x7E8 전체 기준, PID별 아님)
+#define CAN_BCM_RESYNC_MS           500  // 이 주기마다 RX_SETUP을 다시 써서 값이 그대로인 PID도 다시 통지받음
+                                         // BCM 모드의 허용 지연은 최소 (요청 주기 + 이 값)으로 늘어남 (값이 그대로인 동안의 여유)
+
+typedef struct {
+    unsigned char pid;         // 주기적으로 요청할 PID
+    unsigned int interval_ms;  // 요청 주기(ms)
+} CANBcmPoll;
+
+int can_bcm_open(const char* interface_name);          // 성공 시 수신용 BCM 소켓 fd, 실패 시 -1
+int can_bcm_start(const CANBcmPoll* polls, int count); // 0=성공, -1=실패
+int can_bcm_receive(CANMessage* msg);                  // 1=값 변화 수신, 0=없음, <0=에러
+int can_bcm_resync(void);                              // PID별 마지막 값을 지워 다음 응답을 다시 통지받음, 0=성공
+unsigned int can_bcm_rx_timeouts(void);                // RX_TIMEOUT(응답 끊김) 누적 횟수
+void can_bcm_close(void);
+
 int can_request_pid(unsigned char pid);
+int can_request_pids(const unsigned char* pids, int count); // 최대 OBD_MAX_PIDS_PER_REQUEST개를 요청 한 번에
 void can_parse_and_update_data(const CANMessage* msg, VehicleData* vehicle_data, unsigned char* flag, unsigned char* flag2);
+int can_parse_response(const CANMessage* msg, VehicleData* vehicle_data, unsigned char* flag, unsigned char* flag2,
+                       unsigned char* pids_out, int max_pids); // 갱신된 PID 수 반환 (ISO-TP 재조립 포함)
 int can_init(const char* interface_name); // <<-- 수정: 인터페이스 이름을 받고, 성공 시 fd를 반환하도록 변경
+int can_init_ex(const char* interface_name, const CANFilter* filters, int count, unsigned int err_mask);
+int can_set_filters(const CANFilter* filters, int count, unsigned int err_mask); // 0=성공, -1=실패
+unsigned int can_error_class(const CANMessage* msg); // 에러 프레임이면 에러 클래스 비트, 아니면 0
 int can_send_message(const CANMessage* msg);
 int can_receive_message(CANMessage* msg); // 1=수신, 0=없음, <0=에러
+int can_receive_batch(CANMessage* msgs, int max, unsigned int* drops); // 수신 개수(0=없음), <0=에러
 void can_close();
 
+// --- 신호 저장소 (VehicleData 값마다 수신 시각과 허용 지연을 함께 관리) ---
+// 플래그를 모두 모은 뒤 한꺼번에 지우는 대신, 값마다 "얼마나 오래됐는지"로 유효성을 판단합니다.
+typedef enum {
+    SIG_ENGINE_SPEED = 0,
+    SIG_VEHICLE_SPEED,
+    SIG_GEAR,
+    SIG_GPS_X,
+    SIG_GPS_Y,
+    SIG_STEERING,
+    SIG_BRAKE,
+    SIG_TIRE,
+    SIG_THROTTLE,
+    SIG_COUNT
+} SignalId;
+
+#define SIG_MASK(id)                (1u << (id))
+#define SIG_MASK_AI                 (SIG_MASK(SIG_GPS_X) | SIG_MASK(SIG_GPS_Y) | SIG_MASK(SIG_STEERING)) // AI 분석 요청에 필요
+#define SIG_MASK_PATH               (SIG_MASK(SIG_VEHICLE_SPEED) | SIG_MASK(SIG_STEERING))                // 경로 예측/충돌 평가에 필요
+#define SIG_MASK_GPS                (SIG_MASK(SIG_GPS_X) | SIG_MASK(SIG_GPS_Y))                           // GPS·속도 융합에 필요
+#define SIG_MASK_ALL                (SIG_MASK(SIG_COUNT) - 1u)
+
+// 기본 허용 지연(초): 이 시간보다 오래된 값은 stale로 보고 다시 요청
+#define SIG_BUDGET_FAST_SEC         0.1  // GPS, 조향각, 속도, RPM, 브레이크, 스로틀
+#define SIG_BUDGET_GEAR_SEC         1.0  // 기어
+#define SIG_BUDGET_TIRE_SEC         5.0  // 타이어 공기압 (천천히 변함)
+
+typedef struct {
+    double timestamp;       // 마지막으로 값을 받은 시각 (now_sec 기준, 0 = 받은 적 없음)
+    double budget;          // 허용 지연(초)
+    unsigned int updates;   // 누적 갱신 횟수
+} SignalState;
+
+typedef struct {
+    VehicleData data;               // 값
+    SignalState sig[SIG_COUNT];     // 값마다 수신 시각/허용 지연
+} SignalStore;
+
+void sig_store_init(SignalStore* store, const double* budgets);       // budgets: SIG_COUNT개, NULL이면 기본값
+int sig_from_pid(unsigned char pid);                                 // PID → SignalId, 모르는 PID면 -1
+void sig_store_touch(SignalStore* store, unsigned char pid, double timestamp); // PID 값 수신 기록
+double sig_store_age(const SignalStore* store, SignalId id, double now);      // 받은 적 없으면 큰 값
+int sig_store_fresh(const SignalStore* store, SignalId id, double now);       // 1=허용 지연 이내
+unsigned int sig_store_fresh_mask(const SignalStore* store, double now);      // 신선한 신호의 SIG_MASK 합
+int sig_store_fresh_all(const SignalStore* store, unsigned int mask, double now); // mask 신호가 모두 신선하면 1
+
+// --- 신호 이력 (값마다 수신 시각이 붙은 최근 샘플, 카메라 촬영 시각의 차량 상태를 보간으로 복원) ---
+// AI 결과는 촬영 후 수백 ms 뒤에 오므로, 그 사이 바뀐 최신 값 대신 촬영 시각의 값으로 위험 평가를 해야 위치 오차가 생기지 않습니다.
+// 연속 신호(GPS, 조향각, 속도, RPM, 브레이크, 스로틀)는 앞뒤 샘플로 선형 보간하고, 기어/타이어는 그 시각 직전 값을 씁니다.
+#define SIG_HIST_LEN                128  // 신호별 샘플 수 (2의 거듭제곱, 50Hz 갱신 기준 약 2.5초)
+
+typedef struct {
+    double t;               // 수신 시각 (now_sec 기준)
+    double v;               // 값 (기어/타이어는 여러 필드를 정수로 묶은 값)
+} SignalSample;
+
+typedef struct {
+    SignalSample s[SIG_COUNT][SIG_HIST_LEN];
+    unsigned int head[SIG_COUNT];   // 다음에 쓸 위치 (누적, SIG_HIST_LEN으로 나눈 나머지가 인덱스)
+    unsigned int count[SIG_COUNT];  // 저장된 샘플 수 (최대 SIG_HIST_LEN)
+} SignalHistory;
+
+void sig_hist_init(SignalHistory* hist);
+int sig_hist_record(SignalHistory* hist, const SignalStore* store); // 수신 시각이 새로워진 신호만 기록, 기록한 샘플 수
+unsigned int sig_hist_at(const SignalHistory* hist, double t, const VehicleData* latest, VehicleData* out);
+                                                                      // t 시각의 상태 (이력이 없는 신호는 latest 값), t가 이력 구간 안인 신호의 SIG_MASK 합
+
+// --- CAN 수집 전용 스레드 (수신/해석/요청 스케줄링을 제어 루프와 분리) ---
+#define CAN_ACQ_RING_SIZE           64   // 스냅샷 링 크기 (2의 거듭제곱)
+#define CAN_ACQ_ROUND_SEC           0.02 // 신호 신선도를 확인하고 stale PID만 다시 요청하는 주기(초, 수집 스레드의 timerfd)
+
+typedef struct {
+    SignalStore store;          // 이 스냅샷 시점의 최신 차량 상태 + 값마다 수신 시각/허용 지연
+    double timestamp;           // 마지막으로 반영한 프레임의 수신 시각 (now_sec 기준)
+    unsigned long seq;          // 스냅샷 일련번호
+    unsigned int drops;         // 소켓 버퍼 오버플로로 버려진 누적 프레임 수
+    unsigned int bus_errors;    // 누적 버스 에러 이벤트 수
+    unsigned int last_error;    // 마지막 버스 에러 클래스
+    unsigned int bcm_timeouts;  // 누적 BCM RX_TIMEOUT 수
+    unsigned int stale_inflight;// 값이 stale인데 이전 요청이 아직 응답 대기 중이던 횟수
+} CANSnapshot;
+
+typedef struct {
+    const char* ifname;             // CAN 인터페이스 이름
+    const unsigned char* pids;      // 스케줄러로 폴링할 PID (등록 순서 = 우선순위)
+    int pid_count;
+    const CANBcmPoll* bcm_polls;    // CAN_POLL_MODE_BCM일 때 커널에 맡길 PID별 주기 요청
+    int bcm_count;
+    double round_period;            // 신선도 확인 주기(초), 0이면 CAN_ACQ_ROUND_SEC
+    const double* budgets;          // 신호별 허용 지연(초, SIG_COUNT개), NULL이면 기본값
+} CANAcqConfig;
+
+int can_acq_start(const CANAcqConfig* cfg);      // 성공 시 새 스냅샷 알림용 eventfd, 실패 시 -1
+int can_acq_latest(CANSnapshot* out, SignalHistory* hist); // 1=새 스냅샷, 0=없음 (hist가 있으면 꺼낸 스냅샷을 모두 기록)
+int can_acq_sched_stats(CANScheduler* out);      // PID별 응답 지연 통계 복사본, 0=성공
+void can_acq_stop(void);
+
 // ================= 7. AI 통신 API =================
 typedef struct{
     unsigned char label;
@@ -197,8 +511,388 @@ typedef struct{
     float y;
     float ax;
     float ay;
+    float score;            // 탐지 신뢰도 (0~1, 결과에 없으면 1)
 }DetectedObject;
 
+// --- AI 결과 JSON 스캐너 ({"objects":[{label,x,y,ax,ay,score}...], "token":N, "capture_time":T} 전용) ---
+// cJSON 트리를 만들지 않고 한 번 훑으면서 미리 잡아 둔 풀에 바로 씀. 풀은 더 큰 결과가 올 때만 늘어남
+typedef struct {
+    DetectedObject* items;
+    int count;              // 마지막 파싱 결과의 객체 수
+    int cap;                // 할당된 객체 수
+    double capture_time;    // 결과가 나온 카메라 프레임의 촬영 시각 (now_sec 기준, 결과에 없으면 0)
+} DetPool;
+
+int det_pool_init(DetPool* pool, int initial_cap);
+int det_pool_reserve(DetPool* pool, int n);        // cap >= n 보장, 실패 시 -1
+void det_pool_free(DetPool* pool);
+int det_json_parse(const char* json, size_t len, DetPool* pool, long* token); // 객체 수, 형식 오류면 -1
+
+// --- C ↔ 파이썬 바이너리 메시지 (길이 접두 프레임, ai/ipc_msg.py와 바이트 단위로 같아야 함) ---
+// 프레임 = 헤더 16바이트 [magic u16][version u8][type u8][payload 길이 u32][사이클 토큰 u64] + payload (리틀 엔디언)
+#define IPC_MAGIC                   0x4242      // "BB"
+#define IPC_VERSION                 1
+#define IPC_HEADER_SIZE             16
+#define IPC_VEHICLE_SIZE            40          // 차량 스냅샷: <ddiiffBbBx4B>
+#define IPC_FRAMESET_SIZE           24          // 카메라 프레임 세트 머리: <IIdd> (카메라 수, 유효 수, 기준 시각, 시각 차)
+#define IPC_FRAME_REF_SIZE          24          // 카메라별 링 슬롯: <iIQd> (슬롯, pad, seq, 수신 시각)
+#define IPC_MAX_PAYLOAD             (1u << 20)  // 이보다 긴 길이는 손상된 프레임으로 보고 다시 동기화
+#define IPC_READ_CHUNK              4096        // 받는 중인 프레임이 없을 때 read 한 번에 확보하는 빈 공간
+
+enum {
+    IPC_MSG_ANALYZE = 1,    // C → Py: 차량 스냅샷 [+ 프레임 세트 머리 + 카메라별 링 슬롯 × 카메라 수] (링이 없으면 생략)
+    IPC_MSG_DRAW,           // C → Py: 차량 스냅샷 + 이벤트 플래그 u32 + 경로 점 수 u32 + path_x f64[n] + path_y f64[n]
+    IPC_MSG_DONE,           // Py → C: draw 처리 완료 (payload 없음)
+    IPC_MSG_RESULT_JSON,    // Py → C: 공유 메모리를 못 쓸 때의 탐지 결과 JSON (NUL 없음)
+    IPC_MSG_HEARTBEAT,      // Py → C: 살아 있음 (payload: 상태 u32, IPC_BEAT_*)
+    IPC_MSG_ACTIVATE        // C → Py: 대기 프로세스를 활성으로 승격 (payload 없음)
+};
+#define IPC_MSG_LAST                IPC_MSG_ACTIVATE
+#define IPC_BEAT_STANDBY            1           // 초기화를 마치고 ACTIVATE를 기다림
+#define IPC_BEAT_ACTIVE             2           // analyze/draw 처리 중
+
+typedef struct {
+    unsigned int type;              // IPC_MSG_*
+    unsigned long token;            // 사이클 토큰
+    unsigned int len;               // payload 길이
+    const unsigned char* payload;   // 리더 버퍼 안을 가리킴 (다음 ipc_reader_* 호출 전까지 유효)
+} IpcMessage;
+
+typedef struct {
+    unsigned char* buf;
+    size_t start;                   // 아직 처리하지 않은 첫 바이트
+    size_t len;                     // 버퍼에 들어 있는 바이트 끝
+    size_t cap;
+    unsigned long resyncs;          // magic/버전이 맞지 않아 건너뛴 바이트 수
+} IpcReader;
+
+size_t ipc_encode_analyze(unsigned char* buf, size_t cap, unsigned long token, const VehicleData* v,
+                          const CamFrameSet* frames);         // frames가 NULL이면 차량 스냅샷만, 0=버퍼 부족
+size_t ipc_encode_draw(unsigned char* buf, size_t cap, unsigned long token, const VehicleData* v,
+                       unsigned int events, const double* path_x, const double* path_y, int count);
+size_t ipc_encode_control(unsigned char* buf, size_t cap, unsigned int type, unsigned long token); // payload 없는 프레임 (ACTIVATE 등)
+int ipc_write_all(int fd, const void* buf, size_t len);     // 0=성공, -1=실패 (EINTR/부분 쓰기 처리)
+int ipc_reader_init(IpcReader* r, size_t initial_cap);
+void ipc_reader_reset(IpcReader* r);                        // 새 프로세스에 붙일 때 남은 바이트 버림
+void ipc_reader_free(IpcReader* r);
+int ipc_reader_fill(IpcReader* r, int fd);                  // 읽을 수 있는 만큼 읽음: 1=읽음, 0=EOF, -1=더 없음(EAGAIN)/에러
+int ipc_reader_next(IpcReader* r, IpcMessage* out);         // 1=메시지 하나, 0=아직 완성된 프레임 없음
+
+// --- 탐지 결과 공유 메모리 채널 (vision_server.py → C, JSON 파싱 없이 제자리에서 읽음) ---
+// memfd 하나에 헤더 + 결과 슬롯 링을 두고, 파이썬이 슬롯을 다 쓴 뒤 write_seq를 올리고 eventfd로 알립니다.
+// 레이아웃은 ai/det_shm.py의 struct 정의와 바이트 단위로 같아야 합니다.
+#define DET_SHM_MAGIC               0x31544544u // 리틀 엔디언 "DET1"
+#define DET_SHM_VERSION             2
+#define DET_SHM_SLOTS               8           // 결과 슬롯 수 (C가 붙잡고 있는 슬롯은 덮어쓰지 않음)
+#define DET_SHM_MAX_OBJECTS         512         // 슬롯 하나의 최대 객체 수 (넘치면 잘리고 DET_SHM_TRUNCATED 표시)
+#define DET_SHM_TRUNCATED           0x01
+#define DET_SHM_ENV_FD              "BLACKBOX_DET_SHM_FD"   // 자식에게 memfd 번호를 넘기는 환경 변수
+#define DET_SHM_ENV_EVENT_FD        "BLACKBOX_DET_EVENT_FD" // 자식에게 eventfd 번호를 넘기는 환경 변수
+
+typedef struct {
+    unsigned long seq;              // 결과 번호 (det_shm_hold에 넘김)
+    long token;                     // analyze 사이클 토큰 (없으면 -1)
+    int count;                      // 객체 수
+    unsigned int flags;             // DET_SHM_TRUNCATED 등
+    double timestamp;               // 결과가 나온 카메라 프레임의 촬영 시각 (time.monotonic, now_sec와 같은 시계)
+    const DetectedObject* objects;  // 공유 메모리 안을 직접 가리킴 (det_shm_hold로 붙잡은 동안만 유효)
+} DetResult;
+
+int det_shm_create(void);                       // 성공 시 새 결과 알림용 eventfd (epoll 감시용), 실패 시 -1
+int det_shm_export(void);                       // fork된 자식에서 호출: fd를 exec 후에도 유지하고 환경 변수로 넘김
+int det_shm_poll(DetResult* out);               // 1=새 결과(가장 최근 것), 0=없음
+void det_shm_hold(unsigned long seq);           // 이 결과를 계속 읽을 것이므로 파이썬이 덮어쓰지 않게 함
+void det_shm_release(void);                     // 붙잡은 결과 없음 (마지막으로 본 결과까지 덮어써도 됨)
+unsigned long det_shm_dropped(void);            // 슬롯이 모자라 파이썬이 버린 결과 수
+void det_shm_destroy(void);
+
+// ================= 8. 스레드 간 통신 API =================
+// 단일 생산자/단일 소비자 락프리 링. 생산자 스레드 하나만 push, 소비자 스레드 하나만 pop 해야 합니다.
+typedef struct SpscRing SpscRing;
+
+SpscRing* spsc_create(size_t elem_size, size_t capacity); // capacity는 2의 거듭제곱으로 올림
+void spsc_destroy(SpscRing* ring);
+int spsc_push(SpscRing* ring, const void* elem);          // 0=성공, -1=가득 참 (생산자 전용)
+int spsc_pop(SpscRing* ring, void* elem);                 // 1=꺼냄, 0=비어 있음 (소비자 전용)
+size_t spsc_count(const SpscRing* ring);
+
+// ================= 9. 로그 API =================
+// 스레드별 락프리 링에 바이너리 레코드(포맷 문자열 포인터 + 인자 값)만 넣고, 문자열 포맷팅과 출력은
+// 백그라운드 드레인 스레드가 나중에 수행합니다. 링이 가득 차면 레코드를 버리고 개수만 셉니다.
+// 주의: 포맷 문자열과 %s 인자는 출력될 때까지 살아 있어야 하므로 문자열 리터럴/정적 문자열만 넘기세요.
+#define LOG_LVL_DEBUG               0
+#define LOG_LVL_INFO                1
+#define LOG_LVL_WARN                2
+#define LOG_LVL_ERROR               3
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL           LOG_LVL_INFO // 이보다 낮은 레벨의 로그 호출은 컴파일 단계에서 제거
+#endif
+
+#define LOG_RING_SIZE               1024 // 스레드별 레코드 수
+#define LOG_MAX_THREADS             8    // 로그를 남길 수 있는 최대 스레드 수
+#define LOG_MAX_ARGS                8    // 레코드 하나의 최대 인자 수
+#define LOG_DRAIN_PERIOD_MS         10   // 드레인 스레드가 링을 비우는 주기
+
+enum { LOG_ARG_INT = 0, LOG_ARG_DOUBLE, LOG_ARG_STR, LOG_ARG_PTR };
+
+typedef struct {
+    union {
+        long long i;
+        double d;
+        const void* p;
+    } v;
+    unsigned char type;     // LOG_ARG_*
+} LogArg;
+
+int log_start(const char* path);    // path가 NULL이면 stderr, 0=성공, -1=실패
+void log_stop(void);                // 남은 레코드를 모두 출력하고 드레인 스레드 종료
+void log_write(int level, const char* fmt, const LogArg* args, int nargs); // 직접 호출하지 말고 log_* 매크로 사용
+unsigned long log_dropped(void);    // 링이 가득 차서 버린 레코드 누적 수
+
+static inline LogArg log_arg_i(long long v)   { LogArg a; a.v.i = v; a.type = LOG_ARG_INT; return a; }
+static inline LogArg log_arg_u(unsigned long long v) { LogArg a; a.v.i = (long long)v; a.type = LOG_ARG_INT; return a; }
+static inline LogArg log_arg_d(double v)      { LogArg a; a.v.d = v; a.type = LOG_ARG_DOUBLE; return a; }
+static inline LogArg log_arg_s(const char* v) { LogArg a; a.v.p = v; a.type = LOG_ARG_STR; return a; }
+static inline LogArg log_arg_p(const void* v) { LogArg a; a.v.p = v; a.type = LOG_ARG_PTR; return a; }
+
+#ifndef __cplusplus
+// 인자 타입에 맞는 LogArg 생성 함수를 컴파일 시점에 고름
+#define LOG__ARG(x) _Generic((x), \
+    float: log_arg_d, double: log_arg_d, \
+    char*: log_arg_s, const char*: log_arg_s, \
+    void*: log_arg_p, const void*: log_arg_p, \
+    unsigned long: log_arg_u, unsigned long long: log_arg_u, \
+    default: log_arg_i)(x)
+#define LOG__NARGS(...)  LOG__NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG__NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+#define LOG__CAT(a, b)   LOG__CAT_(a, b)
+#define LOG__CAT_(a, b)  a##b
+#define LOG__M0()
+#define LOG__M1(a)                      , LOG__ARG(a)
+#define LOG__M2(a, b)                   LOG__M1(a) LOG__M1(b)
+#define LOG__M3(a, b, c)                LOG__M2(a, b) LOG__M1(c)
+#define LOG__M4(a, b, c, d)             LOG__M3(a, b, c) LOG__M1(d)
+#define LOG__M5(a, b, c, d, e)          LOG__M4(a, b, c, d) LOG__M1(e)
+#define LOG__M6(a, b, c, d, e, f)       LOG__M5(a, b, c, d, e) LOG__M1(f)
+#define LOG__M7(a, b, c, d, e, f, g)    LOG__M6(a, b, c, d, e, f) LOG__M1(g)
+#define LOG__M8(a, b, c, d, e, f, g, h) LOG__M7(a, b, c, d, e, f, g) LOG__M1(h)
+
+#define LOG_AT(level, fmt, ...) do { \
+    if ((level) >= LOG_COMPILE_LEVEL) { \
+        const LogArg log__args_[] = { log_arg_i(0) LOG__CAT(LOG__M, LOG__NARGS(__VA_ARGS__))(__VA_ARGS__) }; \
+        log_write((level), (fmt), log__args_ + 1, (int)(sizeof(log__args_) / sizeof(log__args_[0])) - 1); \
+    } \
+} while (0)
+
+#define log_debug(fmt, ...) LOG_AT(LOG_LVL_DEBUG, fmt, ##__VA_ARGS__)
+#define log_info(fmt, ...)  LOG_AT(LOG_LVL_INFO,  fmt, ##__VA_ARGS__)
+#define log_warn(fmt, ...)  LOG_AT(LOG_LVL_WARN,  fmt, ##__VA_ARGS__)
+#define log_error(fmt, ...) LOG_AT(LOG_LVL_ERROR, fmt, ##__VA_ARGS__)
+#endif
+
+// ================= 10. 충돌 예측 API =================
+// 객체(등속 직선 운동)와 차량 예상 경로(중심 + 차량 크기의 축 정렬 박스)의 모든 객체 × 시간 단계 쌍을 한 번에 평가합니다.
+// 객체를 구조체 배열(SoA)로 펼쳐 두고 NEON(ARM) / AVX·SSE(x86) 커널이 객체 여러 개를 한 레지스터로 계산하며,
+// 첫 충돌에서 멈추지 않고 객체마다 첫 접촉 시각과 최소 거리를 남깁니다.
+#define COLL_OBJ_RADIUS             1.0  // 객체 충돌 반경 (m)
+#define COLL_MAX_STEPS              64   // 경로 단계 최대 수 (넘는 단계는 평가하지 않음)
+#define COLL_NO_CONTACT             (-1.0f)
+
+typedef struct {
+    // 입력 (coll_batch_load가 채움, 32바이트 정렬, cap은 SIMD 폭의 배수, count 뒤 칸은 충돌하지 않는 값으로 채움)
+    float* x;
+    float* y;
+    float* vx;                  // 속도 (DetectedObject.ax/ay, m/s)
+    float* vy;
+    // 결과 (coll_batch_check가 채움)
+    float* t_contact;           // 첫 접촉 시각(초), 예측 구간 안에 접촉이 없으면 COLL_NO_CONTACT
+    float* min_dist;            // 예측 구간 동안 객체 중심과 차량 박스 사이 최소 거리 (m, 박스 안이면 0)
+    float* prob;                // 충돌 확률 (0~1, risk_mc_eval이 채움)
+    int count;
+    int cap;
+} CollBatch;
+
+int coll_batch_init(CollBatch* batch, int initial_cap);
+int coll_batch_load(CollBatch* batch, const DetectedObject* objs, int n); // SoA로 옮김 (모자라면 늘림), 실패 시 -1
+int coll_batch_check(CollBatch* batch, const double* path_x, const double* path_y, int path_count, double dt);
+                                                                          // 접촉하는 객체 수 (path[k]는 (k+1)*dt초 뒤 차량 중심)
+void coll_batch_free(CollBatch* batch);
+const char* coll_kernel_name(void);                                       // 빌드된 커널 ("neon", "avx", "sse", "scalar")
+
+// --- 연속 시간 충돌 시각(TTC) ---
+// 경로 샘플 사이를 건너뛰지 않도록, 자전거 모델 원호(calc_future_path와 같은 모델)를 따라 진행 방향으로 회전하는 차량 박스와
+// 등속 객체의 첫 접촉 시각을 직접 구합니다. 직진은 닫힌 해(선분과 둥근 사각형의 교차), 곡선은 보수적 전진
+// (그 사이에 접촉할 수 없는 가장 큰 보폭으로 전진)으로 TTC_TOL_M 이내까지 구하며, 객체당 반복 횟수는 TTC_MAX_ITERS로 묶입니다.
+// 예측 구간은 속도에 맞춰 늘어납니다: 반응 시간 + 정지까지 걸리는 시간.
+#define TTC_NONE                    (-1.0)
+#define TTC_REACTION_SEC            1.5  // 반응 시간
+#define TTC_DECEL_MPS2              4.0  // 제동 감속도 (m/s^2)
+#define TTC_HORIZON_MIN_SEC         2.0  // 예측 구간 하한 (저속/정지)
+#define TTC_HORIZON_MAX_SEC         10.0 // 예측 구간 상한
+#define TTC_TOL_M                   0.01 // 접촉 판정 허용 오차 (m)
+#define TTC_MAX_ITERS               64   // 곡선 주행 시 객체당 최대 전진 횟수 (넘으면 그 시각을 접촉으로 봄, 안전 쪽)
+#define TTC_CORRIDOR_PTS            64   // coll_batch_ttc_grid가 차량 원호를 나누는 최대 점 수
+
+typedef struct {
+    double v;               // 차량 속도 (m/s)
+    double omega;           // 요 각속도 (rad/s, 0이면 직진)
+    double horizon;         // 예측 구간 (초)
+    double half_l;          // 차량 박스 반 길이/반 폭 (m)
+    double half_w;
+    double radius;          // 객체 충돌 반경 (m)
+} TtcEgo;
+
+double ttc_horizon(double v_mps);                                         // 속도에 맞춘 예측 구간 (초)
+void ttc_ego_init(TtcEgo* ego, int speed_kph, float steer_deg);           // 바퀴 조향각(도)으로 자전거 모델 설정, 차량 크기/객체 반경은 기본값
+double ttc_solve(const TtcEgo* ego, double x, double y, double vx, double vy); // 첫 접촉 시각(초), 예측 구간 안에 없으면 TTC_NONE
+int coll_batch_ttc(CollBatch* batch, const TtcEgo* ego);                  // 적재된 객체마다 t_contact를 TTC로 채움, 접촉 객체 수
+
+// --- 몬테카를로 충돌 확률 ---
+// 궤적 하나만 보면 운전자 조작의 흔들림을 반영하지 못하므로, 조향각/가속도 가설과 객체 속도 오차를 여러 개 뽑아
+// 가설마다 차량 박스(진행 방향으로 회전)와 객체가 예측 구간 안에 닿는지 보고, 닿은 가설의 비율을 객체별 충돌 확률로 냅니다.
+// 가설은 RISK_MC_CHUNK개씩 나눠 작업 스레드 풀(호출 스레드 포함)이 가져가며, 묶음 안의 가설을 SIMD 레인에 담아 계산합니다.
+// 시간 예산이 지나면 새 묶음을 가져가지 않으므로, 확률은 예산 안에 끝낸 가설 수를 분모로 합니다.
+#define RISK_MC_WORKERS             3      // 작업 스레드 수 (호출 스레드도 함께 계산 → Pi 5 코어 4개)
+#define RISK_MC_MAX_WORKERS         8
+#define RISK_MC_SAMPLES             512    // 사이클당 최대 가설 수
+#define RISK_MC_CHUNK               16     // 작업 단위 가설 수 (SIMD 폭의 배수)
+#define RISK_MC_DT                  0.05   // 가설 궤적의 시간 간격 (초)
+#define RISK_MC_MAX_STEPS           256    // 예측 구간 / RISK_MC_DT 상한
+#define RISK_MC_BUDGET_SEC          0.005  // 사이클당 시간 예산 (초)
+#define RISK_MC_STEER_SIGMA_DEG     2.0    // 바퀴 조향각 흔들림 (표준편차, 도)
+#define RISK_MC_ACCEL_SIGMA         1.5    // 가감속 (표준편차, m/s^2)
+#define RISK_MC_OBJ_VEL_SIGMA       0.5    // 객체 속도 오차 (축별 표준편차, m/s)
+#define RISK_MC_PROB_THRESH         0.3    // 이 확률 이상인 객체가 있으면 충돌 위험
+
+typedef struct {
+    int samples;            // 예산 안에 평가한 가설 수 (확률의 분모)
+    int threads;            // 계산에 참여한 스레드 수
+    double elapsed;         // 걸린 시간 (초)
+} RiskMcStats;
+
+int risk_mc_start(int workers);                 // 작업 스레드 풀 시작 (0 이하면 RISK_MC_WORKERS), 0=성공
+int risk_mc_eval(CollBatch* batch, int speed_kph, float steer_deg, double budget_sec, RiskMcStats* stats);
+                                                // 적재된 객체마다 prob를 채움, 평가한 가설 수 (풀이 없으면 0)
+void risk_mc_stop(void);
+
+// --- 예상 경로 (곡률 룩업 테이블 + 캐시) ---
+// calc_future_path()와 같은 자전거 모델 경로 (PREDICTION_DT 간격 POS_COUNT개 점)를 tan/sin/cos 반복 없이 구합니다.
+// 조향각 → 곡률은 처음 쓸 때 만드는 표에서 보간하고, 단계별 위치는 한 단계 회전을 곱해 나가며(sin/cos 한 번) 구합니다.
+// 속도와 불감대를 적용한 조향각이 지난번과 같으면 이전 경로를 그대로 둡니다.
+#define PATH_LUT_STEER_MAX_DEG      45   // 곡률 표 범위 (±도, 넘는 각은 tan을 직접 계산)
+#define PATH_LUT_STEPS_PER_DEG      20   // 곡률 표 간격 (도당 칸 수, 0.05도)
+#define PATH_STEER_DEADBAND_DEG     0.5  // 이보다 작은 바퀴 조향각은 직진 (노이즈 제거)
+
+typedef struct {
+    int valid;
+    int speed_kph;              // 캐시 키: 속도, 불감대를 적용한 조향각 (정지면 0)
+    float steer_deg;
+    double x[POS_COUNT];        // (k+1)*PREDICTION_DT초 뒤 차량 중심 (시작 (0,0), 진행 방향 x축)
+    double y[POS_COUNT];
+    unsigned long computed;     // 새로 계산한 횟수
+    unsigned long reused;       // 이전 경로를 그대로 쓴 횟수
+} PathCache;
+
+void path_cache_init(PathCache* cache);
+int path_predict(PathCache* cache, int speed_kph, float steer_deg);      // 1=새로 계산, 0=이전 경로 재사용, -1=인자 오류
+double path_curvature(float steer_deg);                                  // 바퀴 조향각(도)의 곡률 (1/m, 표 보간)
+
+// --- 다중 객체 추적 ---
+// AI 결과는 사이클마다 통째로 바뀌므로, 탐지를 이전 트랙과 짝지어 사이클을 넘는 ID와 칼만 필터로 다듬은 속도를 유지합니다.
+// 객체 좌표는 촬영 시각의 차량 좌표계이므로, 트랙은 이전 촬영 이후 차량이 움직인 만큼(자전거 모델 원호) 옮긴 뒤 비교합니다.
+// 짝짓기: 예측 위치를 게이트 크기 격자의 공간 해시에 넣고 주변 9칸의 탐지만 후보로 삼아, 비용이 작은 쌍부터 탐욕적으로 정합니다.
+// 필터: 축마다 [위치, 속도] 등속 모델, 측정은 위치와 AI가 낸 속도(ax/ay). 두 축의 잡음이 같아 공분산 하나를 같이 씁니다.
+// 점수가 높은 탐지는 바로, 나머지는 TRK_CONFIRM_HITS번 연속으로 잡혀야 확정 트랙이 되며, 위험 평가는 확정 트랙만 봅니다.
+#define TRK_MAX_TRACKS              128  // 동시에 유지하는 최대 트랙 수 (넘는 새 탐지는 추적하지 않음)
+#define TRK_GATE_M                  2.5  // 예측 위치와 탐지 사이 최대 거리 (m, 공간 해시 격자 크기)
+#define TRK_LABEL_PENALTY_M2        4.0  // 라벨이 다른 쌍의 비용 가산 (m^2, 트럭/승용차 오분류에도 ID 유지)
+#define TRK_CONFIRM_HITS            2    // 확정까지 필요한 연속 탐지 수
+#define TRK_CONFIRM_SCORE           0.7  // 이 점수 이상인 탐지는 처음부터 확정
+#define TRK_MAX_MISSES              3    // 확정 트랙이 이만큼 연속으로 놓치면 삭제 (그 사이엔 예측 위치로 유지)
+#define TRK_RESET_SEC               1.0  // 촬영 간격이 이보다 벌어지면 모든 트랙을 버림
+#define TRK_POS_SIGMA               0.5  // 위치 측정 잡음 (m)
+#define TRK_VEL_SIGMA               1.5  // 속도 측정 잡음 (m/s)
+#define TRK_ACCEL_SIGMA             2.0  // 과정 잡음: 객체 가속도 (m/s^2)
+#define TRK_HASH_BITS               8    // 공간 해시 버킷 수 = 2^TRK_HASH_BITS
+
+typedef struct {
+    unsigned int id;            // 사이클을 넘어 유지되는 ID (1부터)
+    unsigned char label;        // 마지막으로 짝지어진 탐지의 라벨
+    float score;
+    double x, y;                // 위치 (m, 마지막 촬영 시각의 차량 좌표계)
+    double vx, vy;              // 필터로 다듬은 속도 (m/s)
+    double p_pp, p_pv, p_vv;    // 축별 [위치, 속도] 공분산 (두 축이 같음)
+    int hits;                   // 연속 탐지 수
+    int misses;                 // 연속으로 놓친 수
+    int age;                    // 생성 후 지난 사이클 수
+    int confirmed;
+    double first_seen;          // 처음 탐지된 촬영 시각
+} Track;
+
+typedef struct {
+    float cost;                 // 거리^2 (+ 라벨 가산)
+    int track;
+    int det;
+} TrkPair;
+
+typedef struct {
+    Track tracks[TRK_MAX_TRACKS];
+    int count;
+    unsigned int next_id;
+    double last_time;           // 마지막 갱신의 촬영 시각 (0이면 아직 없음)
+    // 확정 트랙 (tracker_update가 채움, 위험 평가용): out[i]는 out_id[i] 트랙, ax/ay는 필터 속도
+    DetectedObject out[TRK_MAX_TRACKS];
+    unsigned int out_id[TRK_MAX_TRACKS];
+    int out_count;
+    // 작업 공간 (탐지 수만큼 늘어남)
+    int hash_head[1 << TRK_HASH_BITS];
+    int* det_next;
+    unsigned char* det_used;
+    int det_cap;
+    TrkPair* pairs;             // 게이트 안 후보 쌍
+    int pair_cap;
+    // 통계 (호출자가 지울 수 있음)
+    unsigned long created;
+    unsigned long dropped;
+} Tracker;
+
+int tracker_init(Tracker* trk);
+void tracker_reset(Tracker* trk);                                         // 모든 트랙 삭제 (ID는 계속 증가)
+int tracker_update(Tracker* trk, const DetectedObject* dets, int n, double t, double ego_v, double ego_omega);
+                                                                          // 촬영 시각 t의 탐지로 갱신, 확정 트랙 수 (실패 시 -1)
+void tracker_free(Tracker* trk);
+
+// --- BEV 격자 색인 ---
+// 객체마다 거리를 재며 모두 훑지 않도록, 사이클마다 객체를 차량 좌표계 BEV 격자(BEV 렌더러와 같은 ±XY_RANGE_M 영역)에
+// 칸 순서로 정렬해 두고(계수 정렬) 반경/경로 통로 질의가 닿는 칸의 객체만 봅니다. 질의 비용은 객체 수가 아니라 훑는 면적에 비례합니다.
+// 메모리는 고정이며, 영역 밖 객체는 따로 모아 질의마다 직접 확인합니다.
+#define BEV_RANGE_M                 61.2 // 격자 범위 (±m, vision_server.py XY_RANGE_M)
+#define BEV_CELL_M                  2.0  // 칸 크기 (m)
+#define BEV_DIM                     62   // 축별 칸 수 (>= 2 * BEV_RANGE_M / BEV_CELL_M)
+#define BEV_MAX_OBJS                DET_SHM_MAX_OBJECTS // 색인할 수 있는 최대 객체 수 (넘는 객체는 색인하지 않음)
+
+typedef struct {
+    const DetectedObject* objs; // 마지막 bev_grid_build의 객체 배열 (질의 결과는 이 배열의 인덱스)
+    int count;
+    float max_speed;            // 색인한 객체 중 가장 빠른 속도 (m/s, 통로 폭 계산용)
+    int cell_start[BEV_DIM * BEV_DIM + 1]; // 칸 c의 객체는 items[cell_start[c] .. cell_start[c + 1])
+    int items[BEV_MAX_OBJS];
+    int outside[BEV_MAX_OBJS];  // 격자 영역 밖 객체
+    int outside_count;
+    unsigned int mark[BEV_MAX_OBJS]; // 통로 질의 중복 제거용 (stamp와 같으면 이미 담음)
+    unsigned int stamp;
+} BevGrid;
+
+int bev_grid_build(BevGrid* grid, const DetectedObject* objs, int n);    // 색인한 객체 수 (앞에서부터 BEV_MAX_OBJS개까지)
+int bev_grid_radius(const BevGrid* grid, double cx, double cy, double r, int* out, int max_out);
+                                                                          // (cx, cy)에서 r 이내 객체 인덱스, 개수
+int bev_grid_corridor(BevGrid* grid, const double* px, const double* py, int n, double half_width, int* out, int max_out);
+                                                                          // 꺾은선 px/py에서 half_width 이내 객체 인덱스, 개수
+int coll_batch_ttc_grid(CollBatch* batch, const TtcEgo* ego, BevGrid* grid);
+                                                                          // coll_batch_ttc와 같되, 차량 원호 통로(객체 최고 속도만큼 넓힘)에
+                                                                          // 드는 객체만 풂 (grid는 batch와 같은 객체 배열로 만든 것)
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,197 @@
+/**
+ * @file bev_grid.c
+ * @brief 차량 좌표계 BEV 격자 색인: 객체를 칸 순서로 정렬해 두고 반경/경로 통로 질의가 닿는 칸만 봅니다.
+ * @details
+ * 격자는 BEV 렌더러(vision_server.py)와 같은 ±BEV_RANGE_M 영역을 BEV_CELL_M 칸으로 나눈 고정 크기입니다.
+ * 만들기는 계수 정렬 한 번입니다: 칸별 개수 → 누적합(cell_start) → 제자리에 인덱스 배치. 비용은 칸 수 + 객체 수.
+ * 칸 하나의 객체가 items에 붙어 있어, 질의는 닿는 칸의 연속 구간만 읽습니다.
+ *
+ * - 반경 질의: 원을 감싸는 칸 사각형만 훑고 거리로 거릅니다.
+ * - 통로 질의: 꺾은선을 max(BEV_CELL_M, half_width) 길이 이하 조각으로 나눠 조각마다 half_width만큼 넓힌 사각형의 칸만 훑습니다.
+ *   긴 대각선 선분 하나의 외접 사각형을 통째로 훑지 않으므로 비용은 통로 면적에 비례하고 (조각 사각형은 통로 면적의 상수 배),
+ *   인접 조각이 같은 칸을 다시 보더라도 mark/stamp로 객체를 한 번만 담습니다.
+ * - 영역 밖 객체는 outside에 모아 질의마다 직접 거리를 잽니다 (보통 없음).
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "hardware.h"
+
+#define BEV_CELLS (BEV_DIM * BEV_DIM)
+
+// 좌표 → 칸 번호 (격자 밖이면 -1)
+static inline int bev_axis(double v) {
+    double f = (v + BEV_RANGE_M) * (1.0 / BEV_CELL_M);
+    if (!(f >= 0.0 && f < BEV_DIM)) return -1;   // NaN 포함
+    return (int)f;
+}
+
+// 좌표 구간 [lo, hi]가 닿는 칸 범위 (격자 안으로 자름), 겹치지 않으면 0
+static inline int bev_span(double lo, double hi, int* a, int* b) {
+    double flo = (lo + BEV_RANGE_M) * (1.0 / BEV_CELL_M);
+    double fhi = (hi + BEV_RANGE_M) * (1.0 / BEV_CELL_M);
+    if (fhi < 0.0 || flo >= BEV_DIM || !(flo <= fhi)) return 0;
+    *a = (flo < 0.0) ? 0 : (int)flo;
+    *b = (fhi >= BEV_DIM) ? BEV_DIM - 1 : (int)fhi;
+    return 1;
+}
+
+/**
+ * @brief 객체 배열을 색인합니다. (배열은 다음 build까지 그대로 있어야 함, 질의 결과는 이 배열의 인덱스)
+ * @return 색인한 객체 수 (앞에서부터 최대 BEV_MAX_OBJS개), 인자가 잘못됐으면 -1
+ */
+int bev_grid_build(BevGrid* grid, const DetectedObject* objs, int n) {
+    if (!grid || n < 0 || (n > 0 && !objs)) return -1;
+    if (n > BEV_MAX_OBJS) n = BEV_MAX_OBJS;
+
+    grid->objs = objs;
+    grid->count = n;
+    grid->outside_count = 0;
+    grid->max_speed = 0.0f;
+
+    // 1. 칸별 개수 (cell_start[c + 1]에 세고 누적합으로 시작 위치를 만듦), 객체별 칸 번호는 mark에 잠시 보관
+    memset(grid->cell_start, 0, sizeof(grid->cell_start));
+    for (int i = 0; i < n; i++) {
+        const DetectedObject* o = &objs[i];
+        float sp = sqrtf(o->ax * o->ax + o->ay * o->ay);
+        if (sp > grid->max_speed) grid->max_speed = sp;
+
+        int cx = bev_axis(o->x), cy = bev_axis(o->y);
+        if (cx < 0 || cy < 0) {
+            grid->mark[i] = BEV_CELLS;
+            grid->outside[grid->outside_count++] = i;
+            continue;
+        }
+        unsigned int c = (unsigned int)(cy * BEV_DIM + cx);
+        grid->mark[i] = c;
+        grid->cell_start[c + 1]++;
+    }
+    for (int c = 0; c < BEV_CELLS; c++) grid->cell_start[c + 1] += grid->cell_start[c];
+
+    // 2. 배치: cell_start[c]를 쓰기 위치로 쓰며 밀고(끝나면 다음 칸 시작), 한 칸씩 되돌림
+    for (int i = 0; i < n; i++) {
+        unsigned int c = grid->mark[i];
+        if (c < BEV_CELLS) grid->items[grid->cell_start[c]++] = i;
+    }
+    for (int c = BEV_CELLS; c > 0; c--) grid->cell_start[c] = grid->cell_start[c - 1];
+    grid->cell_start[0] = 0;
+
+    memset(grid->mark, 0, sizeof(grid->mark));
+    grid->stamp = 0;
+    return n;
+}
+
+/**
+ * @brief (cx, cy)에서 r 이내(경계 포함)인 객체 인덱스를 out에 담습니다. (max_out을 넘는 것은 버림)
+ * @return 담은 개수
+ */
+int bev_grid_radius(const BevGrid* grid, double cx, double cy, double r, int* out, int max_out) {
+    if (!grid || !out || max_out <= 0 || r < 0.0) return 0;
+    const DetectedObject* objs = grid->objs;
+    double r2 = r * r;
+    int found = 0;
+
+    int x0, x1, y0, y1;
+    if (bev_span(cx - r, cx + r, &x0, &x1) && bev_span(cy - r, cy + r, &y0, &y1)) {
+        for (int gy = y0; gy <= y1; gy++) {
+            for (int gx = x0; gx <= x1; gx++) {
+                int c = gy * BEV_DIM + gx;
+                for (int k = grid->cell_start[c]; k < grid->cell_start[c + 1]; k++) {
+                    int i = grid->items[k];
+                    double dx = objs[i].x - cx, dy = objs[i].y - cy;
+                    if (dx * dx + dy * dy <= r2) {
+                        out[found++] = i;
+                        if (found >= max_out) return found;
+                    }
+                }
+            }
+        }
+    }
+    for (int k = 0; k < grid->outside_count; k++) {
+        int i = grid->outside[k];
+        double dx = objs[i].x - cx, dy = objs[i].y - cy;
+        if (dx * dx + dy * dy <= r2) {
+            out[found++] = i;
+            if (found >= max_out) break;
+        }
+    }
+    return found;
+}
+
+// 점 (x, y)와 선분 a-b 사이 거리^2
+static double seg_dist2(double x, double y, double ax, double ay, double bx, double by) {
+    double ux = bx - ax, uy = by - ay;
+    double wx = x - ax, wy = y - ay;
+    double len2 = ux * ux + uy * uy;
+    double t = (len2 > 0.0) ? (wx * ux + wy * uy) / len2 : 0.0;
+    if (t < 0.0) t = 0.0;
+    if (t > 1.0) t = 1.0;
+    double dx = wx - ux * t, dy = wy - uy * t;
+    return dx * dx + dy * dy;
+}
+
+/**
+ * @brief 꺾은선 (px[k], py[k])에서 half_width 이내인 객체 인덱스를 out에 담습니다. (n == 1이면 반경 질의와 같음)
+ * @return 담은 개수 (max_out을 넘는 것은 버림)
+ */
+int bev_grid_corridor(BevGrid* grid, const double* px, const double* py, int n, double half_width, int* out, int max_out) {
+    if (!grid || !px || !py || n <= 0 || !out || max_out <= 0 || half_width < 0.0) return 0;
+    if (n == 1) return bev_grid_radius(grid, px[0], py[0], half_width, out, max_out);
+
+    const DetectedObject* objs = grid->objs;
+    double hw2 = half_width * half_width;
+    double piece_len = fmax(BEV_CELL_M, half_width);
+    int found = 0;
+
+    if (++grid->stamp == 0) {   // 한 바퀴 돌면 표시를 지우고 다시 시작
+        memset(grid->mark, 0, sizeof(grid->mark));
+        grid->stamp = 1;
+    }
+    const unsigned int stamp = grid->stamp;
+
+    for (int s = 0; s + 1 < n; s++) {
+        double ax = px[s], ay = py[s], bx = px[s + 1], by = py[s + 1];
+        double len = hypot(bx - ax, by - ay);
+        int pieces = (int)ceil(len / piece_len);
+        if (pieces < 1) pieces = 1;
+
+        for (int p = 0; p < pieces; p++) {
+            double t0 = (double)p / pieces, t1 = (double)(p + 1) / pieces;
+            double sx0 = ax + (bx - ax) * t0, sy0 = ay + (by - ay) * t0;
+            double sx1 = ax + (bx - ax) * t1, sy1 = ay + (by - ay) * t1;
+
+            int x0, x1, y0, y1;
+            if (!bev_span(fmin(sx0, sx1) - half_width, fmax(sx0, sx1) + half_width, &x0, &x1) ||
+                !bev_span(fmin(sy0, sy1) - half_width, fmax(sy0, sy1) + half_width, &y0, &y1)) {
+                continue;
+            }
+            for (int gy = y0; gy <= y1; gy++) {
+                for (int gx = x0; gx <= x1; gx++) {
+                    int c = gy * BEV_DIM + gx;
+                    for (int k = grid->cell_start[c]; k < grid->cell_start[c + 1]; k++) {
+                        int i = grid->items[k];
+                        if (grid->mark[i] == stamp) continue;
+                        if (seg_dist2(objs[i].x, objs[i].y, sx0, sy0, sx1, sy1) <= hw2) {
+                            grid->mark[i] = stamp;
+                            out[found++] = i;
+                            if (found >= max_out) return found;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (int k = 0; k < grid->outside_count; k++) {
+        int i = grid->outside[k];
+        for (int s = 0; s + 1 < n; s++) {
+            if (seg_dist2(objs[i].x, objs[i].y, px[s], py[s], px[s + 1], py[s + 1]) <= hw2) {
+                out[found++] = i;
+                if (found >= max_out) return found;
+                break;
+            }
+        }
+    }
+    return found;
+}
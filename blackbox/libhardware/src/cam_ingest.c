@@ -0,0 +1,224 @@
+/**
+ * @file cam_ingest.c
+ * @brief 다중 카메라 RTP/H.264 수신 엔진: 카메라마다 udpsrc → 디코드 → BGR 프레임을 공유 메모리 링(cam_ring)에 씁니다.
+ * @details
+ * vision_server.py의 GstVideoReceiver와 같은 파이프라인을 C에서 카메라마다 하나씩 돌립니다.
+ * 폴링 대신 appsink new-sample 콜백(GStreamer 스트리밍 스레드)에서 디코더 버퍼를 링 슬롯에 한 번만 복사하고,
+ * 파이썬은 그 슬롯을 np.frombuffer로 복사 없이 읽습니다. 크기 변환(800x450)도 파이프라인 안(videoscale)에서 끝냅니다.
+ *
+ * 수신 시각: 파이프라인 시계를 CLOCK_MONOTONIC 시스템 시계로 고정하고, 버퍼의 running time + base time을 씁니다.
+ * udpsrc는 라이브 소스라 패킷 도착 시각으로 타임스탬프를 찍으므로, 디코드 지연과 상관없이 now_sec()와 바로 비교할 수 있습니다.
+ *
+ * 에러(카메라 끊김 등)가 나면 그 카메라 파이프라인만 멈추고 CAM_RESTART_SEC 뒤에 cam_ingest_poll()이 다시 시작합니다.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+
+#include "hardware.h"
+
+typedef struct {
+    int index;
+    GstElement* pipeline;
+    GstBus* bus;
+    double restart_at;          // 0이 아니면 이 시각에 다시 시작 (에러로 멈춘 상태)
+} CamChannel;
+
+static CamChannel s_cams[CAM_RING_MAX_CAMS];
+static int s_num_cams = 0;
+static int s_width = 0;
+static int s_height = 0;
+static GstClock* s_clock = NULL;
+static unsigned int s_restarts = 0;
+
+// 버퍼 수신 시각 (CLOCK_MONOTONIC 초), 타임스탬프가 없으면 지금
+static double capture_time(const CamChannel* ch, GstSample* sample, GstBuffer* buf) {
+    GstClockTime pts = GST_BUFFER_PTS(buf);
+    const GstSegment* seg = gst_sample_get_segment(sample);
+    GstClockTime base = gst_element_get_base_time(ch->pipeline);
+    if (GST_CLOCK_TIME_IS_VALID(pts) && seg && GST_CLOCK_TIME_IS_VALID(base)) {
+        GstClockTime rt = gst_segment_to_running_time(seg, GST_FORMAT_TIME, pts);
+        if (GST_CLOCK_TIME_IS_VALID(rt)) return (double)(base + rt) * 1e-9;
+    }
+    return now_sec();
+}
+
+// appsink 스트리밍 스레드: 디코드된 프레임을 링 슬롯에 복사 (행 끝 패딩은 빼고 촘촘하게)
+static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data) {
+    CamChannel* ch = user_data;
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (!sample) return GST_FLOW_EOS;
+
+    GstBuffer* buf = gst_sample_get_buffer(sample);
+    GstCaps* caps = gst_sample_get_caps(sample);
+    int w = 0, h = 0;
+    if (caps) {
+        const GstStructure* st = gst_caps_get_structure(caps, 0);
+        gst_structure_get_int(st, "width", &w);
+        gst_structure_get_int(st, "height", &h);
+    }
+
+    GstMapInfo map;
+    if (buf && w == s_width && h == s_height && gst_buffer_map(buf, &map, GST_MAP_READ)) {
+        size_t row = (size_t)w * 3;
+        size_t src_stride = map.size / (size_t)h; // BGR 기본 stride는 4바이트 정렬
+        int slot;
+        unsigned char* dst = (src_stride >= row) ? cam_ring_write_begin(ch->index, &slot) : NULL;
+        if (dst) {
+            if (src_stride == row) {
+                memcpy(dst, map.data, row * (size_t)h);
+            } else {
+                for (int y = 0; y < h; y++) memcpy(dst + row * (size_t)y, map.data + src_stride * (size_t)y, row);
+            }
+            cam_ring_write_end(ch->index, slot, capture_time(ch, sample, buf));
+        }
+        gst_buffer_unmap(buf, &map);
+    }
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+static int build_pipeline(CamChannel* ch, int port, int latency_ms) {
+    char desc[768];
+    snprintf(desc, sizeof(desc),
+        "udpsrc port=%d caps=\"application/x-rtp,media=video,encoding-name=H264,payload=96\" ! "
+        "rtpjitterbuffer latency=%d ! "
+        "rtph264depay ! h264parse config-interval=-1 ! "
+        "avdec_h264 max-threads=0 ! videoconvert ! videoscale ! "
+        "video/x-raw,format=BGR,width=%d,height=%d ! "
+        "appsink name=sink drop=true max-buffers=1 sync=false",
+        port, latency_ms, s_width, s_height);
+
+    GError* err = NULL;
+    ch->pipeline = gst_parse_launch(desc, &err);
+    if (!ch->pipeline || err) {
+        fprintf(stderr, "[CAM] camera %d pipeline: %s\n", ch->index, err ? err->message : "unknown error");
+        if (err) g_error_free(err);
+        if (ch->pipeline) { gst_object_unref(ch->pipeline); ch->pipeline = NULL; }
+        return -1;
+    }
+
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(ch->pipeline), "sink");
+    if (!sink) {
+        fprintf(stderr, "[CAM] camera %d: appsink not found\n", ch->index);
+        gst_object_unref(ch->pipeline);
+        ch->pipeline = NULL;
+        return -1;
+    }
+    GstAppSinkCallbacks cb;
+    memset(&cb, 0, sizeof(cb));
+    cb.new_sample = on_new_sample;
+    gst_app_sink_set_callbacks(GST_APP_SINK(sink), &cb, ch, NULL);
+    gst_object_unref(sink);
+
+    // 모든 카메라가 같은 CLOCK_MONOTONIC 시계를 쓰게 해서 수신 시각끼리, 그리고 now_sec()와 비교 가능하게 함
+    gst_pipeline_use_clock(GST_PIPELINE(ch->pipeline), s_clock);
+    ch->bus = gst_element_get_bus(ch->pipeline);
+    return 0;
+}
+
+/**
+ * @brief 공유 메모리 링을 만들고 카메라 파이프라인을 모두 시작합니다. 파이썬 자식을 띄우기 전에 호출하세요.
+ * @param cfg 설정 (NULL이거나 0인 필드는 CAM_* 기본값).
+ * @return 0: 성공 (카메라가 아직 송출 전이어도 성공), -1: 링/GStreamer 초기화 실패.
+ */
+int cam_ingest_start(const CamIngestConfig* cfg) {
+    if (s_num_cams > 0) return 0;
+
+    int n = (cfg && cfg->num_cams > 0) ? cfg->num_cams : CAM_NUM;
+    int port0 = (cfg && cfg->base_port > 0) ? cfg->base_port : CAM_BASE_PORT;
+    int latency = (cfg && cfg->latency_ms > 0) ? cfg->latency_ms : CAM_JITTER_LATENCY_MS;
+    s_width = (cfg && cfg->width > 0) ? cfg->width : CAM_FRAME_W;
+    s_height = (cfg && cfg->height > 0) ? cfg->height : CAM_FRAME_H;
+    if (n > CAM_RING_MAX_CAMS) n = CAM_RING_MAX_CAMS;
+
+    GError* err = NULL;
+    if (!gst_init_check(NULL, NULL, &err)) {
+        fprintf(stderr, "[CAM] gst_init: %s\n", err ? err->message : "unknown error");
+        if (err) g_error_free(err);
+        return -1;
+    }
+    if (cam_ring_create(n, s_width, s_height) < 0) return -1;
+
+    s_clock = gst_system_clock_obtain();
+    g_object_set(s_clock, "clock-type", GST_CLOCK_TYPE_MONOTONIC, NULL);
+
+    for (int i = 0; i < n; i++) {
+        CamChannel* ch = &s_cams[i];
+        memset(ch, 0, sizeof(*ch));
+        ch->index = i;
+        s_num_cams = i + 1;
+        if (build_pipeline(ch, port0 + i, latency) < 0) goto fail;
+        if (gst_element_set_state(ch->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+            gst_element_set_state(ch->pipeline, GST_STATE_NULL);
+            ch->restart_at = now_sec() + CAM_RESTART_SEC; // 포트 점유 등: 나중에 다시 시도
+        }
+    }
+    s_restarts = 0;
+    return 0;
+
+fail:
+    cam_ingest_stop();
+    return -1;
+}
+
+/**
+ * @brief 제어 주기마다 호출: 버스에 쌓인 에러/EOS를 확인하고, 멈춘 파이프라인은 CAM_RESTART_SEC 뒤에 다시 시작합니다.
+ */
+void cam_ingest_poll(double now) {
+    for (int i = 0; i < s_num_cams; i++) {
+        CamChannel* ch = &s_cams[i];
+        if (!ch->pipeline) continue;
+
+        if (ch->restart_at > 0.0) {
+            if (now < ch->restart_at) continue;
+            ch->restart_at = 0.0;
+            s_restarts++;
+            if (gst_element_set_state(ch->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+                gst_element_set_state(ch->pipeline, GST_STATE_NULL);
+                ch->restart_at = now + CAM_RESTART_SEC;
+                continue;
+            }
+            log_info("[CAM] camera %d pipeline restarted\n", i);
+        }
+
+        GstMessage* msg;
+        while ((msg = gst_bus_pop_filtered(ch->bus, GST_MESSAGE_ERROR | GST_MESSAGE_EOS)) != NULL) {
+            if (ch->restart_at == 0.0) {
+                log_warn("[CAM] camera %d pipeline %s, restarting in %.1fs\n", i,
+                         GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS ? "EOS" : "error", CAM_RESTART_SEC);
+                gst_element_set_state(ch->pipeline, GST_STATE_NULL);
+                ch->restart_at = now + CAM_RESTART_SEC;
+            }
+            gst_message_unref(msg);
+        }
+    }
+}
+
+void cam_ingest_stats(CamIngestStats* out) {
+    if (!out) return;
+    cam_ring_stats(out);
+    out->restarts = s_restarts;
+}
+
+/**
+ * @brief 파이프라인을 모두 멈추고 링을 해제합니다. (NULL 상태 전환이 끝나면 콜백이 더 불리지 않음)
+ */
+void cam_ingest_stop(void) {
+    for (int i = 0; i < s_num_cams; i++) {
+        CamChannel* ch = &s_cams[i];
+        if (ch->pipeline) {
+            gst_element_set_state(ch->pipeline, GST_STATE_NULL);
+            gst_object_unref(ch->pipeline);
+            ch->pipeline = NULL;
+        }
+        if (ch->bus) { gst_object_unref(ch->bus); ch->bus = NULL; }
+    }
+    s_num_cams = 0;
+    if (s_clock) { gst_object_unref(s_clock); s_clock = NULL; }
+    cam_ring_destroy();
+}
@@ -0,0 +1,318 @@
+/**
+ * @file cam_ring.c
+ * @brief 카메라 프레임 공유 메모리 링 (C 수신 엔진이 쓰고 vision_server.py가 np.frombuffer로 읽음).
+ * @details
+ * 기존에는 vision_server.py의 GstVideoReceiver 스레드 6개가 try-pull-sample을 5ms 간격으로 폴링하며
+ * 프레임을 numpy로 복사해 latest_frame 하나만 남겼고, analyze는 그 순간 남아 있던 프레임을 카메라마다 제각각 가져갔습니다.
+ * 이 링은 카메라마다 고정 크기 슬롯 CAM_RING_SLOTS개를 memfd 하나에 두고, 디코더 출력을 수신 시각과 함께 슬롯에 씁니다.
+ *
+ * 동기화 (슬롯을 고르고 지키는 일은 전부 C 프로세스 안에서, 카메라별 뮤텍스로 처리):
+ * - 쓰기: 최신 슬롯, 붙잡힌 슬롯이 아닌 것 중 가장 오래된 슬롯에 씀. 쓰는 동안 seq는 0, 다 쓰면 새 번호.
+ * - 읽기: cam_ring_pick()이 analyze마다 수신 시각이 가장 잘 맞는 세트를 골라 붙잡고 슬롯 번호/seq를 돌려줌.
+ *   붙잡힌 세트는 다음 CAM_RING_HOLDS번의 pick 동안 덮어쓰지 않으므로 파이썬은 잠금 없이 읽음.
+ *   파이썬이 그보다 늦게 읽는 경우에 대비해 읽은 뒤 seq가 그대로인지 한 번 더 확인합니다.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include "hardware.h"
+
+// 공유 메모리 헤더 (64바이트, 슬롯은 그 뒤에 [카메라][슬롯] 순서로 slot_size 간격)
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t cams;
+    uint32_t slots;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;            // 한 줄 바이트 수 (width * 3, 패딩 없음)
+    uint32_t slot_size;         // 슬롯 머리 + 픽셀, 64바이트 단위로 올림
+    uint8_t pad[32];
+} CamRingHeader;
+
+// 슬롯 머리 (64바이트, 바로 뒤에 BGR 픽셀 stride * height)
+typedef struct {
+    _Atomic uint64_t seq;       // 카메라별 프레임 번호 (1부터), 0이면 비었거나 쓰는 중
+    double timestamp;           // 수신 시각 (CLOCK_MONOTONIC 초)
+    uint32_t width;
+    uint32_t height;
+    uint8_t pad[40];
+} CamRingSlot;
+
+// ai/cam_ring.py의 struct 포맷과 어긋나면 컴파일 단계에서 잡음
+_Static_assert(sizeof(CamRingHeader) == 64, "CamRingHeader layout");
+_Static_assert(sizeof(CamRingSlot) == 64, "CamRingSlot layout");
+_Static_assert(offsetof(CamRingSlot, timestamp) == 8, "CamRingSlot.timestamp offset");
+
+// 프로세스 안에서만 쓰는 카메라별 상태
+typedef struct {
+    pthread_mutex_t lock;
+    int latest;                             // 마지막으로 다 쓴 슬롯 (-1: 아직 없음)
+    int writing;                            // 쓰는 중인 슬롯 (-1: 없음)
+    unsigned char held[CAM_RING_SLOTS];     // 슬롯을 붙잡은 세트 수
+    uint64_t next_seq;
+    unsigned long frames;
+    unsigned long drops;
+} CamRingChannel;
+
+static int s_shm_fd = -1;
+static unsigned char* s_base = NULL;
+static size_t s_total = 0;
+static int s_cams = 0;
+static CamRingChannel s_ch[CAM_RING_MAX_CAMS];
+
+// 최근 CAM_RING_HOLDS번의 pick이 붙잡은 슬롯 (가장 오래된 것부터 다음 pick 때 풀어 줌)
+static int s_holds[CAM_RING_HOLDS][CAM_RING_MAX_CAMS];
+static int s_hold_next = 0;
+
+static CamRingHeader* header(void) {
+    return (CamRingHeader*)s_base;
+}
+
+static CamRingSlot* slot_at(int cam, int slot) {
+    return (CamRingSlot*)(s_base + sizeof(CamRingHeader) +
+                          (size_t)header()->slot_size * ((size_t)cam * CAM_RING_SLOTS + (size_t)slot));
+}
+
+/**
+ * @brief 공유 메모리를 만들고 헤더를 초기화합니다. 파이썬 자식을 띄우기 전에 호출하세요.
+ * @param cams 카메라 수 (최대 CAM_RING_MAX_CAMS).
+ * @param width, height 프레임 크기 (BGR, 디코더 뒤에서 이 크기로 맞춰 들어와야 함).
+ * @return 0: 성공, -1: 실패.
+ */
+int cam_ring_create(int cams, int width, int height) {
+    if (s_base) return 0;
+    if (cams <= 0 || cams > CAM_RING_MAX_CAMS || width <= 0 || height <= 0) return -1;
+
+    size_t stride = (size_t)width * 3;
+    size_t slot_size = (sizeof(CamRingSlot) + stride * (size_t)height + 63) & ~(size_t)63;
+    size_t total = sizeof(CamRingHeader) + slot_size * (size_t)cams * CAM_RING_SLOTS;
+
+    s_shm_fd = memfd_create("blackbox-cameras", MFD_CLOEXEC);
+    if (s_shm_fd < 0 || ftruncate(s_shm_fd, (off_t)total) < 0) {
+        perror("[CAM_RING] memfd");
+        goto fail;
+    }
+    void* base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, s_shm_fd, 0);
+    if (base == MAP_FAILED) {
+        perror("[CAM_RING] mmap");
+        goto fail;
+    }
+    s_base = base;
+    s_total = total;
+    s_cams = cams;
+
+    // memfd는 0으로 채워져 있으므로 헤더 필드만 설정 (seq 0 = 빈 슬롯)
+    CamRingHeader* h = header();
+    h->magic = CAM_RING_MAGIC;
+    h->version = CAM_RING_VERSION;
+    h->cams = (uint32_t)cams;
+    h->slots = CAM_RING_SLOTS;
+    h->width = (uint32_t)width;
+    h->height = (uint32_t)height;
+    h->stride = (uint32_t)stride;
+    h->slot_size = (uint32_t)slot_size;
+
+    for (int c = 0; c < cams; c++) {
+        CamRingChannel* ch = &s_ch[c];
+        memset(ch, 0, sizeof(*ch));
+        pthread_mutex_init(&ch->lock, NULL);
+        ch->latest = -1;
+        ch->writing = -1;
+    }
+    for (int k = 0; k < CAM_RING_HOLDS; k++) {
+        for (int c = 0; c < CAM_RING_MAX_CAMS; c++) s_holds[k][c] = -1;
+    }
+    s_hold_next = 0;
+    return 0;
+
+fail:
+    cam_ring_destroy();
+    return -1;
+}
+
+/**
+ * @brief fork된 자식에서 exec 직전에 호출: memfd를 exec 후에도 열려 있게 하고 번호를 환경 변수로 넘깁니다.
+ * @return 0: 성공, -1: 링이 없음.
+ */
+int cam_ring_export(void) {
+    if (s_shm_fd < 0) return -1;
+
+    char buf[16];
+    fcntl(s_shm_fd, F_SETFD, 0);
+    snprintf(buf, sizeof(buf), "%d", s_shm_fd);
+    setenv(CAM_RING_ENV_FD, buf, 1);
+    return 0;
+}
+
+/**
+ * @brief 카메라 cam의 프레임을 쓸 슬롯을 잡습니다. (수신 스레드에서 호출)
+ * @details 최신 슬롯과 붙잡힌 슬롯은 건너뛰고 가장 오래된 슬롯을 고릅니다.
+ * @param slot 잡은 슬롯 번호 (cam_ring_write_end에 그대로 넘김).
+ * @return 픽셀을 쓸 위치 (stride = width * 3), 쓸 슬롯이 없으면 NULL (프레임을 버리고 drops 증가).
+ */
+unsigned char* cam_ring_write_begin(int cam, int* slot) {
+    if (!s_base || cam < 0 || cam >= s_cams || !slot) return NULL;
+    CamRingChannel* ch = &s_ch[cam];
+
+    pthread_mutex_lock(&ch->lock);
+    int best = -1;
+    uint64_t best_seq = UINT64_MAX;
+    for (int s = 0; s < CAM_RING_SLOTS; s++) {
+        if (s == ch->latest || s == ch->writing || ch->held[s]) continue;
+        uint64_t seq = atomic_load_explicit(&slot_at(cam, s)->seq, memory_order_relaxed);
+        if (seq < best_seq) {
+            best = s;
+            best_seq = seq;
+        }
+    }
+    if (best < 0) {
+        ch->drops++;
+        pthread_mutex_unlock(&ch->lock);
+        return NULL;
+    }
+    ch->writing = best;
+    atomic_store_explicit(&slot_at(cam, best)->seq, 0, memory_order_release); // 파이썬에게 쓰는 중임을 알림
+    pthread_mutex_unlock(&ch->lock);
+
+    *slot = best;
+    return (unsigned char*)(slot_at(cam, best) + 1);
+}
+
+/**
+ * @brief 다 쓴 슬롯을 최신 프레임으로 공개합니다.
+ * @param timestamp 수신 시각 (now_sec와 같은 시계).
+ */
+void cam_ring_write_end(int cam, int slot, double timestamp) {
+    if (!s_base || cam < 0 || cam >= s_cams || slot < 0 || slot >= CAM_RING_SLOTS) return;
+    CamRingChannel* ch = &s_ch[cam];
+    CamRingSlot* sl = slot_at(cam, slot);
+
+    sl->timestamp = timestamp;
+    sl->width = header()->width;
+    sl->height = header()->height;
+
+    pthread_mutex_lock(&ch->lock);
+    atomic_store_explicit(&sl->seq, ++ch->next_seq, memory_order_release);
+    ch->latest = slot;
+    ch->writing = -1;
+    ch->frames++;
+    pthread_mutex_unlock(&ch->lock);
+}
+
+/**
+ * @brief analyze 한 번에 넘길 프레임 세트를 고르고 붙잡습니다. (제어 루프에서 호출)
+ * @details
+ * 기준 시각은 각 카메라 최신 프레임 시각 중 가장 이른 것(모든 카메라가 그 시각까지는 프레임을 가짐)이고,
+ * 카메라마다 기준 시각에 가장 가까운 슬롯을 고릅니다. 기준보다 CAM_STALE_SEC 넘게 오래된 프레임만 있는 카메라는 slot -1.
+ * 가장 오래된 세트는 풀어 주므로 붙잡힌 세트는 항상 최근 CAM_RING_HOLDS개입니다.
+ * @return 프레임이 있는 카메라 수, 링이 없으면 -1.
+ */
+int cam_ring_pick(CamFrameSet* out, double now) {
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!s_base) return -1;
+    out->count = s_cams;
+
+    // 1) 가장 오래된 세트를 풀어 그 자리에 이번 세트를 기록
+    int* hold = s_holds[s_hold_next];
+    s_hold_next = (s_hold_next + 1) % CAM_RING_HOLDS;
+    for (int c = 0; c < s_cams; c++) {
+        if (hold[c] < 0) continue;
+        pthread_mutex_lock(&s_ch[c].lock);
+        if (s_ch[c].held[hold[c]] > 0) s_ch[c].held[hold[c]]--;
+        pthread_mutex_unlock(&s_ch[c].lock);
+        hold[c] = -1;
+    }
+
+    // 2) 기준 시각: 최근 프레임이 있는 카메라들의 최신 시각 중 가장 이른 것
+    double ref = 0.0;
+    int have_ref = 0;
+    for (int c = 0; c < s_cams; c++) {
+        CamRingChannel* ch = &s_ch[c];
+        pthread_mutex_lock(&ch->lock);
+        if (ch->latest >= 0) {
+            double ts = slot_at(c, ch->latest)->timestamp;
+            if (now - ts <= CAM_STALE_SEC && (!have_ref || ts < ref)) {
+                ref = ts;
+                have_ref = 1;
+            }
+        }
+        pthread_mutex_unlock(&ch->lock);
+    }
+
+    // 3) 카메라마다 기준 시각에 가장 가까운 완성 슬롯을 골라 붙잡음 (잠금 안에서 붙잡으므로 쓰기와 겹치지 않음)
+    double t_min = 0.0, t_max = 0.0;
+    for (int c = 0; c < s_cams; c++) {
+        CamFrameRef* r = &out->cams[c];
+        r->slot = -1;
+        if (!have_ref) continue;
+
+        CamRingChannel* ch = &s_ch[c];
+        pthread_mutex_lock(&ch->lock);
+        int best = -1;
+        double best_err = 0.0;
+        for (int s = 0; s < CAM_RING_SLOTS; s++) {
+            if (s == ch->writing) continue;
+            const CamRingSlot* sl = slot_at(c, s);
+            if (atomic_load_explicit(&sl->seq, memory_order_relaxed) == 0) continue;
+            if (ref - sl->timestamp > CAM_STALE_SEC) continue;
+            double err = fabs(sl->timestamp - ref);
+            if (best < 0 || err < best_err) {
+                best = s;
+                best_err = err;
+            }
+        }
+        if (best >= 0) {
+            const CamRingSlot* sl = slot_at(c, best);
+            ch->held[best]++;
+            hold[c] = best;
+            r->slot = best;
+            r->seq = (unsigned long)atomic_load_explicit(&sl->seq, memory_order_relaxed);
+            r->timestamp = sl->timestamp;
+        }
+        pthread_mutex_unlock(&ch->lock);
+
+        if (best >= 0) {
+            if (out->valid == 0 || r->timestamp < t_min) t_min = r->timestamp;
+            if (out->valid == 0 || r->timestamp > t_max) t_max = r->timestamp;
+            out->valid++;
+        }
+    }
+    out->ref_time = have_ref ? ref : 0.0;
+    out->spread = t_max - t_min;
+    return out->valid;
+}
+
+void cam_ring_stats(CamIngestStats* out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    out->cams = s_cams;
+    for (int c = 0; c < s_cams; c++) {
+        pthread_mutex_lock(&s_ch[c].lock);
+        out->frames[c] = s_ch[c].frames;
+        out->drops[c] = s_ch[c].drops;
+        pthread_mutex_unlock(&s_ch[c].lock);
+    }
+}
+
+/**
+ * @brief 링을 해제합니다. 수신 스레드가 모두 멈춘 뒤 호출하세요.
+ */
+void cam_ring_destroy(void) {
+    if (s_base) { munmap(s_base, s_total); s_base = NULL; }
+    for (int c = 0; c < s_cams; c++) pthread_mutex_destroy(&s_ch[c].lock);
+    s_cams = 0;
+    s_total = 0;
+    if (s_shm_fd >= 0) { close(s_shm_fd); s_shm_fd = -1; }
+}
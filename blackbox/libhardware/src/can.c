@@ -10,6 +10,7 @@
  */
 
 // --- 1. 필수 헤더 파일 포함 ---
+#define _GNU_SOURCE     // recvmmsg() 사용을 위해 필요
 #include <stdio.h>      // 표준 입출력 함수 (perror)
 #include <string.h>     // 문자열 및 메모리 처리 함수 (strncpy, memcpy, memset)
 #include <unistd.h>     // 유닉스 표준(POSIX) API (close, write, read)
@@ -19,6 +20,11 @@
 #include <net/if.h>     // 네트워크 인터페이스 구조체 (ifreq)
 #include <linux/can.h>  // 리눅스 CAN 프로토콜 관련 정의 (PF_CAN, CAN_RAW, sockaddr_can, can_frame)
 #include <linux/can/raw.h>// CAN RAW 소켓 관련 정의
+#include <linux/can/error.h>// 에러 프레임 클래스 정의 (CAN_ERR_*)
+#include <linux/net_tstamp.h>// SO_TIMESTAMPING 플래그 (SOF_TIMESTAMPING_*)
+#include <linux/errqueue.h>  // struct scm_timestamping
+#include <errno.h>      // EAGAIN 판별
+#include <stdint.h>     // uint32_t (SO_RXQ_OVFL 카운터)
 
 #include "hardware.h"   // 이 파일에서 구현할 함수의 원형이 담긴 헤더
 // #include "main.h"    // PID, 상태 플래그 정의를 포함하기 위해 필요할 수 있습니다.
@@ -30,12 +36,79 @@
 // -1은 아직 초기화되지 않았거나 유효하지 않은 상태임을 나타내는 일반적인 관례입니다.
 static int s_can_fd = -1;
 
+// recvmmsg() 한 번에 프레임마다 붙는 제어 메시지(타임스탬프 + 드롭 카운터)를 담을 버퍼 크기
+#define CAN_CMSG_SPACE (CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(uint32_t)))
+
+// 기본 커널 필터: OBD-II 진단 응답(0x7E8 ~ 0x7EF)만 사용자 공간으로 올림
+static const CANFilter s_default_filters[] = {
+    { CAN_OBD_RESPONSE_ID, CAN_OBD_RESPONSE_MASK },
+};
+
 /**
- * @brief CAN 인터페이스를 초기화하고 소켓을 준비합니다.
+ * @brief CAN 인터페이스를 기본 필터(진단 응답 + 버스 에러)로 초기화합니다.
  * @param interface_name "can0"와 같은 CAN 인터페이스 이름.
  * @return 성공 시 CAN 소켓 파일 디스크립터(fd), 실패 시 -1.
  */
 int can_init(const char* interface_name) {
+    return can_init_ex(interface_name, s_default_filters,
+                       (int)(sizeof(s_default_filters) / sizeof(s_default_filters[0])),
+                       CAN_ERR_EVENTS_DEFAULT);
+}
+
+/**
+ * @brief 소켓에 커널 수신 필터(CAN_RAW_FILTER)와 에러 프레임 구독(CAN_RAW_ERR_FILTER)을 설치합니다.
+ * @details
+ * 필터는 커널에서 적용되므로, 걸러진 프레임은 사용자 공간으로 복사되지도 않고 select()를 깨우지도 않습니다.
+ * 표준(11비트) ID 필터에는 확장 프레임/RTR 프레임이 섞여 들어오지 않도록 EFF/RTR 비트를 마스크에 추가합니다.
+ * @param filters 통과시킬 ID/마스크 목록. count가 0이면 데이터 프레임을 하나도 받지 않습니다(에러 프레임만 수신).
+ * @param count 필터 개수 (최대 CAN_FILTER_MAX).
+ * @param err_mask 구독할 에러 클래스 비트 (CAN_ERR_EVENTS_DEFAULT 등), 0이면 에러 프레임 수신 안 함.
+ * @return 0: 성공, -1: 실패.
+ */
+int can_set_filters(const CANFilter* filters, int count, unsigned int err_mask) {
+    if (s_can_fd < 0 || count < 0 || count > CAN_FILTER_MAX) return -1;
+    if (count > 0 && !filters) return -1;
+
+    struct can_filter rfilter[CAN_FILTER_MAX];
+    for (int i = 0; i < count; i++) {
+        rfilter[i].can_id   = filters[i].id;
+        rfilter[i].can_mask = filters[i].mask;
+        if (!(filters[i].id & CAN_EFF_FLAG)) {
+            rfilter[i].can_mask |= CAN_EFF_FLAG | CAN_RTR_FLAG;
+        }
+    }
+    if (setsockopt(s_can_fd, SOL_CAN_RAW, CAN_RAW_FILTER,
+                   (count > 0) ? rfilter : NULL, sizeof(struct can_filter) * count) < 0) {
+        perror("setsockopt(CAN_RAW_FILTER) error");
+        return -1;
+    }
+
+    can_err_mask_t em = (can_err_mask_t)(err_mask & CAN_ERR_MASK);
+    if (setsockopt(s_can_fd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &em, sizeof(em)) < 0) {
+        perror("setsockopt(CAN_RAW_ERR_FILTER) error");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 수신된 메시지가 에러 프레임인지 확인합니다.
+ * @return 에러 프레임이면 에러 클래스 비트(CAN_ERR_* 조합), 일반 데이터 프레임이면 0.
+ */
+unsigned int can_error_class(const CANMessage* msg) {
+    if (!msg || !(msg->id & CAN_ERR_FLAG)) return 0;
+    return msg->id & CAN_ERR_MASK;
+}
+
+/**
+ * @brief CAN 인터페이스를 초기화하고 소켓을 준비합니다.
+ * @param interface_name "can0"와 같은 CAN 인터페이스 이름.
+ * @param filters 커널에 설치할 수신 필터 목록 (can_set_filters 참고).
+ * @param count 필터 개수.
+ * @param err_mask 구독할 에러 클래스 비트.
+ * @return 성공 시 CAN 소켓 파일 디스크립터(fd), 실패 시 -1.
+ */
+int can_init_ex(const char* interface_name, const CANFilter* filters, int count, unsigned int err_mask) {
     // 1. CAN RAW 소켓 생성
     s_can_fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
     if (s_can_fd < 0) {
@@ -62,9 +135,28 @@ int can_init(const char* interface_name) {
         return -1;
     }
     
-    // 4. 소켓을 논블로킹(Non-blocking) 모드로 설정 (중요!)
+    // 4. 커널 수신 필터 설치: 필요한 진단 응답과 버스 에러 이벤트만 사용자 공간으로 올림
+    if (can_set_filters(filters, count, err_mask) < 0) {
+        close(s_can_fd); s_can_fd = -1;
+        return -1;
+    }
+
+    // 5. 소켓을 논블로킹(Non-blocking) 모드로 설정 (중요!)
     // read() 함수가 읽을 데이터가 없을 때 기다리지 않고 즉시 리턴되도록 합니다.
     fcntl(s_can_fd, F_SETFL, O_NONBLOCK);
+
+    // 6. 수신 타임스탬프와 소켓 버퍼 오버플로 카운터 활성화
+    // 하드웨어 타임스탬프를 지원하지 않는 컨트롤러(MCP2515 등)에서는 커널 소프트웨어 타임스탬프만 붙습니다.
+    // 실패해도 수신 자체에는 지장이 없으므로 치명적 에러로 취급하지 않습니다.
+    int ts_flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                   SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (setsockopt(s_can_fd, SOL_SOCKET, SO_TIMESTAMPING, &ts_flags, sizeof(ts_flags)) < 0) {
+        perror("setsockopt(SO_TIMESTAMPING) warning");
+    }
+    int ovfl = 1;
+    if (setsockopt(s_can_fd, SOL_SOCKET, SO_RXQ_OVFL, &ovfl, sizeof(ovfl)) < 0) {
+        perror("setsockopt(SO_RXQ_OVFL) warning");
+    }
     
     return s_can_fd; // 성공 시, 생성된 파일 디스크립터를 직접 반환
 }
@@ -108,10 +200,92 @@ int can_receive_message(CANMessage* msg) {
     msg->id = frame.can_id;
     msg->dlc = frame.can_dlc;
     memcpy(msg->data, frame.data, frame.can_dlc);
+    // read()로는 커널 타임스탬프를 받을 수 없으므로 현재 시각으로 대신합니다.
+    msg->timestamp = now_sec();
+    msg->hw_timestamp = 0.0;
     
     return 1; // 메시지 1개 수신 성공
 }
 
+/**
+ * @brief 여러 개의 CAN 메시지를 한 번의 시스템 콜(recvmmsg)로 수신합니다. (논블로킹)
+ * @details
+ * 프레임마다 read()를 호출하던 방식 대신, 소켓 버퍼에 쌓인 프레임을 최대 max개까지 한 번에 가져옵니다.
+ * 각 프레임에는 커널이 수신한 시점의 타임스탬프(SO_TIMESTAMPING)가 붙습니다.
+ * 커널 소프트웨어 타임스탬프는 CLOCK_REALTIME 기준이므로, now_sec()와 같은 CLOCK_MONOTONIC 축으로 변환해 저장합니다.
+ * @param msgs 수신된 메시지를 저장할 배열 (최소 max개).
+ * @param max 한 번에 받을 최대 메시지 수 (CAN_RX_BATCH 이하 권장).
+ * @param drops 소켓 버퍼 오버플로로 버려진 누적 프레임 수를 저장할 포인터 (NULL 가능, 정보가 없으면 변경하지 않음).
+ * @return 수신한 메시지 수 (0: 수신된 메시지 없음), <0: 에러 발생.
+ */
+int can_receive_batch(CANMessage* msgs, int max, unsigned int* drops) {
+    if (s_can_fd < 0 || !msgs || max <= 0) return -1;
+    if (max > CAN_RX_BATCH) max = CAN_RX_BATCH;
+
+    struct can_frame frames[CAN_RX_BATCH];
+    struct iovec iov[CAN_RX_BATCH];
+    struct mmsghdr mmsg[CAN_RX_BATCH];
+    char ctrl[CAN_RX_BATCH][CAN_CMSG_SPACE];
+
+    memset(mmsg, 0, sizeof(mmsg[0]) * max);
+    for (int i = 0; i < max; i++) {
+        iov[i].iov_base = &frames[i];
+        iov[i].iov_len  = sizeof(frames[i]);
+        mmsg[i].msg_hdr.msg_iov        = &iov[i];
+        mmsg[i].msg_hdr.msg_iovlen     = 1;
+        mmsg[i].msg_hdr.msg_control    = ctrl[i];
+        mmsg[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+    }
+
+    int n = recvmmsg(s_can_fd, mmsg, max, MSG_DONTWAIT, NULL);
+    if (n < 0) {
+        // 읽을 데이터가 없는 것은 에러가 아님 (논블로킹)
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+
+    // REALTIME -> MONOTONIC 변환용 오프셋 (배치 단위로 한 번만 계산)
+    struct timespec rt;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    double rx_now = now_sec();
+    double rt_to_mono = rx_now - ((double)rt.tv_sec + (double)rt.tv_nsec * 1e-9);
+
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        // 잘린 프레임은 건너뜀
+        if (mmsg[i].msg_len < sizeof(struct can_frame)) continue;
+
+        CANMessage* msg = &msgs[count++];
+        msg->id  = frames[i].can_id;
+        msg->dlc = frames[i].can_dlc;
+        memcpy(msg->data, frames[i].data, frames[i].can_dlc);
+        msg->timestamp    = rx_now;
+        msg->hw_timestamp = 0.0;
+
+        // 제어 메시지에서 타임스탬프/드롭 카운터 추출
+        struct msghdr* mh = &mmsg[i].msg_hdr;
+        for (struct cmsghdr* c = CMSG_FIRSTHDR(mh); c; c = CMSG_NXTHDR(mh, c)) {
+            if (c->cmsg_level != SOL_SOCKET) continue;
+
+            if (c->cmsg_type == SO_TIMESTAMPING) {
+                const struct scm_timestamping* st = (const struct scm_timestamping*)CMSG_DATA(c);
+                // ts[0]: 커널 소프트웨어 타임스탬프, ts[2]: 하드웨어 raw 타임스탬프
+                if (st->ts[0].tv_sec || st->ts[0].tv_nsec) {
+                    msg->timestamp = (double)st->ts[0].tv_sec + (double)st->ts[0].tv_nsec * 1e-9 + rt_to_mono;
+                }
+                if (st->ts[2].tv_sec || st->ts[2].tv_nsec) {
+                    msg->hw_timestamp = (double)st->ts[2].tv_sec + (double)st->ts[2].tv_nsec * 1e-9;
+                }
+            } else if (c->cmsg_type == SO_RXQ_OVFL && drops) {
+                uint32_t d;
+                memcpy(&d, CMSG_DATA(c), sizeof(d));
+                *drops = d;
+            }
+        }
+    }
+
+    return count;
+}
+
 
 // ===================================================================================
 // ====================== 아래부터 새로 추가/수정된 함수들 ========================
@@ -150,117 +324,270 @@ int can_request_pid(unsigned char pid) {
 
 
 /**
- * @brief [응답 해석 함수] 수신된 CAN 메시지를 파싱하여 VehicleData 구조체를 업데이트합니다.
- * @details main.c의 select() 루프에서 CAN 메시지가 수신될 때마다 이 함수를 호출하여,
- * 수신된 메시지가 우리가 기다리던 유효한 응답인지 확인하고 데이터를 갱신합니다.
- * @param msg can_receive_message()로 수신한 CAN 메시지 포인터.
- * @param vehicle_data 파싱된 데이터를 저장하고 업데이트할 차량 데이터 구조체 포인터.
- * @return 어떤 데이터가 업데이트되었는지 나타내는 상태 플래그. (예: STATE_SPEED_RECEIVED)
- * 유효한 응답이 아니면 0을 반환합니다.
+ * @brief [요청 함수] 여러 PID를 서비스 모드 01 요청 한 번으로 묶어서 전송합니다.
+ * @details OBD-II는 한 요청에 PID를 최대 6개까지 넣을 수 있습니다 (단일 프레임: 서비스 1바이트 + PID 6바이트).
+ * 응답은 ECU가 ISO-TP 멀티 프레임으로 보내며, can_parse_response()가 재조립합니다.
+ * @param pids 요청할 PID 배열.
+ * @param count PID 개수 (1 ~ OBD_MAX_PIDS_PER_REQUEST).
+ * @return 성공 시 0, 실패 시 -1.
  */
-void can_parse_and_update_data(const CANMessage* msg, VehicleData* vehicle_data, unsigned char* flag, unsigned char* flag2) {
-    // 1. 이 메시지가 ECU의 진단 응답이 맞는지 ID부터 확인합니다. (응답 ID 범위: 0x7E8 ~ 0x7EF)
-    if (msg->id < 0x7E8 || msg->id > 0x7EF) {
-        return; // 우리가 기다리던 진단 응답이 아니므로 무시.
+int can_request_pids(const unsigned char* pids, int count) {
+    if (s_can_fd < 0 || !pids || count <= 0 || count > OBD_MAX_PIDS_PER_REQUEST) return -1;
+
+    struct can_frame frame = {0};
+    frame.can_id = 0x7DF; // 브로드캐스트 진단 요청 ID
+    frame.can_dlc = 8;
+    frame.data[0] = (unsigned char)(1 + count); // ISO-TP 단일 프레임 길이 (서비스 + PID들)
+    frame.data[1] = 0x01;                       // 서비스 모드 01
+    memcpy(&frame.data[2], pids, (size_t)count);
+
+    int n = write(s_can_fd, &frame, sizeof(frame));
+    return (n == sizeof(frame)) ? 0 : -1;
+}
+
+
+// --- ISO-TP(ISO 15765-2) 재조립 상태: 응답 ID(0x7E8 ~ 0x7EF)마다 하나씩 ---
+#define ISOTP_PCI_SF      0x0 // 단일 프레임
+#define ISOTP_PCI_FF      0x1 // 첫 프레임
+#define ISOTP_PCI_CF      0x2 // 연속 프레임
+#define ISOTP_CF_TIMEOUT  1.0 // 연속 프레임 간 최대 대기 시간(초, N_Cr)
+
+typedef struct {
+    unsigned char active;
+    unsigned char next_sn;    // 다음에 와야 할 연속 프레임 순번 (0~15 순환)
+    int total;                // 전체 페이로드 길이
+    int received;             // 지금까지 받은 길이
+    double last_rx;           // 마지막 프레임 수신 시각
+    unsigned char buf[ISOTP_MAX_PAYLOAD];
+} IsoTpRx;
+
+static IsoTpRx s_isotp_rx[8];
+
+// 첫 프레임을 받으면 "계속 보내라"는 흐름 제어(Flow Control) 프레임을 ECU 물리 주소(응답ID - 8)로 보냄
+static void isotp_send_flow_control(unsigned int rx_id) {
+    if (s_can_fd < 0) return;
+    struct can_frame fc = {0};
+    fc.can_id = rx_id - 8;  // 0x7E8 → 0x7E0
+    fc.can_dlc = 8;
+    fc.data[0] = 0x30;      // FC: Continue To Send
+    fc.data[1] = 0x00;      // 블록 크기 0: 나머지를 한 번에 전송
+    fc.data[2] = 0x00;      // 프레임 간 최소 간격(STmin) 0ms
+    if (write(s_can_fd, &fc, sizeof(fc)) != sizeof(fc)) {
+        perror("isotp flow control write");
     }
+}
 
-    // 2. 응답 데이터의 기본 형식이 맞는지 확인합니다.
-    //    표준 응답 형식: [Byte 수, 0x41(서비스모드01응답), 요청PID, 값A, 값B, ...]
-    if (msg->dlc < 4 || msg->data[1] != 0x41) {
-        return; // 서비스 모드 01에 대한 응답(0x41)이 아니거나, 데이터 길이가 너무 짧으면 무시.
+/**
+ * @brief PID별 응답 값 길이(바이트)를 반환합니다. 멀티 PID 응답을 PID 단위로 자를 때 사용합니다.
+ * @return 값 길이, 모르는 PID면 0.
+ */
+static int pid_value_len(unsigned char pid) {
+    switch (pid) {
+        case PID_ENGINE_SPEED:   return 2; // A, B
+        case PID_VEHICLE_SPEED:  return 1; // A
+        case PID_GEAR_STATE:     return 3; // 기어비 A,B + 기어 C (두 ECU 모두 3바이트)
+        case PID_GPS_XDATA:      return 5; // 부호 + 정수부 + 소수부 3바이트
+        case PID_GPS_YDATA:      return 5;
+        case PID_STEERING_DATA:  return 3; // 부호 + 정수부 + 소수부
+        case PID_BRAKE_DATA:     return 1;
+        case PID_TIRE_DATA:      return 4; // 타이어 4개
+        case PID_THROTTLE_DATA:  return 1;
+        default:                 return 0;
     }
+}
 
-    // 3. 이 응답이 어떤 PID에 대한 것인지 확인합니다.
-    unsigned char responded_pid = msg->data[2];
+/**
+ * @brief PID 하나의 값을 해석해서 VehicleData와 상태 플래그를 갱신합니다.
+ * @param v PID 바로 다음의 값 바이트 (v[0] = 값 A).
+ * @param len v에서 읽을 수 있는 바이트 수.
+ * @return 1: 갱신함, 0: 모르는 PID이거나 길이 부족.
+ */
+static int apply_pid_value(unsigned char pid, const unsigned char* v, int len,
+                           VehicleData* vehicle_data, unsigned char* flag, unsigned char* flag2) {
     double temp = 0.0;
     float degree = 0.0;
 
-    // 4. switch 문을 통해 PID에 맞는 파싱 로직을 수행합니다.
-    switch (responded_pid) {
+    int need = pid_value_len(pid);
+    if (need == 0 || len < need) return 0;
+
+    // switch 문을 통해 PID에 맞는 파싱 로직을 수행합니다.
+    switch (pid) {
         case PID_VEHICLE_SPEED:
             // 차량 속도(PID 0x0D)의 계산식: 값 A
-            vehicle_data->speed = msg->data[3];
-            printf("\n[C] CAN received, PID : %x, vale: %d\n", PID_VEHICLE_SPEED, vehicle_data->speed);
+            vehicle_data->speed = v[0];
             *flag |= VEHICLE_SPEED_FLAG; // '속도 수신 완료' 깃발 설정
-            break; // switch 문 탈출
+            break;
 
         case PID_ENGINE_SPEED:
             // 엔진 RPM(PID 0x0C)의 계산식: (A * 256 + B) / 4
-            vehicle_data->rpm = ((int)msg->data[3] * 256 + (int)msg->data[4]) / 4;
+            vehicle_data->rpm = ((int)v[0] * 256 + (int)v[1]) / 4;
             *flag |= ENGINE_SPEED_FLAG; // 'RPM 수신 완료' 깃발 설정
-            break; // switch 문 탈출
+            break;
         
         case PID_GEAR_STATE:
-            vehicle_data->gear_ratio = ((float)(msg->data[3] * 256 + msg->data[4])) / 1000.0;
+            vehicle_data->gear_ratio = ((float)(v[0] * 256 + v[1])) / 1000.0;
             
-            switch(((msg->data[5] >> 4) & 0x0F)){
-                //case 0x00: vehicle_data->gear_state = 'P'; break;
-                //case 0x01: vehicle_data->gear_state = 'R'; break;
-                //case 0x02: vehicle_data->gear_state = 'N'; break;
-                //case 0x03: vehicle_data->gear_state = 'D'; break;
-                //case 0x04: vehicle_data->gear_state = '1'; break;
-                //case 0x05: vehicle_data->gear_state = '2'; break;
-                //case 0x06: vehicle_data->gear_state = '3'; break;
-                //case 0x07: vehicle_data->gear_state = '4'; break;
-                //case 0x08: vehicle_data->gear_state = '5'; break;
-                //case 0x09: vehicle_data->gear_state = '6'; break;
-                //default:vehicle_data->gear_state = '?'; break;
+            switch(((v[2] >> 4) & 0x0F)){
                 case 0x00: vehicle_data->gear_state = 'P'; break;
                 case 0x01: vehicle_data->gear_state = 'D'; break; 
                 case 0x02: vehicle_data->gear_state = 'R'; break;  
                 default:   vehicle_data->gear_state = '?'; break;
-
             }
 
             *flag |= GEAR_STATE_FLAG;
             break;
         
         case PID_GPS_XDATA:
-            temp = (double)msg->data[4] + (double)msg->data[5] / 100 + (double)msg->data[6] / 10000 + (double)msg->data[7] / 1000000;
-            vehicle_data->gps_x = (msg->data[3] != 0) ? temp : -temp;
+            temp = (double)v[1] + (double)v[2] / 100 + (double)v[3] / 10000 + (double)v[4] / 1000000;
+            vehicle_data->gps_x = (v[0] != 0) ? temp : -temp;
             *flag |= GPS_XDATA_FLAG;
             break;
 
         case PID_GPS_YDATA:
-            temp = (double)msg->data[4] + (double)msg->data[5] / 100 + (double)msg->data[6] / 10000 + (double)msg->data[7] / 1000000;
-            vehicle_data->gps_y = (msg->data[3] != 0) ? temp : -temp;
+            temp = (double)v[1] + (double)v[2] / 100 + (double)v[3] / 10000 + (double)v[4] / 1000000;
+            vehicle_data->gps_y = (v[0] != 0) ? temp : -temp;
             *flag |= GPS_YDATA_FLAG;
             break;
 
         case PID_STEERING_DATA:
-            degree = (float)msg->data[4] + ((float)msg->data[5]) / 100.0f;
-            vehicle_data->degree = (msg->data[3] == 1) ? degree : -degree;
+            degree = (float)v[1] + ((float)v[2]) / 100.0f;
+            vehicle_data->degree = (v[0] == 1) ? degree : -degree;
             *flag |= STEERING_DATA_FLAG;
             break;
         
         case PID_BRAKE_DATA:
-            vehicle_data->brake_state = msg->data[3];
+            vehicle_data->brake_state = v[0];
             *flag|= BRAKE_DATA_FLAG;
             break;
         
         case PID_TIRE_DATA:
-            vehicle_data->tire_pressure[0] = msg->data[3]; vehicle_data->tire_pressure[1] = msg->data[4];
-            vehicle_data->tire_pressure[2] = msg->data[5]; vehicle_data->tire_pressure[3] = msg->data[6];
+            vehicle_data->tire_pressure[0] = v[0]; vehicle_data->tire_pressure[1] = v[1];
+            vehicle_data->tire_pressure[2] = v[2]; vehicle_data->tire_pressure[3] = v[3];
             *flag |= TIRE_DATA_FLAG;
             break;
         
         case PID_THROTTLE_DATA:
-            vehicle_data->throttle = msg->data[3];
+            vehicle_data->throttle = v[0];
             *flag2 |= THROTTLE_DATA_FLAG;
             break;
-        // 여기에 다른 PID(GPS 위도, 경도, 조향각 등)에 대한 case를 계속 추가.
-        // case PID_GPS_LATITUDE:
-        //     ... 파싱 로직 ...
-        //     new_state_flag = STATE_GPS_LAT_RECEIVED;
-        //     break;
 
         default:
             // 우리가 요청하지 않았거나, 아직 처리 로직을 만들지 않은 PID는 그냥 무시.
-            break;
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief 서비스 모드 01 응답 페이로드 [0x41, PID, 값..., PID, 값...]를 PID 단위로 잘라 적용합니다.
+ * @return 갱신한 PID 수.
+ */
+static int parse_obd_payload(const unsigned char* p, int len,
+                             VehicleData* vehicle_data, unsigned char* flag, unsigned char* flag2,
+                             unsigned char* pids_out, int max_pids) {
+    if (len < 2 || p[0] != 0x41) return 0; // 서비스 모드 01 응답(0x41)이 아니면 무시
+
+    int updated = 0;
+    int i = 1;
+    while (i < len) {
+        unsigned char pid = p[i];
+        int vlen = pid_value_len(pid);
+        if (vlen == 0) break;                 // 모르는 PID(또는 패딩)부터는 길이를 알 수 없으므로 중단
+        int avail = len - (i + 1);
+        if (avail < vlen) break;              // 값이 잘린 마지막 PID는 버림 (부분 값으로 덮어쓰지 않음)
+        if (apply_pid_value(pid, &p[i + 1], vlen, vehicle_data, flag, flag2)) {
+            if (pids_out && updated < max_pids) pids_out[updated] = pid;
+            updated++;
+        }
+        i += 1 + vlen;
     }
+    return (pids_out && updated > max_pids) ? max_pids : updated;
+}
 
-    // main.c에 어떤 데이터가 갱신되었는지 알려주기 위해 상태 플래그를 반환.
+/**
+ * @brief [응답 해석 함수] 수신된 CAN 메시지를 파싱하여 VehicleData 구조체를 업데이트하고, 갱신된 PID 목록을 알려줍니다.
+ * @details
+ * - 단일 프레임 응답: [길이, 0x41, PID, 값..., (PID, 값...)] → 바로 해석
+ * - 멀티 프레임 응답(멀티 PID 요청): 첫 프레임 수신 시 흐름 제어를 보내고, 연속 프레임을 모아 완성되면 해석
+ * @param msg 수신한 CAN 메시지 포인터.
+ * @param vehicle_data 파싱된 데이터를 저장하고 업데이트할 차량 데이터 구조체 포인터.
+ * @param flag, flag2 갱신된 데이터에 해당하는 상태 플래그를 세울 변수.
+ * @param pids_out 갱신된 PID를 저장할 배열 (NULL 가능).
+ * @param max_pids pids_out 크기.
+ * @return 이 메시지로 갱신된 PID 수 (멀티 프레임 응답이 아직 완성되지 않았으면 0).
+ */
+int can_parse_response(const CANMessage* msg, VehicleData* vehicle_data, unsigned char* flag, unsigned char* flag2,
+                       unsigned char* pids_out, int max_pids) {
+    // 1. 이 메시지가 ECU의 진단 응답이 맞는지 ID부터 확인합니다. (응답 ID 범위: 0x7E8 ~ 0x7EF)
+    if (!msg || msg->id < 0x7E8 || msg->id > 0x7EF || msg->dlc < 2) {
+        return 0; // 우리가 기다리던 진단 응답이 아니므로 무시.
+    }
 
+    IsoTpRx* rx = &s_isotp_rx[msg->id - 0x7E8];
+    unsigned char pci = (msg->data[0] >> 4) & 0x0F;
+
+    switch (pci) {
+        case ISOTP_PCI_SF: {
+            // 2. 단일 프레임: [Byte 수, 0x41, 요청PID, 값A, 값B, ...]
+            int len = msg->data[0] & 0x0F;
+            // 바이트 수를 제대로 채우지 않는 ECU를 위해, 첫 PID도 못 담는 길이면 프레임 전체를 사용
+            int first_need = 2 + pid_value_len(msg->data[2]);
+            if (len < first_need) len = msg->dlc - 1;
+            if (len > msg->dlc - 1) len = msg->dlc - 1;
+            return parse_obd_payload(&msg->data[1], len, vehicle_data, flag, flag2, pids_out, max_pids);
+        }
+
+        case ISOTP_PCI_FF: {
+            // 3. 첫 프레임: [0x1L, LL, 0x41, PID, 값...] (L = 12비트 전체 길이)
+            int total = ((msg->data[0] & 0x0F) << 8) | msg->data[1];
+            rx->active = 0;
+            if (msg->dlc < 8 || total <= 6 || total > ISOTP_MAX_PAYLOAD) return 0;
+            memcpy(rx->buf, &msg->data[2], 6);
+            rx->total = total;
+            rx->received = 6;
+            rx->next_sn = 1;
+            rx->last_rx = msg->timestamp;
+            rx->active = 1;
+            isotp_send_flow_control(msg->id);
+            return 0;
+        }
+
+        case ISOTP_PCI_CF: {
+            // 4. 연속 프레임: [0x2N, 데이터 7바이트] (N = 순번)
+            if (!rx->active) return 0;
+            if ((msg->data[0] & 0x0F) != rx->next_sn ||
+                (msg->timestamp - rx->last_rx) > ISOTP_CF_TIMEOUT) {
+                rx->active = 0; // 순번이 어긋나거나 너무 늦게 오면 이번 응답은 버림
+                return 0;
+            }
+            int chunk = rx->total - rx->received;
+            if (chunk > 7) chunk = 7;
+            if (chunk > msg->dlc - 1) chunk = msg->dlc - 1;
+            memcpy(&rx->buf[rx->received], &msg->data[1], (size_t)chunk);
+            rx->received += chunk;
+            rx->next_sn = (rx->next_sn + 1) & 0x0F;
+            rx->last_rx = msg->timestamp;
+
+            if (rx->received < rx->total) return 0;
+            rx->active = 0;
+            return parse_obd_payload(rx->buf, rx->total, vehicle_data, flag, flag2, pids_out, max_pids);
+        }
+
+        default:
+            // 흐름 제어 등 그 밖의 프레임은 무시
+            return 0;
+    }
+}
+
+/**
+ * @brief [응답 해석 함수] 수신된 CAN 메시지를 파싱하여 VehicleData 구조체를 업데이트합니다.
+ * @details 갱신된 PID 목록이 필요 없을 때 사용하는 can_parse_response()의 간단한 형태입니다.
+ * @param msg can_receive_message()로 수신한 CAN 메시지 포인터.
+ * @param vehicle_data 파싱된 데이터를 저장하고 업데이트할 차량 데이터 구조체 포인터.
+ * @param flag, flag2 갱신된 데이터에 해당하는 상태 플래그를 세울 변수.
+ */
+void can_parse_and_update_data(const CANMessage* msg, VehicleData* vehicle_data, unsigned char* flag, unsigned char* flag2) {
+    can_parse_response(msg, vehicle_data, flag, flag2, NULL, 0);
 }
 
 
@@ -0,0 +1,358 @@
+/**
+ * @file can_acq.c
+ * @brief CAN 수집 전용 스레드: 요청 스케줄링, 수신, 타임스탬프, 해석을 제어 루프와 분리합니다.
+ * @details
+ * 기존에는 CAN 수신, 파이썬 IPC, 제어 로직이 main()의 select() 스레드 하나를 공유해서,
+ * wait_python_done()이나 storage_stop_recording()이 멈추면 CAN 수신도 멈추고 소켓 버퍼가 넘쳤습니다.
+ * 이 스레드는 CAN 소켓(및 BCM 소켓)을 단독으로 소유하고, 해석한 VehicleData를 스냅샷으로 만들어
+ * 락프리 SPSC 링으로 넘깁니다. 새 스냅샷이 생기면 eventfd로 알려 제어 루프가 select()로 기다릴 수 있습니다.
+ * 제어 루프는 can_acq_latest()로 최신 스냅샷만 가져가며, 어느 쪽도 상대를 기다리지 않습니다.
+ * 요청은 timerfd 주기마다 신호 저장소를 확인해, 다음 주기 전에 허용 지연을 넘길 PID만 다시 보냅니다.
+ * 신선한 값은 다시 요청하지 않으므로, 느린 신호(타이어, 기어)가 빠른 신호(GPS, 조향각)의 버스 시간을 빼앗지 않습니다.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "hardware.h"
+
+#define CAN_ACQ_POLL_MAX_MS 50 // 할 일이 없어도 이 간격마다 깨어나 종료 요청을 확인
+
+static pthread_t s_thread;
+static atomic_int s_running = 0;
+static int s_event_fd = -1;
+static SpscRing* s_ring = NULL;
+
+// --- 아래는 수집 스레드만 접근 ---
+static CANAcqConfig s_cfg;
+static unsigned char s_pids[CAN_SCHED_MAX_PIDS];
+static CANBcmPoll s_bcm_polls[CAN_BCM_MAX_POLLS];
+static int s_can_fd = -1;
+static int s_bcm_fd = -1;
+static CANScheduler s_sched;
+static CANSnapshot s_snap;            // 다음에 내보낼 스냅샷
+static int s_round_fd = -1;           // 신선도 확인 주기 타이머 (스케줄러 모드)
+static double s_bcm_resync_at;        // BCM 모드: 다음 RX_SETUP 재등록 시각 (now_sec 기준)
+static int s_pending;                 // 링이 가득 차서 아직 못 넘긴 갱신이 있으면 1
+
+// --- 제어 루프가 읽는 통계 복사본 (수집 스레드는 trylock만 하므로 절대 기다리지 않음) ---
+static pthread_mutex_t s_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static CANScheduler s_stats;
+
+// 스냅샷을 링에 넣고 eventfd로 알림. 링이 가득 차면 다음 기회에 최신 상태로 다시 넘김
+static void publish(void) {
+    s_snap.seq++;
+    s_pending = (spsc_push(s_ring, &s_snap) < 0);
+    if (s_pending) return;
+
+    uint64_t one = 1;
+    ssize_t w = write(s_event_fd, &one, sizeof(one));
+    (void)w; // 카운터가 이미 크면 EAGAIN이지만, 소비자는 어차피 깨어남
+}
+
+// RAW 소켓 수신 버퍼를 모두 비우면서 해석. 값이 갱신되었으면 1
+static int drain_raw(void) {
+    CANMessage batch[CAN_RX_BATCH];
+    int changed = 0;
+
+    while (1) {
+        int r = can_receive_batch(batch, CAN_RX_BATCH, &s_snap.drops);
+        if (r < 0) {
+            perror("[CAN_ACQ] can_receive_batch");
+            break;
+        }
+        for (int i = 0; i < r; i++) {
+            unsigned int err = can_error_class(&batch[i]);
+            if (err) {
+                s_snap.bus_errors++;
+                s_snap.last_error = err;
+                changed = 1;
+                continue;
+            }
+            unsigned char updated[OBD_MAX_PIDS_PER_REQUEST];
+            unsigned char flag = 0, flag2 = 0;
+            int n = can_parse_response(&batch[i], &s_snap.store.data, &flag, &flag2,
+                                       updated, OBD_MAX_PIDS_PER_REQUEST);
+            if (n > 0) {
+                for (int k = 0; k < n; k++) sig_store_touch(&s_snap.store, updated[k], batch[i].timestamp);
+                can_sched_complete(&s_sched, updated, n, batch[i].timestamp);
+                s_snap.timestamp = batch[i].timestamp;
+                changed = 1;
+            }
+        }
+        if (r < CAN_RX_BATCH) break;
+    }
+    return changed;
+}
+
+// BCM 소켓에서 값이 바뀐 응답을 모두 읽어 해석. 응답이나 RX_TIMEOUT 통지가 실제로 왔으면 1
+// 수신 시각은 RX_CHANGED에 실린 원래 프레임 시각 그대로 둠. 값이 그대로인 PID는 can_bcm_resync()로
+// 다시 통지받으므로, 응답이 끊긴 PID만 자기 수신 시각 기준으로 stale해짐
+static int drain_bcm(void) {
+    CANMessage msg;
+    int changed = 0;
+
+    while (can_bcm_receive(&msg) > 0) {
+        unsigned char updated[OBD_MAX_PIDS_PER_REQUEST];
+        unsigned char flag = 0, flag2 = 0;
+        int n = can_parse_response(&msg, &s_snap.store.data, &flag, &flag2, updated, OBD_MAX_PIDS_PER_REQUEST);
+        for (int k = 0; k < n; k++) sig_store_touch(&s_snap.store, updated[k], msg.timestamp);
+        if (n > 0) {
+            s_snap.timestamp = msg.timestamp;
+            changed = 1;
+        }
+    }
+    unsigned int timeouts = can_bcm_rx_timeouts();
+    if (timeouts != s_snap.bcm_timeouts) {
+        s_snap.bcm_timeouts = timeouts;
+        changed = 1;
+    }
+    return changed;
+}
+
+// 주기 타이머가 울리면 다음 주기 전에 허용 지연을 넘길 PID만 요청
+static void on_round_timer(void) {
+    uint64_t expirations = 0;
+    if (read(s_round_fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) return;
+
+    // 지금 요청해도 응답까지 평균 지연만큼 걸리므로, 그만큼 미리 요청함
+    double horizon = now_sec() + s_cfg.round_period;
+    for (int i = 0; i < s_sched.count; i++) {
+        const CANPidSlot* slot = &s_sched.slots[i];
+        int id = sig_from_pid(slot->pid);
+        if (id >= 0 && sig_store_fresh(&s_snap.store, (SignalId)id, horizon + slot->avg_latency)) continue;
+        if (slot->in_flight) {
+            s_snap.stale_inflight++; // 이전 요청이 아직 응답 대기 중이면 겹쳐 보내지 않음
+            continue;
+        }
+        can_sched_want(&s_sched, slot->pid);
+    }
+
+    // 주기마다 통계 복사본 갱신 (제어 루프가 읽는 중이면 이번엔 건너뜀)
+    if (pthread_mutex_trylock(&s_stats_lock) == 0) {
+        s_stats = s_sched;
+        pthread_mutex_unlock(&s_stats_lock);
+    }
+}
+
+static void* acq_thread_main(void* arg) {
+    (void)arg;
+
+    while (atomic_load_explicit(&s_running, memory_order_relaxed)) {
+        int wait_ms = CAN_ACQ_POLL_MAX_MS;
+
+        if (s_bcm_fd >= 0) {
+            // 값이 그대로인 PID도 다음 응답을 다시 통지받도록 주기적으로 수신 필터 재등록
+            double now = now_sec();
+            if (now >= s_bcm_resync_at) {
+                can_bcm_resync();
+                s_bcm_resync_at = now + CAN_BCM_RESYNC_MS / 1000.0;
+            }
+            int ms = (int)((s_bcm_resync_at - now) * 1000.0 + 0.999);
+            if (ms < wait_ms) wait_ms = ms;
+        }
+        if (s_round_fd >= 0) {
+            // 새 요청 전송 + 타임아웃된 요청 재전송, 다음 응답 제한 시각까지만 대기
+            double now = now_sec();
+            can_sched_service(&s_sched, now);
+            double wake = can_sched_next_deadline(&s_sched);
+            if (wake > 0.0) {
+                int ms = (int)((wake - now) * 1000.0 + 0.999);
+                if (ms < 0) ms = 0;
+                if (ms < wait_ms) wait_ms = ms;
+            }
+        }
+
+        struct pollfd pfds[3];
+        int nfds = 0;
+        pfds[nfds].fd = s_can_fd;
+        pfds[nfds++].events = POLLIN;
+        int bcm_idx = -1, round_idx = -1;
+        if (s_bcm_fd >= 0) {
+            bcm_idx = nfds;
+            pfds[nfds].fd = s_bcm_fd;
+            pfds[nfds++].events = POLLIN;
+        }
+        if (s_round_fd >= 0) {
+            round_idx = nfds;
+            pfds[nfds].fd = s_round_fd;
+            pfds[nfds++].events = POLLIN;
+        }
+
+        int ready = poll(pfds, nfds, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("[CAN_ACQ] poll");
+            break;
+        }
+
+        unsigned int drops_before = s_snap.drops;
+        int changed = 0;
+        if (ready > 0 && (pfds[0].revents & POLLIN)) changed |= drain_raw();
+        if (bcm_idx >= 0 && (pfds[bcm_idx].revents & POLLIN)) changed |= drain_bcm();
+        if (round_idx >= 0 && (pfds[round_idx].revents & POLLIN)) on_round_timer();
+        if (s_snap.drops != drops_before) changed = 1;
+
+        // 못 넘긴 갱신이 남아 있어도 다시 시도
+        if (changed || s_pending) publish();
+    }
+    return NULL;
+}
+
+/**
+ * @brief CAN 소켓을 열고 수집 스레드를 시작합니다.
+ * @details
+ * 스케줄러 모드에서는 cfg->pids를 등록 순서대로 우선순위를 매기고, round_period 주기 타이머마다
+ * 허용 지연(cfg->budgets)을 넘기기 전인 PID는 건너뛰고 stale해질 PID만 요청합니다.
+ * CAN_POLL_MODE_BCM이면 주기 요청을 커널에 맡기고 RAW 소켓은 버스 에러 이벤트만 받습니다.
+ * 이후 CAN 소켓은 이 스레드가 단독으로 사용하므로, 다른 스레드에서 can_* 송수신 함수를 호출하지 마세요.
+ * @param cfg 수집 설정.
+ * @return 성공 시 새 스냅샷이 생길 때마다 읽을 수 있게 되는 eventfd (select 감시용), 실패 시 -1.
+ */
+int can_acq_start(const CANAcqConfig* cfg) {
+    if (!cfg || !cfg->ifname || atomic_load(&s_running)) return -1;
+    if (cfg->pid_count > CAN_SCHED_MAX_PIDS || cfg->bcm_count > CAN_BCM_MAX_POLLS) return -1;
+
+    s_cfg = *cfg;
+    if (s_cfg.round_period <= 0.0) s_cfg.round_period = CAN_ACQ_ROUND_SEC;
+    if (cfg->pid_count > 0) memcpy(s_pids, cfg->pids, cfg->pid_count);
+    if (cfg->bcm_count > 0) memcpy(s_bcm_polls, cfg->bcm_polls, sizeof(CANBcmPoll) * cfg->bcm_count);
+    s_cfg.pids = s_pids;
+    s_cfg.bcm_polls = s_bcm_polls;
+
+    s_can_fd = can_init(s_cfg.ifname);
+    if (s_can_fd < 0) return -1;
+
+    s_bcm_fd = -1;
+    if (CAN_POLL_MODE_BCM) {
+        s_bcm_fd = can_bcm_open(s_cfg.ifname);
+        if (s_bcm_fd < 0 || can_bcm_start(s_bcm_polls, s_cfg.bcm_count) < 0 ||
+            can_set_filters(NULL, 0, CAN_ERR_EVENTS_DEFAULT) < 0) {
+            can_bcm_close();
+            can_close();
+            return -1;
+        }
+    }
+
+    // 빠진 PID는 요청 한 번에 최대 6개씩 묶어서 보냄
+    can_sched_init(&s_sched, CAN_SCHED_MAX_INFLIGHT, CAN_SCHED_TIMEOUT_SEC, CAN_SCHED_MAX_RETRY,
+                   OBD_MAX_PIDS_PER_REQUEST);
+    if (s_bcm_fd < 0) {
+        for (int i = 0; i < s_cfg.pid_count; i++) can_sched_add(&s_sched, s_pids[i]);
+    }
+    s_stats = s_sched;
+    memset(&s_snap, 0, sizeof(s_snap));
+    sig_store_init(&s_snap.store, s_cfg.budgets);
+    s_cfg.budgets = NULL; // 호출자 배열은 여기서만 읽음 (허용 지연은 스냅샷에 실려 나감)
+    if (s_bcm_fd >= 0) {
+        // BCM 모드: 값이 그대로인 PID는 재등록 후 다음 요청의 응답에서야 다시 통지되므로,
+        // 허용 지연을 최소 (요청 주기 + CAN_BCM_RESYNC_MS)로 늘림 (값이 그대로인 동안의 여유)
+        for (int i = 0; i < s_cfg.bcm_count; i++) {
+            int id = sig_from_pid(s_bcm_polls[i].pid);
+            if (id < 0) continue;
+            double allow = (s_bcm_polls[i].interval_ms + CAN_BCM_RESYNC_MS) / 1000.0;
+            if (s_snap.store.sig[id].budget < allow) s_snap.store.sig[id].budget = allow;
+        }
+    }
+    s_bcm_resync_at = now_sec() + CAN_BCM_RESYNC_MS / 1000.0; // can_bcm_start가 방금 등록함
+    s_pending = 0;
+
+    s_ring = spsc_create(sizeof(CANSnapshot), CAN_ACQ_RING_SIZE);
+    s_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!s_ring || s_event_fd < 0) {
+        perror("[CAN_ACQ] ring/eventfd");
+        goto fail;
+    }
+
+    // 스케줄러 모드: 신선도 확인 주기 타이머 (처음엔 모든 신호가 stale이므로 바로 전체 요청)
+    s_round_fd = -1;
+    if (s_bcm_fd < 0 && s_sched.count > 0) {
+        s_round_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        long period_ns = (long)(s_cfg.round_period * 1e9);
+        struct itimerspec its = {0};
+        its.it_interval.tv_sec  = period_ns / 1000000000L;
+        its.it_interval.tv_nsec = period_ns % 1000000000L;
+        its.it_value.tv_nsec    = 1;
+        if (s_round_fd < 0 || timerfd_settime(s_round_fd, 0, &its, NULL) < 0) {
+            perror("[CAN_ACQ] timerfd");
+            goto fail;
+        }
+    }
+
+    atomic_store(&s_running, 1);
+    if (pthread_create(&s_thread, NULL, acq_thread_main, NULL) != 0) {
+        perror("[CAN_ACQ] pthread_create");
+        atomic_store(&s_running, 0);
+        goto fail;
+    }
+    return s_event_fd;
+
+fail:
+    if (s_round_fd >= 0) { close(s_round_fd); s_round_fd = -1; }
+    if (s_event_fd >= 0) { close(s_event_fd); s_event_fd = -1; }
+    spsc_destroy(s_ring);
+    s_ring = NULL;
+    can_bcm_close();
+    can_close();
+    return -1;
+}
+
+/**
+ * @brief 쌓인 스냅샷을 모두 꺼내 가장 최근 것만 돌려줍니다. (논블로킹, 제어 루프 전용)
+ * @details 값마다 수신 시각이 함께 실려 있으므로, 중간 스냅샷을 합칠 필요 없이 최신 것 하나면 충분합니다.
+ *          eventfd 카운터도 함께 비웁니다.
+ * @param out 결과를 저장할 스냅샷.
+ * @param hist 신호 이력 (NULL 가능). 있으면 건너뛴 스냅샷까지 모두 기록해 촬영 시각 보간에 쓸 샘플을 잃지 않습니다.
+ * @return 1: 새 스냅샷 있음, 0: 없음.
+ */
+int can_acq_latest(CANSnapshot* out, SignalHistory* hist) {
+    if (!s_ring || !out) return 0;
+
+    uint64_t cnt;
+    ssize_t r = read(s_event_fd, &cnt, sizeof(cnt));
+    (void)r;
+
+    int got = 0;
+    while (spsc_pop(s_ring, out)) {
+        if (hist) sig_hist_record(hist, &out->store);
+        got = 1;
+    }
+    return got;
+}
+
+/**
+ * @brief PID별 응답 지연/타임아웃 통계를 복사합니다. (신선도 확인 주기마다 갱신되는 복사본)
+ * @return 0: 성공, -1: 수집 스레드가 동작 중이 아님.
+ */
+int can_acq_sched_stats(CANScheduler* out) {
+    if (!out || !s_ring) return -1;
+    pthread_mutex_lock(&s_stats_lock);
+    *out = s_stats;
+    pthread_mutex_unlock(&s_stats_lock);
+    return 0;
+}
+
+/**
+ * @brief 수집 스레드를 멈추고 CAN/BCM 소켓과 링을 정리합니다.
+ */
+void can_acq_stop(void) {
+    if (!atomic_load(&s_running)) return;
+    atomic_store(&s_running, 0);
+    pthread_join(s_thread, NULL);
+
+    can_bcm_close();
+    can_close();
+    if (s_round_fd >= 0) { close(s_round_fd); s_round_fd = -1; }
+    close(s_event_fd);
+    s_event_fd = -1;
+    spsc_destroy(s_ring);
+    s_ring = NULL;
+}
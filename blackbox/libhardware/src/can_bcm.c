@@ -0,0 +1,257 @@
+/**
+ * @file can_bcm.c
+ * @brief SocketCAN 브로드캐스트 매니저(CAN_BCM)에 주기적인 OBD-II 요청을 맡기는 모드.
+ * @details
+ * 사용자 공간 루프가 요청을 보내면 select() 타임아웃, 파이썬 대기 등에 따라 요청 주기가 흔들립니다.
+ * 이 모드에서는 PID별 요청 프레임을 커널 BCM에 주기 전송(TX_SETUP)으로 등록하므로,
+ * 애플리케이션이 멈춰 있어도 요청은 정확한 주기로 나갑니다.
+ * 응답(0x7E8)은 BCM 수신 필터(RX_SETUP)에 PID 멀티플렉스로 등록해서,
+ * 값이 실제로 바뀌었을 때만(RX_CHANGED) 애플리케이션을 깨웁니다.
+ *
+ * 참고: BCM 송신 작업은 소켓마다 CAN ID로 구분되므로, 같은 0x7DF로 PID마다 다른 주기를 주려면
+ * PID마다 별도의 BCM 소켓이 필요합니다. 수신은 첫 번째(수신 전용) 소켓 하나로 처리합니다.
+ *
+ * RX_TIMEOUT 타이머는 CAN ID(0x7E8) 단위라서 어느 PID 응답이 와도 다시 시작됩니다.
+ * 그래서 한 PID만 끊긴 것은 RX_TIMEOUT으로 알 수 없고, 값이 그대로인 PID는 RX_CHANGED도 오지 않습니다.
+ * can_bcm_resync()로 RX_SETUP을 다시 쓰면 커널이 마지막 수신 값을 지우므로, 살아 있는 PID는
+ * 다음 응답이 값이 같아도 RX_CHANGED로 다시 통지됩니다. PID별 신선도는 이 통지의 수신 시각으로 판단합니다.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <net/if.h>
+#include <linux/can.h>
+#include <linux/can/bcm.h>
+
+#include "hardware.h"
+
+// BCM 메시지 = 헤더 + 프레임 (RX_SETUP은 멀티플렉스 마스크 프레임 + PID별 프레임)
+typedef struct {
+    struct bcm_msg_head head;
+    struct can_frame frames[CAN_BCM_MAX_POLLS + 1];
+} BcmMsg;
+
+static int s_bcm_rx_fd = -1;                     // 응답 수신(변화 감지)용 BCM 소켓
+static int s_bcm_tx_fd[CAN_BCM_MAX_POLLS];       // PID별 주기 요청 BCM 소켓
+static int s_bcm_tx_count = 0;
+static int s_bcm_ifindex = 0;
+static unsigned int s_bcm_rx_timeouts = 0;       // RX_TIMEOUT(응답 끊김) 통지 수
+static BcmMsg s_bcm_rx_setup;                    // 등록한 RX_SETUP (can_bcm_resync에서 다시 씀)
+static size_t s_bcm_rx_setup_len = 0;
+
+// 인터페이스에 연결된 BCM 소켓 하나를 만듭니다.
+static int bcm_socket_open(void) {
+    int fd = socket(PF_CAN, SOCK_DGRAM, CAN_BCM);
+    if (fd < 0) {
+        perror("socket(CAN_BCM) error");
+        return -1;
+    }
+    struct sockaddr_can addr = {0};
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = s_bcm_ifindex;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("connect(CAN_BCM) error");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void ms_to_timeval(unsigned int ms, struct bcm_timeval* tv) {
+    tv->tv_sec  = ms / 1000;
+    tv->tv_usec = (ms % 1000) * 1000;
+}
+
+/**
+ * @brief BCM 모드를 위한 수신용 소켓을 엽니다.
+ * @param interface_name "can0"와 같은 CAN 인터페이스 이름.
+ * @return 성공 시 수신용 BCM 소켓 fd (select 감시용), 실패 시 -1.
+ */
+int can_bcm_open(const char* interface_name) {
+    if (!interface_name) return -1;
+    if (s_bcm_rx_fd >= 0) return s_bcm_rx_fd;
+
+    s_bcm_ifindex = (int)if_nametoindex(interface_name);
+    if (s_bcm_ifindex == 0) {
+        perror("if_nametoindex(bcm) error");
+        return -1;
+    }
+
+    s_bcm_rx_fd = bcm_socket_open();
+    if (s_bcm_rx_fd < 0) return -1;
+
+    fcntl(s_bcm_rx_fd, F_SETFL, O_NONBLOCK);
+    // RX_CHANGED에는 커널이 원래 프레임의 수신 시각을 붙여 주므로, 읽은 시각 대신 그 시각을 사용
+    int on = 1;
+    if (setsockopt(s_bcm_rx_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+        perror("setsockopt(BCM SO_TIMESTAMPNS) warning"); // 실패하면 읽은 시각으로 대신함
+    }
+    s_bcm_rx_timeouts = 0;
+    s_bcm_rx_setup_len = 0;
+    return s_bcm_rx_fd;
+}
+
+/**
+ * @brief PID별 주기 요청과 응답 변화 감지를 커널 BCM에 등록합니다.
+ * @param polls 요청할 PID와 주기(ms) 목록.
+ * @param count 목록 길이 (최대 CAN_BCM_MAX_POLLS).
+ * @return 0: 성공, -1: 실패.
+ */
+int can_bcm_start(const CANBcmPoll* polls, int count) {
+    if (s_bcm_rx_fd < 0 || !polls || count <= 0 || count > CAN_BCM_MAX_POLLS) return -1;
+
+    BcmMsg msg;
+
+    // 1) 수신 필터: 0x7E8 응답을 PID(멀티플렉스)별로 나눠 값 변화만 통지
+    //    frames[0]  : 멀티플렉스 마스크 (data[1]=서비스 응답 0x41, data[2]=PID 위치)
+    //    frames[1..]: PID별 멀티플렉스 값 + 변화 감지할 비트(data[3..7] 전체)
+    memset(&msg, 0, sizeof(msg));
+    msg.head.opcode  = RX_SETUP;
+    msg.head.can_id  = CAN_OBD_RESPONSE_ID;
+    msg.head.flags   = SETTIMER | RX_ANNOUNCE_RESUME;
+    msg.head.nframes = (unsigned int)count + 1;
+    ms_to_timeval(CAN_BCM_RX_TIMEOUT_MS, &msg.head.ival1); // 이 시간 동안 응답 없으면 RX_TIMEOUT
+    msg.frames[0].can_id  = CAN_OBD_RESPONSE_ID;
+    msg.frames[0].can_dlc = 8;
+    msg.frames[0].data[1] = 0xFF;
+    msg.frames[0].data[2] = 0xFF;
+    for (int i = 0; i < count; i++) {
+        struct can_frame* f = &msg.frames[i + 1];
+        f->can_id  = CAN_OBD_RESPONSE_ID;
+        f->can_dlc = 8;
+        f->data[1] = 0x41;
+        f->data[2] = polls[i].pid;
+        memset(&f->data[3], 0xFF, 5);
+    }
+    size_t len = sizeof(msg.head) + sizeof(struct can_frame) * msg.head.nframes;
+    if (write(s_bcm_rx_fd, &msg, len) != (ssize_t)len) {
+        perror("write(BCM RX_SETUP) error");
+        return -1;
+    }
+    s_bcm_rx_setup = msg;
+    s_bcm_rx_setup_len = len;
+
+    // 2) 주기 요청: PID마다 별도 소켓에 0x7DF 요청 프레임을 무한 반복 전송으로 등록
+    for (int i = 0; i < count; i++) {
+        int fd = bcm_socket_open();
+        if (fd < 0) {
+            can_bcm_close();
+            return -1;
+        }
+        s_bcm_tx_fd[s_bcm_tx_count++] = fd;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.head.opcode  = TX_SETUP;
+        msg.head.can_id  = 0x7DF;
+        msg.head.flags   = SETTIMER | STARTTIMER | TX_CP_CAN_ID;
+        msg.head.count   = 0;     // ival1 단계 없이 바로 ival2 주기로 무한 반복
+        msg.head.nframes = 1;
+        ms_to_timeval(polls[i].interval_ms, &msg.head.ival2);
+        msg.frames[0].can_dlc = 8;
+        msg.frames[0].data[0] = 0x02;          // 요청 길이 (서비스 + PID)
+        msg.frames[0].data[1] = 0x01;          // 서비스 모드 01
+        msg.frames[0].data[2] = polls[i].pid;
+
+        len = sizeof(msg.head) + sizeof(struct can_frame);
+        if (write(fd, &msg, len) != (ssize_t)len) {
+            perror("write(BCM TX_SETUP) error");
+            can_bcm_close();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 등록한 수신 필터(RX_SETUP)를 다시 써서 PID별 마지막 수신 값을 지웁니다.
+ * @details 이후 PID마다 첫 응답은 값이 같아도 RX_CHANGED로 통지되므로,
+ *          값이 그대로인 PID도 응답이 오는 한 CAN_BCM_RESYNC_MS + 요청 주기 안에 수신 시각이 갱신됩니다.
+ *          응답이 끊긴 PID는 통지가 없으므로 자기 수신 시각 기준으로 stale해집니다.
+ * @return 0: 성공, -1: 실패 (can_bcm_start 전이면 실패).
+ */
+int can_bcm_resync(void) {
+    if (s_bcm_rx_fd < 0 || s_bcm_rx_setup_len == 0) return -1;
+    if (write(s_bcm_rx_fd, &s_bcm_rx_setup, s_bcm_rx_setup_len) != (ssize_t)s_bcm_rx_setup_len) {
+        perror("write(BCM RX_SETUP resync) error");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief BCM 수신 소켓에서 값이 바뀐 응답을 하나 읽습니다. (논블로킹)
+ * @details RX_TIMEOUT 통지(응답 끊김)는 내부 카운터만 올리고 0을 반환합니다. can_bcm_rx_timeouts()로 확인하세요.
+ *          수신 시각은 커널이 붙인 원래 프레임의 수신 시각(CLOCK_REALTIME)을 now_sec() 축으로 변환한 값입니다.
+ * @param msg 값이 바뀐 응답 프레임을 저장할 구조체 포인터.
+ * @return 1: 응답 수신, 0: 수신된 메시지 없음(또는 타임아웃 통지), <0: 에러.
+ */
+int can_bcm_receive(CANMessage* msg) {
+    if (s_bcm_rx_fd < 0 || !msg) return -1;
+
+    struct {
+        struct bcm_msg_head head;
+        struct can_frame frame;
+    } rx;
+    char ctrl[CMSG_SPACE(sizeof(struct timespec))];
+    struct iovec iov = { .iov_base = &rx, .iov_len = sizeof(rx) };
+    struct msghdr mh = {0};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctrl;
+    mh.msg_controllen = sizeof(ctrl);
+    ssize_t n = recvmsg(s_bcm_rx_fd, &mh, MSG_DONTWAIT);
+    if (n < 0) return 0;
+    if (n < (ssize_t)sizeof(rx.head)) return -1;
+
+    if (rx.head.opcode == RX_TIMEOUT) {
+        s_bcm_rx_timeouts++;
+        return 0;
+    }
+    if (rx.head.opcode != RX_CHANGED || n < (ssize_t)sizeof(rx)) return 0;
+
+    msg->id  = rx.frame.can_id;
+    msg->dlc = rx.frame.can_dlc;
+    memcpy(msg->data, rx.frame.data, rx.frame.can_dlc);
+    msg->timestamp = now_sec();
+    msg->hw_timestamp = 0.0;
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SO_TIMESTAMPNS) continue;
+        struct timespec ts, rt;
+        memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+        if (!ts.tv_sec && !ts.tv_nsec) break;
+        // REALTIME -> MONOTONIC (can_receive_batch와 같은 방식)
+        clock_gettime(CLOCK_REALTIME, &rt);
+        double rt_to_mono = msg->timestamp - ((double)rt.tv_sec + (double)rt.tv_nsec * 1e-9);
+        msg->timestamp = (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9 + rt_to_mono;
+        break;
+    }
+    return 1;
+}
+
+/**
+ * @brief 지금까지 받은 RX_TIMEOUT(ECU 응답 끊김) 통지 수를 반환합니다.
+ */
+unsigned int can_bcm_rx_timeouts(void) {
+    return s_bcm_rx_timeouts;
+}
+
+/**
+ * @brief 등록된 주기 요청/수신 필터를 모두 해제하고 소켓을 닫습니다.
+ * @details BCM 작업은 소켓을 닫으면 커널이 함께 제거합니다.
+ */
+void can_bcm_close(void) {
+    for (int i = 0; i < s_bcm_tx_count; i++) {
+        close(s_bcm_tx_fd[i]);
+    }
+    s_bcm_tx_count = 0;
+    s_bcm_rx_setup_len = 0;
+    if (s_bcm_rx_fd >= 0) {
+        close(s_bcm_rx_fd);
+        s_bcm_rx_fd = -1;
+    }
+}
@@ -0,0 +1,204 @@
+/**
+ * @file can_sched.c
+ * @brief 여러 OBD-II PID 요청을 동시에 띄워두고(in-flight) 응답을 추적하는 요청 스케줄러.
+ * @details
+ * 기존 main.c는 루프 한 바퀴에 PID 하나만 요청하고, 응답이 올 때까지 다음 요청을 미뤘습니다.
+ * 이 스케줄러는 필요한 PID를 한꺼번에 전송해 두고 요청마다 응답 제한 시각(deadline)을 기록합니다.
+ * - 응답이 오면 요청 완료 처리 후 응답 지연(latency)을 PID별로 기록합니다.
+ * - 제한 시각이 지나면 재전송하고, 재전송 한도를 넘으면 이번 요청을 포기합니다.
+ * 이렇게 하면 차량 상태 한 벌을 대략 버스 왕복 한 번 만에 채울 수 있습니다.
+ */
+
+#include <string.h>
+#include "hardware.h"
+
+// 응답 지연 이동평균 가중치 (새 샘플 비중)
+#define LATENCY_EMA_ALPHA 0.2
+
+static CANPidSlot* find_slot(CANScheduler* s, unsigned char pid) {
+    for (int i = 0; i < s->count; i++) {
+        if (s->slots[i].pid == pid) return &s->slots[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief 스케줄러를 초기화합니다.
+ * @param max_inflight 동시에 응답을 기다릴 수 있는 최대 요청 수 (CAN_SCHED_MAX_INFLIGHT 권장).
+ * @param timeout_sec 요청 1건의 응답 대기 제한 시간(초).
+ * @param max_retry 타임아웃 시 재전송 횟수.
+ * @param pids_per_request 요청 프레임 하나에 묶어 보낼 PID 수. 1이면 PID마다 따로 요청(멀티 PID 미지원 ECU용).
+ */
+void can_sched_init(CANScheduler* s, int max_inflight, double timeout_sec, int max_retry, int pids_per_request) {
+    if (!s) return;
+    memset(s, 0, sizeof(*s));
+    s->max_inflight = (max_inflight > 0) ? max_inflight : 1;
+    s->timeout = (timeout_sec > 0.0) ? timeout_sec : CAN_SCHED_TIMEOUT_SEC;
+    s->max_retry = (max_retry >= 0) ? max_retry : 0;
+    if (pids_per_request < 1) pids_per_request = 1;
+    if (pids_per_request > OBD_MAX_PIDS_PER_REQUEST) pids_per_request = OBD_MAX_PIDS_PER_REQUEST;
+    s->pids_per_request = pids_per_request;
+}
+
+/**
+ * @brief 스케줄러가 관리할 PID를 등록합니다. 등록 순서가 전송 우선순위가 됩니다.
+ * @return 0: 성공(이미 등록된 PID 포함), -1: 등록 공간 부족.
+ */
+int can_sched_add(CANScheduler* s, unsigned char pid) {
+    if (!s) return -1;
+    if (find_slot(s, pid)) return 0;
+    if (s->count >= CAN_SCHED_MAX_PIDS) return -1;
+
+    CANPidSlot* slot = &s->slots[s->count++];
+    memset(slot, 0, sizeof(*slot));
+    slot->pid = pid;
+    return 0;
+}
+
+/**
+ * @brief 해당 PID 값이 필요하다고 표시합니다. 이미 요청 중이면 아무 일도 하지 않습니다.
+ * @return 0: 성공, -1: 등록되지 않은 PID.
+ */
+int can_sched_want(CANScheduler* s, unsigned char pid) {
+    if (!s) return -1;
+    CANPidSlot* slot = find_slot(s, pid);
+    if (!slot) return -1;
+    slot->wanted = 1;
+    return 0;
+}
+
+// 모아둔 슬롯들을 요청 프레임 하나로 전송 (멀티 PID 요청)
+static int send_batch(CANScheduler* s, CANPidSlot** batch, int n, double now) {
+    if (n <= 0) return 0;
+    unsigned char pids[OBD_MAX_PIDS_PER_REQUEST];
+    for (int i = 0; i < n; i++) pids[i] = batch[i]->pid;
+
+    int r = (n == 1) ? can_request_pid(pids[0]) : can_request_pids(pids, n);
+    if (r < 0) return -1;
+
+    for (int i = 0; i < n; i++) {
+        batch[i]->sent_at = now;
+        batch[i]->deadline = now + s->timeout;
+    }
+    return 0;
+}
+
+/**
+ * @brief 타임아웃된 요청을 재전송하고, 대기 중인 요청을 in-flight 한도까지 전송합니다.
+ * @details
+ * main 루프가 매 반복(또는 타이머)마다 호출합니다. 시스템 콜은 실제로 보낼 요청이 있을 때만 발생합니다.
+ * 보낼 PID는 pids_per_request개씩 묶어서 요청 프레임 하나로 보냅니다 (응답은 ISO-TP 멀티 프레임).
+ * @param now 현재 시각 (now_sec 기준).
+ * @return 이번 호출에서 전송(재전송 포함)한 PID 수.
+ */
+int can_sched_service(CANScheduler* s, double now) {
+    if (!s) return 0;
+    int sent = 0;
+    CANPidSlot* batch[OBD_MAX_PIDS_PER_REQUEST];
+    int nb = 0;
+
+    // 1) 응답 제한 시각이 지난 요청 처리: 재전송 대상은 모아서 다시 보내고, 한도를 넘으면 포기
+    for (int i = 0; i < s->count; i++) {
+        CANPidSlot* slot = &s->slots[i];
+        if (!slot->in_flight || now < slot->deadline) continue;
+
+        slot->timeouts++;
+        if (slot->retries < s->max_retry) {
+            slot->retries++;
+            batch[nb++] = slot;
+            if (nb == s->pids_per_request) {
+                if (send_batch(s, batch, nb, now) == 0) sent += nb;
+                nb = 0;
+            }
+            continue;
+        }
+        // 재전송 한도 초과: 이번 요청은 포기하고 호출자가 다시 요청하게 둠
+        slot->in_flight = 0;
+        slot->wanted = 0;
+        slot->failures++;
+        s->inflight--;
+    }
+    if (nb > 0) {
+        // 전송에 실패해도 deadline이 그대로라 다음 호출에서 다시 재전송을 시도함
+        if (send_batch(s, batch, nb, now) == 0) sent += nb;
+        nb = 0;
+    }
+
+    // 2) 아직 보내지 않은 요청을 등록 순서대로 in-flight 한도까지 묶어서 전송
+    for (int i = 0; i < s->count; i++) {
+        CANPidSlot* slot = &s->slots[i];
+        if (!slot->wanted || slot->in_flight) continue;
+        if (s->inflight + nb >= s->max_inflight) break;
+
+        batch[nb++] = slot;
+        if (nb == s->pids_per_request) {
+            if (send_batch(s, batch, nb, now) < 0) { nb = 0; break; } // 송신 버퍼가 가득 찼으면 다음 기회에
+            for (int k = 0; k < nb; k++) { batch[k]->in_flight = 1; batch[k]->retries = 0; }
+            s->inflight += nb;
+            sent += nb;
+            nb = 0;
+        }
+    }
+    if (nb > 0 && send_batch(s, batch, nb, now) == 0) {
+        for (int k = 0; k < nb; k++) { batch[k]->in_flight = 1; batch[k]->retries = 0; }
+        s->inflight += nb;
+        sent += nb;
+    }
+
+    return sent;
+}
+
+// 요청 완료 처리 및 응답 지연 기록
+static void complete_slot(CANScheduler* s, CANPidSlot* slot, double rx_time) {
+    if (slot->in_flight) {
+        double latency = rx_time - slot->sent_at;
+        if (latency < 0.0) latency = 0.0;
+        slot->last_latency = latency;
+        slot->avg_latency = (slot->responses == 0)
+                          ? latency
+                          : slot->avg_latency + LATENCY_EMA_ALPHA * (latency - slot->avg_latency);
+        slot->in_flight = 0;
+        s->inflight--;
+    }
+    slot->wanted = 0;
+    slot->responses++;
+}
+
+/**
+ * @brief 응답으로 값이 갱신된 PID들의 요청을 완료 처리합니다.
+ * @param pids can_parse_response()가 알려준 갱신된 PID 목록 (멀티 PID 응답이면 여러 개).
+ * @param count PID 수.
+ * @param rx_time 응답 프레임 수신 시각 (CANMessage.timestamp).
+ */
+void can_sched_complete(CANScheduler* s, const unsigned char* pids, int count, double rx_time) {
+    if (!s || !pids) return;
+    for (int i = 0; i < count; i++) {
+        CANPidSlot* slot = find_slot(s, pids[i]);
+        if (slot) complete_slot(s, slot, rx_time);
+    }
+}
+
+/**
+ * @brief 응답을 기다리는 요청 중 가장 가까운 제한 시각을 반환합니다.
+ * @details select() 타임아웃을 이 시각에 맞추면 재전송이 늦어지지 않습니다.
+ * @return 가장 이른 deadline, 응답 대기 중인 요청이 없으면 0.
+ */
+double can_sched_next_deadline(const CANScheduler* s) {
+    if (!s) return 0.0;
+    double next = 0.0;
+    for (int i = 0; i < s->count; i++) {
+        const CANPidSlot* slot = &s->slots[i];
+        if (!slot->in_flight) continue;
+        if (next == 0.0 || slot->deadline < next) next = slot->deadline;
+    }
+    return next;
+}
+
+/**
+ * @brief PID별 상태(응답 지연, 타임아웃 통계 등)를 조회합니다.
+ * @return 해당 PID 슬롯, 등록되지 않았으면 NULL.
+ */
+const CANPidSlot* can_sched_slot(const CANScheduler* s, unsigned char pid) {
+    if (!s) return NULL;
+    return find_slot((CANScheduler*)s, pid);
+}
@@ -0,0 +1,298 @@
+/**
+ * @file det_json.c
+ * @brief vision_server.py 결과 JSON 전용 단일 패스 스캐너.
+ * @details
+ * 기존 parse_ai_results()는 cJSON_Parse()로 키와 숫자마다 노드를 malloc하고,
+ * 객체마다 cJSON_GetObjectItemCaseSensitive로 키 문자열을 다섯 번 비교한 뒤 결과 배열을 매번 새로 malloc했습니다.
+ * 이 스캐너는 {"objects":[{label,x,y,ax,ay,score}...], "token":N, "capture_time":T} 형식만 알고,
+ * 입력을 제자리에서 한 번 훑으면서 키 길이와 글자로 필드를 고르고 숫자를 바로 DetPool에 씁니다.
+ * 입력은 NUL로 끝나지 않아도 되고(IPC 프레임 payload), 길이 제한도 없습니다.
+ * 모르는 키의 값은 중첩 객체/배열까지 건너뛰며, 숫자가 아닌 필드 값은 cJSON 경로와 같이 기본값으로 둡니다.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "hardware.h"
+
+typedef struct {
+    const char* p;
+    const char* end;
+} Scan;
+
+enum { F_NONE = -1, F_LABEL, F_X, F_Y, F_AX, F_AY, F_SCORE };
+
+int det_pool_init(DetPool* pool, int initial_cap) {
+    if (!pool) return -1;
+    memset(pool, 0, sizeof(*pool));
+    return det_pool_reserve(pool, initial_cap > 0 ? initial_cap : 16);
+}
+
+int det_pool_reserve(DetPool* pool, int n) {
+    if (!pool) return -1;
+    if (n <= pool->cap) return 0;
+
+    int cap = pool->cap > 0 ? pool->cap : 16;
+    while (cap < n) cap *= 2;
+    DetectedObject* items = realloc(pool->items, sizeof(DetectedObject) * (size_t)cap);
+    if (!items) return -1;
+    pool->items = items;
+    pool->cap = cap;
+    return 0;
+}
+
+void det_pool_free(DetPool* pool) {
+    if (!pool) return;
+    free(pool->items);
+    memset(pool, 0, sizeof(*pool));
+}
+
+static inline void skip_ws(Scan* s) {
+    while (s->p < s->end && (*s->p == ' ' || *s->p == '\n' || *s->p == '\r' || *s->p == '\t')) s->p++;
+}
+
+static inline int is_digit(char c) {
+    return (unsigned)(c - '0') <= 9;
+}
+
+// 공백 뒤 c가 오면 소비하고 1
+static inline int accept(Scan* s, char c) {
+    skip_ws(s);
+    if (s->p < s->end && *s->p == c) {
+        s->p++;
+        return 1;
+    }
+    return 0;
+}
+
+// 문자열을 건너뛰고 따옴표 안쪽 구간을 돌려줌 (이스케이프는 풀지 않음: 키 비교에는 필요 없음)
+static int scan_string(Scan* s, const char** str, size_t* len) {
+    if (s->p >= s->end || *s->p != '"') return -1;
+    const char* start = ++s->p;
+    while (s->p < s->end) {
+        char c = *s->p;
+        if (c == '\\') {
+            s->p += 2;
+            continue;
+        }
+        if (c == '"') {
+            if (str) *str = start;
+            if (len) *len = (size_t)(s->p - start);
+            s->p++;
+            return 0;
+        }
+        s->p++;
+    }
+    return -1;
+}
+
+// 10^0 ~ 10^22은 double로 정확히 표현되므로 가수가 2^53 미만이면 곱/나누기 한 번으로 올바르게 반올림됨
+static const double k_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * @brief JSON 숫자 하나를 읽습니다. (strtod와 달리 입력 끝을 넘지 않고 로캘에 영향받지 않음)
+ * @details 유효 숫자 19자리까지 정수로 모은 뒤 10의 거듭제곱으로 한 번 스케일합니다.
+ *          결과는 float로 저장되므로 이 정밀도로 충분합니다.
+ */
+static int scan_number(Scan* s, double* out) {
+    const char* p = s->p;
+    const char* end = s->end;
+    int neg = 0;
+
+    if (p < end && *p == '-') { neg = 1; p++; }
+    if (p >= end || !is_digit(*p)) return -1;
+
+    uint64_t mant = 0;
+    int digits = 0;
+    int exp10 = 0;
+    for (; p < end && is_digit(*p); p++) {
+        if (digits < 19) { mant = mant * 10 + (uint64_t)(*p - '0'); if (mant) digits++; }
+        else exp10++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        if (p >= end || !is_digit(*p)) return -1;
+        for (; p < end && is_digit(*p); p++) {
+            if (digits < 19) { mant = mant * 10 + (uint64_t)(*p - '0'); if (mant) digits++; exp10--; }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int eneg = 0;
+        if (p < end && (*p == '+' || *p == '-')) { eneg = (*p == '-'); p++; }
+        if (p >= end || !is_digit(*p)) return -1;
+        int e = 0;
+        for (; p < end && is_digit(*p); p++) {
+            if (e < 10000) e = e * 10 + (*p - '0');
+        }
+        exp10 += eneg ? -e : e;
+    }
+
+    double v = (double)mant;
+    if (mant != 0 && exp10 != 0) {
+        if (exp10 > 0 && exp10 <= 22) v *= k_pow10[exp10];
+        else if (exp10 < 0 && exp10 >= -22) v /= k_pow10[-exp10];
+        else v *= pow(10.0, exp10);
+    }
+    *out = neg ? -v : v;
+    s->p = p;
+    return 0;
+}
+
+// 값 하나(문자열/숫자/리터럴/중첩 객체·배열)를 건너뜀. 괄호 종류 짝은 보지 않고 깊이만 셈
+static int skip_value(Scan* s) {
+    int depth = 0;
+    do {
+        skip_ws(s);
+        if (s->p >= s->end) return -1;
+        char c = *s->p;
+        if (c == '"') {
+            if (scan_string(s, NULL, NULL) < 0) return -1;
+        } else if (c == '{' || c == '[') {
+            depth++;
+            s->p++;
+        } else if (c == '}' || c == ']') {
+            if (--depth < 0) return -1;
+            s->p++;
+        } else if (c == ',' || c == ':') {
+            if (depth == 0) return -1;
+            s->p++;
+        } else {
+            // 숫자, true/false/null
+            const char* start = s->p;
+            while (s->p < s->end && (is_digit(*s->p) || (*s->p >= 'a' && *s->p <= 'z') ||
+                                     *s->p == '-' || *s->p == '+' || *s->p == '.' || *s->p == 'E')) {
+                s->p++;
+            }
+            if (s->p == start) return -1;
+        }
+    } while (depth > 0);
+    return 0;
+}
+
+static int object_field(const char* k, size_t n) {
+    switch (n) {
+        case 1:
+            if (k[0] == 'x') return F_X;
+            if (k[0] == 'y') return F_Y;
+            break;
+        case 2:
+            if (k[0] == 'a' && k[1] == 'x') return F_AX;
+            if (k[0] == 'a' && k[1] == 'y') return F_AY;
+            break;
+        case 5:
+            if (memcmp(k, "label", 5) == 0) return F_LABEL;
+            if (memcmp(k, "score", 5) == 0) return F_SCORE;
+            break;
+    }
+    return F_NONE;
+}
+
+// {"label":..,"x":..,...} 하나를 o에 채움 (s->p는 '{' 위)
+static int scan_object(Scan* s, DetectedObject* o) {
+    memset(o, 0, sizeof(*o));
+    o->score = 1.0f;
+
+    s->p++;
+    if (accept(s, '}')) return 0;
+    do {
+        const char* key;
+        size_t klen;
+        skip_ws(s);
+        if (scan_string(s, &key, &klen) < 0 || !accept(s, ':')) return -1;
+        skip_ws(s);
+
+        int f = object_field(key, klen);
+        double v;
+        if (f != F_NONE && s->p < s->end && (*s->p == '-' || is_digit(*s->p))) {
+            if (scan_number(s, &v) < 0) return -1;
+            switch (f) {
+                case F_LABEL: o->label = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : (int)v)); break;
+                case F_X:     o->x = (float)v; break;
+                case F_Y:     o->y = (float)v; break;
+                case F_AX:    o->ax = (float)v; break;
+                case F_AY:    o->ay = (float)v; break;
+                case F_SCORE: o->score = (float)v; break;
+            }
+        } else if (skip_value(s) < 0) {
+            return -1;
+        }
+    } while (accept(s, ','));
+    return accept(s, '}') ? 0 : -1;
+}
+
+// "objects" 배열 (s->p는 '[' 앞 공백). 객체가 아닌 원소는 건너뜀
+static int scan_objects(Scan* s, DetPool* pool) {
+    pool->count = 0;
+    if (!accept(s, '[')) return -1;
+    if (accept(s, ']')) return 0;
+    do {
+        skip_ws(s);
+        if (s->p < s->end && *s->p == '{') {
+            if (det_pool_reserve(pool, pool->count + 1) < 0) return -1;
+            if (scan_object(s, &pool->items[pool->count]) < 0) return -1;
+            pool->count++;
+        } else if (skip_value(s) < 0) {
+            return -1;
+        }
+    } while (accept(s, ','));
+    return accept(s, ']') ? 0 : -1;
+}
+
+/**
+ * @brief 결과 JSON을 pool에 파싱합니다. 이전 내용은 덮어씁니다.
+ * @param json 입력 (NUL로 끝나지 않아도 됨).
+ * @param len 입력 길이.
+ * @param pool 결과를 받을 풀 (모자라면 늘림).
+ * @param token 결과에 붙은 사이클 토큰 (없으면 -1).
+ * @return 객체 수, 형식이 틀렸거나 "objects" 배열이 없으면 -1 (pool->count는 0).
+ *         촬영 시각("capture_time")은 pool->capture_time에 씀 (없으면 0).
+ */
+int det_json_parse(const char* json, size_t len, DetPool* pool, long* token) {
+    if (token) *token = -1;
+    if (!pool) return -1;
+    pool->count = 0;
+    pool->capture_time = 0.0;
+    if (!json) return -1;
+
+    Scan s = { json, json + len };
+    int have_objects = 0;
+
+    if (!accept(&s, '{')) return -1;
+    if (!accept(&s, '}')) {
+        do {
+            const char* key;
+            size_t klen;
+            skip_ws(&s);
+            if (scan_string(&s, &key, &klen) < 0 || !accept(&s, ':')) goto fail;
+            skip_ws(&s);
+
+            if (klen == 7 && memcmp(key, "objects", 7) == 0 && s.p < s.end && *s.p == '[') {
+                if (scan_objects(&s, pool) < 0) goto fail;
+                have_objects = 1;
+            } else if (klen == 5 && memcmp(key, "token", 5) == 0 && s.p < s.end &&
+                       (*s.p == '-' || is_digit(*s.p))) {
+                double v;
+                if (scan_number(&s, &v) < 0) goto fail;
+                if (token) *token = (long)v;
+            } else if (klen == 12 && memcmp(key, "capture_time", 12) == 0 && s.p < s.end &&
+                       (*s.p == '-' || is_digit(*s.p))) {
+                if (scan_number(&s, &pool->capture_time) < 0) goto fail;
+            } else if (skip_value(&s) < 0) {
+                goto fail;
+            }
+        } while (accept(&s, ','));
+        if (!accept(&s, '}')) goto fail;
+    }
+    if (!have_objects) goto fail;
+    return pool->count;
+
+fail:
+    pool->count = 0;
+    return -1;
+}
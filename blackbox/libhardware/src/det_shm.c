@@ -0,0 +1,191 @@
+/**
+ * @file det_shm.c
+ * @brief vision_server.py의 탐지 결과를 공유 메모리(memfd + mmap) 링으로 받는 채널.
+ * @details
+ * 기존에는 결과가 JSON 한 줄로 파이프를 타고 왔고, C는 4096바이트 스택 버퍼에 fgets()로 읽은 뒤
+ * cJSON 트리를 만들고 DetectedObject 배열을 malloc했습니다. 객체가 많으면 줄이 조용히 잘렸습니다.
+ * 이 채널은 고정 레이아웃 슬롯에 DetectedObject를 그대로 써 두고, C는 파싱/복사 없이 그 자리에서 읽습니다.
+ *
+ * 동기화:
+ * - 파이썬(생산자)은 슬롯을 모두 쓴 뒤 write_seq를 올리고 eventfd에 씁니다.
+ *   C(소비자)는 eventfd를 읽은 뒤에 write_seq를 읽으므로, eventfd의 커널 잠금이 쓰기 순서를 보장합니다.
+ * - C는 붙잡고 있는 결과 번호를 read_seq에 적고, 파이썬은 그 슬롯을 덮어쓸 차례가 되면 새 결과를 버립니다.
+ *   그래서 C가 다음 결과를 받을 때까지 이전 결과를 제어 주기마다 계속 읽어도 안전합니다.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+#include "hardware.h"
+
+// 공유 메모리 헤더 (64바이트, 슬롯은 그 뒤에 slot_size 간격으로 이어짐)
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t max_objects;
+    uint32_t slot_size;
+    uint32_t reserved;
+    _Atomic uint64_t write_seq;     // 마지막으로 다 쓴 결과 번호 (파이썬만 갱신)
+    _Atomic uint64_t read_seq;      // C가 붙잡고 있는 결과 번호 (C만 갱신)
+    uint64_t dropped;               // 슬롯이 모자라 버린 결과 수 (파이썬만 갱신)
+    uint8_t pad[16];
+} DetShmHeader;
+
+// 결과 슬롯 머리 (32바이트, 바로 뒤에 DetectedObject[max_objects])
+typedef struct {
+    uint64_t seq;
+    int64_t token;
+    uint32_t count;
+    uint32_t flags;
+    double timestamp;
+} DetShmSlot;
+
+// ai/det_shm.py의 struct 포맷과 어긋나면 컴파일 단계에서 잡음
+_Static_assert(sizeof(DetShmHeader) == 64, "DetShmHeader layout");
+_Static_assert(offsetof(DetShmHeader, write_seq) == 24, "DetShmHeader.write_seq offset");
+_Static_assert(offsetof(DetShmHeader, read_seq) == 32, "DetShmHeader.read_seq offset");
+_Static_assert(offsetof(DetShmHeader, dropped) == 40, "DetShmHeader.dropped offset");
+_Static_assert(sizeof(DetShmSlot) == 32, "DetShmSlot layout");
+_Static_assert(sizeof(DetectedObject) == 24, "DetectedObject layout (<B3xfffff)");
+
+#define DET_SHM_SLOT_SIZE   ((sizeof(DetShmSlot) + sizeof(DetectedObject) * DET_SHM_MAX_OBJECTS + 63) & ~(size_t)63)
+#define DET_SHM_TOTAL_SIZE  (sizeof(DetShmHeader) + DET_SHM_SLOT_SIZE * DET_SHM_SLOTS)
+
+static int s_shm_fd = -1;
+static int s_event_fd = -1;
+static unsigned char* s_base = NULL;
+static uint64_t s_last_seen = 0;    // 마지막으로 읽은 write_seq
+
+static DetShmHeader* header(void) {
+    return (DetShmHeader*)s_base;
+}
+
+static DetShmSlot* slot_for(uint64_t seq) {
+    return (DetShmSlot*)(s_base + sizeof(DetShmHeader) + DET_SHM_SLOT_SIZE * (seq % DET_SHM_SLOTS));
+}
+
+/**
+ * @brief 공유 메모리와 eventfd를 만들고 헤더를 초기화합니다. 파이썬 자식을 띄우기 전에 호출하세요.
+ * @return 성공 시 새 결과가 올 때마다 읽을 수 있게 되는 eventfd, 실패 시 -1.
+ */
+int det_shm_create(void) {
+    if (s_base) return s_event_fd;
+
+    s_shm_fd = memfd_create("blackbox-detections", MFD_CLOEXEC);
+    if (s_shm_fd < 0 || ftruncate(s_shm_fd, (off_t)DET_SHM_TOTAL_SIZE) < 0) {
+        perror("[DET_SHM] memfd");
+        goto fail;
+    }
+    void* base = mmap(NULL, DET_SHM_TOTAL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, s_shm_fd, 0);
+    if (base == MAP_FAILED) {
+        perror("[DET_SHM] mmap");
+        goto fail;
+    }
+    s_base = base;
+
+    s_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (s_event_fd < 0) {
+        perror("[DET_SHM] eventfd");
+        goto fail;
+    }
+
+    // memfd는 0으로 채워져 있으므로 헤더 필드만 설정
+    DetShmHeader* h = header();
+    h->magic = DET_SHM_MAGIC;
+    h->version = DET_SHM_VERSION;
+    h->slots = DET_SHM_SLOTS;
+    h->max_objects = DET_SHM_MAX_OBJECTS;
+    h->slot_size = (uint32_t)DET_SHM_SLOT_SIZE;
+    atomic_init(&h->write_seq, 0);
+    atomic_init(&h->read_seq, 0);
+    s_last_seen = 0;
+    return s_event_fd;
+
+fail:
+    det_shm_destroy();
+    return -1;
+}
+
+/**
+ * @brief fork된 자식에서 exec 직전에 호출: 두 fd를 exec 후에도 열려 있게 하고 번호를 환경 변수로 넘깁니다.
+ * @return 0: 성공, -1: 채널이 없음.
+ */
+int det_shm_export(void) {
+    if (s_shm_fd < 0 || s_event_fd < 0) return -1;
+
+    char buf[16];
+    fcntl(s_shm_fd, F_SETFD, 0);
+    fcntl(s_event_fd, F_SETFD, 0);
+    snprintf(buf, sizeof(buf), "%d", s_shm_fd);
+    setenv(DET_SHM_ENV_FD, buf, 1);
+    snprintf(buf, sizeof(buf), "%d", s_event_fd);
+    setenv(DET_SHM_ENV_EVENT_FD, buf, 1);
+    return 0;
+}
+
+/**
+ * @brief 새 결과가 있으면 가장 최근 것을 돌려줍니다. (논블로킹, 복사 없음)
+ * @details 중간 결과는 건너뜁니다 (C는 항상 최신 탐지만 필요).
+ *          돌려받은 objects를 다음 poll 이후에도 쓰려면 det_shm_hold(out->seq)로 붙잡아야 합니다.
+ * @return 1: 새 결과, 0: 없음.
+ */
+int det_shm_poll(DetResult* out) {
+    if (!s_base || !out) return 0;
+
+    // eventfd를 먼저 읽어야 파이썬이 eventfd에 쓰기 전에 쓴 슬롯 내용이 보임
+    uint64_t cnt;
+    ssize_t r = read(s_event_fd, &cnt, sizeof(cnt));
+    (void)r;
+
+    uint64_t w = atomic_load_explicit(&header()->write_seq, memory_order_acquire);
+    if (w == s_last_seen) return 0;
+    s_last_seen = w;
+
+    const DetShmSlot* slot = slot_for(w);
+    if (slot->seq != w) return 0; // 파이썬이 재시작하며 덜 쓴 슬롯 등 (다음 결과를 기다림)
+
+    out->seq = (unsigned long)w;
+    out->token = (long)slot->token;
+    out->count = (int)((slot->count > DET_SHM_MAX_OBJECTS) ? DET_SHM_MAX_OBJECTS : slot->count);
+    out->flags = slot->flags;
+    out->timestamp = slot->timestamp;
+    out->objects = (const DetectedObject*)(slot + 1);
+    return 1;
+}
+
+/**
+ * @brief 이 결과를 계속 읽을 것이므로 파이썬이 해당 슬롯을 덮어쓰지 않게 합니다.
+ */
+void det_shm_hold(unsigned long seq) {
+    if (!s_base) return;
+    atomic_store_explicit(&header()->read_seq, (uint64_t)seq, memory_order_release);
+}
+
+/**
+ * @brief 붙잡은 결과가 없음을 알립니다. 마지막으로 본 결과까지 덮어써도 됩니다.
+ */
+void det_shm_release(void) {
+    det_shm_hold((unsigned long)s_last_seen);
+}
+
+unsigned long det_shm_dropped(void) {
+    if (!s_base) return 0;
+    return (unsigned long)__atomic_load_n(&header()->dropped, __ATOMIC_RELAXED);
+}
+
+void det_shm_destroy(void) {
+    if (s_base) { munmap(s_base, DET_SHM_TOTAL_SIZE); s_base = NULL; }
+    if (s_event_fd >= 0) { close(s_event_fd); s_event_fd = -1; }
+    if (s_shm_fd >= 0) { close(s_shm_fd); s_shm_fd = -1; }
+    s_last_seen = 0;
+}
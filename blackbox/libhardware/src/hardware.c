@@ -10,6 +10,6 @@ int hardware_init(void) {
 }
 
 void hardware_close(void) {
-    // 녹화 중이면 정리
-    storage_stop_recording();
+    // 녹화 중이면 mp4 마무리까지 기다린 뒤 정리
+    storage_finish();
 }
@@ -0,0 +1,246 @@
+/**
+ * @file ipc_msg.c
+ * @brief C ↔ vision_server.py 사이의 길이 접두 바이너리 메시지 인코더/디코더.
+ * @details
+ * 기존 draw 명령은 fprintf 15번 정도로 JSON을 만들었고(경로 점마다 %.2f 포맷팅),
+ * 파이썬은 parse_command()에서 json.loads()로 다시 풀었습니다. analyze도 마찬가지였습니다.
+ * 이 형식은 고정 헤더(magic, 버전, 종류, payload 길이, 사이클 토큰) 뒤에 고정 레이아웃 payload를 붙여
+ * 양쪽 모두 텍스트 포맷팅/파싱 없이 memcpy와 struct.unpack만으로 처리합니다.
+ * 수신 쪽은 magic/버전이 맞지 않으면 한 바이트씩 건너뛰며 다시 동기화하므로,
+ * 파이썬 라이브러리가 stdout에 잘못 찍은 글자가 섞여도 프레임을 잃지 않습니다.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "hardware.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "ipc_msg: 와이어 형식은 리틀 엔디언 기준입니다 (빅 엔디언 대상이면 put/get에 바이트 교환 추가 필요)"
+#endif
+
+// 리틀 엔디언 호스트 전제: 정렬되지 않은 위치에도 안전하게 memcpy로 씀
+#define PUT(p, v) do { __typeof__(v) put_tmp_ = (v); memcpy((p), &put_tmp_, sizeof(put_tmp_)); (p) += sizeof(put_tmp_); } while (0)
+
+static unsigned char* put_header(unsigned char* p, unsigned int type, unsigned long token, uint32_t payload_len) {
+    PUT(p, (uint16_t)IPC_MAGIC);
+    PUT(p, (uint8_t)IPC_VERSION);
+    PUT(p, (uint8_t)type);
+    PUT(p, payload_len);
+    PUT(p, (uint64_t)token);
+    return p;
+}
+
+// 차량 스냅샷 40바이트: gps_x, gps_y, speed, rpm, gear_ratio, degree, brake, gear, throttle, pad, tires[4]
+static unsigned char* put_vehicle(unsigned char* p, const VehicleData* v) {
+    PUT(p, (double)v->gps_x);
+    PUT(p, (double)v->gps_y);
+    PUT(p, (int32_t)v->speed);
+    PUT(p, (int32_t)v->rpm);
+    PUT(p, (float)v->gear_ratio);
+    PUT(p, (float)v->degree);
+    PUT(p, (uint8_t)v->brake_state);
+    PUT(p, (int8_t)v->gear_state);
+    PUT(p, (uint8_t)v->throttle);
+    PUT(p, (uint8_t)0);
+    memcpy(p, v->tire_pressure, 4);
+    return p + 4;
+}
+
+/**
+ * @brief analyze 프레임을 만듭니다.
+ * @param frames 이번 사이클에 분석할 카메라 프레임 세트 (cam_ring_pick 결과, 링이 없으면 NULL).
+ * @return 프레임 길이, buf가 작으면 0.
+ */
+size_t ipc_encode_analyze(unsigned char* buf, size_t cap, unsigned long token, const VehicleData* v,
+                          const CamFrameSet* frames) {
+    int cams = frames ? frames->count : 0;
+    if (cams < 0) cams = 0;
+    if (cams > CAM_RING_MAX_CAMS) cams = CAM_RING_MAX_CAMS;
+    size_t payload = IPC_VEHICLE_SIZE + (frames ? IPC_FRAMESET_SIZE + IPC_FRAME_REF_SIZE * (size_t)cams : 0);
+    if (!buf || !v || cap < IPC_HEADER_SIZE + payload) return 0;
+
+    unsigned char* p = put_header(buf, IPC_MSG_ANALYZE, token, (uint32_t)payload);
+    p = put_vehicle(p, v);
+    if (frames) {
+        PUT(p, (uint32_t)cams);
+        PUT(p, (uint32_t)frames->valid);
+        PUT(p, (double)frames->ref_time);
+        PUT(p, (double)frames->spread);
+        for (int i = 0; i < cams; i++) {
+            PUT(p, (int32_t)frames->cams[i].slot);
+            PUT(p, (uint32_t)0);
+            PUT(p, (uint64_t)frames->cams[i].seq);
+            PUT(p, (double)frames->cams[i].timestamp);
+        }
+    }
+    return IPC_HEADER_SIZE + payload;
+}
+
+/**
+ * @brief draw 프레임을 만듭니다. 경로는 double 배열을 그대로 복사합니다.
+ * @param events 이번 사이클의 이벤트 플래그 (car_state_flag).
+ * @param count 경로 점 수 (path_x/path_y가 NULL이면 0으로 보냄).
+ * @return 프레임 길이, buf가 작으면 0.
+ */
+size_t ipc_encode_draw(unsigned char* buf, size_t cap, unsigned long token, const VehicleData* v,
+                       unsigned int events, const double* path_x, const double* path_y, int count) {
+    if (!path_x || !path_y || count < 0) count = 0;
+    size_t path_bytes = sizeof(double) * (size_t)count;
+    size_t payload = IPC_VEHICLE_SIZE + 8 + path_bytes * 2;
+    if (!buf || !v || cap < IPC_HEADER_SIZE + payload) return 0;
+
+    unsigned char* p = put_header(buf, IPC_MSG_DRAW, token, (uint32_t)payload);
+    p = put_vehicle(p, v);
+    PUT(p, (uint32_t)events);
+    PUT(p, (uint32_t)count);
+    if (count > 0) {
+        memcpy(p, path_x, path_bytes);
+        memcpy(p + path_bytes, path_y, path_bytes);
+    }
+    return IPC_HEADER_SIZE + payload;
+}
+
+/**
+ * @brief payload 없는 프레임(IPC_MSG_ACTIVATE 등)을 만듭니다.
+ * @return 프레임 길이, buf가 작으면 0.
+ */
+size_t ipc_encode_control(unsigned char* buf, size_t cap, unsigned int type, unsigned long token) {
+    if (!buf || cap < IPC_HEADER_SIZE) return 0;
+    put_header(buf, type, token, 0);
+    return IPC_HEADER_SIZE;
+}
+
+/**
+ * @brief 버퍼 전체를 씁니다. (블로킹 fd 기준, EINTR/부분 쓰기 처리)
+ * @return 0: 성공, -1: 실패 (EPIPE 등).
+ */
+int ipc_write_all(int fd, const void* buf, size_t len) {
+    const unsigned char* p = buf;
+    while (len > 0) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+int ipc_reader_init(IpcReader* r, size_t initial_cap) {
+    if (!r) return -1;
+    memset(r, 0, sizeof(*r));
+    if (initial_cap < IPC_HEADER_SIZE) initial_cap = 4096;
+    r->buf = malloc(initial_cap);
+    if (!r->buf) return -1;
+    r->cap = initial_cap;
+    return 0;
+}
+
+void ipc_reader_reset(IpcReader* r) {
+    if (!r) return;
+    r->start = 0;
+    r->len = 0;
+}
+
+void ipc_reader_free(IpcReader* r) {
+    if (!r) return;
+    free(r->buf);
+    memset(r, 0, sizeof(*r));
+}
+
+// 빈 공간 확보: 처리한 앞부분을 당기고, 그래도 모자라면 키움 (최대 헤더 + IPC_MAX_PAYLOAD)
+static int reserve(IpcReader* r, size_t need) {
+    if (r->start > 0 && r->cap - r->len < need) {
+        memmove(r->buf, r->buf + r->start, r->len - r->start);
+        r->len -= r->start;
+        r->start = 0;
+    }
+    if (r->cap - r->len >= need) return 0;
+
+    size_t cap = r->cap;
+    while (cap - r->len < need) cap *= 2;
+    if (cap > IPC_HEADER_SIZE + IPC_MAX_PAYLOAD) cap = IPC_HEADER_SIZE + IPC_MAX_PAYLOAD;
+    if (cap - r->len < need) return -1;
+    unsigned char* nb = realloc(r->buf, cap);
+    if (!nb) return -1;
+    r->buf = nb;
+    r->cap = cap;
+    return 0;
+}
+
+// 다음 read에 필요한 빈 공간: 받는 중인 프레임이 있으면 그 프레임의 남은 바이트, 없으면 IPC_READ_CHUNK
+// (남은 바이트는 헤더 + IPC_MAX_PAYLOAD 안이므로 버퍼 상한 안에서 항상 확보 가능, 최대 길이 근처 프레임도 끝까지 받음)
+static size_t fill_need(const IpcReader* r) {
+    size_t pending = r->len - r->start;
+    if (pending == 0) return IPC_READ_CHUNK;
+    if (pending < IPC_HEADER_SIZE) return IPC_HEADER_SIZE - pending;
+
+    uint32_t plen;
+    memcpy(&plen, r->buf + r->start + 4, 4);
+    if (plen > IPC_MAX_PAYLOAD) return 1;               // 손상된 헤더: ipc_reader_next가 다시 동기화
+    size_t frame = IPC_HEADER_SIZE + plen;
+    size_t need = (pending < frame) ? frame - pending : 1; // 완성된 프레임은 ipc_reader_next가 꺼냄
+    return (need < IPC_READ_CHUNK) ? need : IPC_READ_CHUNK;
+}
+
+/**
+ * @brief 논블로킹 fd에서 읽을 수 있는 만큼 읽어 버퍼에 쌓습니다.
+ * @return 1: 읽음, 0: EOF (이미 쌓인 프레임은 ipc_reader_next로 계속 꺼낼 수 있음), -1: 읽을 것 없음/에러.
+ */
+int ipc_reader_fill(IpcReader* r, int fd) {
+    if (!r || !r->buf) return -1;
+    int got = 0;
+    while (1) {
+        if (reserve(r, fill_need(r)) < 0) return got ? 1 : -1; // 완성된 프레임을 먼저 꺼내야 함
+        ssize_t n = read(fd, r->buf + r->len, r->cap - r->len);
+        if (n > 0) {
+            r->len += (size_t)n;
+            got = 1;
+            continue;
+        }
+        if (n == 0) return 0;
+        if (errno == EINTR) continue;
+        return got ? 1 : -1;
+    }
+}
+
+/**
+ * @brief 완성된 프레임 하나를 꺼냅니다. payload는 다음 ipc_reader_* 호출 전까지만 유효합니다.
+ * @return 1: 메시지 있음, 0: 아직 없음.
+ */
+int ipc_reader_next(IpcReader* r, IpcMessage* out) {
+    if (!r || !out) return 0;
+
+    while (r->len - r->start >= IPC_HEADER_SIZE) {
+        const unsigned char* h = r->buf + r->start;
+        uint16_t magic;
+        uint32_t plen;
+        uint64_t token;
+        memcpy(&magic, h, 2);
+        memcpy(&plen, h + 4, 4);
+        memcpy(&token, h + 8, 8);
+
+        if (magic != IPC_MAGIC || h[2] != IPC_VERSION || h[3] < IPC_MSG_ANALYZE || h[3] > IPC_MSG_LAST ||
+            plen > IPC_MAX_PAYLOAD) {
+            r->start++;         // 프레임 경계를 잃었음: 한 바이트씩 밀며 다음 magic을 찾음
+            r->resyncs++;
+            continue;
+        }
+        if (r->len - r->start < IPC_HEADER_SIZE + plen) return 0; // payload가 아직 덜 옴
+
+        out->type = h[3];
+        out->token = (unsigned long)token;
+        out->len = plen;
+        out->payload = h + IPC_HEADER_SIZE;
+        r->start += IPC_HEADER_SIZE + plen;
+        if (r->start == r->len) r->start = r->len = 0; // 남은 바이트가 없으면 처음부터 다시 씀 (payload는 그대로 남음)
+        return 1;
+    }
+    return 0;
+}
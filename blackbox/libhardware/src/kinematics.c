@@ -0,0 +1,235 @@
+/**
+ * @file kinematics.c
+ * @brief 주행 상태 추정기: 속도 회귀 가감속/저크, GPS·CAN 속도 융합, 타이어 공기압 추세.
+ * @details
+ * 기존 SpeedMonitor는 32개 샘플을 저장해 두고 바로 앞 샘플 하나와만 비교했으므로,
+ * 1 km/h 단위 CAN 속도가 한 칸 바뀔 때마다(0.28 m/s / 샘플 간격) 가속도가 튀었습니다.
+ *
+ * - 가감속/저크: 최근 KIN_WIN_SEC 안의 (최대 KIN_WIN개) 속도 샘플에 직선 회귀(기울기 = 가감속)와 2차 회귀(2 * 2차 계수 = 저크)를 합니다.
+ *   정규 방정식에 필요한 합(tau^0..4, v, tau*v, tau^2*v)을 들고 있다가 새 샘플은 더하고 창을 벗어난 샘플은 빼므로 샘플당 O(1)입니다.
+ *   빼기가 쌓이며 생기는 반올림 오차와 기준 시각에서 멀어지며 생기는 정밀도 손실은 KIN_REBASE_EVERY 샘플마다
+ *   기준 시각을 창의 첫 샘플로 옮기고 합을 다시 계산해 없앱니다 (창 크기만큼, 평균 O(1)).
+ * - 속도 융합: 등가속 모델 [속도, 가속도] 칼만 필터에 CAN 속도(KIN_SPEED_SIGMA_MPS)와
+ *   GPS 위치 차분 속도(KIN_GPS_SPEED_SIGMA_MPS)를 들어오는 대로 넣습니다.
+ * - 타이어: 바퀴마다 시상수 KIN_TIRE_TAU_SEC인 지수 가중 직선 회귀를 합니다. 기준 시각을 마지막 샘플로 옮기는 것은
+ *   합의 선형 변환이라 정확하게 O(1)로 되므로, 샘플마다 옮긴 뒤 감쇠하고 새 샘플을 더합니다.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "hardware.h"
+
+void kin_init(KinEstimator* k) {
+    if (!k) return;
+    memset(k, 0, sizeof(*k));
+    k->gps_speed = -1.0;
+}
+
+// ---------------- 속도 회귀 창 ----------------
+
+static void kin_sum(KinEstimator* k, double t, double v, double sign) {
+    double tau = t - k->base;
+    double tau2 = tau * tau;
+    k->s0 += sign;
+    k->s1 += sign * tau;
+    k->s2 += sign * tau2;
+    k->s3 += sign * tau2 * tau;
+    k->s4 += sign * tau2 * tau2;
+    k->sv += sign * v;
+    k->stv += sign * tau * v;
+    k->sttv += sign * tau2 * v;
+}
+
+static void kin_rebase(KinEstimator* k) {
+    k->s0 = k->s1 = k->s2 = k->s3 = k->s4 = k->sv = k->stv = k->sttv = 0.0;
+    if (k->count > 0) k->base = k->t[k->head];
+    for (int i = 0; i < k->count; i++) {
+        int p = (k->head + i) % KIN_WIN;
+        kin_sum(k, k->t[p], k->v[p], 1.0);
+    }
+    k->since_rebase = 0;
+}
+
+static void kin_pop_oldest(KinEstimator* k) {
+    kin_sum(k, k->t[k->head], k->v[k->head], -1.0);
+    k->head = (k->head + 1) % KIN_WIN;
+    k->count--;
+}
+
+// 창의 합으로 직선/2차 회귀 (창이 충분히 길 때만), 1=갱신
+static int kin_fit(KinEstimator* k) {
+    int newest = (k->head + k->count - 1) % KIN_WIN;
+    k->span = (k->count > 0) ? k->t[newest] - k->t[k->head] : 0.0;
+    if (k->count < 3 || k->span < KIN_MIN_SPAN_SEC) {
+        k->valid = 0;
+        return 0;
+    }
+
+    // 직선: v = c0 + c1 * tau → 가감속 c1
+    double den = k->s0 * k->s2 - k->s1 * k->s1;
+    if (den <= 0.0) return 0;
+    k->accel = (k->s0 * k->stv - k->s1 * k->sv) / den;
+
+    // 2차: [s0 s1 s2; s1 s2 s3; s2 s3 s4] c = [sv stv sttv] → 저크 2 * c2 (크라메르 공식)
+    double a = k->s0, b = k->s1, c = k->s2, d = k->s3, e = k->s4;
+    double det = a * (c * e - d * d) - b * (b * e - c * d) + c * (b * d - c * c);
+    if (fabs(det) > 1e-12) {
+        double det2 = a * (c * k->sttv - k->stv * d) - b * (b * k->sttv - k->stv * c) + k->sv * (b * d - c * c);
+        k->jerk = 2.0 * det2 / det;
+    }
+    k->valid = 1;
+    return 1;
+}
+
+// ---------------- 속도 융합 ([v, a] 칼만 필터) ----------------
+
+static void kin_fuse(KinEstimator* k, double z, double r, double t) {
+    if (k->f_t <= 0.0) {
+        k->fv = z;
+        k->fa = 0.0;
+        k->p_vv = r * r;
+        k->p_va = 0.0;
+        k->p_aa = 4.0;
+        k->f_t = t;
+        return;
+    }
+    double dt = t - k->f_t;
+    if (dt > 0.0) {
+        // 예측: 등가속 + 백색 저크 잡음
+        double q = KIN_JERK_SIGMA * KIN_JERK_SIGMA;
+        double dt2 = dt * dt;
+        k->fv += k->fa * dt;
+        k->p_vv += 2.0 * dt * k->p_va + dt2 * k->p_aa + q * dt2 * dt / 3.0;
+        k->p_va += dt * k->p_aa + q * dt2 / 2.0;
+        k->p_aa += q * dt;
+        k->f_t = t;
+    }
+    // 갱신: 속도 측정 (순서가 바뀐 샘플은 지금 시각의 측정으로 봄)
+    double s = k->p_vv + r * r;
+    double kv = k->p_vv / s, ka = k->p_va / s;
+    double y = z - k->fv;
+    k->fv += kv * y;
+    k->fa += ka * y;
+    k->p_aa -= ka * k->p_va;
+    k->p_va *= (1.0 - kv);
+    k->p_vv *= (1.0 - kv);
+}
+
+/**
+ * @brief 속도 샘플 하나를 넣습니다. (CAN 수신 시각 기준, 같은 시각이나 더 이른 시각의 샘플은 무시)
+ * @return 1=accel/jerk 갱신됨, 0=아직 창이 짧거나 무시한 샘플
+ */
+int kin_push_speed(KinEstimator* k, double v_kph, double t) {
+    if (!k) return 0;
+    if (k->count > 0 && t <= k->t[(k->head + k->count - 1) % KIN_WIN]) return 0;
+    double v = v_kph * KPH_TO_MPS;
+
+    // DV10: KIN_DV_LAG 샘플 전 대비 변화 (km/h)
+    k->dv_ring[k->dv_head] = v_kph;
+    k->dv_head = (k->dv_head + 1) % (KIN_DV_LAG + 1);
+    if (k->dv_count < KIN_DV_LAG + 1) k->dv_count++;
+    k->dv_kph = (k->dv_count == KIN_DV_LAG + 1) ? v_kph - k->dv_ring[k->dv_head] : 0.0;
+
+    kin_fuse(k, v, KIN_SPEED_SIGMA_MPS, t);
+
+    // 창 밖(시간) 또는 가득 찬 창의 가장 오래된 샘플을 빼고 새 샘플을 더함
+    while (k->count > 0 && (k->count >= KIN_WIN || t - k->t[k->head] > KIN_WIN_SEC)) {
+        kin_pop_oldest(k);
+    }
+    int p = (k->head + k->count) % KIN_WIN;
+    k->t[p] = t;
+    k->v[p] = v;
+    k->count++;
+    if (k->count == 1 || ++k->since_rebase >= KIN_REBASE_EVERY) {
+        kin_rebase(k);
+    } else {
+        kin_sum(k, t, v, 1.0);
+    }
+    return kin_fit(k);
+}
+
+/**
+ * @brief GPS 위치(m)를 넣습니다. 직전 위치와 KIN_GPS_MIN_DT ~ KIN_GPS_MAX_DT 떨어져 있으면 차분 속도를 융합합니다.
+ */
+void kin_push_gps(KinEstimator* k, double x, double y, double t) {
+    if (!k) return;
+    double dt = t - k->gps_t;
+    if (k->gps_t > 0.0 && dt < KIN_GPS_MIN_DT && dt >= 0.0) return;   // 너무 가까움: 기준 위치 유지
+
+    if (k->gps_t > 0.0 && dt >= KIN_GPS_MIN_DT && dt <= KIN_GPS_MAX_DT) {
+        k->gps_speed = hypot(x - k->gps_x, y - k->gps_y) / dt;
+        kin_fuse(k, k->gps_speed, KIN_GPS_SPEED_SIGMA_MPS, t);
+    }
+    k->gps_x = x;
+    k->gps_y = y;
+    k->gps_t = t;
+}
+
+// ---------------- 타이어 공기압 추세 ----------------
+
+static void kin_tire_push(KinTire* tr, double p, double t) {
+    if (tr->first_t <= 0.0) {
+        memset(tr, 0, sizeof(*tr));
+        tr->t0 = t;
+        tr->first_t = t;
+        tr->w = 1.0;
+        tr->wp = p;
+        tr->level = p;
+        return;
+    }
+    double dt = t - tr->t0;
+    if (dt <= 0.0) return;
+
+    // 기준 시각을 t로 옮김 (tau' = tau - dt) 후 감쇠, 새 샘플은 tau = 0
+    double lam = exp(-dt / KIN_TIRE_TAU_SEC);
+    double wtt = tr->wtt - 2.0 * dt * tr->wt + dt * dt * tr->w;
+    double wt = tr->wt - dt * tr->w;
+    double wtp = tr->wtp - dt * tr->wp;
+    tr->w = tr->w * lam + 1.0;
+    tr->wt = wt * lam;
+    tr->wtt = wtt * lam;
+    tr->wp = tr->wp * lam + p;
+    tr->wtp = wtp * lam;
+    tr->t0 = t;
+
+    double den = tr->w * tr->wtt - tr->wt * tr->wt;
+    if (den > 1e-9) {
+        double slope = (tr->w * tr->wtp - tr->wt * tr->wp) / den;   // psi/초
+        tr->level = (tr->wp - slope * tr->wt) / tr->w;              // tau = 0의 값
+        tr->slope = slope * 60.0;
+    } else {
+        tr->level = tr->wp / tr->w;
+        tr->slope = 0.0;
+    }
+}
+
+/**
+ * @brief 네 바퀴 공기압(psi) 샘플을 넣고 추세를 갱신합니다.
+ * @return 이상 바퀴 비트 (비트 i = 바퀴 i): 누설 추세(tire_leak) | 다른 바퀴 대비 저압(tire_low)
+ */
+unsigned int kin_push_tires(KinEstimator* k, const unsigned char psi[4], double t) {
+    if (!k || !psi) return 0;
+    k->tire_leak = 0;
+    k->tire_low = 0;
+
+    double sum = 0.0;
+    int ready = 1;
+    for (int i = 0; i < 4; i++) {
+        KinTire* tr = &k->tire[i];
+        kin_tire_push(tr, (double)psi[i], t);
+        sum += tr->level;
+        if (t - tr->first_t < KIN_TIRE_MIN_SPAN_SEC) {
+            ready = 0;
+            continue;
+        }
+        if (tr->slope <= -KIN_TIRE_LEAK_PSI_MIN) k->tire_leak |= 1u << i;
+    }
+    if (ready) {
+        for (int i = 0; i < 4; i++) {
+            double others = (sum - k->tire[i].level) / 3.0;
+            if (k->tire[i].level <= others - KIN_TIRE_DIFF_PSI) k->tire_low |= 1u << i;
+        }
+    }
+    return k->tire_leak | k->tire_low;
+}
@@ -0,0 +1,282 @@
+/**
+ * @file log.c
+ * @brief 스레드별 락프리 링 + 지연 포맷팅 로그 시스템.
+ * @details
+ * printf는 호출한 스레드에서 포맷팅과 write()를 바로 수행하므로, 시리얼 콘솔이나 journald로 나가는 경우
+ * 제어 루프 시간 대부분을 출력이 차지했습니다.
+ * log_* 매크로는 포맷 문자열 포인터와 인자 값만 호출 스레드 전용 SPSC 링에 복사하고 바로 돌아갑니다.
+ * 포맷팅과 출력은 드레인 스레드가 LOG_DRAIN_PERIOD_MS마다 모아서 처리하며,
+ * 링이 가득 차면 새 레코드를 버리고 개수만 세므로 로그 때문에 호출 스레드가 멈추는 일은 없습니다.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "hardware.h"
+
+typedef struct {
+    double timestamp;           // 기록 시각 (now_sec 기준)
+    const char* fmt;            // 포맷 문자열 (리터럴이어야 함)
+    unsigned char level;
+    unsigned char nargs;
+    LogArg args[LOG_MAX_ARGS];
+} LogRecord;
+
+typedef struct {
+    SpscRing* ring;             // 생산자: 해당 스레드, 소비자: 드레인 스레드
+    atomic_ulong dropped;       // 링이 가득 차서 버린 레코드 수
+    unsigned long reported;     // 드레인 스레드가 마지막으로 알린 버림 수 (드레인 스레드 전용)
+} LogThread;
+
+static LogThread s_threads[LOG_MAX_THREADS];
+static atomic_int s_thread_count = 0;           // 링이 준비된 스레드 수 (드레인 스레드가 읽음)
+static atomic_int s_thread_claimed = 0;         // 슬롯을 가져간 스레드 수
+static atomic_ulong s_unregistered_drops = 0;   // 슬롯이 부족해 링 없이 버린 레코드 수
+static _Thread_local LogThread* t_log = NULL;
+static _Thread_local int t_log_failed = 0;
+
+static pthread_t s_drain_thread;
+static atomic_int s_running = 0;
+static FILE* s_out = NULL;
+static int s_out_owned = 0;
+
+// 호출 스레드의 링을 처음 한 번만 만듦. 슬롯이 없거나 할당에 실패하면 NULL
+static LogThread* log_thread_self(void) {
+    if (t_log || t_log_failed) return t_log;
+
+    int idx = atomic_fetch_add(&s_thread_claimed, 1);
+    if (idx >= LOG_MAX_THREADS) {
+        t_log_failed = 1;
+        return NULL;
+    }
+    LogThread* lt = &s_threads[idx];
+    lt->ring = spsc_create(sizeof(LogRecord), LOG_RING_SIZE);
+    atomic_init(&lt->dropped, 0);
+    lt->reported = 0;
+
+    // 슬롯은 순서대로 채워지므로, 앞 슬롯이 공개될 때까지 기다렸다가 공개 (스레드 시작 시 한 번뿐)
+    // 링 할당에 실패한 슬롯도 공개해야 뒤 슬롯이 멈추지 않음 (드레인 스레드는 ring이 NULL이면 건너뜀)
+    int expected = idx;
+    while (!atomic_compare_exchange_weak(&s_thread_count, &expected, idx + 1)) expected = idx;
+    if (!lt->ring) {
+        t_log_failed = 1;
+        return NULL;
+    }
+    t_log = lt;
+    return lt;
+}
+
+/**
+ * @brief 레코드 하나를 호출 스레드의 링에 넣습니다. (포맷팅/시스템 콜 없음)
+ * @details log_debug/log_info/log_warn/log_error 매크로가 호출합니다.
+ */
+void log_write(int level, const char* fmt, const LogArg* args, int nargs) {
+    LogThread* lt = log_thread_self();
+    if (!lt) {
+        atomic_fetch_add_explicit(&s_unregistered_drops, 1, memory_order_relaxed);
+        return;
+    }
+
+    LogRecord rec;
+    rec.timestamp = now_sec();
+    rec.fmt = fmt;
+    rec.level = (unsigned char)level;
+    if (nargs > LOG_MAX_ARGS) nargs = LOG_MAX_ARGS;
+    rec.nargs = (unsigned char)nargs;
+    if (nargs > 0) memcpy(rec.args, args, sizeof(LogArg) * nargs);
+
+    if (spsc_push(lt->ring, &rec) < 0) {
+        atomic_fetch_add_explicit(&lt->dropped, 1, memory_order_relaxed);
+    }
+}
+
+// 정수 인자를 길이 수식자에 맞는 폭으로 잘라 long long/unsigned long long으로 다시 넓힘
+static long long narrow_signed(long long v, const char* len) {
+    if (strcmp(len, "hh") == 0) return (signed char)v;
+    if (strcmp(len, "h") == 0) return (short)v;
+    if (len[0] == '\0') return (int)v;
+    if (strcmp(len, "l") == 0) return (long)v;
+    return v;
+}
+
+static unsigned long long narrow_unsigned(long long v, const char* len) {
+    if (strcmp(len, "hh") == 0) return (unsigned char)v;
+    if (strcmp(len, "h") == 0) return (unsigned short)v;
+    if (len[0] == '\0') return (unsigned int)v;
+    if (strcmp(len, "l") == 0) return (unsigned long)v;
+    return (unsigned long long)v;
+}
+
+/**
+ * @brief 레코드를 printf 규칙대로 문자열로 만듭니다. (드레인 스레드에서만 호출)
+ * @details 변환 지정자마다 저장된 인자 하나를 snprintf로 출력합니다. '*' 폭/정밀도는 지원하지 않습니다.
+ * @return 만들어진 문자열 길이.
+ */
+static size_t log_render(const LogRecord* rec, char* out, size_t size) {
+    size_t pos = 0;
+    int ai = 0;
+    const char* p = rec->fmt ? rec->fmt : "";
+
+    while (*p && pos + 1 < size) {
+        if (*p != '%') { out[pos++] = *p++; continue; }
+        if (p[1] == '%') { out[pos++] = '%'; p += 2; continue; }
+
+        // 지정자 분해: %[플래그][폭][.정밀도][길이]변환
+        char spec[32];
+        char len[3] = {0};
+        size_t sn = 0;
+        spec[sn++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && sn < sizeof(spec) - 4) spec[sn++] = *p++;
+        for (int k = 0; k < 2 && *p && strchr("hlzjtL", *p); k++) len[k] = *p++;
+        char conv = *p;
+        if (!conv) break;
+        p++;
+
+        char* dst = out + pos;
+        size_t room = size - pos;
+        int n = 0;
+        if (ai >= rec->nargs) {
+            n = snprintf(dst, room, "<?>");
+        } else {
+            const LogArg* a = &rec->args[ai++];
+            long long iv = (a->type == LOG_ARG_DOUBLE) ? (long long)a->v.d : a->v.i;
+            switch (conv) {
+                case 'd': case 'i':
+                    memcpy(spec + sn, "lld", 4);
+                    n = snprintf(dst, room, spec, narrow_signed(iv, len));
+                    break;
+                case 'u': case 'x': case 'X': case 'o':
+                    spec[sn] = 'l'; spec[sn + 1] = 'l'; spec[sn + 2] = conv; spec[sn + 3] = '\0';
+                    n = snprintf(dst, room, spec, narrow_unsigned(iv, len));
+                    break;
+                case 'c':
+                    spec[sn] = 'c'; spec[sn + 1] = '\0';
+                    n = snprintf(dst, room, spec, (int)iv);
+                    break;
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                    spec[sn] = conv; spec[sn + 1] = '\0';
+                    n = snprintf(dst, room, spec, (a->type == LOG_ARG_DOUBLE) ? a->v.d : (double)a->v.i);
+                    break;
+                case 's':
+                    spec[sn] = 's'; spec[sn + 1] = '\0';
+                    n = snprintf(dst, room, spec,
+                                 (a->type == LOG_ARG_STR && a->v.p) ? (const char*)a->v.p : "(null)");
+                    break;
+                case 'p':
+                    spec[sn] = 'p'; spec[sn + 1] = '\0';
+                    n = snprintf(dst, room, spec, a->v.p);
+                    break;
+                default:
+                    n = snprintf(dst, room, "<%%%c?>", conv);
+                    break;
+            }
+        }
+        if (n < 0) n = 0;
+        pos += ((size_t)n < room) ? (size_t)n : room - 1;
+    }
+    out[pos] = '\0';
+    return pos;
+}
+
+static const char k_level_chars[] = { 'D', 'I', 'W', 'E' };
+
+// 모든 스레드의 링을 비우면서 출력. 출력한 레코드 수 반환
+static int log_drain_once(void) {
+    int total = 0;
+    int count = atomic_load(&s_thread_count);
+    char line[1024];
+    LogRecord rec;
+
+    for (int t = 0; t < count; t++) {
+        LogThread* lt = &s_threads[t];
+        if (!lt->ring) continue;
+        while (spsc_pop(lt->ring, &rec)) {
+            log_render(&rec, line, sizeof(line));
+            char lv = (rec.level < sizeof(k_level_chars)) ? k_level_chars[rec.level] : '?';
+            size_t n = strlen(line);
+            fprintf(s_out, "%12.6f %c T%d %s%s", rec.timestamp, lv, t, line,
+                    (n > 0 && line[n - 1] == '\n') ? "" : "\n");
+            total++;
+        }
+        unsigned long dropped = atomic_load_explicit(&lt->dropped, memory_order_relaxed);
+        if (dropped != lt->reported) {
+            fprintf(s_out, "%12.6f W T%d [LOG] %lu records dropped (ring full)\n",
+                    now_sec(), t, dropped - lt->reported);
+            lt->reported = dropped;
+            total++;
+        }
+    }
+    if (total > 0) fflush(s_out);
+    return total;
+}
+
+static void* log_drain_main(void* arg) {
+    (void)arg;
+    struct timespec period = { 0, LOG_DRAIN_PERIOD_MS * 1000000L };
+
+    while (atomic_load_explicit(&s_running, memory_order_relaxed)) {
+        log_drain_once();
+        nanosleep(&period, NULL);
+    }
+    log_drain_once(); // 종료 직전까지 쌓인 레코드
+    return NULL;
+}
+
+/**
+ * @brief 드레인 스레드를 시작합니다. 시작 전에 남긴 로그도 링에 남아 있다가 함께 출력됩니다.
+ * @param path 로그 파일 경로 (이어 쓰기). NULL이면 stderr.
+ * @return 0: 성공, -1: 실패.
+ */
+int log_start(const char* path) {
+    if (atomic_load(&s_running)) return -1;
+
+    s_out = stderr;
+    s_out_owned = 0;
+    if (path) {
+        s_out = fopen(path, "a");
+        if (!s_out) {
+            perror("[LOG] fopen");
+            s_out = stderr;
+            return -1;
+        }
+        s_out_owned = 1;
+    }
+
+    atomic_store(&s_running, 1);
+    if (pthread_create(&s_drain_thread, NULL, log_drain_main, NULL) != 0) {
+        perror("[LOG] pthread_create");
+        atomic_store(&s_running, 0);
+        if (s_out_owned) fclose(s_out);
+        s_out = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 남은 레코드를 모두 출력하고 드레인 스레드를 멈춥니다.
+ * @details 스레드별 링은 해제하지 않습니다 (다른 스레드가 아직 로그를 남길 수 있음).
+ */
+void log_stop(void) {
+    if (!atomic_load(&s_running)) return;
+    atomic_store(&s_running, 0);
+    pthread_join(s_drain_thread, NULL);
+
+    if (s_out_owned) fclose(s_out);
+    s_out = NULL;
+    s_out_owned = 0;
+}
+
+/**
+ * @brief 링이 가득 차거나 스레드 슬롯이 부족해 버린 레코드 누적 수.
+ */
+unsigned long log_dropped(void) {
+    unsigned long total = atomic_load_explicit(&s_unregistered_drops, memory_order_relaxed);
+    int count = atomic_load(&s_thread_count);
+    for (int t = 0; t < count; t++) {
+        total += atomic_load_explicit(&s_threads[t].dropped, memory_order_relaxed);
+    }
+    return total;
+}
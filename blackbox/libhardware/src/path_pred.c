@@ -0,0 +1,98 @@
+/**
+ * @file path_pred.c
+ * @brief 예상 경로 계산: 조향각 곡률 룩업 테이블 + 단계 회전 누적 + 입력이 같으면 이전 경로 재사용.
+ * @details
+ * 기존 calc_future_path()는 매 호출마다 tan 한 번과 단계마다 sin/cos를 계산했고, 속도/조향각이 그대로여도 다시 계산했습니다.
+ * 모델은 그대로 둡니다: 시작 위치 (0,0), 진행 방향 x축, 자전거 모델 원호 (곡률 k = tan(조향각) / 축거).
+ *
+ * - 곡률: 조향각 ±PATH_LUT_STEER_MAX_DEG 범위를 도당 PATH_LUT_STEPS_PER_DEG칸으로 나눈 표를 처음 쓸 때 한 번 만들고 선형 보간합니다.
+ *   tan은 이 범위에서 매끄러워 보간 오차는 곡률의 1e-6배 미만입니다. 범위를 넘는 각도만 tan을 직접 계산합니다.
+ * - 위치: i번째 점의 회전각은 한 단계 회전각 d = v * PREDICTION_DT * 곡률의 (i+1)배이므로, cos/sin(d)를 한 번 구해
+ *   회전을 곱해 나갑니다. x = sin(theta) / 곡률, y = (1 - cos(theta)) / 곡률 로 기존 식과 같습니다.
+ * - 캐시: 속도(km/h 정수)와 불감대를 적용한 조향각이 지난번과 같으면 계산하지 않습니다.
+ *   정지(0 km/h)면 조향각과 무관하게 모든 점이 (0,0)이므로 조향각을 키에서 뺍니다.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "hardware.h"
+
+#define PATH_LUT_SIZE (2 * PATH_LUT_STEER_MAX_DEG * PATH_LUT_STEPS_PER_DEG + 1)
+
+static double s_curv[PATH_LUT_SIZE]; // s_curv[i]: 조향각 (i / PATH_LUT_STEPS_PER_DEG - MAX)도의 곡률
+static pthread_once_t s_lut_once = PTHREAD_ONCE_INIT;
+
+static void path_lut_build(void) {
+    for (int i = 0; i < PATH_LUT_SIZE; i++) {
+        double deg = (double)i / PATH_LUT_STEPS_PER_DEG - PATH_LUT_STEER_MAX_DEG;
+        s_curv[i] = tan(deg * (M_PI / 180.0)) / VEHICLE_WHEELBASE;
+    }
+}
+
+/**
+ * @brief 바퀴 조향각(도)의 자전거 모델 곡률(1/m, 왼쪽 +)을 표에서 보간합니다.
+ */
+double path_curvature(float steer_deg) {
+    pthread_once(&s_lut_once, path_lut_build);
+
+    double pos = ((double)steer_deg + PATH_LUT_STEER_MAX_DEG) * PATH_LUT_STEPS_PER_DEG;
+    if (!(pos >= 0.0 && pos <= PATH_LUT_SIZE - 1)) {
+        return tan((double)steer_deg * (M_PI / 180.0)) / VEHICLE_WHEELBASE; // 표 밖 (NaN 포함)
+    }
+    int i = (int)pos;
+    if (i >= PATH_LUT_SIZE - 1) return s_curv[PATH_LUT_SIZE - 1];
+    double f = pos - i;
+    return s_curv[i] + (s_curv[i + 1] - s_curv[i]) * f;
+}
+
+void path_cache_init(PathCache* cache) {
+    if (!cache) return;
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * @brief 현재 속도/바퀴 조향각의 예상 경로를 cache->x/y에 채웁니다. (입력이 지난번과 같으면 그대로 둠)
+ * @return 1=새로 계산, 0=이전 경로 재사용, -1=인자 오류
+ */
+int path_predict(PathCache* cache, int speed_kph, float steer_deg) {
+    if (!cache) return -1;
+
+    // 각도가 너무 작으면(직진) 0으로 처리 (노이즈 제거), 정지면 경로가 (0,0)뿐이므로 조향각 무시
+    if (fabsf(steer_deg) < PATH_STEER_DEADBAND_DEG || speed_kph == 0) steer_deg = 0.0f;
+
+    if (cache->valid && cache->speed_kph == speed_kph && cache->steer_deg == steer_deg) {
+        cache->reused++;
+        return 0;
+    }
+
+    double v_mps = (double)speed_kph * KPH_TO_MPS;
+    if (steer_deg == 0.0f) {
+        // [직진일 때]
+        for (int i = 0; i < POS_COUNT; i++) {
+            cache->x[i] = v_mps * (i + 1) * PREDICTION_DT;
+            cache->y[i] = 0.0;
+        }
+    } else {
+        // [곡선일 때: 자전거 모델] 한 단계 회전 (c1, s1)을 곱해 나감
+        double k = path_curvature(steer_deg);
+        double R = 1.0 / k;
+        double d = v_mps * PREDICTION_DT * k;
+        double c1 = cos(d), s1 = sin(d);
+        double c = c1, s = s1;
+        for (int i = 0; i < POS_COUNT; i++) {
+            cache->x[i] = R * s;
+            cache->y[i] = R * (1.0 - c);
+            double cn = c * c1 - s * s1;
+            s = s * c1 + c * s1;
+            c = cn;
+        }
+    }
+
+    cache->speed_kph = speed_kph;
+    cache->steer_deg = steer_deg;
+    cache->valid = 1;
+    cache->computed++;
+    return 1;
+}
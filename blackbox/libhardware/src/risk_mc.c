@@ -0,0 +1,398 @@
+/**
+ * @file risk_mc.c
+ * @brief 몬테카를로 충돌 확률: 조향/가감속 가설 × 객체 속도 오차를 작업 스레드 풀에서 SIMD로 평가합니다.
+ * @details
+ * calc_future_path()/TTC는 지금 속도와 조향각으로 원호 하나만 보므로, 운전자가 조금만 더 꺾거나 브레이크를 밟아도
+ * 결과가 0 아니면 1로 뒤집힙니다. 여기서는 가설마다 바퀴 조향각(+N(0, σ_steer)), 가감속(N(0, σ_a)),
+ * 객체 속도 오차(축별 N(0, σ_v))를 뽑아 RISK_MC_DT 간격으로 차량 박스(진행 방향으로 회전)와 객체 원이 닿는지 보고,
+ * 닿은 가설의 비율을 객체별 확률로 냅니다.
+ *
+ * 작업 분배: 가설을 RISK_MC_CHUNK개 묶음으로 나누고, 풀의 작업 스레드와 호출 스레드가 원자 카운터로 묶음을 하나씩 가져갑니다.
+ * 묶음 안에서는 가설 궤적(위치/방향)을 먼저 펼쳐 두고, 객체마다 가설 여러 개를 SIMD 레인 하나씩에 담아 시간 단계를 돕니다.
+ * 시간 예산이 지나면 새 묶음을 가져가지 않으므로(진행 중인 묶음은 끝냄) 사이클당 시간이 예산 + 묶음 하나로 묶입니다.
+ * 난수는 묶음 번호로 시드를 정하므로, 같은 입력이면 스레드 수와 상관없이 같은 묶음은 같은 가설을 씁니다.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MC_KERNEL_NEON 1
+#define MC_LANES 4
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define MC_KERNEL_AVX 1
+#define MC_LANES 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MC_KERNEL_SSE 1
+#define MC_LANES 4
+#else
+#define MC_LANES 1
+#endif
+
+#include "hardware.h"
+
+// --- 커널용 최소 SIMD 연산 (레인 = 가설) ---
+#if defined(MC_KERNEL_NEON)
+typedef float32x4_t vf;
+typedef uint32x4_t vm;
+static inline vf vf_set(float a)        { return vdupq_n_f32(a); }
+static inline vf vf_load(const float* p) { return vld1q_f32(p); }
+static inline vf vf_add(vf a, vf b)     { return vaddq_f32(a, b); }
+static inline vf vf_sub(vf a, vf b)     { return vsubq_f32(a, b); }
+static inline vf vf_mul(vf a, vf b)     { return vmulq_f32(a, b); }
+static inline vf vf_max(vf a, vf b)     { return vmaxq_f32(a, b); }
+static inline vf vf_abs(vf a)           { return vabsq_f32(a); }
+static inline vm vm_le(vf a, vf b)      { return vcleq_f32(a, b); }
+static inline vm vm_or(vm a, vm b)      { return vorrq_u32(a, b); }
+static inline vm vm_none(void)          { return vdupq_n_u32(0); }
+static inline int vm_count(vm m)        { return (int)vaddvq_u32(vshrq_n_u32(m, 31)); }
+#elif defined(MC_KERNEL_AVX)
+typedef __m256 vf;
+typedef __m256 vm;
+static inline vf vf_set(float a)        { return _mm256_set1_ps(a); }
+static inline vf vf_load(const float* p) { return _mm256_load_ps(p); }
+static inline vf vf_add(vf a, vf b)     { return _mm256_add_ps(a, b); }
+static inline vf vf_sub(vf a, vf b)     { return _mm256_sub_ps(a, b); }
+static inline vf vf_mul(vf a, vf b)     { return _mm256_mul_ps(a, b); }
+static inline vf vf_max(vf a, vf b)     { return _mm256_max_ps(a, b); }
+static inline vf vf_abs(vf a)           { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline vm vm_le(vf a, vf b)      { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline vm vm_or(vm a, vm b)      { return _mm256_or_ps(a, b); }
+static inline vm vm_none(void)          { return _mm256_setzero_ps(); }
+static inline int vm_count(vm m)        { return __builtin_popcount((unsigned)_mm256_movemask_ps(m)); }
+#elif defined(MC_KERNEL_SSE)
+typedef __m128 vf;
+typedef __m128 vm;
+static inline vf vf_set(float a)        { return _mm_set1_ps(a); }
+static inline vf vf_load(const float* p) { return _mm_load_ps(p); }
+static inline vf vf_add(vf a, vf b)     { return _mm_add_ps(a, b); }
+static inline vf vf_sub(vf a, vf b)     { return _mm_sub_ps(a, b); }
+static inline vf vf_mul(vf a, vf b)     { return _mm_mul_ps(a, b); }
+static inline vf vf_max(vf a, vf b)     { return _mm_max_ps(a, b); }
+static inline vf vf_abs(vf a)           { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline vm vm_le(vf a, vf b)      { return _mm_cmple_ps(a, b); }
+static inline vm vm_or(vm a, vm b)      { return _mm_or_ps(a, b); }
+static inline vm vm_none(void)          { return _mm_setzero_ps(); }
+static inline int vm_count(vm m)        { return __builtin_popcount((unsigned)_mm_movemask_ps(m)); }
+#else
+typedef float vf;
+typedef int vm;
+static inline vf vf_set(float a)        { return a; }
+static inline vf vf_load(const float* p) { return *p; }
+static inline vf vf_add(vf a, vf b)     { return a + b; }
+static inline vf vf_sub(vf a, vf b)     { return a - b; }
+static inline vf vf_mul(vf a, vf b)     { return a * b; }
+static inline vf vf_max(vf a, vf b)     { return a > b ? a : b; }
+static inline vf vf_abs(vf a)           { return fabsf(a); }
+static inline vm vm_le(vf a, vf b)      { return a <= b; }
+static inline vm vm_or(vm a, vm b)      { return a | b; }
+static inline vm vm_none(void)          { return 0; }
+static inline int vm_count(vm m)        { return m; }
+#endif
+
+// 묶음 하나의 가설 궤적 (시간 단계 × 가설, 가설 방향이 연속이라 SIMD 로드 한 번에 레인이 채워짐)
+typedef struct {
+    float cx[RISK_MC_MAX_STEPS][RISK_MC_CHUNK] __attribute__((aligned(32)));
+    float cy[RISK_MC_MAX_STEPS][RISK_MC_CHUNK] __attribute__((aligned(32)));
+    float c[RISK_MC_MAX_STEPS][RISK_MC_CHUNK] __attribute__((aligned(32)));
+    float s[RISK_MC_MAX_STEPS][RISK_MC_CHUNK] __attribute__((aligned(32)));
+    float dvx[RISK_MC_CHUNK] __attribute__((aligned(32)));
+    float dvy[RISK_MC_CHUNK] __attribute__((aligned(32)));
+    float travel;           // 묶음 안 가설 중 가장 먼 이동 거리 (먼 객체 제외용)
+    float dv_max;           // 묶음 안 가장 큰 객체 속도 오차
+} McChunk;
+
+// 사이클 하나의 작업 (호출 스레드가 채우고 작업 스레드는 읽기만)
+typedef struct {
+    const CollBatch* batch;
+    double v0;              // 차량 속도 (m/s)
+    double steer_deg;       // 바퀴 조향각
+    int steps;
+    double deadline;        // now_sec 기준
+    int chunks;
+    uint64_t seed;
+} McJob;
+
+static pthread_t s_workers[RISK_MC_MAX_WORKERS];
+static int s_num_workers = 0;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_job_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t s_done_cv = PTHREAD_COND_INITIALIZER;
+static unsigned int s_job_gen = 0;      // 새 작업마다 증가
+static unsigned int s_start_gen = 0;    // 풀을 시작할 때의 s_job_gen (다시 시작해도 지난 작업을 하지 않게)
+static int s_busy = 0;                  // 아직 끝나지 않은 작업 스레드 수
+static int s_quit = 0;
+static McJob s_job;
+static atomic_int s_next_chunk;
+static atomic_int s_done_chunks;
+static atomic_int s_threads_used;
+
+// 스레드별 객체 충돌 횟수 (마지막 칸은 호출 스레드)
+static int* s_hits[RISK_MC_MAX_WORKERS + 1];
+static int s_hits_cap = 0;
+static McChunk* s_caller_chunk = NULL;  // 호출 스레드용 묶음 버퍼
+static uint64_t s_cycle = 0;
+
+// splitmix64: 묶음마다 독립된 난수열
+static inline uint64_t mc_rand(uint64_t* st) {
+    uint64_t z = (*st += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline double mc_uniform(uint64_t* st) {
+    return ((double)(mc_rand(st) >> 11) + 0.5) * (1.0 / 9007199254740992.0); // (0, 1)
+}
+
+// 표준 정규분포 두 개 (Box-Muller)
+static inline void mc_gauss2(uint64_t* st, double* a, double* b) {
+    double r = sqrt(-2.0 * log(mc_uniform(st)));
+    double th = 2.0 * M_PI * mc_uniform(st);
+    *a = r * cos(th);
+    *b = r * sin(th);
+}
+
+// 묶음 번호의 가설들을 뽑아 시간 단계별 차량 위치/방향을 펼침
+static void mc_build_chunk(const McJob* job, int chunk, McChunk* ck) {
+    uint64_t st = job->seed ^ ((uint64_t)chunk * 0xD1B54A32D192ED03ull);
+    ck->travel = 0.0f;
+    ck->dv_max = 0.0f;
+
+    for (int h = 0; h < RISK_MC_CHUNK; h++) {
+        double g_steer, g_acc, g_vx, g_vy;
+        mc_gauss2(&st, &g_steer, &g_acc);
+        mc_gauss2(&st, &g_vx, &g_vy);
+        double steer = job->steer_deg + g_steer * RISK_MC_STEER_SIGMA_DEG;
+        double acc = g_acc * RISK_MC_ACCEL_SIGMA;
+        ck->dvx[h] = (float)(g_vx * RISK_MC_OBJ_VEL_SIGMA);
+        ck->dvy[h] = (float)(g_vy * RISK_MC_OBJ_VEL_SIGMA);
+        float dv = sqrtf(ck->dvx[h] * ck->dvx[h] + ck->dvy[h] * ck->dvy[h]);
+        if (dv > ck->dv_max) ck->dv_max = dv;
+
+        // calc_future_path와 같은 직진 판정/자전거 모델, 감속 가설은 멈춘 뒤 그 자리에 섬
+        double inv_R = (fabs(steer) < 0.5) ? 0.0 : tan(steer * (M_PI / 180.0)) / VEHICLE_WHEELBASE;
+        double t_stop = (acc < 0.0) ? -job->v0 / acc : INFINITY;
+        double dist = 0.0;
+        for (int k = 0; k < job->steps; k++) {
+            double t = (k + 1) * RISK_MC_DT;
+            if (t > t_stop) t = t_stop;
+            dist = job->v0 * t + 0.5 * acc * t * t;
+            if (inv_R == 0.0) {
+                ck->cx[k][h] = (float)dist;
+                ck->cy[k][h] = 0.0f;
+                ck->c[k][h] = 1.0f;
+                ck->s[k][h] = 0.0f;
+            } else {
+                double th = dist * inv_R;
+                double sn = sin(th), cs = cos(th);
+                ck->cx[k][h] = (float)(sn / inv_R);
+                ck->cy[k][h] = (float)((1.0 - cs) / inv_R);
+                ck->c[k][h] = (float)cs;
+                ck->s[k][h] = (float)sn;
+            }
+        }
+        if (dist > ck->travel) ck->travel = (float)dist;
+    }
+}
+
+// 묶음 하나: 객체마다 닿은 가설 수를 hits에 더함
+static void mc_eval_chunk(const McJob* job, const McChunk* ck, int* hits) {
+    const CollBatch* b = job->batch;
+    const float hl = (float)(VEHICLE_LENGTH / 2.0), hw = (float)(VEHICLE_WIDTH / 2.0);
+    const float r2 = (float)(COLL_OBJ_RADIUS * COLL_OBJ_RADIUS);
+    const float rho = sqrtf(hl * hl + hw * hw);
+    const float horizon = (float)(job->steps * RISK_MC_DT);
+    const vf v_hl = vf_set(hl), v_hw = vf_set(hw), v_r2 = vf_set(r2), zero = vf_set(0.0f);
+
+    for (int i = 0; i < b->count; i++) {
+        float x = b->x[i], y = b->y[i], vx = b->vx[i], vy = b->vy[i];
+        // 이 묶음의 어느 가설로도 닿을 수 없는 객체는 건너뜀
+        float reach = ck->travel + (sqrtf(vx * vx + vy * vy) + ck->dv_max) * horizon + rho + (float)COLL_OBJ_RADIUS;
+        if (x * x + y * y > reach * reach) continue;
+
+        int n = 0;
+        for (int h = 0; h < RISK_MC_CHUNK; h += MC_LANES) {
+            vf ovx = vf_add(vf_set(vx), vf_load(&ck->dvx[h]));
+            vf ovy = vf_add(vf_set(vy), vf_load(&ck->dvy[h]));
+            vm hit = vm_none();
+            for (int k = 0; k < job->steps; k++) {
+                vf t = vf_set((float)((k + 1) * RISK_MC_DT));
+                vf dx = vf_sub(vf_add(vf_set(x), vf_mul(ovx, t)), vf_load(&ck->cx[k][h]));
+                vf dy = vf_sub(vf_add(vf_set(y), vf_mul(ovy, t)), vf_load(&ck->cy[k][h]));
+                vf c = vf_load(&ck->c[k][h]), s = vf_load(&ck->s[k][h]);
+                // 차량 좌표계로 회전 후 박스까지 거리²
+                vf ex = vf_max(vf_sub(vf_abs(vf_add(vf_mul(c, dx), vf_mul(s, dy))), v_hl), zero);
+                vf ey = vf_max(vf_sub(vf_abs(vf_sub(vf_mul(c, dy), vf_mul(s, dx))), v_hw), zero);
+                hit = vm_or(hit, vm_le(vf_add(vf_mul(ex, ex), vf_mul(ey, ey)), v_r2));
+            }
+            n += vm_count(hit);
+        }
+        hits[i] += n;
+    }
+}
+
+static McChunk* mc_chunk_alloc(void) {
+    void* p = NULL;
+    return (posix_memalign(&p, 32, sizeof(McChunk)) == 0) ? p : NULL; // 스택에 두기엔 큼
+}
+
+// 예산이 남아 있는 동안 묶음을 하나씩 가져가 계산
+static void mc_run(int slot, McChunk* ck) {
+    if (!ck) return;
+    int used = 0;
+    while (now_sec() < s_job.deadline) {
+        int chunk = atomic_fetch_add(&s_next_chunk, 1);
+        if (chunk >= s_job.chunks) break;
+        mc_build_chunk(&s_job, chunk, ck);
+        mc_eval_chunk(&s_job, ck, s_hits[slot]);
+        atomic_fetch_add(&s_done_chunks, 1);
+        used = 1;
+    }
+    if (used) atomic_fetch_add(&s_threads_used, 1);
+}
+
+static void* mc_worker_main(void* arg) {
+    int slot = (int)(intptr_t)arg;
+    McChunk* ck = mc_chunk_alloc();   // 실패하면 이 스레드는 작업을 가져가지 않음 (다른 스레드가 처리)
+
+    pthread_mutex_lock(&s_lock);
+    unsigned int seen = s_start_gen;
+    for (;;) {
+        while (s_job_gen == seen && !s_quit) pthread_cond_wait(&s_job_cv, &s_lock);
+        if (s_quit) break;
+        seen = s_job_gen;
+        pthread_mutex_unlock(&s_lock);
+
+        mc_run(slot, ck);
+
+        pthread_mutex_lock(&s_lock);
+        if (--s_busy == 0) pthread_cond_signal(&s_done_cv);
+    }
+    pthread_mutex_unlock(&s_lock);
+    free(ck);
+    return NULL;
+}
+
+/**
+ * @brief 작업 스레드 풀을 시작합니다. 실패해도 risk_mc_eval은 0을 돌려줄 뿐이므로 호출 쪽은 TTC만으로 동작할 수 있습니다.
+ * @param workers 작업 스레드 수 (0 이하면 RISK_MC_WORKERS, 최대 RISK_MC_MAX_WORKERS).
+ * @return 0: 성공, -1: 스레드 생성 실패.
+ */
+int risk_mc_start(int workers) {
+    if (s_num_workers > 0) return 0;
+    if (workers <= 0) workers = RISK_MC_WORKERS;
+    if (workers > RISK_MC_MAX_WORKERS) workers = RISK_MC_MAX_WORKERS;
+
+    s_caller_chunk = mc_chunk_alloc();
+    if (!s_caller_chunk) return -1;
+    pthread_mutex_lock(&s_lock);
+    s_quit = 0;
+    s_start_gen = s_job_gen;
+    pthread_mutex_unlock(&s_lock);
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&s_workers[i], NULL, mc_worker_main, (void*)(intptr_t)i) != 0) {
+            perror("[RISK] pthread_create");
+            risk_mc_stop();
+            return -1;
+        }
+        s_num_workers = i + 1;
+    }
+    return 0;
+}
+
+// 스레드별 충돌 횟수 배열을 n개 이상으로
+static int mc_reserve_hits(int n) {
+    if (n <= s_hits_cap) return 0;
+    int cap = s_hits_cap > 0 ? s_hits_cap : 64;
+    while (cap < n) cap *= 2;
+    for (int w = 0; w <= RISK_MC_MAX_WORKERS; w++) {
+        int* p = realloc(s_hits[w], sizeof(int) * (size_t)cap);
+        if (!p) return -1;
+        s_hits[w] = p;
+    }
+    s_hits_cap = cap;
+    return 0;
+}
+
+/**
+ * @brief coll_batch_load로 적재한 객체마다 충돌 확률(batch->prob)을 구합니다. 호출 스레드도 계산에 참여하며, 끝날 때까지 블록됩니다.
+ * @param speed_kph, steer_deg 가설의 기준이 되는 차량 상태 (calc_future_path와 같은 입력).
+ * @param budget_sec 시간 예산 (0 이하면 RISK_MC_BUDGET_SEC). 예산이 지나면 남은 가설은 평가하지 않습니다.
+ * @param stats 통계 (NULL 가능).
+ * @return 평가한 가설 수 (확률의 분모), 풀이 없거나 객체가 없으면 0.
+ */
+int risk_mc_eval(CollBatch* batch, int speed_kph, float steer_deg, double budget_sec, RiskMcStats* stats) {
+    double t0 = now_sec();
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!batch || batch->count <= 0 || s_num_workers <= 0) return 0;
+    if (mc_reserve_hits(batch->count) < 0) return 0;
+    for (int w = 0; w <= s_num_workers; w++) memset(s_hits[w], 0, sizeof(int) * (size_t)batch->count);
+
+    double v0 = (double)speed_kph * KPH_TO_MPS;
+    int steps = (int)(ttc_horizon(v0) / RISK_MC_DT + 0.5);
+    if (steps > RISK_MC_MAX_STEPS) steps = RISK_MC_MAX_STEPS;
+    if (steps < 1) steps = 1;
+
+    pthread_mutex_lock(&s_lock);
+    s_job.batch = batch;
+    s_job.v0 = v0;
+    s_job.steer_deg = steer_deg;
+    s_job.steps = steps;
+    s_job.deadline = t0 + (budget_sec > 0.0 ? budget_sec : RISK_MC_BUDGET_SEC);
+    s_job.chunks = RISK_MC_SAMPLES / RISK_MC_CHUNK;
+    s_job.seed = 0x5DEECE66Dull * ++s_cycle;
+    atomic_store(&s_next_chunk, 0);
+    atomic_store(&s_done_chunks, 0);
+    atomic_store(&s_threads_used, 0);
+    s_busy = s_num_workers;
+    s_job_gen++;
+    pthread_cond_broadcast(&s_job_cv);
+    pthread_mutex_unlock(&s_lock);
+
+    mc_run(s_num_workers, s_caller_chunk); // 호출 스레드는 마지막 칸
+
+    pthread_mutex_lock(&s_lock);
+    while (s_busy > 0) pthread_cond_wait(&s_done_cv, &s_lock);
+    pthread_mutex_unlock(&s_lock);
+
+    int samples = atomic_load(&s_done_chunks) * RISK_MC_CHUNK;
+    for (int i = 0; i < batch->count; i++) {
+        int h = 0;
+        for (int w = 0; w <= s_num_workers; w++) h += s_hits[w][i];
+        batch->prob[i] = samples > 0 ? (float)h / (float)samples : 0.0f;
+    }
+    if (stats) {
+        stats->samples = samples;
+        stats->threads = atomic_load(&s_threads_used);
+        stats->elapsed = now_sec() - t0;
+    }
+    return samples;
+}
+
+/**
+ * @brief 작업 스레드를 모두 끝내고 버퍼를 해제합니다.
+ */
+void risk_mc_stop(void) {
+    pthread_mutex_lock(&s_lock);
+    s_quit = 1;
+    pthread_cond_broadcast(&s_job_cv);
+    pthread_mutex_unlock(&s_lock);
+    for (int i = 0; i < s_num_workers; i++) pthread_join(s_workers[i], NULL);
+    s_num_workers = 0;
+    for (int w = 0; w <= RISK_MC_MAX_WORKERS; w++) {
+        free(s_hits[w]);
+        s_hits[w] = NULL;
+    }
+    s_hits_cap = 0;
+    free(s_caller_chunk);
+    s_caller_chunk = NULL;
+}
@@ -0,0 +1,258 @@
+/**
+ * @file signal_store.c
+ * @brief VehicleData 값마다 수신 시각과 허용 지연(staleness budget)을 관리하는 신호 저장소.
+ * @details
+ * 기존 main.c는 state_flag/state_flag2 비트가 모두 모일 때까지 기다렸다가 한꺼번에 지웠기 때문에,
+ * 응답이 느린 PID 하나가 전체 위험 평가를 지연시켰습니다.
+ * 신호 저장소는 값마다 "언제 받았는지"를 기록해 두고, 사용하는 쪽이 자기에게 필요한 신호만
+ * 허용 지연 이내인지 확인하게 합니다. 수집 스레드는 같은 기준으로 stale해질 신호만 다시 요청합니다.
+ */
+
+#include <string.h>
+#include "hardware.h"
+
+// 받은 적 없는 신호의 나이 (어떤 허용 지연보다도 큼)
+#define SIG_AGE_NEVER 1e9
+
+static const double k_default_budgets[SIG_COUNT] = {
+    [SIG_ENGINE_SPEED]  = SIG_BUDGET_FAST_SEC,
+    [SIG_VEHICLE_SPEED] = SIG_BUDGET_FAST_SEC,
+    [SIG_GEAR]          = SIG_BUDGET_GEAR_SEC,
+    [SIG_GPS_X]         = SIG_BUDGET_FAST_SEC,
+    [SIG_GPS_Y]         = SIG_BUDGET_FAST_SEC,
+    [SIG_STEERING]      = SIG_BUDGET_FAST_SEC,
+    [SIG_BRAKE]         = SIG_BUDGET_FAST_SEC,
+    [SIG_TIRE]          = SIG_BUDGET_TIRE_SEC,
+    [SIG_THROTTLE]      = SIG_BUDGET_FAST_SEC,
+};
+
+/**
+ * @brief 신호 저장소를 초기화합니다. 모든 신호는 "받은 적 없음" 상태가 됩니다.
+ * @param budgets 신호별 허용 지연(초) SIG_COUNT개. NULL이거나 0 이하인 항목은 기본값을 사용합니다.
+ */
+void sig_store_init(SignalStore* store, const double* budgets) {
+    if (!store) return;
+    memset(store, 0, sizeof(*store));
+    for (int i = 0; i < SIG_COUNT; i++) {
+        double b = budgets ? budgets[i] : 0.0;
+        store->sig[i].budget = (b > 0.0) ? b : k_default_budgets[i];
+    }
+}
+
+/**
+ * @brief OBD-II PID를 신호 ID로 변환합니다.
+ * @return SignalId, 저장소에서 관리하지 않는 PID면 -1.
+ */
+int sig_from_pid(unsigned char pid) {
+    switch (pid) {
+        case PID_ENGINE_SPEED:  return SIG_ENGINE_SPEED;
+        case PID_VEHICLE_SPEED: return SIG_VEHICLE_SPEED;
+        case PID_GEAR_STATE:    return SIG_GEAR;
+        case PID_GPS_XDATA:     return SIG_GPS_X;
+        case PID_GPS_YDATA:     return SIG_GPS_Y;
+        case PID_STEERING_DATA: return SIG_STEERING;
+        case PID_BRAKE_DATA:    return SIG_BRAKE;
+        case PID_TIRE_DATA:     return SIG_TIRE;
+        case PID_THROTTLE_DATA: return SIG_THROTTLE;
+        default:                return -1;
+    }
+}
+
+/**
+ * @brief PID 값을 받았음을 기록합니다. 값 자체는 can_parse_response()가 store->data에 이미 써 둔 상태여야 합니다.
+ * @param timestamp 응답 프레임 수신 시각 (CANMessage.timestamp).
+ */
+void sig_store_touch(SignalStore* store, unsigned char pid, double timestamp) {
+    if (!store) return;
+    int id = sig_from_pid(pid);
+    if (id < 0) return;
+    // 재정렬된 프레임이 더 최근 값을 과거 시각으로 덮지 않게 함
+    if (timestamp > store->sig[id].timestamp) store->sig[id].timestamp = timestamp;
+    store->sig[id].updates++;
+}
+
+/**
+ * @brief 신호의 나이(now - 마지막 수신 시각)를 반환합니다.
+ * @return 초 단위 나이, 받은 적 없으면 매우 큰 값.
+ */
+double sig_store_age(const SignalStore* store, SignalId id, double now) {
+    if (!store || id < 0 || id >= SIG_COUNT) return SIG_AGE_NEVER;
+    double ts = store->sig[id].timestamp;
+    if (ts <= 0.0) return SIG_AGE_NEVER;
+    double age = now - ts;
+    return (age < 0.0) ? 0.0 : age;
+}
+
+/**
+ * @brief 신호가 허용 지연 이내인지 확인합니다.
+ * @return 1: 신선함, 0: stale 또는 받은 적 없음.
+ */
+int sig_store_fresh(const SignalStore* store, SignalId id, double now) {
+    if (!store || id < 0 || id >= SIG_COUNT) return 0;
+    return sig_store_age(store, id, now) <= store->sig[id].budget;
+}
+
+/**
+ * @brief 현재 신선한 신호들을 SIG_MASK 비트 합으로 반환합니다.
+ */
+unsigned int sig_store_fresh_mask(const SignalStore* store, double now) {
+    unsigned int mask = 0;
+    for (int i = 0; i < SIG_COUNT; i++) {
+        if (sig_store_fresh(store, (SignalId)i, now)) mask |= SIG_MASK(i);
+    }
+    return mask;
+}
+
+/**
+ * @brief mask에 포함된 신호가 모두 신선한지 확인합니다.
+ * @return 1: 모두 신선함, 0: 하나라도 stale.
+ */
+int sig_store_fresh_all(const SignalStore* store, unsigned int mask, double now) {
+    return (sig_store_fresh_mask(store, now) & mask) == mask;
+}
+
+// --- 신호 이력 ---
+// 기어/타이어처럼 여러 필드로 된 신호는 정수 하나로 묶어 double에 정확히 담습니다 (보간하지 않음).
+
+static int sig_is_step(int id) {
+    return id == SIG_GEAR || id == SIG_TIRE;
+}
+
+static double sig_value(const VehicleData* d, int id) {
+    switch (id) {
+        case SIG_ENGINE_SPEED:  return d->rpm;
+        case SIG_VEHICLE_SPEED: return d->speed;
+        case SIG_GEAR: {
+            // 기어비(1/1000 단위) * 256 + 기어 상태 문자
+            long ratio = (long)(d->gear_ratio * 1000.0f + 0.5f);
+            if (ratio < 0) ratio = 0;
+            return (double)ratio * 256.0 + (unsigned char)d->gear_state;
+        }
+        case SIG_GPS_X:         return d->gps_x;
+        case SIG_GPS_Y:         return d->gps_y;
+        case SIG_STEERING:      return d->degree;
+        case SIG_BRAKE:         return d->brake_state;
+        case SIG_TIRE:
+            return (double)((unsigned int)d->tire_pressure[0] | ((unsigned int)d->tire_pressure[1] << 8) |
+                            ((unsigned int)d->tire_pressure[2] << 16) | ((unsigned int)d->tire_pressure[3] << 24));
+        case SIG_THROTTLE:      return d->throttle;
+        default:                return 0.0;
+    }
+}
+
+static int round_int(double v) {
+    return (int)(v < 0.0 ? v - 0.5 : v + 0.5);
+}
+
+static void sig_apply(VehicleData* d, int id, double v) {
+    switch (id) {
+        case SIG_ENGINE_SPEED:  d->rpm = round_int(v); break;
+        case SIG_VEHICLE_SPEED: d->speed = round_int(v); break;
+        case SIG_GEAR: {
+            unsigned long packed = (unsigned long)v;
+            d->gear_state = (char)(packed & 0xFFu);
+            d->gear_ratio = (float)(packed >> 8) / 1000.0f;
+            break;
+        }
+        case SIG_GPS_X:         d->gps_x = v; break;
+        case SIG_GPS_Y:         d->gps_y = v; break;
+        case SIG_STEERING:      d->degree = (float)v; break;
+        case SIG_BRAKE:         d->brake_state = (unsigned char)round_int(v); break;
+        case SIG_TIRE: {
+            unsigned int packed = (unsigned int)v;
+            for (int k = 0; k < 4; k++) d->tire_pressure[k] = (unsigned char)(packed >> (8 * k));
+            break;
+        }
+        case SIG_THROTTLE:      d->throttle = (unsigned char)round_int(v); break;
+        default: break;
+    }
+}
+
+// k번째로 오래된 샘플 (0 = 가장 오래된 것)
+static const SignalSample* hist_sample(const SignalHistory* hist, int id, unsigned int k) {
+    unsigned int first = hist->head[id] - hist->count[id];
+    return &hist->s[id][(first + k) & (SIG_HIST_LEN - 1)];
+}
+
+/**
+ * @brief 신호 이력을 비웁니다.
+ */
+void sig_hist_init(SignalHistory* hist) {
+    if (!hist) return;
+    memset(hist, 0, sizeof(*hist));
+}
+
+/**
+ * @brief 저장소에서 수신 시각이 마지막 기록보다 새로워진 신호의 값을 이력에 추가합니다.
+ * @details 수집 스레드의 스냅샷을 받을 때마다 호출하세요. 스냅샷 사이에 같은 신호가 여러 번 갱신됐다면
+ *          마지막 값만 남지만, 스냅샷은 제어 주기(20ms)보다 자주 오므로 보간 정확도에는 영향이 작습니다.
+ * @return 추가한 샘플 수.
+ */
+int sig_hist_record(SignalHistory* hist, const SignalStore* store) {
+    if (!hist || !store) return 0;
+    int added = 0;
+    for (int id = 0; id < SIG_COUNT; id++) {
+        double t = store->sig[id].timestamp;
+        if (t <= 0.0) continue;
+        if (hist->count[id] > 0 && t <= hist_sample(hist, id, hist->count[id] - 1)->t) continue;
+
+        SignalSample* s = &hist->s[id][hist->head[id] & (SIG_HIST_LEN - 1)];
+        s->t = t;
+        s->v = sig_value(&store->data, id);
+        hist->head[id]++;
+        if (hist->count[id] < SIG_HIST_LEN) hist->count[id]++;
+        added++;
+    }
+    return added;
+}
+
+/**
+ * @brief t 시각의 차량 상태를 이력으로 복원합니다.
+ * @details 연속 신호는 t를 사이에 둔 두 샘플로 선형 보간하고, 기어/타이어는 t 직전 샘플 값을 씁니다.
+ *          t가 이력보다 뒤면 마지막 값, 앞이면 가장 오래된 값을 씁니다 (외삽하지 않음).
+ * @param latest 이력이 없는 신호에 쓸 값 (보통 최신 스냅샷). NULL이면 0.
+ * @return t가 이력 구간(가장 오래된 샘플 ~ 마지막 샘플) 안에 있던 신호의 SIG_MASK 합.
+ */
+unsigned int sig_hist_at(const SignalHistory* hist, double t, const VehicleData* latest, VehicleData* out) {
+    if (!out) return 0;
+    if (latest) *out = *latest;
+    else memset(out, 0, sizeof(*out));
+    if (!hist) return 0;
+
+    unsigned int covered = 0;
+    for (int id = 0; id < SIG_COUNT; id++) {
+        unsigned int n = hist->count[id];
+        if (n == 0) continue;
+
+        const SignalSample* oldest = hist_sample(hist, id, 0);
+        const SignalSample* newest = hist_sample(hist, id, n - 1);
+        if (t >= newest->t) {
+            sig_apply(out, id, newest->v);
+            if (t == newest->t) covered |= SIG_MASK(id);
+            continue;
+        }
+        if (t <= oldest->t) {
+            sig_apply(out, id, oldest->v);
+            if (t == oldest->t) covered |= SIG_MASK(id);
+            continue;
+        }
+
+        // a->t <= t < b->t 인 마지막 a를 이분 탐색
+        unsigned int lo = 0, hi = n - 1;
+        while (hi - lo > 1) {
+            unsigned int mid = lo + (hi - lo) / 2;
+            if (hist_sample(hist, id, mid)->t <= t) lo = mid;
+            else hi = mid;
+        }
+        const SignalSample* a = hist_sample(hist, id, lo);
+        const SignalSample* b = hist_sample(hist, id, hi);
+        if (sig_is_step(id)) {
+            sig_apply(out, id, a->v);
+        } else {
+            double w = (t - a->t) / (b->t - a->t);
+            sig_apply(out, id, a->v + (b->v - a->v) * w);
+        }
+        covered |= SIG_MASK(id);
+    }
+    return covered;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file spsc.c
+ * @brief 단일 생산자/단일 소비자(SPSC) 락프리 링 버퍼.
+ * @details
+ * 생산자는 head만, 소비자는 tail만 갱신하므로 뮤텍스 없이 C11 원자 연산(acquire/release)만으로 동기화됩니다.
+ * 어느 쪽도 상대 스레드 때문에 잠들지 않으므로, CAN 수집 스레드처럼 지연에 민감한 생산자가
+ * 느린 소비자(제어 루프, AI 대기 등)에 묶이지 않습니다.
+ * head/tail은 서로 다른 캐시 라인에 두어 두 코어가 같은 라인을 번갈아 빼앗지 않게 합니다.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "hardware.h"
+
+#define SPSC_CACHE_LINE 64
+
+struct SpscRing {
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t head;  // 다음에 쓸 위치 (생산자만 갱신)
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t tail;  // 다음에 읽을 위치 (소비자만 갱신)
+    _Alignas(SPSC_CACHE_LINE) size_t mask;         // capacity - 1
+    size_t elem_size;
+    unsigned char* buf;
+};
+
+/**
+ * @brief 링을 생성합니다.
+ * @param elem_size 원소 하나의 크기(바이트).
+ * @param capacity 원소 수. 2의 거듭제곱으로 올림합니다.
+ * @return 성공 시 링 포인터, 실패 시 NULL.
+ */
+SpscRing* spsc_create(size_t elem_size, size_t capacity) {
+    if (elem_size == 0 || capacity == 0) return NULL;
+
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    SpscRing* ring = aligned_alloc(SPSC_CACHE_LINE, sizeof(SpscRing));
+    if (!ring) return NULL;
+    ring->buf = malloc(elem_size * cap);
+    if (!ring->buf) {
+        free(ring);
+        return NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->mask = cap - 1;
+    ring->elem_size = elem_size;
+    return ring;
+}
+
+void spsc_destroy(SpscRing* ring) {
+    if (!ring) return;
+    free(ring->buf);
+    free(ring);
+}
+
+/**
+ * @brief 원소 하나를 넣습니다. 생산자 스레드에서만 호출하세요.
+ * @return 0: 성공, -1: 링이 가득 참.
+ */
+int spsc_push(SpscRing* ring, const void* elem) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail > ring->mask) return -1;
+
+    memcpy(ring->buf + (head & ring->mask) * ring->elem_size, elem, ring->elem_size);
+    // 원소 복사가 끝난 뒤에 head를 공개해야 소비자가 덜 쓰인 원소를 읽지 않음
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * @brief 원소 하나를 꺼냅니다. 소비자 스레드에서만 호출하세요.
+ * @return 1: 꺼냄, 0: 비어 있음.
+ */
+int spsc_pop(SpscRing* ring, void* elem) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail == head) return 0;
+
+    memcpy(elem, ring->buf + (tail & ring->mask) * ring->elem_size, ring->elem_size);
+    // 복사가 끝난 뒤에 자리를 돌려줘야 생산자가 읽는 중인 칸을 덮어쓰지 않음
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * @brief 현재 들어 있는 원소 수 (다른 스레드가 동시에 움직이므로 근사값).
+ */
+size_t spsc_count(const SpscRing* ring) {
+    size_t head = atomic_load_explicit(&((SpscRing*)ring)->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&((SpscRing*)ring)->tail, memory_order_acquire);
+    return head - tail;
+}
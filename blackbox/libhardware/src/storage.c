@@ -1,11 +1,34 @@
-// storage.c
+/**
+ * @file storage.c
+ * @brief 녹화 엔진: 프로세스 안의 GStreamer 파이프라인으로 하드웨어 H.264 인코딩 → mp4 파일.
+ * @details
+ * 기존에는 녹화를 시작할 때마다 설정 파일을 다시 읽고 `sh -lc "exec gst-launch-1.0 ..."`를 fork/exec 했고
+ * (셸 + 프로세스 + 플러그인 로딩으로 시작이 느림), storage_write_frame()은 -38(미구현)이라 대시보드 녹화는 파이썬 OpenCV(mp4v)로 했습니다.
+ *
+ * - 설정: "record" 항목은 파일 mtime이 바뀌었을 때만 다시 파싱합니다.
+ * - GStreamer 초기화와 플러그인 등록은 처음 한 번뿐이고, 녹화 시작은 gst_parse_launch + PLAYING 전환만 하므로 수 ms입니다.
+ * - source "v4l2": v4l2src io-mode=dmabuf(형식은 설정 "format"으로 고정) → 변환기 → 인코더 입력 STORAGE_ENC_FORMAT → v4l2h264enc.
+ *   변환기는 v4l2convert(하드웨어)이고, 카메라 형식이 이미 STORAGE_ENC_FORMAT이면 통과만 하므로 dmabuf가 CPU 복사 없이 인코더로 갑니다
+ *   (인코더는 output-io-mode=dmabuf-import). 다른 형식이면 하드웨어 변환기가 바꿉니다.
+ *   v4l2convert가 없는 보드에서는 예전 파이프라인처럼 videoconvert로 바꾸고 인코더는 일반 메모리를 받습니다.
+ *   카메라가 "format"을 지원하지 않는 등 협상이 실패하면 버스 에러로 오므로, storage_poll()이 녹화를 내리고 알립니다.
+ * - source "appsrc": storage_write_frame()의 RGB24 프레임을 gst_buffer_new_wrapped_full()로 감싸 넣습니다 (복사 없음).
+ *   프레임은 인코더가 놓는 순간(버퍼 해제 알림) camera_release_frame()으로 해제됩니다.
+ *   RGB 행이 4바이트 정렬이 아니면(GStreamer 기본 stride와 다름) 그때만 행을 복사합니다.
+ *   캡스(크기)는 첫 프레임에서 정하고, 타임스탬프는 녹화 시작 이후 now_sec() 경과 시간입니다. 변환기/인코더 쪽은 v4l2와 같습니다.
+ *   지금 main이 넣는 프레임은 camera_get_frame() 스텁(검은 화면)뿐이라, 대시보드 합성 화면은 아직 이 엔진으로 녹화되지 않습니다.
+ * - 정지: storage_stop_recording()은 EOS만 보내고 바로 돌아옵니다 (제어 루프를 막지 않음).
+ *   mp4mux가 파일을 마무리해 EOS(또는 에러)가 버스에 오면, 또는 STORAGE_EOS_TIMEOUT_SEC가 지나면
+ *   storage_poll()이 파이프라인을 내립니다. 마무리가 끝나기 전에는 새 녹화를 시작하지 않습니다.
+ *   프로세스 종료 때만 storage_finish()로 마무리를 기다립니다.
+ */
+
 #include "hardware.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <signal.h>
-#include <sys/wait.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <libgen.h>
 #include <limits.h>
@@ -13,15 +36,33 @@
 #include <errno.h>
 #include "cJSON.h"
 
-static pid_t g_rec_pid = -1;
-static char  g_rec_target[PATH_MAX] = {0};
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
 
 static int   g_rec_w = 1280, g_rec_h = 720, g_rec_fps = 30, g_rec_bitrate = 4000000;
 static char  g_rec_device[64] = "/dev/video2";
 static char  g_rec_dir[PATH_MAX] = "/data/records";
+static char  g_rec_source[16] = "v4l2";
+static char  g_rec_format[16] = "YUY2";    // v4l2 소스 픽셀 형식 (GStreamer 이름)
+static time_t g_cfg_mtime = 0;
+
+static pthread_mutex_t g_rec_lock = PTHREAD_MUTEX_INITIALIZER;
+static GstElement* g_rec_pipeline = NULL;
+static GstElement* g_rec_appsrc = NULL;    // appsrc 모드일 때만
+static char  g_rec_target[PATH_MAX] = {0};
+static int   g_src_w = 0, g_src_h = 0;     // appsrc 캡스 (첫 프레임에서 정함)
+static double g_rec_t0 = 0.0;
+static int   g_inflight = 0;               // 인코더가 아직 놓지 않은 appsrc 프레임 수 (__atomic)
+static GstElement* g_fin_pipeline = NULL;  // EOS를 보내고 mp4 마무리를 기다리는 파이프라인
+static double g_fin_deadline = 0.0;        // 마무리 대기 제한 시각 (now_sec 기준)
 
+// mtime이 바뀌었을 때만 "record" 설정을 다시 읽음
 static void load_config_record(void) {
-    const char *path = "/etc/aiblackbox/config.json";
+    const char *path = STORAGE_CONFIG_PATH;
+    struct stat st;
+    if (stat(path, &st) != 0 || st.st_mtime == g_cfg_mtime) return;
+    g_cfg_mtime = st.st_mtime;
+
     FILE *fp = fopen(path, "rb"); if (!fp) return;
 
     if (fseek(fp, 0, SEEK_END) != 0) { fclose(fp); return; }
@@ -52,10 +93,15 @@ static void load_config_record(void) {
                 g_rec_bitrate = j->valueint;
             if((j=cJSON_GetObjectItemCaseSensitive(rec,"dir"))    && cJSON_IsString(j))
                 strncpy(g_rec_dir,j->valuestring,sizeof(g_rec_dir)-1);
+            if((j=cJSON_GetObjectItemCaseSensitive(rec,"source")) && cJSON_IsString(j))
+                strncpy(g_rec_source,j->valuestring,sizeof(g_rec_source)-1);
+            if((j=cJSON_GetObjectItemCaseSensitive(rec,"format")) && cJSON_IsString(j))
+                strncpy(g_rec_format,j->valuestring,sizeof(g_rec_format)-1);
         }
         cJSON_Delete(root);
     }
     free(buf);
+    if (g_rec_fps <= 0) g_rec_fps = 30;
 }
 
 static int ensure_parent_dir(const char *path){
@@ -69,11 +115,32 @@ static int ensure_parent_dir(const char *path){
     return (errno == EEXIST) ? 0 : -1;
 }
 
+// GStreamer 초기화는 프로세스에서 한 번 (cam_ingest와 같이 써도 gst_init_check는 중복 호출 안전)
+static int storage_gst_init(void) {
+    GError* err = NULL;
+    if (!gst_init_check(NULL, NULL, &err)) {
+        fprintf(stderr, "[REC] gst_init: %s\n", err ? err->message : "unknown error");
+        if (err) g_error_free(err);
+        return -1;
+    }
+    return 0;
+}
+
+// 하드웨어 변환기가 있으면 1 (없으면 videoconvert로 대신함)
+static int storage_has_v4l2convert(void) {
+    GstElementFactory* f = gst_element_factory_find("v4l2convert");
+    if (!f) return 0;
+    gst_object_unref(f);
+    return 1;
+}
+
 int storage_start_recording(const char* filename)
 {
-    if (g_rec_pid > 0) return -1; // already recording
+    pthread_mutex_lock(&g_rec_lock);
+    if (g_rec_pipeline || g_fin_pipeline) { pthread_mutex_unlock(&g_rec_lock); return -1; } // 녹화 중 또는 이전 파일 마무리 중
 
     load_config_record();
+    if (storage_gst_init() < 0) { pthread_mutex_unlock(&g_rec_lock); return -1; }
 
     // 최종 파일 경로 결정
     if (filename && filename[0]) {
@@ -86,45 +153,250 @@ int storage_start_recording(const char* filename)
                  g_rec_dir, tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday,
                  tm.tm_hour, tm.tm_min, tm.tm_sec);
     }
-    if (ensure_parent_dir(g_rec_target) < 0) return -1;
+    if (ensure_parent_dir(g_rec_target) < 0) { pthread_mutex_unlock(&g_rec_lock); return -1; }
 
-    // GStreamer 파이프라인 (하드웨어 인코더 우선)
-    char cmd[2048];
-    int n = snprintf(cmd, sizeof(cmd),
-        "exec gst-launch-1.0 -e "
-        "v4l2src device=%s io-mode=2 ! "
-        "video/x-raw,width=%d,height=%d,framerate=%d/1 ! "
-        "videoconvert ! "
-        "v4l2h264enc extra-controls=controls,video_bitrate_mode=1,video_bitrate=%d ! "
+    // 파이프라인: 소스만 다르고 변환기 → 하드웨어 인코더 → mp4는 같음
+    const int use_appsrc = (strcmp(g_rec_source, "appsrc") == 0);
+    const int hw_convert = storage_has_v4l2convert();
+    char src[256];
+    if (use_appsrc) {
+        snprintf(src, sizeof(src), "appsrc name=src is-live=true format=time do-timestamp=false");
+    } else {
+        snprintf(src, sizeof(src),
+            "v4l2src device=%s io-mode=dmabuf ! video/x-raw,format=%s,width=%d,height=%d,framerate=%d/1",
+            g_rec_device, g_rec_format, g_rec_w, g_rec_h, g_rec_fps);
+    }
+    char desc[2048];
+    int n = snprintf(desc, sizeof(desc),
+        "%s ! %s ! video/x-raw,format=%s ! "
+        "v4l2h264enc %s"
+        "extra-controls=controls,video_bitrate_mode=1,video_bitrate=%d ! "
         "h264parse ! mp4mux faststart=true ! "
-        "filesink location='%s' sync=false",
-        g_rec_device, g_rec_w, g_rec_h, g_rec_fps, g_rec_bitrate, g_rec_target);
-    if (n < 0 || (size_t)n >= sizeof(cmd)) return -1;
+        "filesink location=\"%s\" sync=false",
+        src, hw_convert ? "v4l2convert" : "videoconvert", STORAGE_ENC_FORMAT,
+        hw_convert ? "output-io-mode=dmabuf-import " : "",
+        g_rec_bitrate, g_rec_target);
+    if (n < 0 || (size_t)n >= sizeof(desc)) { pthread_mutex_unlock(&g_rec_lock); return -1; }
 
-    pid_t pid = fork();
-    if (pid < 0) return -1;
-    if (pid == 0) {
-        execl("/bin/sh","sh","-lc",cmd,(char*)NULL);
-        _exit(127);
+    GError* err = NULL;
+    GstElement* pipeline = gst_parse_launch(desc, &err);
+    if (!pipeline || err) {
+        fprintf(stderr, "[REC] pipeline: %s\n", err ? err->message : "unknown error");
+        if (err) g_error_free(err);
+        if (pipeline) gst_object_unref(pipeline);
+        pthread_mutex_unlock(&g_rec_lock);
+        return -1;
+    }
+    GstElement* appsrc = use_appsrc ? gst_bin_get_by_name(GST_BIN(pipeline), "src") : NULL;
+    if (use_appsrc && !appsrc) {
+        gst_object_unref(pipeline);
+        pthread_mutex_unlock(&g_rec_lock);
+        return -1;
+    }
+    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        fprintf(stderr, "[REC] %s: failed to start\n", g_rec_target);
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        if (appsrc) gst_object_unref(appsrc);
+        gst_object_unref(pipeline);
+        pthread_mutex_unlock(&g_rec_lock);
+        return -1;
     }
-    g_rec_pid = pid;
+
+    g_rec_pipeline = pipeline;
+    g_rec_appsrc = appsrc;
+    g_src_w = g_src_h = 0;
+    g_rec_t0 = now_sec();
+    pthread_mutex_unlock(&g_rec_lock);
     return 0;
 }
 
+// 파이프라인을 내림. NULL 전환에서 남은 버퍼가 해제되며 프레임도 camera_release_frame()으로 돌아감
+static void storage_release(GstElement* pipeline, GstElement* appsrc)
+{
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    if (appsrc) gst_object_unref(appsrc);
+    gst_object_unref(pipeline);
+}
+
+// 마무리 중인 파이프라인의 EOS/에러를 최대 timeout_ns 기다림 (0이면 확인만). 끝났거나 제한 시각이 지났으면 내림
+static void storage_reap_finished(GstClockTime timeout_ns)
+{
+    pthread_mutex_lock(&g_rec_lock);
+    GstElement* pipeline = g_fin_pipeline;
+    pthread_mutex_unlock(&g_rec_lock);
+    if (!pipeline) return;
+
+    GstBus* bus = gst_element_get_bus(pipeline);
+    GstMessage* msg = gst_bus_timed_pop_filtered(bus, timeout_ns, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    gst_object_unref(bus);
+    if (!msg) {
+        if (now_sec() < g_fin_deadline) return; // 아직 마무리 중
+        fprintf(stderr, "[REC] %s: EOS timeout, file may be incomplete\n", g_rec_target);
+    } else {
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) fprintf(stderr, "[REC] %s: pipeline error while finishing\n", g_rec_target);
+        gst_message_unref(msg);
+    }
+
+    pthread_mutex_lock(&g_rec_lock);
+    g_fin_pipeline = NULL;
+    pthread_mutex_unlock(&g_rec_lock);
+    storage_release(pipeline, NULL);
+}
+
+/**
+ * @brief 녹화를 멈춥니다. EOS만 보내고 바로 돌아오며, mp4 마무리와 파이프라인 정리는 storage_poll()이 합니다.
+ */
 void storage_stop_recording(void)
 {
-    if (g_rec_pid > 0) {
-        kill(g_rec_pid, SIGINT); // EOS 유도
-        for (int i=0;i<50;i++){ // 5초 대기
-            int st; pid_t r = waitpid(g_rec_pid, &st, WNOHANG);
-            if (r == g_rec_pid) { g_rec_pid = -1; return; }
-            usleep(100*1000);
-        }
-        kill(g_rec_pid, SIGTERM);
-        waitpid(g_rec_pid, NULL, 0);
-        g_rec_pid = -1;
+    pthread_mutex_lock(&g_rec_lock);
+    GstElement* pipeline = g_rec_pipeline;
+    GstElement* appsrc = g_rec_appsrc;
+    g_rec_pipeline = NULL;   // 이후 storage_write_frame()은 -ENODEV
+    g_rec_appsrc = NULL;
+    if (pipeline) {
+        g_fin_pipeline = pipeline;
+        g_fin_deadline = now_sec() + STORAGE_EOS_TIMEOUT_SEC;
+    }
+    pthread_mutex_unlock(&g_rec_lock);
+    if (!pipeline) return;
+
+    // EOS 유도: mp4mux가 moov를 쓰고 나면 EOS가 버스에 옴
+    if (appsrc) {
+        gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+        gst_object_unref(appsrc);
+    } else {
+        gst_element_send_event(pipeline, gst_event_new_eos());
     }
 }
 
-// 현재 구조에선 미지원(별도 프로세스 방식)
-int storage_write_frame(const FrameBuffer* frame) { (void)frame; return -38; }
+/**
+ * @brief 녹화 중이면 멈추고, mp4 마무리가 끝날 때까지(최대 STORAGE_EOS_TIMEOUT_SEC) 기다립니다. 프로세스 종료 때만 호출하세요.
+ */
+void storage_finish(void)
+{
+    storage_stop_recording();
+    while (1) {
+        pthread_mutex_lock(&g_rec_lock);
+        int finishing = (g_fin_pipeline != NULL);
+        double left = g_fin_deadline - now_sec();
+        pthread_mutex_unlock(&g_rec_lock);
+        if (!finishing) return;
+        storage_reap_finished(left > 0.0 ? (GstClockTime)(left * GST_SECOND) : 0);
+    }
+}
+
+/**
+ * @brief 제어 주기에서 호출하세요. 녹화 중 버스 에러(협상 실패, 장치 끊김 등)를 확인하고, 정지 후 마무리 중인 파이프라인을 정리합니다.
+ * @return 0: 녹화 중이 아니거나 정상, -1: 에러로 녹화를 내림 (파일은 마무리되지 않을 수 있음)
+ */
+int storage_poll(void)
+{
+    storage_reap_finished(0);
+
+    pthread_mutex_lock(&g_rec_lock);
+    GstElement* pipeline = g_rec_pipeline;
+    GstMessage* msg = NULL;
+    if (pipeline) {
+        GstBus* bus = gst_element_get_bus(pipeline);
+        msg = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR);
+        gst_object_unref(bus);
+    }
+    GstElement* appsrc = NULL;
+    if (msg) {
+        // 에러 난 파이프라인은 EOS가 오지 않으므로 마무리를 기다리지 않고 바로 내림
+        appsrc = g_rec_appsrc;
+        g_rec_pipeline = NULL;
+        g_rec_appsrc = NULL;
+    }
+    pthread_mutex_unlock(&g_rec_lock);
+    if (!msg) return 0;
+
+    GError* err = NULL;
+    gst_message_parse_error(msg, &err, NULL);
+    fprintf(stderr, "[REC] %s: %s, recording stopped\n", g_rec_target, err ? err->message : "pipeline error");
+    if (err) g_error_free(err);
+    gst_message_unref(msg);
+    storage_release(pipeline, appsrc);
+    return -1;
+}
+
+/**
+ * @brief appsrc 녹화 중이면 프레임을 넣을 주기(설정 fps), 아니면 0 (storage_write_frame을 부를 필요 없음)
+ */
+int storage_frame_fps(void)
+{
+    pthread_mutex_lock(&g_rec_lock);
+    int fps = g_rec_appsrc ? g_rec_fps : 0;
+    pthread_mutex_unlock(&g_rec_lock);
+    return fps;
+}
+
+// 인코더(또는 파이프라인 정리)가 버퍼를 놓을 때: 감싼 프레임 해제
+static void release_wrapped_frame(gpointer data) {
+    camera_release_frame((FrameBuffer*)data);
+    __atomic_fetch_sub(&g_inflight, 1, __ATOMIC_RELAXED);
+}
+
+int storage_write_frame(FrameBuffer* frame)
+{
+    if (!frame || !frame->data || frame->width <= 0 || frame->height <= 0) return -EINVAL;
+    const size_t row = (size_t)frame->width * 3;
+    const size_t stride = (row + 3) & ~(size_t)3;   // GStreamer RGB 기본 stride (4바이트 정렬)
+    if (frame->size < row * (size_t)frame->height) return -EINVAL;
+
+    pthread_mutex_lock(&g_rec_lock);
+    if (!g_rec_appsrc) { pthread_mutex_unlock(&g_rec_lock); return -ENODEV; }
+
+    if (g_src_w == 0) {
+        // 첫 프레임: 캡스 확정
+        char caps_str[128];
+        snprintf(caps_str, sizeof(caps_str), "video/x-raw,format=RGB,width=%d,height=%d,framerate=%d/1",
+                 frame->width, frame->height, g_rec_fps);
+        GstCaps* caps = gst_caps_from_string(caps_str);
+        gst_app_src_set_caps(GST_APP_SRC(g_rec_appsrc), caps);
+        gst_caps_unref(caps);
+        g_src_w = frame->width;
+        g_src_h = frame->height;
+    } else if (frame->width != g_src_w || frame->height != g_src_h) {
+        pthread_mutex_unlock(&g_rec_lock);
+        return -EINVAL;
+    }
+    if (__atomic_load_n(&g_inflight, __ATOMIC_RELAXED) >= STORAGE_MAX_INFLIGHT) {
+        pthread_mutex_unlock(&g_rec_lock);
+        return -EAGAIN;
+    }
+
+    GstBuffer* buf;
+    int owned = 0;
+    if (stride == row) {
+        // 복사 없이 프레임 메모리를 그대로 감쌈, 해제는 release_wrapped_frame()
+        __atomic_fetch_add(&g_inflight, 1, __ATOMIC_RELAXED);
+        buf = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, frame->data, row * (size_t)frame->height,
+                                          0, row * (size_t)frame->height, frame, release_wrapped_frame);
+        owned = 1;
+    } else {
+        // 행 끝 패딩이 필요한 폭: 이때만 복사 (프레임은 바로 해제)
+        buf = gst_buffer_new_allocate(NULL, stride * (size_t)frame->height, NULL);
+        GstMapInfo map;
+        if (!buf || !gst_buffer_map(buf, &map, GST_MAP_WRITE)) {
+            if (buf) gst_buffer_unref(buf);
+            pthread_mutex_unlock(&g_rec_lock);
+            return -EAGAIN;
+        }
+        for (int y = 0; y < frame->height; y++) {
+            memcpy(map.data + stride * (size_t)y, frame->data + row * (size_t)y, row);
+        }
+        gst_buffer_unmap(buf, &map);
+    }
+
+    GstClockTime frame_ns = GST_SECOND / (GstClockTime)g_rec_fps;
+    GST_BUFFER_PTS(buf) = (GstClockTime)((now_sec() - g_rec_t0) * GST_SECOND);
+    GST_BUFFER_DURATION(buf) = frame_ns;
+
+    // push_buffer는 buf의 참조를 가져감 (실패해도 해제되며, 감싼 프레임은 release_wrapped_frame으로 해제)
+    GstFlowReturn ret = gst_app_src_push_buffer(GST_APP_SRC(g_rec_appsrc), buf);
+    pthread_mutex_unlock(&g_rec_lock);
+
+    if (!owned) camera_release_frame(frame);
+    return (ret == GST_FLOW_OK) ? 0 : -EPIPE;
+}
@@ -0,0 +1,272 @@
+/**
+ * @file tracker.c
+ * @brief 다중 객체 추적: 차량 이동 보상 + 공간 해시 게이팅 + 탐욕적 짝짓기 + 축별 칼만 필터.
+ * @details
+ * AI 결과는 사이클마다 새 배열로 오므로, 한 번 나왔다 사라지는 오탐과 계속 다가오는 보행자를 구분할 수 없었습니다.
+ * 사이클마다 다음 순서로 갱신합니다.
+ *
+ * 1. 예측: 트랙을 지난 촬영 이후 dt만큼 등속으로 옮기고, 그동안 차량이 원호를 따라 움직이고 돈 만큼
+ *    새 촬영 시각의 차량 좌표계로 바꿉니다. 두 축의 공분산이 같으므로 회전해도 공분산은 그대로입니다.
+ * 2. 후보: 탐지를 TRK_GATE_M 크기 격자의 해시 버킷에 넣고, 트랙마다 예측 위치 주변 3x3칸의 탐지만 거리를 봅니다.
+ *    객체가 고르게 흩어져 있으면 후보 쌍 수는 트랙 수에 비례합니다 (모든 쌍을 보는 O(트랙 x 탐지)를 피함).
+ * 3. 짝짓기: 게이트 안의 쌍을 비용(거리^2, 라벨이 다르면 가산) 순으로 정렬해 두 쪽 다 비어 있는 쌍부터 정합니다.
+ *    헝가리안보다 최적은 아니지만, 게이트가 객체 간격보다 좁아 실제로 경합하는 쌍이 드물고 비용이 정렬 한 번입니다.
+ * 4. 갱신: 짝지어진 트랙은 위치와 AI 속도로 칼만 갱신, 놓친 트랙은 예측 위치로 유지하다 삭제, 남은 탐지는 새 트랙이 됩니다.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "hardware.h"
+
+#define TRK_HASH_SIZE (1 << TRK_HASH_BITS)
+
+int tracker_init(Tracker* trk) {
+    if (!trk) return -1;
+    memset(trk, 0, sizeof(*trk));
+    trk->next_id = 1;
+    return 0;
+}
+
+void tracker_reset(Tracker* trk) {
+    if (!trk) return;
+    trk->dropped += (unsigned long)trk->count;
+    trk->count = 0;
+    trk->out_count = 0;
+    trk->last_time = 0.0;
+}
+
+void tracker_free(Tracker* trk) {
+    if (!trk) return;
+    free(trk->det_next);
+    free(trk->det_used);
+    free(trk->pairs);
+    memset(trk, 0, sizeof(*trk));
+}
+
+static int trk_reserve_dets(Tracker* trk, int n) {
+    if (n <= trk->det_cap) return 0;
+    int cap = trk->det_cap > 0 ? trk->det_cap : 64;
+    while (cap < n) cap *= 2;
+    int* next = realloc(trk->det_next, sizeof(int) * (size_t)cap);
+    if (!next) return -1;
+    trk->det_next = next;
+    unsigned char* used = realloc(trk->det_used, (size_t)cap);
+    if (!used) return -1;
+    trk->det_used = used;
+    trk->det_cap = cap;
+    return 0;
+}
+
+static int trk_push_pair(Tracker* trk, int* count, float cost, int track, int det) {
+    if (*count >= trk->pair_cap) {
+        int cap = trk->pair_cap > 0 ? trk->pair_cap * 2 : 256;
+        TrkPair* pairs = realloc(trk->pairs, sizeof(TrkPair) * (size_t)cap);
+        if (!pairs) return -1;
+        trk->pairs = pairs;
+        trk->pair_cap = cap;
+    }
+    trk->pairs[*count].cost = cost;
+    trk->pairs[*count].track = track;
+    trk->pairs[*count].det = det;
+    (*count)++;
+    return 0;
+}
+
+static int pair_cmp(const void* a, const void* b) {
+    const TrkPair* p = a;
+    const TrkPair* q = b;
+    if (p->cost != q->cost) return (p->cost < q->cost) ? -1 : 1;
+    if (p->track != q->track) return p->track - q->track;
+    return p->det - q->det;
+}
+
+static inline int trk_cell(double v) {
+    return (int)floor(v * (1.0 / TRK_GATE_M));
+}
+
+static inline unsigned int trk_hash(int cx, int cy) {
+    return ((unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u) & (TRK_HASH_SIZE - 1);
+}
+
+// 등속 예측 (공분산: 백색 가속도 잡음)
+static void trk_predict(Track* tr, double dt) {
+    double q = TRK_ACCEL_SIGMA * TRK_ACCEL_SIGMA;
+    double dt2 = dt * dt;
+    tr->x += tr->vx * dt;
+    tr->y += tr->vy * dt;
+    tr->p_pp += 2.0 * dt * tr->p_pv + dt2 * tr->p_vv + q * dt2 * dt2 * 0.25;
+    tr->p_pv += dt * tr->p_vv + q * dt2 * dt * 0.5;
+    tr->p_vv += q * dt2;
+}
+
+// 측정 z = [위치, 속도] (H = I)로 칼만 갱신, 이득은 두 축이 같음
+static void trk_correct(Track* tr, const DetectedObject* d) {
+    double a = tr->p_pp + TRK_POS_SIGMA * TRK_POS_SIGMA;
+    double b = tr->p_pv;
+    double c = tr->p_vv + TRK_VEL_SIGMA * TRK_VEL_SIGMA;
+    double inv = 1.0 / (a * c - b * b);
+    double k00 = (tr->p_pp * c - tr->p_pv * b) * inv;
+    double k01 = (tr->p_pv * a - tr->p_pp * b) * inv;
+    double k10 = (tr->p_pv * c - tr->p_vv * b) * inv;
+    double k11 = (tr->p_vv * a - tr->p_pv * b) * inv;
+
+    double ex = d->x - tr->x, evx = d->ax - tr->vx;
+    double ey = d->y - tr->y, evy = d->ay - tr->vy;
+    tr->x += k00 * ex + k01 * evx;
+    tr->vx += k10 * ex + k11 * evx;
+    tr->y += k00 * ey + k01 * evy;
+    tr->vy += k10 * ey + k11 * evy;
+
+    double pp = tr->p_pp - (k00 * tr->p_pp + k01 * tr->p_pv);
+    double pv = tr->p_pv - (k00 * tr->p_pv + k01 * tr->p_vv);
+    double vv = tr->p_vv - (k10 * tr->p_pv + k11 * tr->p_vv);
+    tr->p_pp = pp;
+    tr->p_pv = pv;
+    tr->p_vv = vv;
+}
+
+static void trk_spawn(Tracker* trk, const DetectedObject* d, double t) {
+    if (trk->count >= TRK_MAX_TRACKS) return;
+    Track* tr = &trk->tracks[trk->count++];
+    memset(tr, 0, sizeof(*tr));
+    tr->id = trk->next_id++;
+    if (trk->next_id == 0) trk->next_id = 1;
+    tr->label = d->label;
+    tr->score = d->score;
+    tr->x = d->x;
+    tr->y = d->y;
+    tr->vx = d->ax;
+    tr->vy = d->ay;
+    tr->p_pp = TRK_POS_SIGMA * TRK_POS_SIGMA;
+    tr->p_vv = TRK_VEL_SIGMA * TRK_VEL_SIGMA;
+    tr->hits = 1;
+    tr->confirmed = (d->score >= TRK_CONFIRM_SCORE || TRK_CONFIRM_HITS <= 1);
+    tr->first_seen = t;
+    trk->created++;
+}
+
+/**
+ * @brief 촬영 시각 t의 탐지로 트랙을 갱신하고 확정 트랙을 trk->out에 채웁니다.
+ * @param ego_v, ego_omega 촬영 시각의 차량 속도(m/s)와 요 각속도(rad/s): 지난 촬영 이후 차량 이동 보상에 씀
+ * @return 확정 트랙 수, 인자가 잘못됐거나 메모리가 모자라면 -1 (트랙은 그대로)
+ */
+int tracker_update(Tracker* trk, const DetectedObject* dets, int n, double t, double ego_v, double ego_omega) {
+    if (!trk || n < 0 || (n > 0 && !dets)) return -1;
+    if (trk_reserve_dets(trk, n) < 0) return -1;
+
+    double dt = (trk->last_time > 0.0) ? t - trk->last_time : 0.0;
+    if (dt > TRK_RESET_SEC) {
+        tracker_reset(trk);
+        dt = 0.0;
+    }
+    if (dt < 0.0) dt = 0.0;    // 순서가 바뀐 결과: 같은 시각으로 봄
+    trk->last_time = t;
+
+    // 1. 예측 + 차량 이동 보상: 새 좌표 = Rot(-dth) * (옛 좌표 - 차량 이동량)
+    double dth = ego_omega * dt;
+    double mx, my;
+    if (ego_omega != 0.0) {
+        double R = ego_v / ego_omega;
+        mx = R * sin(dth);
+        my = R * (1.0 - cos(dth));
+    } else {
+        mx = ego_v * dt;
+        my = 0.0;
+    }
+    double c = cos(dth), s = sin(dth);
+    for (int i = 0; i < trk->count; i++) {
+        Track* tr = &trk->tracks[i];
+        trk_predict(tr, dt);
+        double px = tr->x - mx, py = tr->y - my;
+        tr->x = c * px + s * py;
+        tr->y = -s * px + c * py;
+        double vx = tr->vx, vy = tr->vy;
+        tr->vx = c * vx + s * vy;
+        tr->vy = -s * vx + c * vy;
+    }
+
+    // 2. 탐지를 공간 해시에 넣고 트랙마다 주변 3x3칸의 후보 쌍 수집
+    for (int b = 0; b < TRK_HASH_SIZE; b++) trk->hash_head[b] = -1;
+    for (int j = 0; j < n; j++) {
+        unsigned int h = trk_hash(trk_cell(dets[j].x), trk_cell(dets[j].y));
+        trk->det_next[j] = trk->hash_head[h];
+        trk->hash_head[h] = j;
+        trk->det_used[j] = 0;
+    }
+
+    const double gate2 = TRK_GATE_M * TRK_GATE_M;
+    int pair_count = 0;
+    for (int i = 0; i < trk->count; i++) {
+        const Track* tr = &trk->tracks[i];
+        int tcx = trk_cell(tr->x), tcy = trk_cell(tr->y);
+        for (int cy = tcy - 1; cy <= tcy + 1; cy++) {
+            for (int cx = tcx - 1; cx <= tcx + 1; cx++) {
+                for (int j = trk->hash_head[trk_hash(cx, cy)]; j >= 0; j = trk->det_next[j]) {
+                    const DetectedObject* d = &dets[j];
+                    if (trk_cell(d->x) != cx || trk_cell(d->y) != cy) continue; // 해시 충돌로 섞인 다른 칸
+                    double ex = d->x - tr->x, ey = d->y - tr->y;
+                    double d2 = ex * ex + ey * ey;
+                    if (d2 > gate2) continue;
+                    if (d->label != tr->label) d2 += TRK_LABEL_PENALTY_M2;
+                    if (trk_push_pair(trk, &pair_count, (float)d2, i, j) < 0) return -1;
+                }
+            }
+        }
+    }
+
+    // 3. 비용 순 탐욕적 짝짓기 + 4. 갱신
+    qsort(trk->pairs, (size_t)pair_count, sizeof(TrkPair), pair_cmp);
+    for (int i = 0; i < trk->count; i++) trk->tracks[i].misses++;   // 짝지어지면 0으로 되돌림
+    for (int k = 0; k < pair_count; k++) {
+        const TrkPair* p = &trk->pairs[k];
+        Track* tr = &trk->tracks[p->track];
+        if (trk->det_used[p->det] || tr->misses == 0) continue;
+        trk->det_used[p->det] = 1;
+
+        const DetectedObject* d = &dets[p->det];
+        trk_correct(tr, d);
+        tr->label = d->label;
+        tr->score = d->score;
+        tr->misses = 0;
+        tr->hits++;
+        if (tr->hits >= TRK_CONFIRM_HITS) tr->confirmed = 1;
+    }
+
+    // 놓친 트랙: 미확정이면 바로, 확정이면 TRK_MAX_MISSES번 넘게 놓쳤을 때 삭제
+    // (새 트랙보다 먼저 지워서 자리가 모자라지 않게 함)
+    int w = 0;
+    for (int i = 0; i < trk->count; i++) {
+        Track* tr = &trk->tracks[i];
+        tr->age++;
+        if (tr->misses > 0) tr->hits = 0;
+        if (tr->misses > 0 && (!tr->confirmed || tr->misses > TRK_MAX_MISSES)) {
+            trk->dropped++;
+            continue;
+        }
+        if (w != i) trk->tracks[w] = *tr;
+        w++;
+    }
+    trk->count = w;
+    // 남은 탐지는 새 트랙
+    for (int j = 0; j < n; j++) {
+        if (!trk->det_used[j]) trk_spawn(trk, &dets[j], t);
+    }
+
+    // 확정 트랙 내보내기 (위험 평가는 DetectedObject 배열을 그대로 받음)
+    trk->out_count = 0;
+    for (int i = 0; i < trk->count; i++) {
+        const Track* tr = &trk->tracks[i];
+        if (!tr->confirmed) continue;
+        DetectedObject* o = &trk->out[trk->out_count];
+        o->label = tr->label;
+        o->x = (float)tr->x;
+        o->y = (float)tr->y;
+        o->ax = (float)tr->vx;
+        o->ay = (float)tr->vy;
+        o->score = tr->score;
+        trk->out_id[trk->out_count++] = tr->id;
+    }
+    return trk->out_count;
+}
@@ -0,0 +1,504 @@
+/**
+ * @file ecu_sim.c
+ * @brief vcan 인터페이스에서 동작하는 가상 ECU(OBD-II 응답기) + 버스 부하 발생기.
+ * @details
+ * 아두이노 ECU 에뮬레이터(carla-client-hostpc/CAN_FINAL.ino)와 같은 PID/값 인코딩으로 0x7DF 요청에 0x7E8로 응답합니다.
+ * 보드 없이 리눅스 PC 한 대에서 can.c의 수신 경로와 main.c의 폴링 로직을 측정하기 위한 도구입니다.
+ * - 단일 PID 요청: 단일 프레임 응답 (아두이노와 동일)
+ * - 멀티 PID 요청: 응답이 7바이트를 넘으면 ISO-TP 첫 프레임을 보내고, 흐름 제어(0x7E0)를 받은 뒤 연속 프레임 전송
+ * - 응답 지연/지터, 요청 손실률, 배경 버스 부하(비트레이트 대비 %, 100이면 포화)를 옵션으로 조절
+ *
+ * vcan 준비:
+ *   sudo modprobe vcan
+ *   sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+ * 실행 예:
+ *   ./build/bin/ecu_sim -i vcan0 -d 5 -j 2 -l 1 -b 60
+ *   ./build/bin/blackbox_main vcan0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#include "hardware.h"
+
+#define SIM_REQ_FUNCTIONAL_ID   0x7DF  // 기능 주소 요청 (전체 ECU)
+#define SIM_REQ_PHYSICAL_ID     0x7E0  // 물리 주소 요청 / 흐름 제어 수신 ID
+#define SIM_RES_ID              0x7E8  // 응답 ID
+
+#define SIM_MAX_PENDING         64     // 지연 전송 대기 중인 응답 최대 수
+#define SIM_FC_TIMEOUT_SEC      1.0    // 첫 프레임 후 흐름 제어 대기 제한 (ISO-TP N_Bs)
+#define SIM_LOAD_TICK_SEC       0.001  // 배경 부하 프레임 전송 주기
+#define SIM_BITS_PER_FRAME      125.0  // 8바이트 표준 프레임 + 평균 비트 스터핑
+#define SIM_STATS_INTERVAL_SEC  1.0
+
+// 지연 전송 대기 중인 응답 하나 (SID 0x41부터 시작하는 ISO-TP 페이로드)
+typedef struct {
+    double due;
+    unsigned char data[ISOTP_MAX_PAYLOAD];
+    int len;
+} PendingReply;
+
+// 멀티 프레임 응답 송신 상태 (한 번에 하나만 진행)
+typedef struct {
+    int active;
+    int waiting_fc;           // 1: 흐름 제어 대기 중
+    double fc_deadline;
+    double next_cf_at;        // 다음 연속 프레임 전송 가능 시각 (STmin 반영)
+    double st_min;            // 연속 프레임 최소 간격(초)
+    int block_size;           // 흐름 제어 한 번에 보낼 연속 프레임 수 (0 = 제한 없음)
+    int block_sent;
+    unsigned char sn;         // 연속 프레임 순번
+    int offset;
+    PendingReply reply;
+} IsoTpTx;
+
+typedef struct {
+    const char* ifname;
+    double latency;           // 응답 지연(초)
+    double jitter;            // 응답 지연 지터(초, ±)
+    double loss;              // 요청 무시 확률 (0~1)
+    double load;              // 배경 버스 부하 (0~1)
+    int bitrate;
+    int single_pid;           // 1: 아두이노처럼 첫 PID 하나만 응답
+    int verbose;
+} SimConfig;
+
+// 가상 차량 상태 (원 궤도를 도는 차량)
+typedef struct {
+    double speed_kph;
+    double rpm;
+    double x, y;              // GPS (m)
+    double heading;           // rad
+    double steer_deg;
+    int brake, throttle;
+    unsigned char tire[4];
+    double last_update;
+} SimVehicle;
+
+typedef struct {
+    unsigned long requests, replies, dropped, fc_timeouts;
+    unsigned long load_sent, load_blocked;
+} SimStats;
+
+static volatile sig_atomic_t s_running = 1;
+
+static void on_signal(int sig) {
+    (void)sig;
+    s_running = 0;
+}
+
+static double frand(void) {
+    return (double)rand() / (double)RAND_MAX;
+}
+
+static unsigned char clamp_0_99(int v) {
+    if (v < 0) return 0;
+    if (v > 99) return 99;
+    return (unsigned char)v;
+}
+
+// --- 가상 차량 ---
+
+static void vehicle_init(SimVehicle* v, double now) {
+    memset(v, 0, sizeof(*v));
+    v->x = 10.0;
+    v->y = 10.0;
+    for (int i = 0; i < 4; i++) v->tire[i] = 35;
+    v->last_update = now;
+}
+
+// 속도는 천천히 오르내리고, 조향은 사인파로 움직이며, GPS는 자전거 모델로 적분
+static void vehicle_update(SimVehicle* v, double now) {
+    double dt = now - v->last_update;
+    if (dt <= 0.0) return;
+    v->last_update = now;
+
+    double prev = v->speed_kph;
+    v->speed_kph = 40.0 + 20.0 * sin(now * 0.2);
+    v->rpm = 800.0 + v->speed_kph * 40.0;
+    v->steer_deg = 30.0 * sin(now * 0.5);
+    v->throttle = (v->speed_kph > prev) ? (int)(20.0 + (v->speed_kph - prev) / dt * 10.0) : 0;
+    v->brake = (v->speed_kph < prev) ? (int)((prev - v->speed_kph) / dt * 10.0) : 0;
+    if (v->throttle > 100) v->throttle = 100;
+    if (v->brake > 100) v->brake = 100;
+
+    double mps = v->speed_kph * KPH_TO_MPS;
+    v->heading += mps / VEHICLE_WHEELBASE * tan(v->steer_deg * M_PI / 180.0 / 15.0) * dt;
+    v->x += mps * cos(v->heading) * dt;
+    v->y += mps * sin(v->heading) * dt;
+    // GPS 인코딩 정수부가 1바이트(0~255)이므로 그 범위 안에서 감싸기
+    v->x = fmod(v->x + 255.0, 510.0) - 255.0;
+    v->y = fmod(v->y + 255.0, 510.0) - 255.0;
+}
+
+// 아두이노 encode_SI_D2D4D6와 같은 부호/정수/소수 2자리씩 인코딩
+static void encode_gps(double meters, unsigned char out[5]) {
+    double a = fabs(meters);
+    unsigned char ip = (a >= 255.0) ? 255 : (unsigned char)floor(a);
+    long frac6 = lround((a - ip) * 1000000.0);
+    if (frac6 > 999999) frac6 = 999999;
+    out[0] = (meters >= 0.0) ? 1 : 0;
+    out[1] = ip;
+    out[2] = clamp_0_99((int)((frac6 / 10000) % 100));
+    out[3] = clamp_0_99((int)((frac6 / 100) % 100));
+    out[4] = clamp_0_99((int)(frac6 % 100));
+}
+
+/**
+ * @brief PID 값 바이트를 out에 채웁니다. (can.c apply_pid_value와 같은 형식)
+ * @return 값 길이, 지원하지 않는 PID면 0.
+ */
+static int encode_pid(const SimVehicle* v, unsigned char pid, unsigned char* out) {
+    switch (pid) {
+        case PID_VEHICLE_SPEED:
+            out[0] = (unsigned char)v->speed_kph;
+            return 1;
+        case PID_ENGINE_SPEED: {
+            unsigned int rpm4 = (unsigned int)(v->rpm * 4.0);
+            out[0] = (unsigned char)(rpm4 >> 8);
+            out[1] = (unsigned char)rpm4;
+            return 2;
+        }
+        case PID_GEAR_STATE: {
+            unsigned int ratio = 3500;      // 기어비 x1000
+            out[0] = (unsigned char)(ratio >> 8);
+            out[1] = (unsigned char)ratio;
+            out[2] = 0x01 << 4;            // D
+            return 3;
+        }
+        case PID_GPS_XDATA:
+            encode_gps(v->x, out);
+            return 5;
+        case PID_GPS_YDATA:
+            encode_gps(v->y, out);
+            return 5;
+        case PID_STEERING_DATA: {
+            double a = fabs(v->steer_deg);
+            int centi = (int)lround(a * 100.0);
+            out[0] = (v->steer_deg >= 0.0) ? 1 : 0;
+            out[1] = (unsigned char)(centi / 100);
+            out[2] = clamp_0_99(centi % 100);
+            return 3;
+        }
+        case PID_BRAKE_DATA:
+            out[0] = (unsigned char)v->brake;
+            return 1;
+        case PID_THROTTLE_DATA:
+            out[0] = (unsigned char)v->throttle;
+            return 1;
+        case PID_TIRE_DATA:
+            memcpy(out, v->tire, 4);
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+// --- CAN 송수신 ---
+
+static int sim_can_open(const char* ifname) {
+    int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (fd < 0) {
+        perror("socket error");
+        return -1;
+    }
+    struct sockaddr_can addr = {0};
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = (int)if_nametoindex(ifname);
+    if (addr.can_ifindex == 0) {
+        perror("if_nametoindex error");
+        close(fd);
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind error");
+        close(fd);
+        return -1;
+    }
+    // 요청(0x7DF)과 물리 요청/흐름 제어(0x7E0)만 받음 → 배경 부하 프레임에 깨어나지 않음
+    struct can_filter filters[2] = {
+        { SIM_REQ_FUNCTIONAL_ID, CAN_SFF_MASK },
+        { SIM_REQ_PHYSICAL_ID,   CAN_SFF_MASK },
+    };
+    setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, filters, sizeof(filters));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+static int send_frame(int fd, canid_t id, const unsigned char* data) {
+    struct can_frame f = {0};
+    f.can_id = id;
+    f.can_dlc = 8;
+    memcpy(f.data, data, 8);
+    return (write(fd, &f, sizeof(f)) == (ssize_t)sizeof(f)) ? 0 : -1;
+}
+
+// --- 응답 큐 ---
+
+static PendingReply s_pending[SIM_MAX_PENDING];
+static int s_pending_count = 0;
+static IsoTpTx s_tx;
+
+static void queue_reply(const SimConfig* cfg, const unsigned char* data, int len, double now) {
+    if (s_pending_count >= SIM_MAX_PENDING) return;
+    PendingReply* r = &s_pending[s_pending_count++];
+    double delay = cfg->latency + cfg->jitter * (2.0 * frand() - 1.0);
+    r->due = now + (delay > 0.0 ? delay : 0.0);
+    memcpy(r->data, data, len);
+    r->len = len;
+}
+
+// 서비스 01 요청 하나를 처리해서 응답을 예약
+static void handle_request(const SimConfig* cfg, SimVehicle* v, SimStats* st,
+                           const struct can_frame* f, double now) {
+    int len = f->data[0] & 0x0F;
+    if ((f->data[0] >> 4) != 0 || len < 2 || len > 7 || f->data[1] != 0x01) return;
+    st->requests++;
+
+    if (cfg->loss > 0.0 && frand() < cfg->loss) {
+        st->dropped++;
+        return;
+    }
+
+    vehicle_update(v, now);
+
+    unsigned char out[ISOTP_MAX_PAYLOAD];
+    int n = 0;
+    out[n++] = 0x41;
+    int npids = cfg->single_pid ? 1 : len - 1;
+    for (int i = 0; i < npids; i++) {
+        unsigned char pid = f->data[2 + i];
+        unsigned char val[8];
+        int vlen = encode_pid(v, pid, val);
+        if (vlen == 0 || n + 1 + vlen > ISOTP_MAX_PAYLOAD) continue;
+        out[n++] = pid;
+        memcpy(&out[n], val, vlen);
+        n += vlen;
+    }
+    if (n > 1) queue_reply(cfg, out, n, now);
+}
+
+// 흐름 제어 프레임 처리 (0x30: 계속, 0x31: 대기, 0x32: 오버플로)
+static void handle_flow_control(const struct can_frame* f, double now) {
+    if (!s_tx.active || !s_tx.waiting_fc) return;
+    unsigned char fs = f->data[0] & 0x0F;
+
+    if (fs == 0x01) {
+        s_tx.fc_deadline = now + SIM_FC_TIMEOUT_SEC;
+        return;
+    }
+    if (fs != 0x00) {
+        s_tx.active = 0;
+        return;
+    }
+    s_tx.block_size = f->data[1];
+    s_tx.block_sent = 0;
+    unsigned char stmin = f->data[2];
+    if (stmin <= 0x7F)                       s_tx.st_min = stmin / 1000.0;
+    else if (stmin >= 0xF1 && stmin <= 0xF9) s_tx.st_min = (stmin - 0xF0) / 10000.0;
+    else                                     s_tx.st_min = 0.127;
+    s_tx.waiting_fc = 0;
+    s_tx.next_cf_at = now;
+}
+
+// 예약된 응답 중 시간이 된 것을 보내고, 진행 중인 멀티 프레임 응답을 이어서 전송
+static void service_replies(int fd, SimStats* st, double now) {
+    // 1) 진행 중인 멀티 프레임 응답
+    if (s_tx.active) {
+        if (s_tx.waiting_fc) {
+            if (now >= s_tx.fc_deadline) {
+                st->fc_timeouts++;
+                s_tx.active = 0;
+            }
+        } else {
+            while (s_tx.offset < s_tx.reply.len && now >= s_tx.next_cf_at) {
+                unsigned char d[8];
+                memset(d, 0xAA, sizeof(d));
+                int chunk = s_tx.reply.len - s_tx.offset;
+                if (chunk > 7) chunk = 7;
+                d[0] = 0x20 | (s_tx.sn & 0x0F);
+                memcpy(&d[1], &s_tx.reply.data[s_tx.offset], chunk);
+                if (send_frame(fd, SIM_RES_ID, d) < 0) break;
+                s_tx.offset += chunk;
+                s_tx.sn++;
+                s_tx.next_cf_at = now + s_tx.st_min;
+                if (s_tx.block_size > 0 && ++s_tx.block_sent >= s_tx.block_size && s_tx.offset < s_tx.reply.len) {
+                    s_tx.waiting_fc = 1;
+                    s_tx.fc_deadline = now + SIM_FC_TIMEOUT_SEC;
+                    break;
+                }
+                if (s_tx.st_min > 0.0) break;
+            }
+            if (s_tx.offset >= s_tx.reply.len) {
+                s_tx.active = 0;
+                st->replies++;
+            }
+        }
+        if (s_tx.active) return; // 멀티 프레임 전송 중에는 다른 응답을 끼워 넣지 않음
+    }
+
+    // 2) 예약 순서대로 시간이 된 응답 전송
+    while (s_pending_count > 0 && now >= s_pending[0].due) {
+        PendingReply* r = &s_pending[0];
+        unsigned char d[8];
+        memset(d, 0xAA, sizeof(d));
+
+        if (r->len <= 7) {
+            d[0] = (unsigned char)r->len;
+            memcpy(&d[1], r->data, r->len);
+            if (send_frame(fd, SIM_RES_ID, d) < 0) return;
+            st->replies++;
+        } else {
+            d[0] = 0x10 | ((r->len >> 8) & 0x0F);
+            d[1] = (unsigned char)r->len;
+            memcpy(&d[2], r->data, 6);
+            if (send_frame(fd, SIM_RES_ID, d) < 0) return;
+            memset(&s_tx, 0, sizeof(s_tx));
+            s_tx.active = 1;
+            s_tx.waiting_fc = 1;
+            s_tx.fc_deadline = now + SIM_FC_TIMEOUT_SEC;
+            s_tx.sn = 1;
+            s_tx.offset = 6;
+            s_tx.reply = *r;
+        }
+        memmove(&s_pending[0], &s_pending[1], sizeof(PendingReply) * (s_pending_count - 1));
+        s_pending_count--;
+        if (s_tx.active) return;
+    }
+}
+
+// 목표 부하율에 맞춰 밀린 만큼 배경 프레임을 전송 (진단 ID 영역 0x7xx는 피함)
+static void service_load(int fd, const SimConfig* cfg, SimStats* st, double* owed, double* last, double now) {
+    if (cfg->load <= 0.0) return;
+    double fps = cfg->load * cfg->bitrate / SIM_BITS_PER_FRAME;
+    *owed += fps * (now - *last);
+    *last = now;
+    // 오래 막혀 있었더라도 한 번에 최대 1초 분량만 따라잡음
+    if (*owed > fps) *owed = fps;
+
+    while (*owed >= 1.0) {
+        unsigned char d[8];
+        for (int i = 0; i < 8; i++) d[i] = (unsigned char)rand();
+        canid_t id = 0x100 + (canid_t)(rand() % 0x600);
+        if (send_frame(fd, id, d) < 0) {
+            st->load_blocked++; // 송신 큐 포화 = 버스 포화
+            break;
+        }
+        st->load_sent++;
+        *owed -= 1.0;
+    }
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-i iface] [-d latency_ms] [-j jitter_ms] [-l loss_pct] [-b load_pct] [-r bitrate] [-s] [-v]\n"
+            "  -i  CAN 인터페이스 (기본 vcan0)\n"
+            "  -d  응답 지연 ms (기본 2)\n"
+            "  -j  응답 지연 지터 ±ms (기본 0)\n"
+            "  -l  요청 손실률 %% (기본 0)\n"
+            "  -b  배경 버스 부하 %% (0~100, 100=포화)\n"
+            "  -r  부하 계산용 비트레이트 (기본 500000)\n"
+            "  -s  멀티 PID 요청에도 첫 PID만 응답 (아두이노 동작)\n"
+            "  -v  1초마다 통계 출력\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    SimConfig cfg = { "vcan0", 0.002, 0.0, 0.0, 0.0, 500000, 0, 0 };
+    int opt;
+    while ((opt = getopt(argc, argv, "i:d:j:l:b:r:svh")) != -1) {
+        switch (opt) {
+            case 'i': cfg.ifname = optarg; break;
+            case 'd': cfg.latency = atof(optarg) / 1000.0; break;
+            case 'j': cfg.jitter = atof(optarg) / 1000.0; break;
+            case 'l': cfg.loss = atof(optarg) / 100.0; break;
+            case 'b': cfg.load = atof(optarg) / 100.0; break;
+            case 'r': cfg.bitrate = atoi(optarg); break;
+            case 's': cfg.single_pid = 1; break;
+            case 'v': cfg.verbose = 1; break;
+            default: usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (cfg.load > 1.0) cfg.load = 1.0;
+    if (cfg.bitrate <= 0) cfg.bitrate = 500000;
+
+    int fd = sim_can_open(cfg.ifname);
+    if (fd < 0) {
+        fprintf(stderr, "[SIM] FATAL: cannot open %s (vcan 생성 여부 확인)\n", cfg.ifname);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    srand((unsigned int)time(NULL));
+
+    SimVehicle vehicle;
+    SimStats stats = {0};
+    double now = now_sec();
+    vehicle_init(&vehicle, now);
+    double load_owed = 0.0, load_last = now;
+    double next_stats = now + SIM_STATS_INTERVAL_SEC;
+
+    printf("[SIM] ECU on %s: latency=%.1fms jitter=%.1fms loss=%.1f%% load=%.0f%% @%d bps\n",
+           cfg.ifname, cfg.latency * 1000.0, cfg.jitter * 1000.0, cfg.loss * 100.0, cfg.load * 100.0, cfg.bitrate);
+
+    while (s_running) {
+        // 다음 할 일(응답 예약 시각, 연속 프레임, 부하 틱)까지만 대기
+        now = now_sec();
+        double wake = next_stats;
+        if (s_pending_count > 0 && s_pending[0].due < wake) wake = s_pending[0].due;
+        if (s_tx.active && !s_tx.waiting_fc && s_tx.next_cf_at < wake) wake = s_tx.next_cf_at;
+        if (s_tx.active && s_tx.waiting_fc && s_tx.fc_deadline < wake) wake = s_tx.fc_deadline;
+        if (cfg.load > 0.0 && now + SIM_LOAD_TICK_SEC < wake) wake = now + SIM_LOAD_TICK_SEC;
+        int timeout_ms = (wake > now) ? (int)ceil((wake - now) * 1000.0) : 0;
+
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int r = poll(&pfd, 1, timeout_ms);
+        if (r < 0 && errno != EINTR) {
+            perror("poll error");
+            break;
+        }
+
+        now = now_sec();
+        if (r > 0 && (pfd.revents & POLLIN)) {
+            struct can_frame f;
+            while (read(fd, &f, sizeof(f)) == (ssize_t)sizeof(f)) {
+                canid_t id = f.can_id & CAN_SFF_MASK;
+                if (id == SIM_REQ_PHYSICAL_ID && (f.data[0] >> 4) == 0x03) {
+                    handle_flow_control(&f, now);
+                } else if (id == SIM_REQ_FUNCTIONAL_ID || id == SIM_REQ_PHYSICAL_ID) {
+                    handle_request(&cfg, &vehicle, &stats, &f, now);
+                }
+            }
+        }
+
+        service_replies(fd, &stats, now);
+        service_load(fd, &cfg, &stats, &load_owed, &load_last, now);
+
+        if (now >= next_stats) {
+            if (cfg.verbose) {
+                printf("[SIM] req=%lu rep=%lu drop=%lu fc_to=%lu load=%lu blocked=%lu pending=%d\n",
+                       stats.requests, stats.replies, stats.dropped, stats.fc_timeouts,
+                       stats.load_sent, stats.load_blocked, s_pending_count);
+            }
+            next_stats = now + SIM_STATS_INTERVAL_SEC;
+        }
+    }
+
+    printf("[SIM] exit: req=%lu rep=%lu drop=%lu fc_to=%lu load=%lu blocked=%lu\n",
+           stats.requests, stats.replies, stats.dropped, stats.fc_timeouts,
+           stats.load_sent, stats.load_blocked);
+    close(fd);
+    return EXIT_SUCCESS;
+}